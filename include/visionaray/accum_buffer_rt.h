@@ -0,0 +1,95 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_ACCUM_BUFFER_RT_H
+#define VSNRAY_ACCUM_BUFFER_RT_H 1
+
+#include "detail/thread_pool.h"
+#include "aligned_vector.h"
+#include "pixel_traits.h"
+#include "render_target.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Render target for progressive rendering
+//
+// Wraps another host render target (e.g. cpu_buffer_rt or simple_buffer_rt). Kernels
+// render and blend into a 32-bit floating point accumulation buffer. The accumulated
+// color is converted to the color format of the wrapped render target once per frame,
+// in end_frame(). Depth and AOVs are written directly to the wrapped render target.
+//
+// If the wrapped render target uses tile-major storage (RT_TILED), the accumulation
+// buffer is also stored tile-major while rendering. Set the layout on target() and
+// clear the color buffer afterwards.
+//
+// end_frame() resolves the accumulation buffer on the threads of the pool passed to the
+// constructor, or in the calling thread if there is none. The pool must outlive the
+// render target.
+//
+
+template <typename RT>
+class accum_buffer_rt : public render_target
+{
+public:
+
+    using color_type    = typename RT::color_type;
+    using depth_type    = typename RT::depth_type;
+    using accum_type    = typename pixel_traits<PF_RGBA32F>::type;
+
+    using ref_type      = render_target_tiled_ref<PF_RGBA32F, RT::ref_type::depth_format>;
+
+public:
+
+    explicit accum_buffer_rt(thread_pool* pool = nullptr);
+
+    color_type* color();
+    depth_type* depth();
+    accum_type* accum();
+
+    color_type const* color() const;
+    depth_type const* depth() const;
+    accum_type const* accum() const;
+
+    // AOV layers of the wrapped render target
+    aov_buffer& aovs();
+    aov_buffer const& aovs() const;
+
+    ref_type ref();
+
+    void clear_color_buffer(vec4 const& color = vec4(0.0f));
+    void clear_depth_buffer(float depth = 1.0f);
+    void begin_frame();
+    void end_frame();
+    void resize(int w, int h);
+    void display_color_buffer() const;
+
+    // Access the wrapped render target
+    RT& target();
+    RT const& target() const;
+
+private:
+
+    RT rt_;
+
+    aligned_vector<accum_type> accum_buffer_;
+
+    // Tile-major accumulation buffer, only allocated if the wrapped target is tiled
+    aligned_vector<accum_type> tiled_accum_buffer_;
+
+    // Threads to resolve the accumulation buffer, not owned
+    thread_pool* pool_;
+
+    // Match the layout of the wrapped render target
+    void update_layout();
+
+};
+
+} // visionaray
+
+#include "detail/accum_buffer_rt.inl"
+
+#endif // VSNRAY_ACCUM_BUFFER_RT_H
@@ -0,0 +1,155 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_AOV_H
+#define VSNRAY_AOV_H 1
+
+#include <algorithm>
+#include <cstddef>
+
+#include "detail/macros.h"
+#include "aligned_vector.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Arbitrary output variables (AOVs)
+//
+// Auxiliary per-pixel layers that are written in the same pass as color and depth.
+// Kernels that return an aov_result_record provide the values, the sample count
+// layer is maintained by the scheduler.
+//
+
+enum aov_layer
+{
+    AOV_NONE            = 0x00,
+    AOV_NORMAL          = 0x01, // float3, shading normal at the first hit
+    AOV_ALBEDO          = 0x02, // float3, reflectance at the first hit
+    AOV_PRIM_ID         = 0x04, // int, primitive id of the first hit, -1 if no hit
+    AOV_GEOM_ID         = 0x08, // int, geometry or instance id of the first hit, -1 if no hit
+    AOV_SAMPLE_COUNT    = 0x10  // unsigned, samples blended into the pixel since accumulation restarted
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Reference to AOV layers, passed to kernels and schedulers
+//
+// Layers are stored as planes (SoA), one plane per vector component.
+// Pointers of disabled layers are null.
+//
+
+struct aov_ref
+{
+    float*    normal[3];
+    float*    albedo[3];
+    int*      prim_id;
+    int*      geom_id;
+    unsigned* sample_count;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Host storage for AOV layers
+//
+
+class aov_buffer
+{
+public:
+
+    aov_buffer() = default;
+
+    void set_layers(unsigned layers)
+    {
+        layers_ = layers;
+        resize(width_, height_);
+    }
+
+    unsigned layers() const
+    {
+        return layers_;
+    }
+
+    void resize(int w, int h)
+    {
+        width_  = w;
+        height_ = h;
+
+        size_t size = static_cast<size_t>(w) * h;
+
+        for (int c = 0; c < 3; ++c)
+        {
+            normal_[c].resize(layers_ & AOV_NORMAL ? size : 0);
+            albedo_[c].resize(layers_ & AOV_ALBEDO ? size : 0);
+        }
+
+        prim_id_.resize(layers_ & AOV_PRIM_ID ? size : 0);
+        geom_id_.resize(layers_ & AOV_GEOM_ID ? size : 0);
+
+        sample_count_.resize(layers_ & AOV_SAMPLE_COUNT ? size : 0);
+    }
+
+    void clear()
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            std::fill(normal_[c].begin(), normal_[c].end(), 0.0f);
+            std::fill(albedo_[c].begin(), albedo_[c].end(), 0.0f);
+        }
+
+        std::fill(prim_id_.begin(), prim_id_.end(), -1);
+        std::fill(geom_id_.begin(), geom_id_.end(), -1);
+
+        std::fill(sample_count_.begin(), sample_count_.end(), 0U);
+    }
+
+    aov_ref ref()
+    {
+        return {
+            { data(normal_[0]), data(normal_[1]), data(normal_[2]) },
+            { data(albedo_[0]), data(albedo_[1]), data(albedo_[2]) },
+            data(prim_id_),
+            data(geom_id_),
+            data(sample_count_)
+            };
+    }
+
+    float const* normal(int c) const        { return data(normal_[c]); }
+    float const* albedo(int c) const        { return data(albedo_[c]); }
+    int const* prim_id() const              { return data(prim_id_); }
+    int const* geom_id() const              { return data(geom_id_); }
+    unsigned const* sample_count() const    { return data(sample_count_); }
+
+private:
+
+    unsigned layers_ = AOV_NONE;
+
+    int width_  = 0;
+    int height_ = 0;
+
+    aligned_vector<float>    normal_[3];
+    aligned_vector<float>    albedo_[3];
+    aligned_vector<int>      prim_id_;
+    aligned_vector<int>      geom_id_;
+    aligned_vector<unsigned> sample_count_;
+
+    // nullptr for disabled layers
+    template <typename T>
+    static T* data(aligned_vector<T>& v)
+    {
+        return v.empty() ? nullptr : v.data();
+    }
+
+    template <typename T>
+    static T const* data(aligned_vector<T> const& v)
+    {
+        return v.empty() ? nullptr : v.data();
+    }
+
+};
+
+} // visionaray
+
+#endif // VSNRAY_AOV_H
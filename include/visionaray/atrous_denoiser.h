@@ -0,0 +1,109 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_ATROUS_DENOISER_H
+#define VSNRAY_ATROUS_DENOISER_H 1
+
+#include "detail/thread_pool.h"
+#include "accum_buffer_rt.h"
+#include "aligned_vector.h"
+#include "aov.h"
+#include "pixel_format.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010)
+//
+// Post-process for progressively rendered images, runs on the host after sched.frame().
+// The color buffer is filtered with a 5x5 B3-spline kernel that is dilated by a factor of
+// two per iteration. Filter weights are guided by the normal and albedo AOV layers and by
+// the depth buffer if those are available (see aov.h).
+//
+// Usage:
+//
+//  rt.aovs().set_layers(AOV_NORMAL | AOV_ALBEDO);
+//  atrous_denoiser denoiser(&pool);
+//  sched.frame(kernel, sparams, ++frame_num);
+//  denoiser.denoise(rt);
+//  rt.display_color_buffer();
+//
+// When denoising an accum_buffer_rt, the accumulation buffer is not modified, the filtered
+// image is written to the color buffer of the wrapped render target.
+//
+// Rows are filtered on the threads of the pool passed to the constructor, or in the calling
+// thread if there is none. The pool must outlive the denoiser.
+//
+
+class atrous_denoiser
+{
+public:
+
+    explicit atrous_denoiser(thread_pool* pool = nullptr);
+
+    // Number of filter passes, the filter footprint is 4 * 2^num_iterations pixels
+    void set_num_iterations(unsigned num_iterations);
+    unsigned get_num_iterations() const;
+
+    // Edge-stopping functions, smaller values preserve more detail
+    void set_sigma_color(float sigma);
+    void set_sigma_normal(float sigma);
+    void set_sigma_albedo(float sigma);
+    void set_sigma_depth(float sigma);
+
+    // Filter the color buffer of rt in place
+    template <typename RT>
+    void denoise(RT& rt);
+
+    // Filter the accumulation buffer into the color buffer of the wrapped render target
+    template <typename RT>
+    void denoise(accum_buffer_rt<RT>& rt);
+
+private:
+
+    // Guide layers, null if not available
+    struct guide
+    {
+        float const* normal[3];
+        float const* albedo[3];
+        float const* depth;
+    };
+
+    template <pixel_format OF, pixel_format IF, typename OutputColor, typename InputColor>
+    void denoise_impl(
+            pixel_format_constant<OF>   /* dst format */,
+            pixel_format_constant<IF>   /* src format */,
+            OutputColor*                output,
+            InputColor const*           input,
+            guide const&                g,
+            int                         width,
+            int                         height
+            );
+
+    // Single filter pass from planes[src] to planes[1 - src]
+    void filter_pass(guide const& g, int width, int height, int src, unsigned iteration);
+
+    // Not owned
+    thread_pool* pool_;
+
+    unsigned num_iterations_;
+
+    float sigma_color_;
+    float sigma_normal_;
+    float sigma_albedo_;
+    float sigma_depth_;
+
+    // Ping-pong color planes (SoA), alpha is not filtered
+    aligned_vector<float> planes_[2][3];
+    aligned_vector<float> alpha_;
+
+};
+
+} // visionaray
+
+#include "detail/atrous_denoiser.inl"
+
+#endif // VSNRAY_ATROUS_DENOISER_H
@@ -663,6 +663,11 @@ using hcc_index_bvh     = index_bvh_t<hcc::device_vector<P>, hcc::device_vector<
 template <typename Tree, typename P>
 Tree build(P* primitives, size_t num_prims, bool use_spatial_splits = false);
 
+// Sort the primitives of each leaf by type so that traversal visits runs of primitives
+// with the same type. Only for BVHs over generic primitives, call after build().
+template <typename Tree>
+void group_leaves_by_type(Tree& tree);
+
 
 //-------------------------------------------------------------------------------------------------
 // Traversal algorithms
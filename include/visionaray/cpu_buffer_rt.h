@@ -8,6 +8,8 @@
 
 #include <memory>
 
+#include "detail/thread_pool.h"
+#include "aov.h"
 #include "pixel_traits.h"
 #include "render_target.h"
 
@@ -22,7 +24,7 @@ public:
     using color_type    = typename pixel_traits<ColorFormat>::type;
     using depth_type    = typename pixel_traits<DepthFormat>::type;
 
-    using ref_type      = render_target_ref<ColorFormat, DepthFormat>;
+    using ref_type      = render_target_tiled_ref<ColorFormat, DepthFormat>;
 
 public:
 
@@ -35,6 +37,17 @@ public:
     color_type const* color() const;
     depth_type const* depth() const;
 
+    // AOV layers, disabled by default
+    aov_buffer& aovs();
+    aov_buffer const& aovs() const;
+
+    // Memory layout kernels write to, RT_LINEAR by default
+    // Contents are discarded, clear the buffers after changing the layout
+    // end_frame() resolves tiles on the threads of pool if not null, the pool must outlive
+    // the render target or the next call to set_layout()
+    void set_layout(render_target_layout layout, thread_pool* pool = nullptr);
+    render_target_layout get_layout() const;
+
     ref_type ref();
 
     void clear_color_buffer(vec4 const& color = vec4(0.0f));
@@ -0,0 +1,197 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+
+#include "color_conversion.h"
+#include "parallel_for.h"
+#include "range.h"
+#include "tiled_layout.h"
+
+namespace visionaray
+{
+
+template <typename RT>
+accum_buffer_rt<RT>::accum_buffer_rt(thread_pool* pool)
+    : pool_(pool)
+{
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Accessors
+//
+
+template <typename RT>
+typename accum_buffer_rt<RT>::color_type* accum_buffer_rt<RT>::color()
+{
+    return rt_.color();
+}
+
+template <typename RT>
+typename accum_buffer_rt<RT>::depth_type* accum_buffer_rt<RT>::depth()
+{
+    return rt_.depth();
+}
+
+template <typename RT>
+typename accum_buffer_rt<RT>::accum_type* accum_buffer_rt<RT>::accum()
+{
+    return accum_buffer_.data();
+}
+
+template <typename RT>
+typename accum_buffer_rt<RT>::color_type const* accum_buffer_rt<RT>::color() const
+{
+    return rt_.color();
+}
+
+template <typename RT>
+typename accum_buffer_rt<RT>::depth_type const* accum_buffer_rt<RT>::depth() const
+{
+    return rt_.depth();
+}
+
+template <typename RT>
+typename accum_buffer_rt<RT>::accum_type const* accum_buffer_rt<RT>::accum() const
+{
+    return accum_buffer_.data();
+}
+
+template <typename RT>
+aov_buffer& accum_buffer_rt<RT>::aovs()
+{
+    return rt_.aovs();
+}
+
+template <typename RT>
+aov_buffer const& accum_buffer_rt<RT>::aovs() const
+{
+    return rt_.aovs();
+}
+
+template <typename RT>
+RT& accum_buffer_rt<RT>::target()
+{
+    return rt_;
+}
+
+template <typename RT>
+RT const& accum_buffer_rt<RT>::target() const
+{
+    return rt_;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Interface
+//
+
+template <typename RT>
+typename accum_buffer_rt<RT>::ref_type accum_buffer_rt<RT>::ref()
+{
+    auto target_ref = rt_.ref();
+
+    // Kernels write depth to tiled storage iff they write color to tiled storage
+    bool tiled = target_ref.tiled() && !tiled_accum_buffer_.empty();
+
+    return {
+        { { accum(), depth(), width(), height() }, rt_.aovs().ref() },
+        tiled ? tiled_accum_buffer_.data() : nullptr,
+        tiled ? target_ref.tiled_depth_ : nullptr
+        };
+}
+
+template <typename RT>
+void accum_buffer_rt<RT>::clear_color_buffer(vec4 const& c)
+{
+    update_layout();
+
+    std::fill(accum_buffer_.begin(), accum_buffer_.end(), c);
+    std::fill(tiled_accum_buffer_.begin(), tiled_accum_buffer_.end(), c);
+
+    rt_.clear_color_buffer(c);
+}
+
+template <typename RT>
+void accum_buffer_rt<RT>::clear_depth_buffer(float d)
+{
+    rt_.clear_depth_buffer(d);
+}
+
+template <typename RT>
+void accum_buffer_rt<RT>::begin_frame()
+{
+    rt_.begin_frame();
+}
+
+template <typename RT>
+void accum_buffer_rt<RT>::end_frame()
+{
+    // Resolve tiles of the wrapped render target first, its tiled color storage
+    // is not written to and would overwrite the resolved accumulation buffer
+    rt_.end_frame();
+
+    if (!tiled_accum_buffer_.empty())
+    {
+        detail::linearize_tiles<ref_type>(
+                tiled_accum_buffer_.data(),
+                accum_buffer_.data(),
+                width(),
+                height(),
+                pool_
+                );
+    }
+
+    // Resolve accumulation buffer, chunks of pixels in parallel
+    auto color = rt_.color();
+    auto accum = accum_buffer_.data();
+
+    auto resolve = [=](range1d<int> const& r)
+    {
+        convert(
+            pixel_format_constant<RT::ref_type::color_format>{},
+            pixel_format_constant<PF_RGBA32F>{},
+            color + r.begin(),
+            accum + r.begin(),
+            static_cast<size_t>(r.length())
+            );
+    };
+
+    int num_pixels = static_cast<int>(accum_buffer_.size());
+
+    detail::optional_parallel_for(pool_, tiled_range1d<int>(0, num_pixels, 4096), resolve);
+}
+
+template <typename RT>
+void accum_buffer_rt<RT>::resize(int w, int h)
+{
+    render_target::resize(w, h);
+
+    accum_buffer_.resize(w * h);
+
+    rt_.resize(w, h);
+
+    update_layout();
+}
+
+template <typename RT>
+void accum_buffer_rt<RT>::display_color_buffer() const
+{
+    rt_.display_color_buffer();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//
+
+template <typename RT>
+void accum_buffer_rt<RT>::update_layout()
+{
+    size_t tiled_size = rt_.ref().tiled() ? detail::tiled_buffer_size<ref_type>(width(), height()) : 0;
+
+    tiled_accum_buffer_.resize(tiled_size);
+}
+
+} // visionaray
@@ -0,0 +1,144 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_DETAIL_ADAPTIVE_SAMPLING_H
+#define VSNRAY_DETAIL_ADAPTIVE_SAMPLING_H 1
+
+#include <cstddef>
+
+#include <visionaray/math/math.h>
+#include <visionaray/aligned_vector.h>
+
+#include "macros.h"
+
+namespace visionaray
+{
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Running luminance statistics of a single pixel
+// Updated with Welford's algorithm, m2 is the sum of squared differences from the mean
+//
+
+struct pixel_variance
+{
+    unsigned count;
+    float    mean;
+    float    m2;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Passed to sample_pixel() in place of the pixel sampler tag
+//
+
+struct adaptive_blend_params
+{
+    // Per-pixel statistics, width * height elements
+    pixel_variance* variance;
+
+    // A pixel has converged when the relative standard error
+    // of its mean is less than tolerance
+    float           tolerance;
+
+    // Minimum number of samples before a pixel is considered for convergence
+    unsigned        min_samples;
+
+    // Upper bound on the number of samples packets with large errors receive per frame
+    unsigned        max_samples_per_frame;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Statistics helpers
+//
+
+VSNRAY_FUNC
+inline void update(pixel_variance& pv, float value)
+{
+    ++pv.count;
+    float delta = value - pv.mean;
+    pv.mean += delta / pv.count;
+    pv.m2 += delta * (value - pv.mean);
+}
+
+// Standard error of the mean, relative to the mean
+VSNRAY_FUNC
+inline float relative_error(pixel_variance const& pv)
+{
+    if (pv.count < 2)
+    {
+        return numeric_limits<float>::max();
+    }
+
+    float variance = pv.m2 / (pv.count - 1);
+
+    // Offset by 1/256 so that dark pixels do not require infinitely many samples
+    return sqrt(variance / pv.count) / (pv.mean + 1.0f / 256.0f);
+}
+
+VSNRAY_FUNC
+inline bool converged(pixel_variance const& pv, adaptive_blend_params const& params)
+{
+    return pv.count >= params.min_samples && relative_error(pv) <= params.tolerance;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Per-pixel statistics that persist between frames, owned by the scheduler
+//
+
+class adaptive_sampling_state
+{
+public:
+
+    adaptive_sampling_state()
+        : tolerance_(0.01f)
+        , min_samples_(16)
+        , max_samples_per_frame_(4)
+    {
+    }
+
+    void set_convergence_tolerance(float tolerance, unsigned min_samples, unsigned max_samples_per_frame)
+    {
+        tolerance_             = tolerance;
+        min_samples_           = min_samples < 2 ? 2 : min_samples;
+        max_samples_per_frame_ = max_samples_per_frame < 1 ? 1 : max_samples_per_frame;
+    }
+
+    // Statistics are discarded whenever accumulation restarts (frame_num <= 1)
+    // or when the render target was resized
+    adaptive_blend_params prepare(int width, int height, unsigned frame_num)
+    {
+        size_t size = static_cast<size_t>(width) * height;
+
+        if (frame_num <= 1 || variance_.size() != size)
+        {
+            variance_.assign(size, pixel_variance{ 0, 0.0f, 0.0f });
+        }
+
+        return { variance_.data(), tolerance_, min_samples_, max_samples_per_frame_ };
+    }
+
+    pixel_variance const* variance() const
+    {
+        return variance_.data();
+    }
+
+private:
+
+    aligned_vector<pixel_variance> variance_;
+
+    float    tolerance_;
+    unsigned min_samples_;
+    unsigned max_samples_per_frame_;
+
+};
+
+} // detail
+} // visionaray
+
+#endif // VSNRAY_DETAIL_ADAPTIVE_SAMPLING_H
@@ -0,0 +1,449 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <cmath>
+#include <cstddef>
+
+#include <visionaray/math/simd/simd.h>
+#include <visionaray/math/math.h>
+
+#include "color_conversion.h"
+#include "parallel_for.h"
+#include "range.h"
+
+namespace visionaray
+{
+namespace detail
+{
+namespace atrous
+{
+
+//-------------------------------------------------------------------------------------------------
+// Helpers so that the filter code compiles for both float and simd::float4
+//
+
+inline simd::float4 load_lanes(float const* src, simd::float4 /* */)
+{
+    return simd::load_unaligned(src);
+}
+
+inline float load_lanes(float const* src, float /* */)
+{
+    return *src;
+}
+
+inline void store_lanes(float* dst, float v)
+{
+    *dst = v;
+}
+
+inline void store_lanes(float* dst, simd::float4 const& v)
+{
+    simd::store_unaligned(dst, v);
+}
+
+inline float exp_(float x)
+{
+    return std::exp(x);
+}
+
+inline simd::float4 exp_(simd::float4 const& x)
+{
+    return simd::exp(x);
+}
+
+inline float abs_(float x)
+{
+    return std::abs(x);
+}
+
+inline simd::float4 abs_(simd::float4 const& x)
+{
+    return simd::abs(x);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Only 32-bit float depth buffers guide the filter
+//
+
+template <pixel_format DF, typename Depth>
+inline float const* depth_guide(pixel_format_constant<DF>, Depth const* /* depth */)
+{
+    return nullptr;
+}
+
+inline float const* depth_guide(pixel_format_constant<PF_DEPTH32F>, float const* depth)
+{
+    return depth;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Filter the pixels [x..x+num_elements<T>) of a single row
+// In x direction, only interior pixels are processed with T = simd::float4
+//
+
+struct pass_params
+{
+    float const* src[3];
+    float*       dst[3];
+
+    int          width;
+    int          height;
+    int          step;
+
+    float        inv_sigma_color2;
+    float        inv_sigma_normal2;
+    float        inv_sigma_albedo2;
+    float        inv_sigma_depth;
+};
+
+template <typename T, typename Guide>
+inline void filter_pixels(pass_params const& p, Guide const& g, int x, int y)
+{
+    // B3-spline
+    static const float h[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+    const int  num_elements = simd::num_elements<T>::value;
+    const bool interior     = num_elements > 1;
+
+    int p_idx = y * p.width + x;
+
+    T cp[3];
+    T np[3];
+    T ap[3];
+    T zp(0.0f);
+
+    for (int c = 0; c < 3; ++c)
+    {
+        cp[c] = load_lanes(p.src[c] + p_idx, T());
+        np[c] = g.normal[c] ? load_lanes(g.normal[c] + p_idx, T()) : T(0.0f);
+        ap[c] = g.albedo[c] ? load_lanes(g.albedo[c] + p_idx, T()) : T(0.0f);
+    }
+
+    if (g.depth)
+    {
+        zp = load_lanes(g.depth + p_idx, T());
+    }
+
+    T sum[3] = { T(0.0f), T(0.0f), T(0.0f) };
+    T weight_sum(0.0f);
+
+    for (int dy = -2; dy <= 2; ++dy)
+    {
+        int qy = y + dy * p.step;
+
+        if (qy < 0 || qy >= p.height)
+        {
+            continue;
+        }
+
+        for (int dx = -2; dx <= 2; ++dx)
+        {
+            int qx = x + dx * p.step;
+
+            if (!interior && (qx < 0 || qx >= p.width))
+            {
+                continue;
+            }
+
+            int q_idx = qy * p.width + qx;
+
+            T cq[3];
+            T e(0.0f);
+
+            for (int c = 0; c < 3; ++c)
+            {
+                cq[c] = load_lanes(p.src[c] + q_idx, T());
+                T d = cq[c] - cp[c];
+                e += d * d * T(p.inv_sigma_color2);
+
+                if (g.normal[c])
+                {
+                    T dn = load_lanes(g.normal[c] + q_idx, T()) - np[c];
+                    e += dn * dn * T(p.inv_sigma_normal2);
+                }
+
+                if (g.albedo[c])
+                {
+                    T da = load_lanes(g.albedo[c] + q_idx, T()) - ap[c];
+                    e += da * da * T(p.inv_sigma_albedo2);
+                }
+            }
+
+            if (g.depth)
+            {
+                T dz = load_lanes(g.depth + q_idx, T()) - zp;
+                e += abs_(dz) * T(p.inv_sigma_depth);
+            }
+
+            T w = T(h[dx + 2] * h[dy + 2]) * exp_(-e);
+
+            for (int c = 0; c < 3; ++c)
+            {
+                sum[c] += w * cq[c];
+            }
+
+            weight_sum += w;
+        }
+    }
+
+    // The center pixel has weight > 0
+    for (int c = 0; c < 3; ++c)
+    {
+        store_lanes(p.dst[c] + p_idx, sum[c] / weight_sum);
+    }
+}
+
+} // atrous
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// atrous_denoiser
+//
+
+inline atrous_denoiser::atrous_denoiser(thread_pool* pool)
+    : pool_(pool)
+    , num_iterations_(5)
+    , sigma_color_(0.5f)
+    , sigma_normal_(0.3f)
+    , sigma_albedo_(0.1f)
+    , sigma_depth_(0.01f)
+{
+}
+
+inline void atrous_denoiser::set_num_iterations(unsigned num_iterations)
+{
+    num_iterations_ = num_iterations;
+}
+
+inline unsigned atrous_denoiser::get_num_iterations() const
+{
+    return num_iterations_;
+}
+
+inline void atrous_denoiser::set_sigma_color(float sigma)
+{
+    sigma_color_ = sigma;
+}
+
+inline void atrous_denoiser::set_sigma_normal(float sigma)
+{
+    sigma_normal_ = sigma;
+}
+
+inline void atrous_denoiser::set_sigma_albedo(float sigma)
+{
+    sigma_albedo_ = sigma;
+}
+
+inline void atrous_denoiser::set_sigma_depth(float sigma)
+{
+    sigma_depth_ = sigma;
+}
+
+template <typename RT>
+inline void atrous_denoiser::denoise(RT& rt)
+{
+    using ref_type = typename RT::ref_type;
+
+    auto ref = rt.ref();
+    auto const& aovs = ref.aovs();
+
+    guide g = {
+        { aovs.normal[0], aovs.normal[1], aovs.normal[2] },
+        { aovs.albedo[0], aovs.albedo[1], aovs.albedo[2] },
+        detail::atrous::depth_guide(pixel_format_constant<ref_type::depth_format>{}, ref.depth())
+        };
+
+    denoise_impl(
+            pixel_format_constant<ref_type::color_format>{},
+            pixel_format_constant<ref_type::color_format>{},
+            ref.color(),
+            ref.color(),
+            g,
+            rt.width(),
+            rt.height()
+            );
+}
+
+template <typename RT>
+inline void atrous_denoiser::denoise(accum_buffer_rt<RT>& rt)
+{
+    using ref_type = typename accum_buffer_rt<RT>::ref_type;
+
+    auto ref = rt.ref();
+    auto const& aovs = ref.aovs();
+
+    guide g = {
+        { aovs.normal[0], aovs.normal[1], aovs.normal[2] },
+        { aovs.albedo[0], aovs.albedo[1], aovs.albedo[2] },
+        detail::atrous::depth_guide(pixel_format_constant<ref_type::depth_format>{}, ref.depth())
+        };
+
+    denoise_impl(
+            pixel_format_constant<RT::ref_type::color_format>{},
+            pixel_format_constant<PF_RGBA32F>{},
+            rt.target().color(),
+            rt.accum(),
+            g,
+            rt.width(),
+            rt.height()
+            );
+}
+
+template <pixel_format OF, pixel_format IF, typename OutputColor, typename InputColor>
+inline void atrous_denoiser::denoise_impl(
+        pixel_format_constant<OF>   /* dst format */,
+        pixel_format_constant<IF>   /* src format */,
+        OutputColor*                output,
+        InputColor const*           input,
+        guide const&                g,
+        int                         width,
+        int                         height
+        )
+{
+    size_t size = static_cast<size_t>(width) * height;
+
+    if (size == 0)
+    {
+        return;
+    }
+
+    for (int i = 0; i < 2; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            planes_[i][c].resize(size);
+        }
+    }
+
+    alpha_.resize(size);
+
+    const int tile_height = 8;
+
+
+    // Convert to SoA
+
+    detail::optional_parallel_for(
+        pool_,
+        tiled_range1d<int>(0, height, tile_height),
+        [&](range1d<int> const& r)
+        {
+            for (int y = r.begin(); y != r.end(); ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    size_t idx = static_cast<size_t>(y) * width + x;
+
+                    vec4 color;
+                    convert(
+                        pixel_format_constant<PF_RGBA32F>{},
+                        pixel_format_constant<IF>{},
+                        color,
+                        input[idx]
+                        );
+
+                    planes_[0][0][idx] = color.x;
+                    planes_[0][1][idx] = color.y;
+                    planes_[0][2][idx] = color.z;
+                    alpha_[idx]        = color.w;
+                }
+            }
+        });
+
+
+    // Filter passes
+
+    int src = 0;
+
+    for (unsigned i = 0; i < num_iterations_; ++i)
+    {
+        filter_pass(g, width, height, src, i);
+        src = 1 - src;
+    }
+
+
+    // Convert back to AoS
+
+    detail::optional_parallel_for(
+        pool_,
+        tiled_range1d<int>(0, height, tile_height),
+        [&](range1d<int> const& r)
+        {
+            for (int y = r.begin(); y != r.end(); ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    size_t idx = static_cast<size_t>(y) * width + x;
+
+                    convert(
+                        pixel_format_constant<OF>{},
+                        pixel_format_constant<PF_RGBA32F>{},
+                        output[idx],
+                        vec4(planes_[src][0][idx], planes_[src][1][idx], planes_[src][2][idx], alpha_[idx])
+                        );
+                }
+            }
+        });
+}
+
+inline void atrous_denoiser::filter_pass(guide const& g, int width, int height, int src, unsigned iteration)
+{
+    using namespace detail::atrous;
+
+    pass_params p;
+
+    for (int c = 0; c < 3; ++c)
+    {
+        p.src[c] = planes_[src][c].data();
+        p.dst[c] = planes_[1 - src][c].data();
+    }
+
+    p.width  = width;
+    p.height = height;
+    p.step   = 1 << iteration;
+
+    // Color sensitivity increases with each iteration (the image is smoother),
+    // depth tolerance grows with the distance between filter taps
+    p.inv_sigma_color2  = static_cast<float>(p.step) / (sigma_color_ * sigma_color_);
+    p.inv_sigma_normal2 = 1.0f / (sigma_normal_ * sigma_normal_);
+    p.inv_sigma_albedo2 = 1.0f / (sigma_albedo_ * sigma_albedo_);
+    p.inv_sigma_depth   = 1.0f / (sigma_depth_ * p.step);
+
+    const int simd_width = simd::num_elements<simd::float4>::value;
+
+    // Range of x coordinates where all filter taps of a SIMD vector are inside the image
+    int interior_begin = 2 * p.step;
+    int interior_end   = width - 2 * p.step - simd_width + 1;
+
+    detail::optional_parallel_for(
+        pool_,
+        tiled_range1d<int>(0, height, 8),
+        [&](range1d<int> const& r)
+        {
+            for (int y = r.begin(); y != r.end(); ++y)
+            {
+                int x = 0;
+
+                for (; x < interior_begin && x < width; ++x)
+                {
+                    filter_pixels<float>(p, g, x, y);
+                }
+
+                for (; x < interior_end; x += simd_width)
+                {
+                    filter_pixels<simd::float4>(p, g, x, y);
+                }
+
+                for (; x < width; ++x)
+                {
+                    filter_pixels<float>(p, g, x, y);
+                }
+            }
+        });
+}
+
+} // visionaray
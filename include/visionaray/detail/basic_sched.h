@@ -6,6 +6,8 @@
 #ifndef VSNRAY_DETAIL_BASIC_SCHED_H
 #define VSNRAY_DETAIL_BASIC_SCHED_H 1
 
+#include "adaptive_sampling.h"
+
 namespace visionaray
 {
 
@@ -23,10 +25,20 @@ public:
     template <typename ...Args>
     void reset(Args&&... args);
 
+    // Convergence criteria for pixel_sampler::jittered_adaptive_blend_type
+    void set_convergence_tolerance(
+            float    tolerance,
+            unsigned min_samples = 16,
+            unsigned max_samples_per_frame = 4
+            );
+
 private:
 
     Backend backend_;
 
+    // Per-pixel variance, only used w/ pixel_sampler::jittered_adaptive_blend_type
+    detail::adaptive_sampling_state adaptive_state_;
+
 };
 
 } // visionaray
@@ -13,16 +13,51 @@ namespace visionaray
 namespace basic_sched_impl
 {
 
+//-------------------------------------------------------------------------------------------------
+// Pixel sampler that is passed on to sample_pixel()
+//
+// Pixel sampler tags are passed on unaltered, the adaptive pixel sampler is replaced
+// with a reference to the per-pixel statistics that the scheduler maintains
+//
+
+template <typename PxSamplerT, typename RT>
+PxSamplerT prepare_pixel_sampler(
+        PxSamplerT                          sampler,
+        RT&                                 rt,
+        unsigned                            frame_num,
+        detail::adaptive_sampling_state&    state
+        )
+{
+    VSNRAY_UNUSED(rt);
+    VSNRAY_UNUSED(frame_num);
+    VSNRAY_UNUSED(state);
+
+    return sampler;
+}
+
+template <typename RT>
+detail::adaptive_blend_params prepare_pixel_sampler(
+        pixel_sampler::jittered_adaptive_blend_type /* */,
+        RT&                                         rt,
+        unsigned                                    frame_num,
+        detail::adaptive_sampling_state&            state
+        )
+{
+    return state.prepare(rt.width(), rt.height(), frame_num);
+}
+
+
 //-------------------------------------------------------------------------------------------------
 // Generate primary ray and sample pixel
 //
 
-template <typename R, typename K, typename SP, typename Generator, typename ...Args>
+template <typename R, typename K, typename SP, typename PxSamplerT, typename Generator, typename ...Args>
 void call_sample_pixel(
         std::false_type /* has intersector */,
         R               /* */,
         K               kernel,
         SP              sparams,
+        PxSamplerT      sampler,
         Generator&      gen,
         unsigned        frame_num,
         Args&&...       args
@@ -37,7 +72,7 @@ void call_sample_pixel(
 
     sample_pixel(
             kernel,
-            typename SP::pixel_sampler_type(),
+            sampler,
             r,
             gen,
             frame_num,
@@ -46,12 +81,13 @@ void call_sample_pixel(
             );
 }
 
-template <typename R, typename K, typename SP, typename Generator, typename ...Args>
+template <typename R, typename K, typename SP, typename PxSamplerT, typename Generator, typename ...Args>
 void call_sample_pixel(
         std::true_type  /* has intersector */,
         R               /* */,
         K               kernel,
         SP              sparams,
+        PxSamplerT      sampler,
         Generator&      gen,
         unsigned        frame_num,
         Args&&...       args
@@ -68,7 +104,7 @@ void call_sample_pixel(
             detail::have_intersector_tag(),
             sparams.intersector,
             kernel,
-            typename SP::pixel_sampler_type(),
+            sampler,
             r,
             gen,
             frame_num,
@@ -112,6 +148,13 @@ void basic_sched<B, R>::frame(K kernel, SP sched_params, unsigned frame_num)
     int nx = x0 + sched_params.scissor_box.w;
     int ny = y0 + sched_params.scissor_box.h;
 
+    auto sampler = basic_sched_impl::prepare_pixel_sampler(
+            typename SP::pixel_sampler_type{},
+            sched_params.rt,
+            frame_num,
+            adaptive_state_
+            );
+
     backend_.for_each_packet(
         tiled_range2d<int>(x0, nx, dx, y0, ny, dy), pw, ph,
         [=](int x, int y)
@@ -127,6 +170,7 @@ void basic_sched<B, R>::frame(K kernel, SP sched_params, unsigned frame_num)
                     R{},
                     kernel,
                     sched_params,
+                    sampler,
                     gen,
                     frame_num,
                     x,
@@ -149,4 +193,14 @@ void basic_sched<B, R>::reset(Args&&... args)
     backend_.reset(std::forward<Args>(args)...);
 }
 
+template <typename B, typename R>
+void basic_sched<B, R>::set_convergence_tolerance(
+        float    tolerance,
+        unsigned min_samples,
+        unsigned max_samples_per_frame
+        )
+{
+    adaptive_state_.set_convergence_tolerance(tolerance, min_samples, max_samples_per_frame);
+}
+
 } // visionaray
@@ -7,6 +7,7 @@
 #include <limits>
 
 #include <visionaray/math/aabb.h>
+#include <visionaray/variant.h>
 
 #include "lbvh.h"
 #include "sah.h"
@@ -159,6 +160,45 @@ void build_tree(Tree& tree, Builder& builder, I first, I last, int max_leaf_size
 }
 
 
+//--------------------------------------------------------------------------------------------------
+// Sort leaf primitives by type
+//
+
+template <typename Tree>
+void group_leaf_by_type(Tree& tree, bvh_node const& node, std::true_type /*is_index_bvh*/)
+{
+    auto first = tree.indices().begin() + node.get_first_primitive();
+    auto last = first + node.get_num_primitives();
+
+    std::stable_sort(
+            first,
+            last,
+            [&](unsigned a, unsigned b)
+            {
+                return tree.primitives()[a].which() < tree.primitives()[b].which();
+            }
+            );
+}
+
+template <typename Tree>
+void group_leaf_by_type(Tree& tree, bvh_node const& node, std::false_type /*is_index_bvh*/)
+{
+    using P = typename Tree::primitive_type;
+
+    auto first = tree.primitives().begin() + node.get_first_primitive();
+    auto last = first + node.get_num_primitives();
+
+    std::stable_sort(
+            first,
+            last,
+            [](P const& a, P const& b)
+            {
+                return a.which() < b.which();
+            }
+            );
+}
+
+
 } // detail
 
 
@@ -191,6 +231,30 @@ Tree build(detail::binned_sah_builder /* */, P* primitives, size_t num_prims, bo
 }
 
 
+//--------------------------------------------------------------------------------------------------
+// Group leaf primitives by type
+//
+
+template <typename Tree>
+void group_leaves_by_type(Tree& tree)
+{
+    static_assert(
+            is_variant<typename Tree::primitive_type>::value,
+            "Tree must store generic primitives"
+            );
+
+    for (size_t i = 0; i < tree.num_nodes(); ++i)
+    {
+        auto const& node = tree.node(i);
+
+        if (is_leaf(node))
+        {
+            detail::group_leaf_by_type(tree, node, is_index_bvh<Tree>());
+        }
+    }
+}
+
+
 //--------------------------------------------------------------------------------------------------
 // Default: binned_sah builder
 //
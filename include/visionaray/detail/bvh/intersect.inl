@@ -10,6 +10,7 @@
 #include <visionaray/math/ray.h>
 #include <visionaray/intersector.h>
 #include <visionaray/update_if.h>
+#include <visionaray/variant.h>
 
 #include "../exit_traversal.h"
 #include "../multi_hit.h"
@@ -20,6 +21,215 @@
 
 namespace visionaray
 {
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Test if isect(ray, prim) is valid and returns Hit
+//
+
+template <typename Intersector, typename R, typename P, typename Hit>
+struct can_intersect_as
+{
+private:
+
+    template <typename I>
+    static auto test(int)
+        -> typename std::is_same<decltype(std::declval<I&>()(std::declval<R const&>(), std::declval<P const&>())), Hit>::type;
+
+    template <typename I>
+    static std::false_type test(...);
+
+public:
+
+    using type = decltype(test<Intersector>(0));
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Intersect the primitives of a leaf and update the traversal result
+//
+
+template <
+    traversal_type Traversal,
+    typename HR,
+    typename RT,
+    typename R,
+    typename BVH,
+    typename Intersector,
+    typename Cond
+    >
+struct leaf_intersector
+{
+    using scalar_type = typename R::scalar_type;
+    using primitive_type = typename BVH::primitive_type;
+    using hit_type = decltype(std::declval<Intersector&>()(std::declval<R const&>(), std::declval<primitive_type const&>()));
+
+    RT&                 result;
+    R const&            ray;
+    BVH const&          b;
+    Intersector&        isect;
+    scalar_type         max_t;
+    Cond&               update_cond;
+
+    // Test primitive i, prim is either the primitive itself or the alternative that a
+    // generic primitive stores. Returns true if traversal can stop.
+    template <typename P>
+    VSNRAY_FUNC
+    bool operator()(P const& prim, unsigned i)
+    {
+        auto hr = HR(intersect_primitive(prim, i, typename can_intersect_as<Intersector, R, P, hit_type>::type{}), i);
+        auto closer = update_cond(hr, result, max_t);
+
+#ifndef __CUDA_ARCH__
+        if (!any(closer))
+        {
+            return false;
+        }
+#endif
+
+        update_if(result, hr, closer);
+
+        exit_traversal<Traversal> early_exit;
+        return early_exit.check(result);
+    }
+
+    template <typename P>
+    VSNRAY_FUNC
+    hit_type intersect_primitive(P const& prim, unsigned /* */, std::true_type /* */)
+    {
+        return isect(ray, prim);
+    }
+
+    // Intersector does not know the alternative, pass the generic primitive
+    template <typename P>
+    VSNRAY_FUNC
+    hit_type intersect_primitive(P const& /* */, unsigned i, std::false_type /* */)
+    {
+        return isect(ray, b.primitive(i));
+    }
+};
+
+
+// Visits one primitive of a run with known type --------
+
+template <typename Leaf>
+class leaf_primitive_visitor
+{
+public:
+
+    using return_type = bool;
+
+public:
+
+    VSNRAY_FUNC leaf_primitive_visitor(Leaf& leaf, unsigned index)
+        : leaf_(leaf)
+        , index_(index)
+    {
+    }
+
+    template <typename X>
+    VSNRAY_FUNC
+    bool operator()(X const& prim) const
+    {
+        return leaf_(prim, index_);
+    }
+
+private:
+
+    Leaf& leaf_;
+    unsigned index_;
+
+};
+
+
+// Visits the run of primitives of the same type that starts at index
+
+template <typename Leaf>
+class leaf_run_visitor
+{
+public:
+
+    using return_type = bool;
+
+public:
+
+    VSNRAY_FUNC leaf_run_visitor(Leaf& leaf, unsigned& index, unsigned last)
+        : leaf_(leaf)
+        , index_(index)
+        , last_(last)
+    {
+    }
+
+    template <typename X>
+    VSNRAY_FUNC
+    bool operator()(X const& /* first */) const
+    {
+        unsigned tag = leaf_.b.primitive(index_).which();
+
+        do
+        {
+            auto i = index_++;
+
+            if (apply_visitor_as<X>(leaf_primitive_visitor<Leaf>(leaf_, i), leaf_.b.primitive(i)))
+            {
+                return true;
+            }
+        }
+        while (index_ != last_ && leaf_.b.primitive(index_).which() == tag);
+
+        return false;
+    }
+
+private:
+
+    Leaf& leaf_;
+    unsigned& index_;
+    unsigned last_;
+
+};
+
+
+// Default: one primitive after the other ---------------
+
+template <typename Leaf>
+VSNRAY_FUNC
+inline bool intersect_leaf(Leaf& leaf, unsigned first, unsigned last, std::false_type /* is_variant */)
+{
+    for (auto i = first; i != last; ++i)
+    {
+        if (leaf(leaf.b.primitive(i), i))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Generic primitives: dispatch once per run of primitives with the same type.
+// group_leaves_by_type() makes the runs as long as possible.
+
+template <typename Leaf>
+VSNRAY_FUNC
+inline bool intersect_leaf(Leaf& leaf, unsigned first, unsigned last, std::true_type /* is_variant */)
+{
+    auto i = first;
+
+    while (i != last)
+    {
+        if (apply_visitor(leaf_run_visitor<Leaf>(leaf, i, last), leaf.b.primitive(i)))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // detail
+
 
 //-------------------------------------------------------------------------------------------------
 // Ray / BVH intersection
@@ -107,27 +317,18 @@ next:
         // while node contains untested primitives
         //     perform a ray-primitive intersection test
 
-        for (auto i = node.get_indices().first; i != node.get_indices().last; ++i)
-        {
-            auto prim = b.primitive(i);
-
-            auto hr = HR(isect(ray, prim), i);
-            auto closer = update_cond(hr, result, max_t);
+        leaf_intersector<Traversal, HR, RT, basic_ray<T>, BVH, Intersector, Cond> leaf{
+                result,
+                ray,
+                b,
+                isect,
+                max_t,
+                update_cond
+                };
 
-#ifndef __CUDA_ARCH__
-            if (!any(closer))
-            {
-                continue;
-            }
-#endif
-
-            update_if(result, hr, closer);
-
-            exit_traversal<Traversal> early_exit;
-            if (early_exit.check(result))
-            {
-                return result;
-            }
+        if (intersect_leaf(leaf, node.get_indices().first, node.get_indices().last, is_variant<typename BVH::primitive_type>{}))
+        {
+            return result;
         }
     }
 
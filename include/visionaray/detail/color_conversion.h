@@ -6,6 +6,11 @@
 #ifndef VSNRAY_DETAIL_COLOR_CONVERSION_H
 #define VSNRAY_DETAIL_COLOR_CONVERSION_H 1
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <visionaray/math/simd/simd.h>
 #include <visionaray/math/detail/math.h>
 #include <visionaray/math/matrix.h>
 #include <visionaray/math/unorm.h>
@@ -279,6 +284,87 @@ inline void convert(
         );
 }
 
+
+//-------------------------------------------------------------------------------------------------
+// Convert arrays of pixels (host only)
+//
+
+template <pixel_format TF, pixel_format SF, typename TargetType, typename SourceType>
+inline void convert(
+        pixel_format_constant<TF>   /* */,
+        pixel_format_constant<SF>   /* */,
+        TargetType*                 target,
+        SourceType const*           source,
+        size_t                      count
+        )
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        convert(
+            pixel_format_constant<TF>{},
+            pixel_format_constant<SF>{},
+            target[i],
+            source[i]
+            );
+    }
+}
+
+// PF_RGBA32F to PF_RGBA32F, plain copy
+inline void convert(
+        pixel_format_constant<PF_RGBA32F>   /* */,
+        pixel_format_constant<PF_RGBA32F>   /* */,
+        vector<4, float>*                   target,
+        vector<4, float> const*             source,
+        size_t                              count
+        )
+{
+    std::memcpy(target, source, count * sizeof(vector<4, float>));
+}
+
+// PF_RGBA32F to PF_RGBA8, one pixel per SSE vector
+// Truncates like float_to_unorm(), source must be 16-byte aligned
+inline void convert(
+        pixel_format_constant<PF_RGBA8>     /* */,
+        pixel_format_constant<PF_RGBA32F>   /* */,
+        vector<4, unorm<8>>*                target,
+        vector<4, float> const*             source,
+        size_t                              count
+        )
+{
+    size_t i = 0;
+
+#if VSNRAY_SIMD_ISA_GE(VSNRAY_SIMD_ISA_SSE2)
+    // Four pixels per iteration, packed to 16 bytes w/o leaving the SSE registers
+    for (; i + 4 <= count; i += 4)
+    {
+        simd::int4 rgba[4];
+
+        for (size_t j = 0; j < 4; ++j)
+        {
+            simd::float4 v(source[i + j].data());
+            rgba[j] = convert_to_int(saturate(v) * simd::float4(255.0f));
+        }
+
+        __m128i lo = _mm_packs_epi32(rgba[0].value, rgba[1].value);
+        __m128i hi = _mm_packs_epi32(rgba[2].value, rgba[3].value);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    VSNRAY_ALIGN(16) int rgba[4];
+
+    for (; i < count; ++i)
+    {
+        simd::float4 v(source[i].data());
+        store(rgba, convert_to_int(saturate(v) * simd::float4(255.0f)));
+
+        target[i].x.value = static_cast<uint8_t>(rgba[0]);
+        target[i].y.value = static_cast<uint8_t>(rgba[1]);
+        target[i].z.value = static_cast<uint8_t>(rgba[2]);
+        target[i].w.value = static_cast<uint8_t>(rgba[3]);
+    }
+}
+
 } // visionaray
 
 
@@ -8,6 +8,8 @@
 #include <visionaray/aligned_vector.h>
 
 #include "color_conversion.h"
+#include "thread_pool.h"
+#include "tiled_layout.h"
 
 
 namespace visionaray
@@ -26,6 +28,15 @@ struct cpu_buffer_rt<ColorFormat, DepthFormat>::impl
 
     aligned_vector<color_type>              color_buffer;
     aligned_vector<depth_type>              depth_buffer;
+
+    aov_buffer                              aovs;
+
+    render_target_layout                    layout = RT_LINEAR;
+
+    // Tile-major storage, only allocated in tiled mode, and the caller's threads to resolve it
+    aligned_vector<color_type>              tiled_color_buffer;
+    aligned_vector<depth_type>              tiled_depth_buffer;
+    thread_pool*                            pool = nullptr;
 };
 
 
@@ -66,9 +77,46 @@ typename cpu_buffer_rt<ColorFormat, DepthFormat>::depth_type const* cpu_buffer_r
     return impl_->depth_buffer.data();
 }
 
+template <pixel_format ColorFormat, pixel_format DepthFormat>
+aov_buffer& cpu_buffer_rt<ColorFormat, DepthFormat>::aovs()
+{
+    return impl_->aovs;
+}
+
+template <pixel_format ColorFormat, pixel_format DepthFormat>
+aov_buffer const& cpu_buffer_rt<ColorFormat, DepthFormat>::aovs() const
+{
+    return impl_->aovs;
+}
+
+template <pixel_format ColorFormat, pixel_format DepthFormat>
+void cpu_buffer_rt<ColorFormat, DepthFormat>::set_layout(render_target_layout layout, thread_pool* pool)
+{
+    impl_->layout = layout;
+    impl_->pool = pool;
+
+    size_t tiled_size = layout == RT_TILED ? detail::tiled_buffer_size<ref_type>(width(), height()) : 0;
+
+    impl_->tiled_color_buffer.resize(tiled_size);
+
+    if (DepthFormat != PF_UNSPECIFIED)
+    {
+        impl_->tiled_depth_buffer.resize(tiled_size);
+    }
+}
+
+template <pixel_format ColorFormat, pixel_format DepthFormat>
+render_target_layout cpu_buffer_rt<ColorFormat, DepthFormat>::get_layout() const
+{
+    return impl_->layout;
+}
+
 template <pixel_format ColorFormat, pixel_format DepthFormat>
 typename cpu_buffer_rt<ColorFormat, DepthFormat>::ref_type cpu_buffer_rt<ColorFormat, DepthFormat>::ref()
 {
+    auto tiled_color = impl_->tiled_color_buffer.empty() ? nullptr : impl_->tiled_color_buffer.data();
+    auto tiled_depth = impl_->tiled_depth_buffer.empty() ? nullptr : impl_->tiled_depth_buffer.data();
+
 #if defined(__HCC__)
     // TODO: check why aggregate initialization doesn't work with hcc here
     typename cpu_buffer_rt<ColorFormat, DepthFormat>::ref_type result;
@@ -76,9 +124,12 @@ typename cpu_buffer_rt<ColorFormat, DepthFormat>::ref_type cpu_buffer_rt<ColorFo
     result.depth_  = depth();
     result.width_  = width();
     result.height_ = height();
+    result.aovs_   = impl_->aovs.ref();
+    result.tiled_color_ = tiled_color;
+    result.tiled_depth_ = tiled_depth;
     return result;
 #else
-    return { color(), depth(), width(), height() };
+    return { { { color(), depth(), width(), height() }, impl_->aovs.ref() }, tiled_color, tiled_depth };
 #endif
 }
 
@@ -95,6 +146,9 @@ void cpu_buffer_rt<ColorFormat, DepthFormat>::clear_color_buffer(vec4 const& c)
         );
 
     std::fill(impl_->color_buffer.begin(), impl_->color_buffer.end(), cc);
+    std::fill(impl_->tiled_color_buffer.begin(), impl_->tiled_color_buffer.end(), cc);
+
+    impl_->aovs.clear();
 }
 
 template <pixel_format ColorFormat, pixel_format DepthFormat>
@@ -110,6 +164,7 @@ void cpu_buffer_rt<ColorFormat, DepthFormat>::clear_depth_buffer(float d)
         );
 
     std::fill(impl_->depth_buffer.begin(), impl_->depth_buffer.end(), dd);
+    std::fill(impl_->tiled_depth_buffer.begin(), impl_->tiled_depth_buffer.end(), dd);
 }
 
 template <pixel_format ColorFormat, pixel_format DepthFormat>
@@ -120,6 +175,28 @@ void cpu_buffer_rt<ColorFormat, DepthFormat>::begin_frame()
 template <pixel_format ColorFormat, pixel_format DepthFormat>
 void cpu_buffer_rt<ColorFormat, DepthFormat>::end_frame()
 {
+    // Resolve tiles
+    if (impl_->layout == RT_TILED)
+    {
+        detail::linearize_tiles<ref_type>(
+                impl_->tiled_color_buffer.data(),
+                impl_->color_buffer.data(),
+                width(),
+                height(),
+                impl_->pool
+                );
+
+        if (DepthFormat != PF_UNSPECIFIED)
+        {
+            detail::linearize_tiles<ref_type>(
+                    impl_->tiled_depth_buffer.data(),
+                    impl_->depth_buffer.data(),
+                    width(),
+                    height(),
+                    impl_->pool
+                    );
+        }
+    }
 }
 
 template <pixel_format ColorFormat, pixel_format DepthFormat>
@@ -137,6 +214,17 @@ void cpu_buffer_rt<ColorFormat, DepthFormat>::resize(int w, int h)
         impl_->depth_buffer.resize(w * h);
     }
 
+    impl_->aovs.resize(w, h);
+
+    size_t tiled_size = impl_->layout == RT_TILED ? detail::tiled_buffer_size<ref_type>(w, h) : 0;
+
+    impl_->tiled_color_buffer.resize(tiled_size);
+
+    if (DepthFormat != PF_UNSPECIFIED)
+    {
+        impl_->tiled_depth_buffer.resize(tiled_size);
+    }
+
     if (!impl_->compositor)
     {
         impl_->compositor.reset(new gl::depth_compositor);
@@ -0,0 +1,493 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cmath>
+
+#include "../math/constants.h"
+#include "../math/simd/simd.h"
+#include "../math/array.h"
+#include "../light_sampler.h"
+#include "../sampling.h"
+#include "../spectrum.h"
+#include "color_conversion.h"
+
+namespace visionaray
+{
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Equirectangular mapping, theta is measured from +y
+//
+
+template <typename T>
+VSNRAY_FUNC
+inline vector<2, T> direction_to_equirect(vector<3, T> const& dir)
+{
+    T theta = acos(clamp(dir.y, T(-1.0), T(1.0)));
+    T phi = atan2(dir.z, dir.x);
+    phi = select(phi < T(0.0), phi + constants::two_pi<T>(), phi);
+
+    return vector<2, T>(phi / constants::two_pi<T>(), theta * constants::inv_pi<T>());
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline vector<3, T> equirect_to_direction(vector<2, T> const& uv)
+{
+    T theta = uv.y * constants::pi<T>();
+    T phi = uv.x * constants::two_pi<T>();
+
+    T sin_theta = sin(theta);
+
+    return vector<3, T>(sin_theta * cos(phi), cos(theta), sin_theta * sin(phi));
+}
+
+// Index i with cdf[i] <= u < cdf[i + 1]
+template <typename T>
+VSNRAY_FUNC
+inline int find_interval(T const* cdf, int size, T u)
+{
+    int first = 0;
+    int last = size - 1;
+
+    while (first + 1 < last)
+    {
+        int mid = (first + last) / 2;
+
+        if (cdf[mid] <= u)
+        {
+            first = mid;
+        }
+        else
+        {
+            last = mid;
+        }
+    }
+
+    return first;
+}
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// environment_light members
+//
+
+template <typename T>
+VSNRAY_FUNC
+inline vector<3, T> environment_light<T>::radiance(vector<3, T> const& dir) const
+{
+    vector<2, T> uv = detail::direction_to_equirect(dir);
+
+    // Bilinear, wrap in u, clamp in v
+    T x = uv.x * width_ - T(0.5);
+    T y = uv.y * height_ - T(0.5);
+
+    T fx = x - floor(x);
+    T fy = y - floor(y);
+
+    int x0 = static_cast<int>(floor(x));
+    int y0 = static_cast<int>(floor(y));
+
+    int x1 = x0 + 1;
+    int y1 = y0 + 1;
+
+    x0 = (x0 % width_ + width_) % width_;
+    x1 = x1 % width_;
+    y0 = max(y0, 0);
+    y1 = min(y1, height_ - 1);
+
+    vector<4, T> c = lerp(
+            lerp(texels_[y0 * width_ + x0], texels_[y0 * width_ + x1], fx),
+            lerp(texels_[y1 * width_ + x0], texels_[y1 * width_ + x1], fx),
+            fy
+            );
+
+    return c.xyz() * scale_;
+}
+
+template <typename T>
+template <typename U, typename>
+inline vector<3, U> environment_light<T>::radiance(vector<3, U> const& dir) const
+{
+    auto dirs = simd::unpack(dir);
+
+    array<vector<3, T>, simd::num_elements<U>::value> result;
+
+    for (int i = 0; i < simd::num_elements<U>::value; ++i)
+    {
+        result[i] = radiance(dirs[i]);
+    }
+
+    return simd::pack(result);
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline T environment_light<T>::pdf(vector<3, T> const& dir) const
+{
+    vector<2, T> uv = detail::direction_to_equirect(dir);
+
+    T sin_theta = sin(uv.y * constants::pi<T>());
+
+    if (sin_theta <= T(0.0))
+    {
+        return T(0.0);
+    }
+
+    int x = min(static_cast<int>(uv.x * width_), width_ - 1);
+    int y = min(static_cast<int>(uv.y * height_), height_ - 1);
+
+    T pdf_uv = func_[y * width_ + x] * inv_func_integral_;
+
+    return pdf_uv / (T(2.0) * constants::pi<T>() * constants::pi<T>() * sin_theta);
+}
+
+template <typename T>
+template <typename U, typename>
+inline U environment_light<T>::pdf(vector<3, U> const& dir) const
+{
+    auto dirs = simd::unpack(dir);
+
+    simd::aligned_array_t<U> result;
+
+    for (int i = 0; i < simd::num_elements<U>::value; ++i)
+    {
+        result[i] = pdf(dirs[i]);
+    }
+
+    return U(result);
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline vector<3, T> environment_light<T>::sample_direction(T u1, T u2, vector<3, T>& dir, T& pdf) const
+{
+    // Row from the marginal distribution
+    int y = detail::find_interval(marginal_cdf_, height_ + 1, u1);
+    T dy = marginal_cdf_[y + 1] - marginal_cdf_[y];
+    dy = dy > T(0.0) ? (u1 - marginal_cdf_[y]) / dy : T(0.5);
+
+    // Column from the conditional distribution of that row
+    T const* cdf = conditional_cdf_ + y * (width_ + 1);
+    int x = detail::find_interval(cdf, width_ + 1, u2);
+    T dx = cdf[x + 1] - cdf[x];
+    dx = dx > T(0.0) ? (u2 - cdf[x]) / dx : T(0.5);
+
+    vector<2, T> uv(
+            (x + dx) / width_,
+            clamp((y + dy) / height_, T(1e-6), T(1.0 - 1e-6))
+            );
+
+    dir = detail::equirect_to_direction(uv);
+
+    T sin_theta = sin(uv.y * constants::pi<T>());
+    T pdf_uv = func_[y * width_ + x] * inv_func_integral_;
+
+    pdf = pdf_uv / (T(2.0) * constants::pi<T>() * constants::pi<T>() * sin_theta);
+
+    return radiance(dir);
+}
+
+template <typename T>
+template <typename U>
+VSNRAY_FUNC
+inline vector<3, U> environment_light<T>::intensity(vector<3, U> const& pos) const
+{
+    VSNRAY_UNUSED(pos);
+
+    return vector<3, U>(0.0);
+}
+
+template <typename T>
+template <typename Generator, typename U>
+VSNRAY_FUNC
+inline light_sample<U> environment_light<T>::sample(Generator& gen) const
+{
+    U u1 = gen.next();
+    U u2 = gen.next();
+
+    vector<3, U> dir;
+    U pdf(0.0);
+
+    light_sample<U> result;
+
+    result.intensity = sample_direction(u1, u2, dir, pdf);
+
+    // Far enough for parallax to be negligible, the sphere area is chosen so that
+    // area / distance^2 is the solid angle 1 / pdf of the sample
+    U distance = U(1e4) * max(radius_, T(1.0));
+
+    result.pos = vector<3, U>(center_) + dir * distance;
+    result.normal = -dir;
+    result.area = pdf > U(0.0) ? distance * distance / pdf : U(0.0);
+    result.delta_light = false;
+
+    return result;
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline vector<3, T> environment_light<T>::position() const
+{
+    return center_;
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline T environment_light<T>::scene_radius() const
+{
+    return radius_;
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline vector<3, T> environment_light<T>::average_radiance() const
+{
+    return average_ * scale_;
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline void environment_light<T>::set_scale(T scale)
+{
+    scale_ = scale;
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline void environment_light<T>::set_scene_bounds(aabb const& bounds)
+{
+    center_ = vector<3, T>(bounds.center());
+    radius_ = T(length(bounds.size()) * 0.5f);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// environment_map members
+//
+
+template <typename Texture>
+inline void environment_map::build(Texture const& tex)
+{
+    texels_ = tex.data();
+    width_  = static_cast<int>(tex.width());
+    height_ = static_cast<int>(tex.height());
+
+    size_t w = static_cast<size_t>(width_);
+    size_t h = static_cast<size_t>(height_);
+
+    func_.resize(w * h);
+    conditional_cdf_.resize(h * (w + 1));
+    marginal_cdf_.resize(h + 1);
+
+    if (w == 0 || h == 0)
+    {
+        return;
+    }
+
+
+    // Luminance weighted by sin(theta) at the row centers, double precision sums
+
+    double total = 0.0;
+    double weight_sum = 0.0;
+    vec3d average(0.0);
+
+    for (size_t y = 0; y < h; ++y)
+    {
+        double sin_theta = std::sin((y + 0.5) / h * constants::pi<double>());
+
+        for (size_t x = 0; x < w; ++x)
+        {
+            vec3 rgb = texels_[y * w + x].xyz();
+            float lum = std::max(rgb_to_luminance(rgb), 0.0f);
+
+            func_[y * w + x] = static_cast<float>(lum * sin_theta);
+            total += func_[y * w + x];
+
+            average += vec3d(rgb) * sin_theta;
+            weight_sum += sin_theta;
+        }
+    }
+
+    average_ = vec3(average / weight_sum);
+
+    // Black images: sample uniformly over the sphere
+    if (total <= 0.0)
+    {
+        total = 0.0;
+
+        for (size_t y = 0; y < h; ++y)
+        {
+            float sin_theta = static_cast<float>(std::sin((y + 0.5) / h * constants::pi<double>()));
+
+            for (size_t x = 0; x < w; ++x)
+            {
+                func_[y * w + x] = sin_theta;
+                total += sin_theta;
+            }
+        }
+    }
+
+    // pdf over [0,1)^2 is func * w * h / total
+    inv_func_integral_ = static_cast<float>(w * h / total);
+
+
+    // CDFs
+
+    for (size_t y = 0; y < h; ++y)
+    {
+        float* cdf = conditional_cdf_.data() + y * (w + 1);
+
+        double row_sum = 0.0;
+        cdf[0] = 0.0f;
+
+        for (size_t x = 0; x < w; ++x)
+        {
+            row_sum += func_[y * w + x];
+            cdf[x + 1] = static_cast<float>(row_sum);
+        }
+
+        for (size_t x = 1; x <= w; ++x)
+        {
+            cdf[x] = row_sum > 0.0 ? static_cast<float>(cdf[x] / row_sum) : static_cast<float>(x) / w;
+        }
+
+        cdf[w] = 1.0f;
+
+        marginal_cdf_[y + 1] = static_cast<float>(row_sum);
+    }
+
+    double sum = 0.0;
+    marginal_cdf_[0] = 0.0f;
+
+    for (size_t y = 0; y < h; ++y)
+    {
+        sum += marginal_cdf_[y + 1];
+        marginal_cdf_[y + 1] = static_cast<float>(sum / total);
+    }
+
+    marginal_cdf_[h] = 1.0f;
+}
+
+inline environment_light<float> environment_map::light(aabb const& scene_bounds, float scale) const
+{
+    environment_light<float> result;
+
+    result.texels_            = texels_;
+    result.width_             = width_;
+    result.height_            = height_;
+    result.func_              = func_.data();
+    result.conditional_cdf_   = conditional_cdf_.data();
+    result.marginal_cdf_      = marginal_cdf_.data();
+    result.inv_func_integral_ = inv_func_integral_;
+    result.average_           = average_;
+    result.scale_             = scale;
+
+    result.set_scene_bounds(scene_bounds);
+
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Radiance for rays that leave the scene
+//
+
+namespace detail
+{
+
+template <typename Params>
+struct has_environment_light
+{
+    template <typename U>
+    static std::true_type test(decltype(&U::environment));
+
+    template <typename U>
+    static std::false_type test(...);
+
+    using type = decltype( test<Params>(nullptr) );
+    static const bool value = type::value;
+};
+
+// Ambient color
+template <typename Params, typename R, typename M, typename S>
+VSNRAY_FUNC
+inline spectrum<S> escaped_radiance(
+        std::false_type         /* */,
+        Params const&           params,
+        R const&                ray,
+        M const&                mis,
+        S const&                brdf_pdf
+        )
+{
+    VSNRAY_UNUSED(ray, mis, brdf_pdf);
+
+    return spectrum<S>(from_rgba(params.ambient_color));
+}
+
+template <typename Params, typename R, typename M, typename S>
+VSNRAY_FUNC
+inline spectrum<S> escaped_radiance(
+        std::true_type          /* */,
+        Params const&           params,
+        R const&                ray,
+        M const&                mis,
+        S const&                brdf_pdf
+        )
+{
+    auto const& env = params.environment;
+
+    vector<3, S> L = env.light.radiance(ray.dir);
+
+    S weight(1.0);
+
+    if (env.index >= 0 && any(mis))
+    {
+        S light_pdf = env.light.pdf(ray.dir) * light_index_pmf(params, ray.ori, env.index);
+        weight = select(mis, power_heuristic(brdf_pdf, light_pdf), S(1.0));
+    }
+
+    return from_rgb(L * weight);
+}
+
+// Background color for primary rays that miss
+template <typename Params, typename C>
+VSNRAY_FUNC
+inline C primary_miss_color(std::false_type /* */, Params const& params, C const& escaped)
+{
+    VSNRAY_UNUSED(escaped);
+
+    return C(params.bg_color);
+}
+
+template <typename Params, typename C>
+VSNRAY_FUNC
+inline C primary_miss_color(std::true_type /* */, Params const& params, C const& escaped)
+{
+    VSNRAY_UNUSED(params);
+
+    return escaped;
+}
+
+} // detail
+
+// Radiance for a ray that left the scene, mis is the mask of rays that were generated by
+// BRDF sampling and can also be sampled as light, brdf_pdf is the pdf of that BRDF sample
+template <typename Params, typename R, typename M, typename S>
+VSNRAY_FUNC
+inline spectrum<S> escaped_radiance(Params const& params, R const& ray, M const& mis, S const& brdf_pdf)
+{
+    return detail::escaped_radiance(
+            typename detail::has_environment_light<Params>::type{},
+            params,
+            ray,
+            mis,
+            brdf_pdf
+            );
+}
+
+} // visionaray
@@ -2,6 +2,8 @@
 // See the LICENSE file for details.
 
 #include <cstddef>
+#include <type_traits>
+#include <utility>
 
 #include <visionaray/math/array.h>
 #include <visionaray/material.h>
@@ -155,10 +157,31 @@ struct generic_material<T, Ts...>::pdf_visitor
 
 namespace simd
 {
+namespace detail
+{
+
+// Material types with a SIMD implementation (simd::pack() overload)
+template <typename M, size_t N, typename = void>
+struct has_simd_material : std::false_type
+{
+};
+
+template <typename M, size_t N>
+struct has_simd_material<M, N, decltype((void)pack(std::declval<array<M, N>>()))> : std::true_type
+{
+};
+
+} // detail
+
 
 //-------------------------------------------------------------------------------------------------
 // SIMD type used internally. Contains N generic materials
 //
+// Shading groups the lanes by material type. For each type that occurs in the packet, the
+// materials of that type are packed into one SIMD material (SoA layout) and shaded for all
+// lanes at once, the results are merged with the lane mask. Material types without a SIMD
+// implementation are shaded lane by lane.
+//
 
 template <size_t N, typename ...Ts>
 class generic_material
@@ -205,6 +228,122 @@ public:
     template <typename SR>
     VSNRAY_FUNC
     spectrum<scalar_type> shade(SR const& sr) const
+    {
+        spectrum<scalar_type> result(scalar_type(0.0));
+
+        int expand[] = { (shade_type<Ts>(sr, result), 0)... };
+        VSNRAY_UNUSED(expand);
+
+        return result;
+    }
+
+    template <typename SR, typename Generator>
+    VSNRAY_FUNC
+    spectrum<scalar_type> sample(
+            SR const&                sr,
+            vector<3, scalar_type>&  refl_dir,
+            scalar_type&             pdf,
+            int_type_t<scalar_type>& inter,
+            Generator&               gen
+            ) const
+    {
+        spectrum<scalar_type> result(scalar_type(0.0));
+
+        refl_dir = vector<3, scalar_type>(0.0);
+        pdf = scalar_type(0.0);
+        inter = int_type_t<scalar_type>(0);
+
+        int expand[] = { (sample_type<Ts>(sr, refl_dir, pdf, inter, gen, result), 0)... };
+        VSNRAY_UNUSED(expand);
+
+        return result;
+    }
+
+    template <typename SR, typename Interaction>
+    VSNRAY_FUNC
+    scalar_type pdf(SR const& sr, Interaction const& inter) const
+    {
+        scalar_type result(0.0);
+
+        int expand[] = { (pdf_type<Ts>(sr, inter, result), 0)... };
+        VSNRAY_UNUSED(expand);
+
+        return result;
+    }
+
+private:
+
+    using mask_type = mask_type_t<scalar_type>;
+    using has_simd  = std::integral_constant<bool, true>;
+    using no_simd   = std::integral_constant<bool, false>;
+
+    array<single_material, N> mats_;
+
+    // Gather the lanes with material type M, the other lanes get a copy of an active
+    // lane so that SIMD code sees valid parameters. Returns false if no lane has type M.
+    template <typename M>
+    VSNRAY_FUNC
+    bool gather(array<M, N>& mats, mask_type& mask) const
+    {
+        using int_array = aligned_array_t<int_type_t<scalar_type>>;
+
+        int_array active;
+        int first = -1;
+
+        for (size_t i = 0; i < N; ++i)
+        {
+            auto ptr = mats_[i].template as<M>();
+            active[i] = ptr != nullptr;
+
+            if (ptr)
+            {
+                mats[i] = *ptr;
+                first = first < 0 ? static_cast<int>(i) : first;
+            }
+        }
+
+        if (first < 0)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (!active[i])
+            {
+                mats[i] = mats[first];
+            }
+        }
+
+        mask = int_type_t<scalar_type>(active) != int_type_t<scalar_type>(0);
+        return true;
+    }
+
+    // shade() for the lanes with material type M
+
+    template <typename M, typename SR>
+    VSNRAY_FUNC
+    void shade_type(SR const& sr, spectrum<scalar_type>& result) const
+    {
+        array<M, N> mats;
+        mask_type mask;
+
+        if (gather(mats, mask))
+        {
+            result = select(mask, shade_impl(mats, sr, detail::has_simd_material<M, N>{}), result);
+        }
+    }
+
+    template <typename M, typename SR>
+    VSNRAY_FUNC
+    spectrum<scalar_type> shade_impl(array<M, N> const& mats, SR const& sr, has_simd) const
+    {
+        return pack(mats).shade(sr);
+    }
+
+    template <typename M, typename SR>
+    VSNRAY_FUNC
+    spectrum<scalar_type> shade_impl(array<M, N> const& mats, SR const& sr, no_simd) const
     {
         auto srs = unpack(sr);
 
@@ -212,20 +351,68 @@ public:
 
         for (size_t i = 0; i < N; ++i)
         {
-            shaded[i] = mats_[i].shade(srs[i]);
+            shaded[i] = mats[i].shade(srs[i]);
         }
 
         return pack(shaded);
     }
 
-    template <typename SR, typename Generator>
+    // sample() for the lanes with material type M
+
+    template <typename M, typename SR, typename Generator>
     VSNRAY_FUNC
-    spectrum<scalar_type> sample(
+    void sample_type(
             SR const&                sr,
             vector<3, scalar_type>&  refl_dir,
             scalar_type&             pdf,
             int_type_t<scalar_type>& inter,
-            Generator&               gen
+            Generator&               gen,
+            spectrum<scalar_type>&   result
+            ) const
+    {
+        array<M, N> mats;
+        mask_type mask;
+
+        if (gather(mats, mask))
+        {
+            vector<3, scalar_type> rd;
+            scalar_type p;
+            int_type_t<scalar_type> in;
+
+            auto sampled = sample_impl(mats, sr, rd, p, in, gen, detail::has_simd_material<M, N>{});
+
+            result   = select(mask, sampled, result);
+            refl_dir = select(mask, rd, refl_dir);
+            pdf      = select(mask, p, pdf);
+            inter    = select(mask, in, inter);
+        }
+    }
+
+    template <typename M, typename SR, typename Generator>
+    VSNRAY_FUNC
+    spectrum<scalar_type> sample_impl(
+            array<M, N> const&       mats,
+            SR const&                sr,
+            vector<3, scalar_type>&  refl_dir,
+            scalar_type&             pdf,
+            int_type_t<scalar_type>& inter,
+            Generator&               gen,
+            has_simd
+            ) const
+    {
+        return pack(mats).sample(sr, refl_dir, pdf, inter, gen);
+    }
+
+    template <typename M, typename SR, typename Generator>
+    VSNRAY_FUNC
+    spectrum<scalar_type> sample_impl(
+            array<M, N> const&       mats,
+            SR const&                sr,
+            vector<3, scalar_type>&  refl_dir,
+            scalar_type&             pdf,
+            int_type_t<scalar_type>& inter,
+            Generator&               gen,
+            no_simd
             ) const
     {
         using float_array = aligned_array_t<scalar_type>;
@@ -240,7 +427,7 @@ public:
 
         for (size_t i = 0; i < N; ++i)
         {
-            sampled[i] = mats_[i].sample(srs[i], rds[i], pdfs[i], inters[i], gen.get_generator(i));
+            sampled[i] = mats[i].sample(srs[i], rds[i], pdfs[i], inters[i], gen.get_generator(i));
         }
 
         refl_dir = pack(rds);
@@ -249,9 +436,31 @@ public:
         return pack(sampled);
     }
 
-    template <typename SR, typename Interaction>
+    // pdf() for the lanes with material type M
+
+    template <typename M, typename SR, typename Interaction>
     VSNRAY_FUNC
-    scalar_type pdf(SR const& sr, Interaction const& inter) const
+    void pdf_type(SR const& sr, Interaction const& inter, scalar_type& result) const
+    {
+        array<M, N> mats;
+        mask_type mask;
+
+        if (gather(mats, mask))
+        {
+            result = select(mask, pdf_impl(mats, sr, inter, detail::has_simd_material<M, N>{}), result);
+        }
+    }
+
+    template <typename M, typename SR, typename Interaction>
+    VSNRAY_FUNC
+    scalar_type pdf_impl(array<M, N> const& mats, SR const& sr, Interaction const& inter, has_simd) const
+    {
+        return pack(mats).pdf(sr, inter);
+    }
+
+    template <typename M, typename SR, typename Interaction>
+    VSNRAY_FUNC
+    scalar_type pdf_impl(array<M, N> const& mats, SR const& sr, Interaction const& inter, no_simd) const
     {
         using float_array = aligned_array_t<scalar_type>;
         using int_array = aligned_array_t<int_type_t<scalar_type>>;
@@ -264,16 +473,12 @@ public:
 
         for (size_t i = 0; i < N; ++i)
         {
-            pdfs[i] = mats_[i].pdf(srs[i], inters[i]);
+            pdfs[i] = mats[i].pdf(srs[i], inters[i]);
         }
 
         return scalar_type(pdfs);
     }
 
-private:
-
-    array<single_material, N> mats_;
-
 };
 
 
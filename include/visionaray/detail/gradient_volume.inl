@@ -0,0 +1,294 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "../math/simd/simd.h"
+#include "parallel_for.h"
+#include "range.h"
+
+namespace visionaray
+{
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Central differences at voxel (x,y,z), neighbors are clamped at the borders
+//
+
+template <typename Texture>
+inline vec3 voxel_gradient(Texture const& volume, vec3i const& dims, int x, int y, int z)
+{
+    auto at = [&](int i, int j, int k)
+    {
+        return static_cast<float>(volume(
+                std::min(std::max(i, 0), dims.x - 1),
+                std::min(std::max(j, 0), dims.y - 1),
+                std::min(std::max(k, 0), dims.z - 1)
+                ));
+    };
+
+    return vec3(
+            (at(x + 1, y, z) - at(x - 1, y, z)) * dims.x,
+            (at(x, y + 1, z) - at(x, y - 1, z)) * dims.y,
+            (at(x, y, z + 1) - at(x, y, z - 1)) * dims.z
+            ) * 0.5f;
+}
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// gradient_volume_ref members
+//
+
+VSNRAY_FUNC
+inline vec3 gradient_volume_ref::value(int x, int y, int z) const
+{
+    packed_gradient g = data[(z * dims.y + y) * dims.x + x];
+
+    float magnitude = static_cast<float>(g.magnitude) * max_magnitude;
+
+    return oct_decode(vec2(static_cast<float>(g.normal[0]), static_cast<float>(g.normal[1]))) * magnitude;
+}
+
+VSNRAY_FUNC
+inline vec3 gradient_volume_ref::sample(vec3 const& coord) const
+{
+    vec3 texel = coord * vec3(dims) - vec3(0.5f);
+
+    if (filter_mode == Nearest)
+    {
+        vec3i i = clamp(vec3i(floor(texel + vec3(0.5f))), vec3i(0), dims - vec3i(1));
+        return value(i.x, i.y, i.z);
+    }
+
+    vec3 f = floor(texel);
+    vec3 frac = texel - f;
+
+    vec3i lo = clamp(vec3i(f), vec3i(0), dims - vec3i(1));
+    vec3i hi = clamp(vec3i(f) + vec3i(1), vec3i(0), dims - vec3i(1));
+
+    vec3 c00 = lerp(value(lo.x, lo.y, lo.z), value(hi.x, lo.y, lo.z), frac.x);
+    vec3 c10 = lerp(value(lo.x, hi.y, lo.z), value(hi.x, hi.y, lo.z), frac.x);
+    vec3 c01 = lerp(value(lo.x, lo.y, hi.z), value(hi.x, lo.y, hi.z), frac.x);
+    vec3 c11 = lerp(value(lo.x, hi.y, hi.z), value(hi.x, hi.y, hi.z), frac.x);
+
+    return lerp(lerp(c00, c10, frac.y), lerp(c01, c11, frac.y), frac.z);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// gradient() with SIMD coordinates
+//
+// Loads the packed gradients per lane, decodes and filters them with SIMD
+//
+
+namespace detail
+{
+
+// Decoded gradients of the voxels with linear indices index
+template <typename I>
+inline vector<3, simd::float_type_t<I>> gradient_values(gradient_volume_ref const& grad, I const& index)
+{
+    using F = simd::float_type_t<I>;
+    using int_array = simd::aligned_array_t<I>;
+
+    int_array indices;
+    store(indices, index);
+
+    int_array nx;
+    int_array ny;
+    int_array magnitude;
+
+    for (int i = 0; i < simd::num_elements<I>::value; ++i)
+    {
+        packed_gradient const& g = grad.data[indices[i]];
+        nx[i] = g.normal[0].value;
+        ny[i] = g.normal[1].value;
+        magnitude[i] = g.magnitude.value;
+    }
+
+    // Cf. snorm_to_float() and unorm_to_float()
+    vector<2, F> e(
+            max(convert_to_float(I(nx)) / F(32767.0f), F(-1.0f)),
+            max(convert_to_float(I(ny)) / F(32767.0f), F(-1.0f))
+            );
+
+    F m = convert_to_float(I(magnitude)) / F(65535.0f) * F(grad.max_magnitude);
+
+    return oct_decode(e) * m;
+}
+
+} // detail
+
+template <typename F, typename>
+inline vector<3, F> gradient(gradient_volume_ref const& grad, vector<3, F> const& coord)
+{
+    using I = simd::int_type_t<F>;
+    using V = vector<3, F>;
+
+    V dims(F(static_cast<float>(grad.dims.x)), F(static_cast<float>(grad.dims.y)), F(static_cast<float>(grad.dims.z)));
+    V max_index = dims - V(F(1.0f));
+
+    V texel = coord * dims - V(F(0.5f));
+
+    auto index = [&](V const& v)
+    {
+        return (convert_to_int(v.z) * I(grad.dims.y) + convert_to_int(v.y)) * I(grad.dims.x) + convert_to_int(v.x);
+    };
+
+    if (grad.filter_mode == Nearest)
+    {
+        V i = clamp(floor(texel + V(F(0.5f))), V(F(0.0f)), max_index);
+        return detail::gradient_values(grad, index(i));
+    }
+
+    V f = floor(texel);
+    V frac = texel - f;
+
+    V lo = clamp(f, V(F(0.0f)), max_index);
+    V hi = clamp(f + V(F(1.0f)), V(F(0.0f)), max_index);
+
+    auto value = [&](F const& x, F const& y, F const& z)
+    {
+        return detail::gradient_values(grad, index(V(x, y, z)));
+    };
+
+    V c00 = lerp(value(lo.x, lo.y, lo.z), value(hi.x, lo.y, lo.z), frac.x);
+    V c10 = lerp(value(lo.x, hi.y, lo.z), value(hi.x, hi.y, lo.z), frac.x);
+    V c01 = lerp(value(lo.x, lo.y, hi.z), value(hi.x, lo.y, hi.z), frac.x);
+    V c11 = lerp(value(lo.x, hi.y, hi.z), value(hi.x, hi.y, hi.z), frac.x);
+
+    return lerp(lerp(c00, c10, frac.y), lerp(c01, c11, frac.y), frac.z);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// gradient_volume members
+//
+
+template <typename Texture>
+inline void gradient_volume::build(Texture const& volume)
+{
+    build_impl(volume, nullptr);
+}
+
+template <typename Texture>
+inline void gradient_volume::build(Texture const& volume, thread_pool& pool)
+{
+    build_impl(volume, &pool);
+}
+
+template <typename Texture>
+inline void gradient_volume::build_impl(Texture const& volume, thread_pool* pool)
+{
+    dims_ = vec3i(
+            static_cast<int>(volume.width()),
+            static_cast<int>(volume.height()),
+            static_cast<int>(volume.depth())
+            );
+
+    data_.resize(static_cast<size_t>(dims_.x) * dims_.y * dims_.z);
+
+    // Maximum gradient length per slice, computing the differences twice is cheaper than
+    // storing them unquantized
+    std::vector<float> slice_max(dims_.z, 0.0f);
+
+    detail::optional_parallel_for(pool, tiled_range1d<int>(0, dims_.z, 1), [&](range1d<int> const& r)
+    {
+        for (int z = r.begin(); z != r.end(); ++z)
+        {
+            for (int y = 0; y < dims_.y; ++y)
+            {
+                for (int x = 0; x < dims_.x; ++x)
+                {
+                    vec3 g = detail::voxel_gradient(volume, dims_, x, y, z);
+                    slice_max[z] = std::max(slice_max[z], length(g));
+                }
+            }
+        }
+    });
+
+    max_magnitude_ = 0.0f;
+
+    for (float m : slice_max)
+    {
+        max_magnitude_ = std::max(max_magnitude_, m);
+    }
+
+    detail::optional_parallel_for(pool, tiled_range1d<int>(0, dims_.z, 1), [&](range1d<int> const& r)
+    {
+        for (int z = r.begin(); z != r.end(); ++z)
+        {
+            for (int y = 0; y < dims_.y; ++y)
+            {
+                for (int x = 0; x < dims_.x; ++x)
+                {
+                    vec3 g = detail::voxel_gradient(volume, dims_, x, y, z);
+                    float len = length(g);
+
+                    packed_gradient& p = data_[(static_cast<size_t>(z) * dims_.y + y) * dims_.x + x];
+
+                    if (len > 0.0f)
+                    {
+                        vec2 e = oct_encode(g / len);
+                        p.normal[0] = e.x;
+                        p.normal[1] = e.y;
+                        p.magnitude = len / max_magnitude_;
+                    }
+                    else
+                    {
+                        p.normal[0] = 0.0f;
+                        p.normal[1] = 0.0f;
+                        p.magnitude = 0.0f;
+                    }
+                }
+            }
+        }
+    });
+}
+
+inline gradient_volume::ref_type gradient_volume::ref() const
+{
+    ref_type result;
+    result.data = data_.data();
+    result.dims = dims_;
+    result.max_magnitude = max_magnitude_;
+    result.filter_mode = filter_mode_;
+    return result;
+}
+
+inline size_t gradient_volume::width() const
+{
+    return static_cast<size_t>(dims_.x);
+}
+
+inline size_t gradient_volume::height() const
+{
+    return static_cast<size_t>(dims_.y);
+}
+
+inline size_t gradient_volume::depth() const
+{
+    return static_cast<size_t>(dims_.z);
+}
+
+inline void gradient_volume::set_filter_mode(tex_filter_mode mode)
+{
+    filter_mode_ = mode;
+}
+
+inline tex_filter_mode gradient_volume::get_filter_mode() const
+{
+    return filter_mode_;
+}
+
+inline vec3 gradient_volume::operator()(size_t x, size_t y, size_t z) const
+{
+    return ref().value(static_cast<int>(x), static_cast<int>(y), static_cast<int>(z));
+}
+
+} // visionaray
@@ -0,0 +1,113 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_DETAIL_GRID_TRAVERSAL_H
+#define VSNRAY_DETAIL_GRID_TRAVERSAL_H 1
+
+#include "../math/aabb.h"
+#include "../math/limits.h"
+#include "../math/ray.h"
+#include "../math/vector.h"
+#include "macros.h"
+
+namespace visionaray
+{
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// 3D DDA over the cells of a uniform grid that is mapped onto bounds
+// See: Amanatides and Woo, A Fast Voxel Traversal Algorithm for Ray Tracing (1987)
+//
+// Cell (i,j,k) covers the texture coordinates [i,i+1) / cells_per_texcoord etc. relative to
+// bounds. [tmin, tmax) must lie inside bounds. Calls func(cell, t_enter, t_exit) for the cells
+// along the ray, front to back, and stops early if func returns false.
+//
+
+template <typename T, typename Func>
+VSNRAY_FUNC
+inline void traverse_grid(
+        basic_ray<T> const& ray,
+        aabb const&         bounds,
+        vec3i const&        dims,
+        vec3 const&         cells_per_texcoord,
+        T                   tmin,
+        T                   tmax,
+        Func                func
+        )
+{
+    using V = vector<3, T>;
+
+    V scale = V(cells_per_texcoord) / V(bounds.size());
+    V p = (ray.ori + ray.dir * tmin - V(bounds.min)) * scale;
+    V d = ray.dir * scale;
+
+    vec3i cell(
+        clamp(static_cast<int>(floor(p.x)), 0, dims.x - 1),
+        clamp(static_cast<int>(floor(p.y)), 0, dims.y - 1),
+        clamp(static_cast<int>(floor(p.z)), 0, dims.z - 1)
+        );
+
+    vec3i step;
+    V t_next;
+    V t_delta;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        if (d[i] > T(0.0))
+        {
+            step[i] = 1;
+            t_next[i] = tmin + (T(cell[i] + 1) - p[i]) / d[i];
+            t_delta[i] = T(1.0) / d[i];
+        }
+        else if (d[i] < T(0.0))
+        {
+            step[i] = -1;
+            t_next[i] = tmin + (T(cell[i]) - p[i]) / d[i];
+            t_delta[i] = T(-1.0) / d[i];
+        }
+        else
+        {
+            step[i] = 0;
+            t_next[i] = numeric_limits<T>::max();
+            t_delta[i] = numeric_limits<T>::max();
+        }
+    }
+
+    T t = tmin;
+
+    for (;;)
+    {
+        int axis = t_next.x < t_next.y ? (t_next.x < t_next.z ? 0 : 2) : (t_next.y < t_next.z ? 1 : 2);
+
+        T t_exit = min(t_next[axis], tmax);
+
+        if (!func(cell, t, t_exit))
+        {
+            return;
+        }
+
+        t = t_exit;
+
+        if (t >= tmax)
+        {
+            return;
+        }
+
+        cell[axis] += step[axis];
+
+        if (cell[axis] < 0 || cell[axis] >= dims[axis])
+        {
+            return;
+        }
+
+        t_next[axis] += t_delta[axis];
+    }
+}
+
+} // detail
+} // visionaray
+
+#endif // VSNRAY_DETAIL_GRID_TRAVERSAL_H
@@ -0,0 +1,655 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <type_traits>
+
+#include "../math/simd/simd.h"
+#include "../math/array.h"
+#include "spd/smits.h"
+#include "color_conversion.h"
+
+namespace visionaray
+{
+
+template <typename T, size_t N>
+constexpr float hero_wavelengths<T, N>::lambda_min;
+
+template <typename T, size_t N>
+constexpr float hero_wavelengths<T, N>::lambda_max;
+
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Apply a function of one wavelength to all SIMD lanes
+//
+
+template <typename Func>
+VSNRAY_FUNC
+inline float apply_per_lane(Func const& func, float lambda)
+{
+    return func(lambda);
+}
+
+template <
+    typename Func,
+    typename T,
+    typename = typename std::enable_if<simd::is_simd_vector<T>::value>::type
+    >
+inline T apply_per_lane(Func const& func, T const& lambda)
+{
+    simd::aligned_array_t<T> arr;
+    store(arr, lambda);
+
+    for (int i = 0; i < simd::num_elements<T>::value; ++i)
+    {
+        arr[i] = func(arr[i]);
+    }
+
+    return T(arr);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// CIE 1931 color matching functions for SIMD types, same fit as cie_x() etc.
+//
+
+template <typename T>
+VSNRAY_FUNC
+inline T cie_lobe(T const& lambda, float mu, float inv_sigma1, float inv_sigma2)
+{
+    T t = (lambda - T(mu)) * select(lambda < T(mu), T(inv_sigma1), T(inv_sigma2));
+    return exp(T(-0.5) * t * t);
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline vector<3, T> cie_xyz(T const& lambda)
+{
+    return vector<3, T>(
+            T(0.362) * cie_lobe(lambda, 442.0f, 0.0624f, 0.0374f)
+          + T(1.056) * cie_lobe(lambda, 599.8f, 0.0264f, 0.0323f)
+          - T(0.065) * cie_lobe(lambda, 501.1f, 0.0490f, 0.0382f),
+            T(0.821) * cie_lobe(lambda, 568.8f, 0.0213f, 0.0247f)
+          + T(0.286) * cie_lobe(lambda, 530.9f, 0.0613f, 0.0322f),
+            T(1.217) * cie_lobe(lambda, 437.0f, 0.0845f, 0.0278f)
+          + T(0.681) * cie_lobe(lambda, 459.0f, 0.0385f, 0.0725f)
+            );
+}
+
+// Integrals of the fits over [360,830] nm, XYZ of a constant 1 spectrum
+VSNRAY_FUNC
+inline vec3 cie_xyz_integral()
+{
+    return vec3(106.714462f, 106.946172f, 106.855454f);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Evaluate a spectrum with one wavelength per lane
+//
+
+template <typename T>
+VSNRAY_FUNC
+inline T evaluate_per_lane(spectrum<T> const& s, T const& lambda, std::false_type /* */)
+{
+    return s(lambda);
+}
+
+template <typename T>
+inline T evaluate_per_lane(spectrum<T> const& s, T const& lambda, std::true_type /* */)
+{
+    simd::aligned_array_t<T> l;
+    simd::aligned_array_t<T> result;
+    simd::aligned_array_t<T> tmp;
+
+    store(l, lambda);
+
+    for (int i = 0; i < simd::num_elements<T>::value; ++i)
+    {
+        store(tmp, s(l[i]));
+        result[i] = tmp[i];
+    }
+
+    return T(result);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Smits' RGB to spectrum conversion
+//
+// A color is the sum of three basis spectra: white times the smallest component, the
+// complement of the smallest component (cyan, magenta, yellow) and the primary of the
+// largest component (red, green, blue). The bases are selected per lane and addressed
+// by their offset into spd_smits::table()
+//
+
+template <typename T>
+struct smits_weights
+{
+    using I = simd::int_type_t<T>;
+
+    T white;
+    T complement;
+    T primary;
+
+    I complement_offset;
+    I primary_offset;
+};
+
+template <typename T>
+inline smits_weights<T> make_smits_weights(vector<3, T> const& rgb)
+{
+    using I = simd::int_type_t<T>;
+
+    const int n = spd_smits::num_bins;
+
+    T r = rgb.x;
+    T g = rgb.y;
+    T b = rgb.z;
+
+    auto r_min = r <= g && r <= b;
+    auto g_min = !r_min && g <= b;
+
+    auto r_max = r > g && r > b;
+    auto g_max = !r_max && g > b;
+
+    T lo  = min(min(r, g), b);
+    T hi  = max(max(r, g), b);
+    T mid = max(min(r, g), min(max(r, g), b));
+
+    smits_weights<T> result;
+
+    result.white      = lo;
+    result.complement = mid - lo;
+    result.primary    = hi - mid;
+
+    result.complement_offset = select(
+            r_min,
+            I(spd_smits::Cyan * n),
+            select(g_min, I(spd_smits::Magenta * n), I(spd_smits::Yellow * n))
+            );
+
+    result.primary_offset = select(
+            r_max,
+            I(spd_smits::Red * n),
+            select(g_max, I(spd_smits::Green * n), I(spd_smits::Blue * n))
+            );
+
+    return result;
+}
+
+// Basis spectra at lambda, interpolated between the bin centers
+template <typename F, typename I>
+inline F smits_basis(F const& lambda, I const& offset)
+{
+    const int n = spd_smits::num_bins;
+
+    F x = clamp((lambda - F(380.0f)) / F(34.0f) - F(0.5f), F(0.0f), F(n - 1.0f));
+    I i = convert_to_int(min(x, F(n - 2.0f)));
+    F s = x - convert_to_float(i);
+
+    I index = offset + i;
+
+    return lerp(gather(spd_smits::table(), index), gather(spd_smits::table(), index + I(1)), s);
+}
+
+// One color, all wavelengths in one SIMD vector
+template <typename T, size_t N>
+inline hero_spectrum<T, N> from_rgb(
+        vector<3, T> const&             rgb,
+        hero_wavelengths<T, N> const&   wl,
+        std::false_type                 /* */
+        )
+{
+    using F = simd::float_from_simd_width_t<N>;
+    using I = simd::int_type_t<F>;
+
+    auto w = make_smits_weights(rgb);
+
+    simd::aligned_array_t<F> arr;
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        arr[i] = wl.lambda[i];
+    }
+
+    F lambda(arr);
+
+    F value = F(w.white)      * smits_basis(lambda, I(0))
+            + F(w.complement) * smits_basis(lambda, I(w.complement_offset))
+            + F(w.primary)    * smits_basis(lambda, I(w.primary_offset));
+
+    store(arr, value);
+
+    hero_spectrum<T, N> result;
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        result[i] = arr[i];
+    }
+
+    return result;
+}
+
+// One color per lane, one wavelength per SIMD vector
+template <typename T, size_t N>
+inline hero_spectrum<T, N> from_rgb(
+        vector<3, T> const&             rgb,
+        hero_wavelengths<T, N> const&   wl,
+        std::true_type                  /* */
+        )
+{
+    using I = simd::int_type_t<T>;
+
+    auto w = make_smits_weights(rgb);
+
+    hero_spectrum<T, N> result;
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        result[i] = w.white      * smits_basis(wl.lambda[i], I(0))
+                  + w.complement * smits_basis(wl.lambda[i], w.complement_offset)
+                  + w.primary    * smits_basis(wl.lambda[i], w.primary_offset);
+    }
+
+    return result;
+}
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// Wavelength sampling
+//
+
+template <size_t N, typename T>
+VSNRAY_FUNC
+inline hero_wavelengths<T, N> sample_hero_wavelengths(T const& u)
+{
+    using W = hero_wavelengths<T, N>;
+
+    const float lmin = W::lambda_min;
+    const float range = W::lambda_max - W::lambda_min;
+
+    W result;
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        T x = u + T(static_cast<float>(i) / N);
+        x = select(x >= T(1.0), x - T(1.0), x);
+        result.lambda[i] = T(lmin) + x * T(range);
+    }
+
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// hero_spectrum members
+//
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N>::hero_spectrum(T const& c)
+    : samples_(c)
+{
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N>::hero_spectrum(vector<N, T> const& samples)
+    : samples_(samples)
+{
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline T& hero_spectrum<T, N>::operator[](size_t i)
+{
+    return samples_[i];
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline T const& hero_spectrum<T, N>::operator[](size_t i) const
+{
+    return samples_[i];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Basic arithmetic
+//
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator-(hero_spectrum<T, N> const& s)
+{
+    return hero_spectrum<T, N>( -s.samples() );
+}
+
+// spectrum op spectrum
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator+(hero_spectrum<T, N> const& s, hero_spectrum<T, N> const& t)
+{
+    return hero_spectrum<T, N>( s.samples() + t.samples() );
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator-(hero_spectrum<T, N> const& s, hero_spectrum<T, N> const& t)
+{
+    return hero_spectrum<T, N>( s.samples() - t.samples() );
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator*(hero_spectrum<T, N> const& s, hero_spectrum<T, N> const& t)
+{
+    return hero_spectrum<T, N>( s.samples() * t.samples() );
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator/(hero_spectrum<T, N> const& s, hero_spectrum<T, N> const& t)
+{
+    return hero_spectrum<T, N>( s.samples() / t.samples() );
+}
+
+// spectrum op scalar
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator+(hero_spectrum<T, N> const& s, T const& t)
+{
+    return hero_spectrum<T, N>( s.samples() + t );
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator-(hero_spectrum<T, N> const& s, T const& t)
+{
+    return hero_spectrum<T, N>( s.samples() - t );
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator*(hero_spectrum<T, N> const& s, T const& t)
+{
+    return hero_spectrum<T, N>( s.samples() * t );
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator/(hero_spectrum<T, N> const& s, T const& t)
+{
+    return hero_spectrum<T, N>( s.samples() / t );
+}
+
+// scalar op spectrum
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator+(T const& s, hero_spectrum<T, N> const& t)
+{
+    return hero_spectrum<T, N>( s + t.samples() );
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator-(T const& s, hero_spectrum<T, N> const& t)
+{
+    return hero_spectrum<T, N>( s - t.samples() );
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator*(T const& s, hero_spectrum<T, N> const& t)
+{
+    return hero_spectrum<T, N>( s * t.samples() );
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> operator/(T const& s, hero_spectrum<T, N> const& t)
+{
+    return hero_spectrum<T, N>( s / t.samples() );
+}
+
+// append operations
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N>& operator+=(hero_spectrum<T, N>& s, hero_spectrum<T, N> const& t)
+{
+    s = s + t;
+    return s;
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N>& operator-=(hero_spectrum<T, N>& s, hero_spectrum<T, N> const& t)
+{
+    s = s - t;
+    return s;
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N>& operator*=(hero_spectrum<T, N>& s, hero_spectrum<T, N> const& t)
+{
+    s = s * t;
+    return s;
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N>& operator/=(hero_spectrum<T, N>& s, hero_spectrum<T, N> const& t)
+{
+    s = s / t;
+    return s;
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N>& operator*=(hero_spectrum<T, N>& s, T const& t)
+{
+    s = s * t;
+    return s;
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N>& operator/=(hero_spectrum<T, N>& s, T const& t)
+{
+    s = s / t;
+    return s;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Misc.
+//
+
+template <typename M, typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> select(M const& m, hero_spectrum<T, N> const& s, hero_spectrum<T, N> const& t)
+{
+    return hero_spectrum<T, N>( select(m, s.samples(), t.samples()) );
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline T mean_value(hero_spectrum<T, N> const& s)
+{
+    return hadd( s.samples() ) / T(N);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Conversions
+//
+
+template <typename SPD, typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> from_spd(SPD const& spd, hero_wavelengths<T, N> const& wl)
+{
+    hero_spectrum<T, N> result;
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        result[i] = detail::apply_per_lane(spd, wl.lambda[i]);
+    }
+
+    return result;
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> from_rgb(vector<3, T> const& rgb, hero_wavelengths<T, N> const& wl)
+{
+    return detail::from_rgb(
+            rgb,
+            wl,
+            std::integral_constant<bool, simd::is_simd_vector<T>::value>{}
+            );
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> from_spectrum(spectrum<T> const& s, hero_wavelengths<T, N> const& wl)
+{
+#if VSNRAY_SPECTRUM_RGB
+    return from_rgb(s.samples(), wl);
+#else
+    hero_spectrum<T, N> result;
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        result[i] = detail::evaluate_per_lane(
+                s,
+                wl.lambda[i],
+                std::integral_constant<bool, simd::is_simd_vector<T>::value>{}
+                );
+    }
+
+    return result;
+#endif
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline vector<3, T> to_xyz(hero_spectrum<T, N> const& s, hero_wavelengths<T, N> const& wl)
+{
+    vector<3, T> xyz(0.0);
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        xyz += detail::cie_xyz(wl.lambda[i]) * s[i];
+    }
+
+    // One sample estimate per wavelength, averaged
+    return xyz / (T(N) * wl.pdf() * T(detail::cie_xyz_integral().y));
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline vector<3, T> to_rgb(hero_spectrum<T, N> const& s, hero_wavelengths<T, N> const& wl)
+{
+    // The white point of the constant spectrum is E, not D65
+    vector<3, T> white = xyz_to_rgb( vector<3, T>(detail::cie_xyz_integral() / detail::cie_xyz_integral().y) );
+
+    return xyz_to_rgb( to_xyz(s, wl) ) / white;
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline vector<4, T> to_rgba(hero_spectrum<T, N> const& s, hero_wavelengths<T, N> const& wl)
+{
+    return vector<4, T>( to_rgb(s, wl), T(1.0) );
+}
+
+
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Spectral type of a path, spectrum<T> unless params have hero wavelengths
+//
+
+template <typename Params>
+struct num_hero_wavelengths
+{
+    template <typename U>
+    static auto test(U*) -> std::integral_constant<size_t, decltype(U::hero_wavelengths)::value>;
+
+    template <typename U>
+    static std::integral_constant<size_t, 0> test(...);
+
+    using type = decltype( test<Params>(nullptr) );
+    static const size_t value = type::value;
+};
+
+// RGB paths have no wavelengths
+struct rgb_wavelengths {};
+
+template <typename Params, typename T, size_t N = num_hero_wavelengths<Params>::value>
+struct path_spectrum
+{
+    using type = hero_spectrum<T, N>;
+    using wavelengths_type = hero_wavelengths<T, N>;
+};
+
+template <typename Params, typename T>
+struct path_spectrum<Params, T, 0>
+{
+    using type = spectrum<T>;
+    using wavelengths_type = rgb_wavelengths;
+};
+
+template <typename Generator>
+VSNRAY_FUNC
+inline void sample_wavelengths(rgb_wavelengths& /* */, Generator& /* */)
+{
+}
+
+template <typename T, size_t N, typename Generator>
+VSNRAY_FUNC
+inline void sample_wavelengths(hero_wavelengths<T, N>& wl, Generator& gen)
+{
+    wl = sample_hero_wavelengths<N>(gen.next());
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline spectrum<T> to_path_spectrum(spectrum<T> const& s, rgb_wavelengths const& /* */)
+{
+    return s;
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> to_path_spectrum(spectrum<T> const& s, hero_wavelengths<T, N> const& wl)
+{
+    return from_spectrum(s, wl);
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline vector<4, T> path_to_rgba(spectrum<T> const& s, rgb_wavelengths const& /* */)
+{
+    return to_rgba(s);
+}
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline vector<4, T> path_to_rgba(hero_spectrum<T, N> const& s, hero_wavelengths<T, N> const& wl)
+{
+    return to_rgba(s, wl);
+}
+
+} // detail
+} // visionaray
@@ -0,0 +1,345 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cstddef>
+
+#include "../math/simd/simd.h"
+#include "../math/intersect.h"
+#include "../math/limits.h"
+#include "grid_traversal.h"
+
+namespace visionaray
+{
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Scalar generator that returns one lane of a SIMD generator
+//
+
+template <typename Generator>
+class lane_generator
+{
+public:
+
+    using value_type = float;
+
+    lane_generator(Generator& gen, int lane)
+        : gen_(gen)
+        , lane_(lane)
+    {
+    }
+
+    float next()
+    {
+        simd::aligned_array_t<typename Generator::value_type> u;
+        store(u, gen_.next());
+        return u[lane_];
+    }
+
+private:
+
+    Generator& gen_;
+    int lane_;
+
+};
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// majorant_grid members
+//
+
+template <typename Texture>
+inline void majorant_grid::build(Texture const& density, int cell_size)
+{
+    int w = static_cast<int>(density.width());
+    int h = static_cast<int>(density.height());
+    int d = static_cast<int>(density.depth());
+
+    ref_.dims = vec3i(div_up(w, cell_size), div_up(h, cell_size), div_up(d, cell_size));
+    ref_.cells_per_texcoord = vec3(w, h, d) / static_cast<float>(cell_size);
+
+    data_.resize(ref_.dims.x * ref_.dims.y * ref_.dims.z);
+
+    ref_.max_majorant = 0.0f;
+
+    for (int z = 0; z < ref_.dims.z; ++z)
+    {
+        for (int y = 0; y < ref_.dims.y; ++y)
+        {
+            for (int x = 0; x < ref_.dims.x; ++x)
+            {
+                // Voxel centers are at i + 0.5, interpolation inside the cell
+                // reads one voxel beyond the cell on each side
+                int x0 = std::max(x * cell_size - 1, 0);
+                int y0 = std::max(y * cell_size - 1, 0);
+                int z0 = std::max(z * cell_size - 1, 0);
+                int x1 = std::min((x + 1) * cell_size, w - 1);
+                int y1 = std::min((y + 1) * cell_size, h - 1);
+                int z1 = std::min((z + 1) * cell_size, d - 1);
+
+                float m = 0.0f;
+
+                for (int k = z0; k <= z1; ++k)
+                {
+                    for (int j = y0; j <= y1; ++j)
+                    {
+                        for (int i = x0; i <= x1; ++i)
+                        {
+                            m = std::max(m, static_cast<float>(density(i, j, k)));
+                        }
+                    }
+                }
+
+                data_[(z * ref_.dims.y + y) * ref_.dims.x + x] = m;
+                ref_.max_majorant = std::max(ref_.max_majorant, m);
+            }
+        }
+    }
+
+    ref_.data = data_.data();
+}
+
+inline majorant_grid_ref majorant_grid::ref() const
+{
+    return ref_;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// heterogeneous_medium members
+//
+
+template <typename T>
+template <typename U>
+VSNRAY_FUNC
+inline spectrum<U> heterogeneous_medium<T>::tr(vector<3, U> const& wo, vector<3, U> const& wi) const
+{
+    return spectrum<U>(phase_.tr(wo, wi));
+}
+
+template <typename T>
+template <typename U, typename Generator>
+VSNRAY_FUNC
+inline spectrum<U> heterogeneous_medium<T>::sample(
+        vector<3, U> const& wo,
+        vector<3, U>&       wi,
+        U&                  pdf,
+        Generator&          gen
+        ) const
+{
+    return spectrum<U>(phase_.sample(wo, wi, pdf, gen));
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline T heterogeneous_medium<T>::extinction(vector<3, T> const& pos) const
+{
+    vector<3, T> coord = (pos - vector<3, T>(bounds_.min)) / vector<3, T>(bounds_.size());
+    return T(tex3D(density_, coord)) * density_scale_;
+}
+
+template <typename T>
+template <typename Generator>
+VSNRAY_FUNC
+inline bool heterogeneous_medium<T>::sample_free_flight(
+        basic_ray<T> const& ray,
+        T                   tmin,
+        T                   tmax,
+        T&                  t,
+        Generator&          gen
+        ) const
+{
+    T tr(1.0);
+    return track<false>(ray, tmin, tmax, t, tr, gen);
+}
+
+template <typename T>
+template <typename U, typename Generator, typename>
+inline simd::mask_type_t<U> heterogeneous_medium<T>::sample_free_flight(
+        basic_ray<U> const& ray,
+        U const&            tmin,
+        U const&            tmax,
+        U&                  t,
+        Generator&          gen
+        ) const
+{
+    using int_array = simd::aligned_array_t<simd::int_type_t<U>>;
+    using float_array = simd::aligned_array_t<U>;
+
+    auto rays = simd::unpack(ray);
+
+    float_array tmins;
+    float_array tmaxs;
+    float_array ts;
+    int_array scattered;
+
+    store(tmins, tmin);
+    store(tmaxs, tmax);
+
+    for (int i = 0; i < simd::num_elements<U>::value; ++i)
+    {
+        detail::lane_generator<Generator> lane_gen(gen, i);
+        scattered[i] = sample_free_flight(rays[i], tmins[i], tmaxs[i], ts[i], lane_gen);
+    }
+
+    t = U(ts);
+    return simd::int_type_t<U>(scattered) != simd::int_type_t<U>(0);
+}
+
+template <typename T>
+template <typename Generator>
+VSNRAY_FUNC
+inline T heterogeneous_medium<T>::transmittance(
+        basic_ray<T> const& ray,
+        T                   tmin,
+        T                   tmax,
+        Generator&          gen
+        ) const
+{
+    T t(0.0);
+    T tr(1.0);
+    track<true>(ray, tmin, tmax, t, tr, gen);
+    return tr;
+}
+
+template <typename T>
+template <typename U, typename Generator, typename>
+inline U heterogeneous_medium<T>::transmittance(
+        basic_ray<U> const& ray,
+        U const&            tmin,
+        U const&            tmax,
+        Generator&          gen
+        ) const
+{
+    using float_array = simd::aligned_array_t<U>;
+
+    auto rays = simd::unpack(ray);
+
+    float_array tmins;
+    float_array tmaxs;
+    float_array trs;
+
+    store(tmins, tmin);
+    store(tmaxs, tmax);
+
+    for (int i = 0; i < simd::num_elements<U>::value; ++i)
+    {
+        detail::lane_generator<Generator> lane_gen(gen, i);
+        trs[i] = transmittance(rays[i], tmins[i], tmaxs[i], lane_gen);
+    }
+
+    return U(trs);
+}
+
+template <typename T>
+inline void heterogeneous_medium<T>::set_density(
+        texture_ref<float, 3> const&    density,
+        majorant_grid_ref const&        majorants
+        )
+{
+    density_ = density;
+    majorants_ = majorants;
+}
+
+template <typename T>
+inline void heterogeneous_medium<T>::set_bounds(aabb const& bounds)
+{
+    bounds_ = bounds;
+}
+
+// Walk the majorant grid with a 3D DDA and sample tentative collisions in each cell with
+// the cell's majorant. Exponential distances are memoryless, so sampling restarts at cell
+// boundaries. Delta tracking (Ratio == false) returns at the first real collision, ratio
+// tracking multiplies tr with the probabilities of null collisions.
+template <typename T>
+template <bool Ratio, typename Generator>
+VSNRAY_FUNC
+inline bool heterogeneous_medium<T>::track(
+        basic_ray<T> const& ray,
+        T                   tmin,
+        T                   tmax,
+        T&                  t,
+        T&                  tr,
+        Generator&          gen
+        ) const
+{
+    auto hr = intersect(ray, bounds_);
+
+    tmin = max(tmin, hr.tnear);
+    tmax = min(tmax, hr.tfar);
+
+    t = tmax;
+
+    if (!hr.hit || tmin >= tmax || majorants_.max_majorant <= 0.0f)
+    {
+        return false;
+    }
+
+    bool collided = false;
+
+    detail::traverse_grid(
+            ray,
+            bounds_,
+            majorants_.dims,
+            majorants_.cells_per_texcoord,
+            tmin,
+            tmax,
+            [&](vec3i const& cell, T t_enter, T t_exit) -> bool
+            {
+                T majorant = T(majorants_.majorant(cell.x, cell.y, cell.z)) * density_scale_;
+
+                if (majorant <= T(0.0))
+                {
+                    return true;
+                }
+
+                T inv_majorant = T(1.0) / majorant;
+                T tt = t_enter;
+
+                for (;;)
+                {
+                    tt -= log(T(1.0) - gen.next()) * inv_majorant;
+
+                    if (tt >= t_exit)
+                    {
+                        return true;
+                    }
+
+                    T sigma = extinction(ray.ori + ray.dir * tt);
+
+                    if (Ratio)
+                    {
+                        tr *= max(T(0.0), T(1.0) - sigma * inv_majorant);
+
+                        // Russian roulette for paths with low transmittance
+                        if (tr < T(0.1))
+                        {
+                            T q = max(T(0.05), T(1.0) - tr);
+
+                            if (gen.next() < q)
+                            {
+                                tr = T(0.0);
+                                return false;
+                            }
+
+                            tr /= T(1.0) - q;
+                        }
+                    }
+                    else if (gen.next() * majorant < sigma)
+                    {
+                        t = tt;
+                        collided = true;
+                        return false;
+                    }
+                }
+            }
+            );
+
+    return collided;
+}
+
+} // visionaray
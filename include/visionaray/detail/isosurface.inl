@@ -0,0 +1,559 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cstddef>
+
+#include "../math/simd/simd.h"
+#include "../math/array.h"
+#include "../math/limits.h"
+#include "parallel_for.h"
+#include "range.h"
+
+namespace visionaray
+{
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Octree node on the traversal stack
+//
+
+struct octree_node
+{
+    int     level;
+    vec3i   pos;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Voxels at the corners of cell (x,y,z), corner i is at offset (i & 1, (i >> 1) & 1, i >> 2)
+//
+
+template <typename Texture>
+inline void cell_corners(Texture const& volume, int x, int y, int z, float corners[8])
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        corners[i] = static_cast<float>(volume(x + (i & 1), y + ((i >> 1) & 1), z + (i >> 2)));
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Interpolant along the ray, f(s) = c[0] + c[1] * s + c[2] * s^2 + c[3] * s^3
+//
+
+VSNRAY_FUNC
+inline float eval_cubic(float const c[4], float s)
+{
+    return ((c[3] * s + c[2]) * s + c[1]) * s + c[0];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// First intersection of a ray segment with the isosurface inside a cell
+//
+// ori and dir in cell coordinates, i.e. the cell spans [0,1]^3. Returns true and the ray
+// parameter in t if the interpolant crosses isovalue in [t0,t1].
+//
+
+VSNRAY_FUNC
+inline bool intersect_cell(
+        float const corners[8],
+        vec3 const& ori,
+        vec3 const& dir,
+        float       t0,
+        float       t1,
+        float       isovalue,
+        float&      t
+        )
+{
+    // Expand the trilinear interpolant along p(s) = ori + dir * (t0 + s)
+    vec3 q = ori + dir * t0;
+
+    float c[4] = { -isovalue, 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 8; ++i)
+    {
+        // Linear weights a + b * s per axis
+        vec3 a(
+                i & 1        ? q.x : 1.0f - q.x,
+                (i >> 1) & 1 ? q.y : 1.0f - q.y,
+                i >> 2       ? q.z : 1.0f - q.z
+                );
+
+        vec3 b(
+                i & 1        ? dir.x : -dir.x,
+                (i >> 1) & 1 ? dir.y : -dir.y,
+                i >> 2       ? dir.z : -dir.z
+                );
+
+        c[0] += corners[i] * a.x * a.y * a.z;
+        c[1] += corners[i] * (b.x * a.y * a.z + a.x * b.y * a.z + a.x * a.y * b.z);
+        c[2] += corners[i] * (a.x * b.y * b.z + b.x * a.y * b.z + b.x * b.y * a.z);
+        c[3] += corners[i] * b.x * b.y * b.z;
+    }
+
+    // The extrema of the cubic split [0,len] into monotonic intervals
+    float len = t1 - t0;
+    float splits[4] = { 0.0f, len, len, len };
+    int num_splits = 1;
+
+    float A = 3.0f * c[3];
+    float B = 2.0f * c[2];
+    float C = c[1];
+
+    if (A != 0.0f)
+    {
+        float disc = B * B - 4.0f * A * C;
+
+        if (disc >= 0.0f)
+        {
+            float q = -0.5f * (B + (B < 0.0f ? -sqrt(disc) : sqrt(disc)));
+            float r1 = q / A;
+            float r2 = q != 0.0f ? C / q : r1;
+
+            if (r1 > r2)
+            {
+                float tmp = r1;
+                r1 = r2;
+                r2 = tmp;
+            }
+
+            if (r1 > 0.0f && r1 < len)
+            {
+                splits[num_splits++] = r1;
+            }
+
+            if (r2 > 0.0f && r2 < len && r2 != r1)
+            {
+                splits[num_splits++] = r2;
+            }
+        }
+    }
+    else if (B != 0.0f)
+    {
+        float r = -C / B;
+
+        if (r > 0.0f && r < len)
+        {
+            splits[num_splits++] = r;
+        }
+    }
+
+    splits[num_splits] = len;
+
+    float sa = splits[0];
+    float fa = eval_cubic(c, sa);
+
+    for (int i = 1; i <= num_splits; ++i)
+    {
+        float sb = splits[i];
+        float fb = eval_cubic(c, sb);
+
+        if (fa == 0.0f || fb == 0.0f)
+        {
+            t = t0 + (fa == 0.0f ? sa : sb);
+            return true;
+        }
+
+        if ((fa < 0.0f) != (fb < 0.0f))
+        {
+            // Repeated linear interpolation, the interval is monotonic and stays bracketed
+            for (int j = 0; j < 4; ++j)
+            {
+                float s = sa + (sb - sa) * fa / (fa - fb);
+                float fs = eval_cubic(c, s);
+
+                if (fs == 0.0f)
+                {
+                    t = t0 + s;
+                    return true;
+                }
+
+                if ((fs < 0.0f) == (fa < 0.0f))
+                {
+                    sa = s;
+                    fa = fs;
+                }
+                else
+                {
+                    sb = s;
+                    fb = fs;
+                }
+            }
+
+            t = t0 + sa + (sb - sa) * fa / (fa - fb);
+            return true;
+        }
+
+        sa = sb;
+        fa = fb;
+    }
+
+    return false;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// World space to cell space scale, voxel centers are at integer coordinates
+//
+
+inline vec3 cell_space_scale(isosurface const& iso)
+{
+    vec3 voxels(iso.volume.width(), iso.volume.height(), iso.volume.depth());
+    return voxels / (iso.bounds.max - iso.bounds.min);
+}
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// minmax_octree_ref members
+//
+
+VSNRAY_FUNC
+inline vec2 const& minmax_octree_ref::range(int level, vec3i const& node) const
+{
+    return ranges[offsets[level] + (node.z * dims[level].y + node.y) * dims[level].x + node.x];
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// minmax_octree members
+//
+
+template <typename Texture>
+inline void minmax_octree::build(Texture const& volume)
+{
+    build_impl(volume, nullptr);
+}
+
+template <typename Texture>
+inline void minmax_octree::build(Texture const& volume, thread_pool& pool)
+{
+    build_impl(volume, &pool);
+}
+
+inline minmax_octree::ref_type minmax_octree::ref() const
+{
+    ref_type result;
+    result.ranges = ranges_.data();
+    result.num_levels = num_levels_;
+
+    for (int l = 0; l < num_levels_; ++l)
+    {
+        result.dims[l] = dims_[l];
+        result.offsets[l] = offsets_[l];
+    }
+
+    return result;
+}
+
+inline int minmax_octree::num_levels() const
+{
+    return num_levels_;
+}
+
+inline vec2 minmax_octree::range(int level, int x, int y, int z) const
+{
+    return ranges_[offsets_[level] + (z * dims_[level].y + y) * dims_[level].x + x];
+}
+
+template <typename Texture>
+inline void minmax_octree::build_impl(Texture const& volume, thread_pool* pool)
+{
+    vec3i cells(
+            static_cast<int>(volume.width()) - 1,
+            static_cast<int>(volume.height()) - 1,
+            static_cast<int>(volume.depth()) - 1
+            );
+
+    num_levels_ = 0;
+
+    if (cells.x < 1 || cells.y < 1 || cells.z < 1)
+    {
+        ranges_.clear();
+        return;
+    }
+
+    // Halve until a single node remains
+    size_t size = 0;
+
+    for (vec3i dims = cells; ; dims = (dims + vec3i(1)) / 2)
+    {
+        dims_[num_levels_] = dims;
+        offsets_[num_levels_] = size;
+        size += static_cast<size_t>(dims.x) * dims.y * dims.z;
+        ++num_levels_;
+
+        if (dims.x == 1 && dims.y == 1 && dims.z == 1)
+        {
+            break;
+        }
+    }
+
+    ranges_.resize(size);
+
+    for (int l = 0; l < num_levels_; ++l)
+    {
+        vec3i dims = dims_[l];
+        vec2* level = ranges_.data() + offsets_[l];
+
+        auto slices = [&](range1d<int> const& r)
+        {
+            for (int z = r.begin(); z != r.end(); ++z)
+            {
+                for (int y = 0; y < dims.y; ++y)
+                {
+                    for (int x = 0; x < dims.x; ++x)
+                    {
+                        vec2 range(numeric_limits<float>::max(), -numeric_limits<float>::max());
+
+                        if (l == 0)
+                        {
+                            float corners[8];
+                            detail::cell_corners(volume, x, y, z, corners);
+
+                            for (int i = 0; i < 8; ++i)
+                            {
+                                range.x = std::min(range.x, corners[i]);
+                                range.y = std::max(range.y, corners[i]);
+                            }
+                        }
+                        else
+                        {
+                            vec3i child_dims = dims_[l - 1];
+                            vec2 const* children = ranges_.data() + offsets_[l - 1];
+
+                            for (int i = 0; i < 8; ++i)
+                            {
+                                vec3i c(x * 2 + (i & 1), y * 2 + ((i >> 1) & 1), z * 2 + (i >> 2));
+
+                                if (c.x < child_dims.x && c.y < child_dims.y && c.z < child_dims.z)
+                                {
+                                    vec2 child = children[(c.z * child_dims.y + c.y) * child_dims.x + c.x];
+                                    range.x = std::min(range.x, child.x);
+                                    range.y = std::max(range.y, child.y);
+                                }
+                            }
+                        }
+
+                        level[(z * dims.y + y) * dims.x + x] = range;
+                    }
+                }
+            }
+        };
+
+        detail::optional_parallel_for(pool, tiled_range1d<int>(0, dims.z, 1), slices);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// isosurface members
+//
+
+inline isosurface::isosurface(
+        texture_ref<float, 3> const&    volume,
+        minmax_octree_ref const&        octree,
+        aabb const&                     bounds,
+        float                           isovalue
+        )
+    : volume(volume)
+    , octree(octree)
+    , bounds(bounds)
+    , isovalue(isovalue)
+{
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Ray / isosurface
+//
+
+inline hit_record<basic_ray<float>, primitive<unsigned>> intersect(
+        basic_ray<float> const& ray,
+        isosurface const&       iso
+        )
+{
+    hit_record<basic_ray<float>, primitive<unsigned>> result;
+    result.t = -1.0f;
+
+    auto const& octree = iso.octree;
+
+    if (octree.num_levels == 0)
+    {
+        return result;
+    }
+
+    // Affine transform to cell space, distances along the ray don't change
+    vec3 scale = detail::cell_space_scale(iso);
+
+    basic_ray<float> r;
+    r.ori = (ray.ori - iso.bounds.min) * scale - vec3(0.5f);
+    r.dir = ray.dir * scale;
+
+    vec3 inv_dir = 1.0f / r.dir;
+    vec3 cells(octree.dims[0]);
+
+    // Visit children in the order i ^ mask, nodes that the ray passes first come first
+    int mask = (r.dir.x < 0.0f ? 1 : 0) | (r.dir.y < 0.0f ? 2 : 0) | (r.dir.z < 0.0f ? 4 : 0);
+
+    detail::octree_node stack[8 * minmax_octree_ref::max_levels];
+    int ptr = 0;
+
+    stack[ptr++] = { octree.num_levels - 1, vec3i(0) };
+
+    while (ptr > 0)
+    {
+        detail::octree_node node = stack[--ptr];
+
+        vec2 range = octree.range(node.level, node.pos);
+
+        if (iso.isovalue < range.x || iso.isovalue > range.y)
+        {
+            continue;
+        }
+
+        float size = static_cast<float>(1 << node.level);
+        aabb box(vec3(node.pos) * size, min(vec3(node.pos + vec3i(1)) * size, cells));
+
+        auto hr = intersect(r, box, inv_dir);
+
+        float t0 = max(hr.tnear, 0.0f);
+        float t1 = hr.tfar;
+
+        if (!hr.hit || t0 > t1)
+        {
+            continue;
+        }
+
+        if (node.level > 0)
+        {
+            // Push far to near
+            vec3i child_dims = octree.dims[node.level - 1];
+
+            for (int i = 7; i >= 0; --i)
+            {
+                int c = i ^ mask;
+                vec3i pos = node.pos * 2 + vec3i(c & 1, (c >> 1) & 1, c >> 2);
+
+                if (pos.x < child_dims.x && pos.y < child_dims.y && pos.z < child_dims.z)
+                {
+                    stack[ptr++] = { node.level - 1, pos };
+                }
+            }
+
+            continue;
+        }
+
+        // Front to back, the first hit is the closest one
+        float corners[8];
+        detail::cell_corners(iso.volume, node.pos.x, node.pos.y, node.pos.z, corners);
+
+        float t = 0.0f;
+
+        if (detail::intersect_cell(corners, r.ori - vec3(node.pos), r.dir, t0, t1, iso.isovalue, t))
+        {
+            result.hit = true;
+            result.prim_id = iso.prim_id;
+            result.geom_id = iso.geom_id;
+            result.t = t;
+            result.isect_pos = ray.ori + ray.dir * t;
+            return result;
+        }
+    }
+
+    return result;
+}
+
+template <typename F, typename>
+inline hit_record<basic_ray<F>, primitive<unsigned>> intersect(
+        basic_ray<F> const&     ray,
+        isosurface const&       iso
+        )
+{
+    auto rays = simd::unpack(ray);
+
+    array<hit_record<basic_ray<float>, primitive<unsigned>>, simd::num_elements<F>::value> hrs;
+
+    for (int i = 0; i < simd::num_elements<F>::value; ++i)
+    {
+        hrs[i] = intersect(rays[i], iso);
+    }
+
+    return simd::pack(hrs);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Geometric functions
+//
+
+inline aabb get_bounds(isosurface const& iso)
+{
+    return iso.bounds;
+}
+
+inline void split_primitive(aabb& L, aabb& R, float plane, int axis, isosurface const& iso)
+{
+    L.invalidate();
+    R.invalidate();
+
+    if (iso.bounds.min[axis] <= plane)
+    {
+        L = iso.bounds;
+        L.max[axis] = std::min(L.max[axis], plane);
+    }
+
+    if (iso.bounds.max[axis] >= plane)
+    {
+        R = iso.bounds;
+        R.min[axis] = std::max(R.min[axis], plane);
+    }
+}
+
+template <typename HR>
+inline vec3 get_normal(HR const& hr, isosurface const& iso)
+{
+    vec3 scale = detail::cell_space_scale(iso);
+    vec3 p = (hr.isect_pos - iso.bounds.min) * scale - vec3(0.5f);
+
+    vec3i cells = iso.octree.dims[0];
+    vec3i cell(
+            std::min(std::max(static_cast<int>(floor(p.x)), 0), cells.x - 1),
+            std::min(std::max(static_cast<int>(floor(p.y)), 0), cells.y - 1),
+            std::min(std::max(static_cast<int>(floor(p.z)), 0), cells.z - 1)
+            );
+
+    vec3 w = p - vec3(cell);
+
+    float corners[8];
+    detail::cell_corners(iso.volume, cell.x, cell.y, cell.z, corners);
+
+    // Gradient of the trilinear interpolant
+    vec3 grad(0.0f);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        vec3 a(
+                i & 1        ? w.x : 1.0f - w.x,
+                (i >> 1) & 1 ? w.y : 1.0f - w.y,
+                i >> 2       ? w.z : 1.0f - w.z
+                );
+
+        vec3 s(
+                i & 1        ? 1.0f : -1.0f,
+                (i >> 1) & 1 ? 1.0f : -1.0f,
+                i >> 2       ? 1.0f : -1.0f
+                );
+
+        grad += corners[i] * s * vec3(a.y * a.z, a.x * a.z, a.x * a.y);
+    }
+
+    return normalize(-grad * scale);
+}
+
+} // visionaray
@@ -0,0 +1,570 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cmath>
+
+#include "../math/detail/math.h"
+#include "../math/limits.h"
+#include "../math/simd/simd.h"
+#include "../generic_light.h"
+#include "../point_light.h"
+#include "../spot_light.h"
+
+namespace visionaray
+{
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Influence radius, lights without one are never culled
+//
+
+template <typename Light>
+inline float light_influence_radius(Light const& /* light */)
+{
+    return numeric_limits<float>::max();
+}
+
+template <typename T>
+inline float light_influence_radius(point_light<T> const& light)
+{
+    return static_cast<float>(light.influence_radius());
+}
+
+template <typename T>
+inline float light_influence_radius(spot_light<T> const& light)
+{
+    return static_cast<float>(light.influence_radius());
+}
+
+struct light_influence_radius_visitor
+{
+    using return_type = float;
+
+    template <typename X>
+    return_type operator()(X const& ref) const
+    {
+        return light_influence_radius(ref);
+    }
+};
+
+template <typename ...Ts>
+inline float light_influence_radius(generic_light<Ts...> const& light)
+{
+    return apply_visitor(light_influence_radius_visitor(), light);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Cluster index per SIMD lane
+//
+
+VSNRAY_FUNC
+inline void cluster_indices(light_clusters_ref const& clusters, vec3 const& pos, int* result)
+{
+    result[0] = clusters.cluster_index(pos);
+}
+
+template <typename T, typename = typename std::enable_if<simd::is_simd_vector<T>::value>::type>
+inline void cluster_indices(light_clusters_ref const& clusters, vector<3, T> const& pos, int* result)
+{
+    auto ps = simd::unpack(pos);
+
+    for (int i = 0; i < simd::num_elements<T>::value; ++i)
+    {
+        result[i] = clusters.cluster_index(ps[i]);
+    }
+}
+
+// Mask of the lanes that are in the same cluster as lane
+template <typename T, typename = typename std::enable_if<!simd::is_simd_vector<T>::value>::type>
+VSNRAY_FUNC
+inline bool same_cluster(T /* */, int const* clusters, int lane)
+{
+    VSNRAY_UNUSED(clusters, lane);
+
+    return true;
+}
+
+template <
+    typename T,
+    typename = typename std::enable_if<simd::is_simd_vector<T>::value>::type,
+    typename = void
+    >
+inline simd::mask_type_t<T> same_cluster(T /* */, int const* clusters, int lane)
+{
+    using I = simd::int_type_t<T>;
+
+    simd::aligned_array_t<I> arr;
+    std::copy(clusters, clusters + simd::num_elements<T>::value, arr);
+
+    return I(arr) == I(clusters[lane]);
+}
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// light_clusters_ref members
+//
+
+VSNRAY_FUNC
+inline int light_clusters_ref::cluster_index(vec3 const& pos) const
+{
+    vec4 clip = view_proj * vec4(pos, 1.0f);
+
+    if (clip.w <= 0.0f)
+    {
+        return overflow_cluster();
+    }
+
+    vec3 ndc = clip.xyz() / clip.w;
+
+    if (ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f)
+    {
+        return overflow_cluster();
+    }
+
+    float depth = -(view * vec4(pos, 1.0f)).z;
+
+    return (slice(depth) * num_tiles_y + tile_y(ndc.y)) * num_tiles_x + tile_x(ndc.x);
+}
+
+VSNRAY_FUNC
+inline int light_clusters_ref::overflow_cluster() const
+{
+    return num_tiles_x * num_tiles_y * num_slices;
+}
+
+VSNRAY_FUNC
+inline int light_clusters_ref::tile_x(float ndc_x) const
+{
+    int t = static_cast<int>((ndc_x + 1.0f) * tiles_per_ndc_x);
+    return max(0, min(t, num_tiles_x - 1));
+}
+
+VSNRAY_FUNC
+inline int light_clusters_ref::tile_y(float ndc_y) const
+{
+    int t = static_cast<int>((ndc_y + 1.0f) * tiles_per_ndc_y);
+    return max(0, min(t, num_tiles_y - 1));
+}
+
+VSNRAY_FUNC
+inline int light_clusters_ref::slice(float depth) const
+{
+    if (depth <= z_near)
+    {
+        return 0;
+    }
+
+    int s = static_cast<int>(log(depth / z_near) * slices_per_log_depth);
+    return min(s, num_slices - 1);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// light_clusters members
+//
+
+inline light_clusters::light_clusters(int tile_size, int num_slices)
+    : tile_size_(tile_size)
+    , num_slices_(num_slices)
+{
+    ref_.offsets = nullptr;
+    ref_.indices = nullptr;
+}
+
+template <typename Camera, typename Lights>
+inline void light_clusters::build(Camera const& cam, Lights begin, Lights end)
+{
+    build(
+        cam.get_view_matrix(),
+        cam.get_proj_matrix(),
+        cam.get_viewport(),
+        cam.z_near(),
+        cam.z_far(),
+        begin,
+        end
+        );
+}
+
+template <typename Lights>
+inline void light_clusters::build(
+        mat4 const&     view,
+        mat4 const&     proj,
+        recti const&    viewport,
+        float           z_near,
+        float           z_far,
+        Lights          begin,
+        Lights          end
+        )
+{
+    light_clusters_ref& r = ref_;
+
+    r.view                 = view;
+    r.view_proj            = proj * view;
+    r.num_tiles_x          = std::max(1, div_up(viewport.w, tile_size_));
+    r.num_tiles_y          = std::max(1, div_up(viewport.h, tile_size_));
+    r.num_slices           = std::max(1, num_slices_);
+    r.tiles_per_ndc_x      = 0.5f * viewport.w / tile_size_;
+    r.tiles_per_ndc_y      = 0.5f * viewport.h / tile_size_;
+    r.z_near               = z_near;
+    r.slices_per_log_depth = r.num_slices / std::log(z_far / z_near);
+
+    int num_lights = static_cast<int>(end - begin);
+    int overflow = r.overflow_cluster();
+
+
+    // Cluster range per light: x, y, and slice intervals, empty if the light is outside the frustum
+
+    struct cluster_range
+    {
+        int x0, x1;
+        int y0, y1;
+        int s0, s1;
+    };
+
+    aligned_vector<cluster_range> ranges(num_lights);
+
+    for (int i = 0; i < num_lights; ++i)
+    {
+        cluster_range& cr = ranges[i];
+
+        cr.x0 = 0; cr.x1 = r.num_tiles_x - 1;
+        cr.y0 = 0; cr.y1 = r.num_tiles_y - 1;
+        cr.s0 = 0; cr.s1 = r.num_slices - 1;
+
+        float radius = detail::light_influence_radius(begin[i]);
+
+        if (!(radius < numeric_limits<float>::max()))
+        {
+            continue;
+        }
+
+        vec3 center = (view * vec4(vec3(begin[i].position()), 1.0f)).xyz();
+        float depth = -center.z;
+
+        if (depth + radius <= 0.0f)
+        {
+            // Behind the camera
+            cr.x1 = -1;
+            continue;
+        }
+
+        cr.s0 = r.slice(std::max(depth - radius, 0.0f));
+        cr.s1 = r.slice(depth + radius);
+
+        // Project the corners of the view space bounding box of the influence sphere
+        vec2 ndc_min( numeric_limits<float>::max());
+        vec2 ndc_max(-numeric_limits<float>::max());
+        bool behind = false;
+
+        for (int c = 0; c < 8; ++c)
+        {
+            vec3 corner(
+                center.x + (c & 1 ? radius : -radius),
+                center.y + (c & 2 ? radius : -radius),
+                center.z + (c & 4 ? radius : -radius)
+                );
+
+            vec4 clip = proj * vec4(corner, 1.0f);
+
+            if (clip.w <= 0.0f)
+            {
+                behind = true;
+                break;
+            }
+
+            vec2 ndc = clip.xy() / clip.w;
+            ndc_min = min(ndc_min, ndc);
+            ndc_max = max(ndc_max, ndc);
+        }
+
+        if (behind)
+        {
+            // Box crosses the camera plane, keep all tiles
+            continue;
+        }
+
+        if (ndc_max.x < -1.0f || ndc_min.x > 1.0f || ndc_max.y < -1.0f || ndc_min.y > 1.0f)
+        {
+            cr.x1 = -1;
+            continue;
+        }
+
+        cr.x0 = r.tile_x(ndc_min.x);
+        cr.x1 = r.tile_x(ndc_max.x);
+        cr.y0 = r.tile_y(ndc_min.y);
+        cr.y1 = r.tile_y(ndc_max.y);
+    }
+
+
+    // Count, prefix sum, and fill (CSR layout), the last cluster has all lights
+
+    offsets_.assign(overflow + 2, 0);
+
+    for (int i = 0; i < num_lights; ++i)
+    {
+        cluster_range const& cr = ranges[i];
+
+        for (int s = cr.s0; s <= cr.s1; ++s)
+        {
+            for (int y = cr.y0; y <= cr.y1; ++y)
+            {
+                for (int x = cr.x0; x <= cr.x1; ++x)
+                {
+                    ++offsets_[(s * r.num_tiles_y + y) * r.num_tiles_x + x + 1];
+                }
+            }
+        }
+    }
+
+    offsets_[overflow + 1] = num_lights;
+
+    for (int c = 0; c <= overflow; ++c)
+    {
+        offsets_[c + 1] += offsets_[c];
+    }
+
+    indices_.resize(offsets_[overflow + 1]);
+
+    aligned_vector<int> fill(offsets_.begin(), offsets_.end() - 1);
+
+    for (int i = 0; i < num_lights; ++i)
+    {
+        cluster_range const& cr = ranges[i];
+
+        for (int s = cr.s0; s <= cr.s1; ++s)
+        {
+            for (int y = cr.y0; y <= cr.y1; ++y)
+            {
+                for (int x = cr.x0; x <= cr.x1; ++x)
+                {
+                    indices_[fill[(s * r.num_tiles_y + y) * r.num_tiles_x + x]++] = i;
+                }
+            }
+        }
+
+        indices_[fill[overflow]++] = i;
+    }
+
+    r.offsets = offsets_.data();
+    r.indices = indices_.data();
+}
+
+inline light_clusters_ref light_clusters::ref() const
+{
+    return ref_;
+}
+
+inline size_t light_clusters::num_clusters() const
+{
+    return offsets_.empty() ? 0 : offsets_.size() - 1;
+}
+
+inline size_t light_clusters::num_indices() const
+{
+    return indices_.size();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// light_iterator members
+//
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline light_iterator<Lights, T>::light_iterator(Lights it)
+    : it_(it)
+{
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline auto light_iterator<Lights, T>::operator*() const -> decltype(*Lights())
+{
+    return *it_;
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline Lights light_iterator<Lights, T>::operator->() const
+{
+    return it_;
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline light_iterator<Lights, T>& light_iterator<Lights, T>::operator++()
+{
+    ++it_;
+    return *this;
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline bool light_iterator<Lights, T>::operator!=(light_iterator const& rhs) const
+{
+    return it_ != rhs.it_;
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline typename light_iterator<Lights, T>::mask_type light_iterator<Lights, T>::active() const
+{
+    return mask_type(true);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// cluster_light_iterator members
+//
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline cluster_light_iterator<Lights, T>::cluster_light_iterator()
+    : lane_(Size)
+    , index_(0)
+    , end_(0)
+{
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline cluster_light_iterator<Lights, T>::cluster_light_iterator(
+        Lights                      lights,
+        light_clusters_ref const&   clusters,
+        vector<3, T> const&         pos
+        )
+    : lights_(lights)
+    , offsets_(clusters.offsets)
+    , indices_(clusters.indices)
+    , lane_(-1)
+    , index_(0)
+    , end_(0)
+{
+    detail::cluster_indices(clusters, pos, clusters_);
+    next_lane();
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline auto cluster_light_iterator<Lights, T>::operator*() const -> decltype(*Lights())
+{
+    return lights_[indices_[index_]];
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline Lights cluster_light_iterator<Lights, T>::operator->() const
+{
+    return lights_ + indices_[index_];
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline cluster_light_iterator<Lights, T>& cluster_light_iterator<Lights, T>::operator++()
+{
+    if (++index_ == end_)
+    {
+        next_lane();
+    }
+
+    return *this;
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline bool cluster_light_iterator<Lights, T>::operator!=(cluster_light_iterator const& rhs) const
+{
+    return lane_ != rhs.lane_ || index_ != rhs.index_;
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline typename cluster_light_iterator<Lights, T>::mask_type cluster_light_iterator<Lights, T>::active() const
+{
+    return detail::same_cluster(T(), clusters_, lane_);
+}
+
+template <typename Lights, typename T>
+VSNRAY_FUNC
+inline void cluster_light_iterator<Lights, T>::next_lane()
+{
+    while (++lane_ < Size)
+    {
+        bool visited = false;
+
+        for (int i = 0; i < lane_; ++i)
+        {
+            visited |= clusters_[i] == clusters_[lane_];
+        }
+
+        if (!visited && offsets_[clusters_[lane_]] != offsets_[clusters_[lane_] + 1])
+        {
+            index_ = offsets_[clusters_[lane_]];
+            end_   = offsets_[clusters_[lane_] + 1];
+            return;
+        }
+    }
+
+    // End
+    index_ = 0;
+    end_   = 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Lights that may affect pos
+//
+
+namespace detail
+{
+
+template <typename Params, typename T>
+VSNRAY_FUNC
+inline typename culled_lights_result<Params, T>::type culled_lights_impl(
+        std::false_type         /* */,
+        Params const&           params,
+        vector<3, T> const&     pos
+        )
+{
+    VSNRAY_UNUSED(pos);
+
+    using iterator = light_iterator<typename culled_lights_result<Params, T>::lights_type, T>;
+
+    return { iterator(params.lights.begin), iterator(params.lights.end) };
+}
+
+template <typename Params, typename T>
+VSNRAY_FUNC
+inline typename culled_lights_result<Params, T>::type culled_lights_impl(
+        std::true_type          /* */,
+        Params const&           params,
+        vector<3, T> const&     pos
+        )
+{
+    using iterator = cluster_light_iterator<typename culled_lights_result<Params, T>::lights_type, T>;
+
+    return { iterator(params.lights.begin, params.light_clusters, pos), iterator() };
+}
+
+} // detail
+
+template <typename Params, typename T>
+VSNRAY_FUNC
+inline typename detail::culled_lights_result<Params, T>::type culled_lights(
+        Params const&       params,
+        vector<3, T> const& pos
+        )
+{
+    return detail::culled_lights_impl(
+            typename detail::has_light_clusters<Params>::type{},
+            params,
+            pos
+            );
+}
+
+} // visionaray
@@ -0,0 +1,706 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "../math/constants.h"
+#include "../area_light.h"
+#include "../generic_light.h"
+#include "../random_generator.h"
+#include "../sampling.h"
+
+namespace visionaray
+{
+
+template <typename T>
+class environment_light;
+
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Primitive ID of the geometry that emits light, -1 for lights that cannot be hit
+//
+
+template <typename Light>
+inline int light_prim_id(Light const& /* light */)
+{
+    return -1;
+}
+
+template <typename T, typename Geometry>
+inline int light_prim_id(area_light<T, Geometry> const& light)
+{
+    return static_cast<int>(light.geometry().prim_id);
+}
+
+struct light_prim_id_visitor
+{
+    using return_type = int;
+
+    template <typename X>
+    return_type operator()(X const& ref) const
+    {
+        return light_prim_id(ref);
+    }
+};
+
+template <typename ...Ts>
+inline int light_prim_id(generic_light<Ts...> const& light)
+{
+    return apply_visitor(light_prim_id_visitor(), light);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Power and bounds of a light, estimated from a single light sample
+//
+
+template <typename Light, typename Generator>
+inline void light_power_bounds(Light const& light, Generator& gen, float& power, aabb& bounds)
+{
+    auto ls = light.sample(gen);
+
+    // Delta lights emit into the whole sphere
+    float area = ls.delta_light ? 4.0f * constants::pi<float>() : ls.area;
+    power = std::max(0.0f, (ls.intensity.x + ls.intensity.y + ls.intensity.z) / 3.0f * area);
+
+    // Bounds of a disk with the same area around the light center
+    float radius = ls.delta_light ? 0.0f : std::sqrt(ls.area / constants::pi<float>());
+    vec3 center(light.position());
+    bounds = aabb(center - vec3(radius), center + vec3(radius));
+}
+
+// Environment lights: flux through the scene cross section, bounded by the scene
+template <typename T, typename Generator>
+inline void light_power_bounds(environment_light<T> const& light, Generator& gen, float& power, aabb& bounds)
+{
+    VSNRAY_UNUSED(gen);
+
+    vec3 L(light.average_radiance());
+    float radius = static_cast<float>(light.scene_radius());
+    power = std::max(0.0f, (L.x + L.y + L.z) / 3.0f * constants::pi<float>() * radius * radius);
+
+    vec3 center(light.position());
+    bounds = aabb(center - vec3(radius), center + vec3(radius));
+}
+
+template <typename Generator>
+struct light_power_bounds_visitor
+{
+    using return_type = void;
+
+    light_power_bounds_visitor(Generator& gen, float& power, aabb& bounds)
+        : gen_(gen)
+        , power_(power)
+        , bounds_(bounds)
+    {
+    }
+
+    template <typename X>
+    return_type operator()(X const& ref) const
+    {
+        light_power_bounds(ref, gen_, power_, bounds_);
+    }
+
+    Generator&  gen_;
+    float&      power_;
+    aabb&       bounds_;
+};
+
+template <typename ...Ts, typename Generator>
+inline void light_power_bounds(generic_light<Ts...> const& light, Generator& gen, float& power, aabb& bounds)
+{
+    apply_visitor(light_power_bounds_visitor<Generator>(gen, power, bounds), light);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Importance of a light BVH node for shading position pos
+// Power over squared distance, clamped to the node extent so that nearby nodes do not blow up
+//
+
+VSNRAY_FUNC
+inline float light_importance(light_bvh_node const& node, vec3 const& pos)
+{
+    vec3 d = max(node.bbox.min - pos, max(pos - node.bbox.max, vec3(0.0f)));
+    vec3 e = node.bbox.size() * 0.5f;
+
+    return node.power / max(dot(d, d), max(dot(e, e), 1e-8f));
+}
+
+// Probability to descend into the left child
+VSNRAY_FUNC
+inline float light_left_prob(light_bvh_node const* nodes, light_bvh_node const& node, vec3 const& pos)
+{
+    float wl = light_importance(nodes[node.first_child], pos);
+    float wr = light_importance(nodes[node.first_child + 1], pos);
+
+    return wl + wr > 0.0f ? wl / (wl + wr) : 0.5f;
+}
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// light_sampler_ref members
+//
+
+VSNRAY_FUNC
+inline int light_sampler_ref::sample_index(vec3 const& pos, float u, float& pmf) const
+{
+    if (nodes != nullptr)
+    {
+        int index = 0;
+        pmf = 1.0f;
+
+        while (nodes[index].light < 0)
+        {
+            float pl = detail::light_left_prob(nodes, nodes[index], pos);
+
+            // Reuse u for the next level
+            if (u < pl)
+            {
+                u = u / pl;
+                pmf *= pl;
+                index = nodes[index].first_child;
+            }
+            else
+            {
+                u = min((u - pl) / (1.0f - pl), 0.99999994f);
+                pmf *= 1.0f - pl;
+                index = nodes[index].first_child + 1;
+            }
+        }
+
+        return nodes[index].light;
+    }
+
+    float x = u * num_lights;
+    int i = min(static_cast<int>(x), num_lights - 1);
+
+    int light = x - i < alias_prob[i] ? i : alias[i];
+    pmf = light_pmf[light];
+
+    return light;
+}
+
+VSNRAY_FUNC
+inline float light_sampler_ref::pmf(vec3 const& pos, int light) const
+{
+    if (nodes != nullptr)
+    {
+        int index = 0;
+        float result = 1.0f;
+
+        for (int d = 0; d < depths[light]; ++d)
+        {
+            float pl = detail::light_left_prob(nodes, nodes[index], pos);
+
+            if (paths[light] & (1U << d))
+            {
+                result *= 1.0f - pl;
+                index = nodes[index].first_child + 1;
+            }
+            else
+            {
+                result *= pl;
+                index = nodes[index].first_child;
+            }
+        }
+
+        return result;
+    }
+
+    return light_pmf[light];
+}
+
+template <typename T, typename>
+inline T light_sampler_ref::pmf(vector<3, T> const& pos, int light) const
+{
+    using float_array = simd::aligned_array_t<T>;
+
+    array<vector<3, float>, simd::num_elements<T>::value> positions = simd::unpack(pos);
+
+    float_array result;
+
+    for (int i = 0; i < simd::num_elements<T>::value; ++i)
+    {
+        result[i] = pmf(positions[i], light);
+    }
+
+    return T(result);
+}
+
+VSNRAY_FUNC
+inline int light_sampler_ref::light_index(int prim_id) const
+{
+    return prim_id >= 0 && prim_id < num_prims ? prim_to_light[prim_id] : -1;
+}
+
+// non-simd
+template <typename Lights, typename Generator, typename T, typename>
+VSNRAY_FUNC
+inline light_sample<T> light_sampler_ref::sample(
+        Lights              lights,
+        vector<3, T> const& pos,
+        Generator&          gen,
+        T&                  pmf
+        ) const
+{
+    int light = sample_index(pos, gen.next(), pmf);
+
+    return lights[light].sample(gen);
+}
+
+// simd
+template <typename Lights, typename Generator, typename T, typename, typename>
+inline light_sample<T> light_sampler_ref::sample(
+        Lights              lights,
+        vector<3, T> const& pos,
+        Generator&          gen,
+        T&                  pmf
+        ) const
+{
+    using float_array = simd::aligned_array_t<T>;
+
+    auto u = gen.next();
+
+    float_array uf;
+    store(uf, u);
+
+    array<vector<3, float>, simd::num_elements<T>::value> positions = simd::unpack(pos);
+
+    light_sample<T> result;
+
+    array<vector<3, float>, simd::num_elements<T>::value> poss;
+    array<vector<3, float>, simd::num_elements<T>::value> intensities;
+    array<vector<3, float>, simd::num_elements<T>::value> normals;
+    float* area = reinterpret_cast<float*>(&result.area);
+    int* delta_light = reinterpret_cast<int*>(&result.delta_light);
+    float* pmfs = reinterpret_cast<float*>(&pmf);
+
+    for (size_t i = 0; i < simd::num_elements<T>::value; ++i)
+    {
+        int light = sample_index(positions[i], uf[i], pmfs[i]);
+
+        auto ls = lights[light].sample(gen.get_generator(i));
+
+        poss[i] = ls.pos;
+        intensities[i] = ls.intensity;
+        normals[i] = ls.normal;
+        area[i] = ls.area;
+        delta_light[i] = ls.delta_light ? 0xFFFFFFFF : 0x00000000;
+    }
+
+    result.pos = simd::pack(poss);
+    result.intensity = simd::pack(intensities);
+    result.normal = simd::pack(normals);
+
+    return result;
+}
+
+VSNRAY_FUNC
+inline float light_sampler_ref::pmf_for_primitive(vec3 const& pos, int prim_id) const
+{
+    int light = light_index(prim_id);
+    return light >= 0 ? pmf(pos, light) : 0.0f;
+}
+
+template <typename T, typename I, typename>
+inline T light_sampler_ref::pmf_for_primitive(vector<3, T> const& pos, I const& prim_id) const
+{
+    using float_array = simd::aligned_array_t<T>;
+    using int_array = simd::aligned_array_t<I>;
+
+    array<vector<3, float>, simd::num_elements<T>::value> positions = simd::unpack(pos);
+
+    int_array ids;
+    store(ids, prim_id);
+
+    float_array result;
+
+    for (int i = 0; i < simd::num_elements<T>::value; ++i)
+    {
+        result[i] = pmf_for_primitive(positions[i], ids[i]);
+    }
+
+    return T(result);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// light_sampler members
+//
+
+template <typename Lights>
+inline void light_sampler::build(Lights begin, Lights end, bool build_bvh)
+{
+    size_t num_lights = static_cast<size_t>(end - begin);
+
+    aligned_vector<float> power(num_lights);
+    aligned_vector<aabb> bounds(num_lights);
+
+    random_generator<float> gen(0);
+
+    int max_prim_id = -1;
+
+    for (size_t i = 0; i < num_lights; ++i)
+    {
+        detail::light_power_bounds(begin[i], gen, power[i], bounds[i]);
+
+        max_prim_id = std::max(max_prim_id, detail::light_prim_id(begin[i]));
+    }
+
+    build_alias_table(power);
+
+    if (build_bvh && num_lights > 0)
+    {
+        this->build_bvh(power, bounds);
+    }
+    else
+    {
+        nodes_.clear();
+        paths_.clear();
+        depths_.clear();
+    }
+
+    prim_to_light_.assign(static_cast<size_t>(max_prim_id + 1), -1);
+
+    for (size_t i = 0; i < num_lights; ++i)
+    {
+        int prim_id = detail::light_prim_id(begin[i]);
+
+        if (prim_id >= 0)
+        {
+            prim_to_light_[prim_id] = static_cast<int>(i);
+        }
+    }
+}
+
+inline light_sampler_ref light_sampler::ref() const
+{
+    light_sampler_ref result;
+
+    result.num_lights    = static_cast<int>(pmf_.size());
+    result.alias_prob    = alias_prob_.data();
+    result.alias         = alias_.data();
+    result.light_pmf     = pmf_.data();
+    result.nodes         = nodes_.empty() ? nullptr : nodes_.data();
+    result.paths         = paths_.data();
+    result.depths        = depths_.data();
+    result.prim_to_light = prim_to_light_.data();
+    result.num_prims     = static_cast<int>(prim_to_light_.size());
+
+    return result;
+}
+
+inline size_t light_sampler::num_lights() const
+{
+    return pmf_.size();
+}
+
+inline bool light_sampler::has_bvh() const
+{
+    return !nodes_.empty();
+}
+
+// Vose's alias method
+inline void light_sampler::build_alias_table(aligned_vector<float> const& power)
+{
+    size_t n = power.size();
+
+    alias_prob_.resize(n);
+    alias_.resize(n);
+    pmf_.resize(n);
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    double total = std::accumulate(power.begin(), power.end(), 0.0);
+
+    // Fall back to uniform sampling if no light emits
+    for (size_t i = 0; i < n; ++i)
+    {
+        pmf_[i] = total > 0.0 ? static_cast<float>(power[i] / total) : 1.0f / n;
+    }
+
+    aligned_vector<double> scaled(n);
+    aligned_vector<int> small;
+    aligned_vector<int> large;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        scaled[i] = static_cast<double>(pmf_[i]) * n;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<int>(i));
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        int s = small.back();
+        small.pop_back();
+        int l = large.back();
+
+        alias_prob_[s] = static_cast<float>(scaled[s]);
+        alias_[s] = l;
+
+        scaled[l] -= 1.0 - scaled[s];
+
+        if (scaled[l] < 1.0)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // Remaining entries are 1 up to rounding errors
+    for (int i : large)
+    {
+        alias_prob_[i] = 1.0f;
+        alias_[i] = i;
+    }
+
+    for (int i : small)
+    {
+        alias_prob_[i] = 1.0f;
+        alias_[i] = i;
+    }
+}
+
+// Binary tree over light centers, split at the median of the largest axis
+inline void light_sampler::build_bvh(aligned_vector<float> const& power, aligned_vector<aabb> const& bounds)
+{
+    size_t n = power.size();
+
+    nodes_.clear();
+    nodes_.reserve(2 * n - 1);
+    paths_.assign(n, 0U);
+    depths_.assign(n, 0);
+
+    aligned_vector<int> indices(n);
+    std::iota(indices.begin(), indices.end(), 0);
+
+    struct work_item
+    {
+        int      node;
+        int      first;
+        int      last;
+        unsigned path;
+        int      depth;
+    };
+
+    nodes_.push_back({});
+
+    aligned_vector<work_item> stack;
+    stack.push_back({ 0, 0, static_cast<int>(n), 0U, 0 });
+
+    while (!stack.empty())
+    {
+        work_item w = stack.back();
+        stack.pop_back();
+
+        light_bvh_node node;
+        node.bbox.invalidate();
+        node.power = 0.0f;
+
+        aabb centroids;
+        centroids.invalidate();
+
+        for (int i = w.first; i < w.last; ++i)
+        {
+            node.bbox.insert(bounds[indices[i]]);
+            node.power += power[indices[i]];
+            centroids.insert(bounds[indices[i]].center());
+        }
+
+        if (w.last - w.first == 1)
+        {
+            node.first_child = -1;
+            node.light = indices[w.first];
+
+            paths_[node.light] = w.path;
+            depths_[node.light] = w.depth;
+
+            nodes_[w.node] = node;
+            continue;
+        }
+
+        vec3 extent = centroids.size();
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+        int mid = (w.first + w.last) / 2;
+
+        std::nth_element(
+                indices.begin() + w.first,
+                indices.begin() + mid,
+                indices.begin() + w.last,
+                [&](int a, int b)
+                {
+                    return bounds[a].center()[axis] < bounds[b].center()[axis];
+                }
+                );
+
+        node.first_child = static_cast<int>(nodes_.size());
+        node.light = -1;
+
+        nodes_[w.node] = node;
+
+        nodes_.push_back({});
+        nodes_.push_back({});
+
+        stack.push_back({ node.first_child,     w.first, mid,    w.path,                    w.depth + 1 });
+        stack.push_back({ node.first_child + 1, mid,     w.last, w.path | (1U << w.depth),  w.depth + 1 });
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Light sampling for kernel params
+//
+
+namespace detail
+{
+
+template <typename Params>
+struct has_light_sampler
+{
+    template <typename U>
+    static std::true_type test(decltype(&U::light_sampler));
+
+    template <typename U>
+    static std::false_type test(...);
+
+    using type = decltype( test<Params>(nullptr) );
+    static const bool value = type::value;
+};
+
+// Uniform choice
+template <typename Params, typename T, typename Generator>
+VSNRAY_FUNC
+inline light_sample<T> sample_light_impl(
+        std::false_type         /* */,
+        Params const&           params,
+        vector<3, T> const&     pos,
+        Generator&              gen,
+        T&                      pmf
+        )
+{
+    VSNRAY_UNUSED(pos);
+
+    auto num_lights = params.lights.end - params.lights.begin;
+    pmf = T(1.0f / static_cast<float>(num_lights));
+
+    return sample_random_light(params.lights.begin, params.lights.end, gen);
+}
+
+template <typename Params, typename T, typename Generator>
+VSNRAY_FUNC
+inline light_sample<T> sample_light_impl(
+        std::true_type          /* */,
+        Params const&           params,
+        vector<3, T> const&     pos,
+        Generator&              gen,
+        T&                      pmf
+        )
+{
+    return params.light_sampler.sample(params.lights.begin, pos, gen, pmf);
+}
+
+template <typename Params, typename T, typename I>
+VSNRAY_FUNC
+inline T light_pmf_impl(
+        std::false_type         /* */,
+        Params const&           params,
+        vector<3, T> const&     pos,
+        I const&                prim_id
+        )
+{
+    VSNRAY_UNUSED(pos, prim_id);
+
+    auto num_lights = params.lights.end - params.lights.begin;
+    return T(1.0f / static_cast<float>(num_lights));
+}
+
+template <typename Params, typename T, typename I>
+VSNRAY_FUNC
+inline T light_pmf_impl(
+        std::true_type          /* */,
+        Params const&           params,
+        vector<3, T> const&     pos,
+        I const&                prim_id
+        )
+{
+    return params.light_sampler.pmf_for_primitive(pos, prim_id);
+}
+
+template <typename Params, typename T>
+VSNRAY_FUNC
+inline T light_index_pmf_impl(
+        std::false_type         /* */,
+        Params const&           params,
+        vector<3, T> const&     pos,
+        int                     light
+        )
+{
+    VSNRAY_UNUSED(pos, light);
+
+    auto num_lights = params.lights.end - params.lights.begin;
+    return T(1.0f / static_cast<float>(num_lights));
+}
+
+template <typename Params, typename T>
+VSNRAY_FUNC
+inline T light_index_pmf_impl(
+        std::true_type          /* */,
+        Params const&           params,
+        vector<3, T> const&     pos,
+        int                     light
+        )
+{
+    return params.light_sampler.pmf(pos, light);
+}
+
+} // detail
+
+template <typename Params, typename T, typename Generator>
+VSNRAY_FUNC
+inline light_sample<T> sample_light(Params const& params, vector<3, T> const& pos, Generator& gen, T& pmf)
+{
+    return detail::sample_light_impl(
+            typename detail::has_light_sampler<Params>::type{},
+            params,
+            pos,
+            gen,
+            pmf
+            );
+}
+
+template <typename Params, typename T, typename I>
+VSNRAY_FUNC
+inline T light_pmf(Params const& params, vector<3, T> const& pos, I const& prim_id)
+{
+    return detail::light_pmf_impl(
+            typename detail::has_light_sampler<Params>::type{},
+            params,
+            pos,
+            prim_id
+            );
+}
+
+template <typename Params, typename T>
+VSNRAY_FUNC
+inline T light_index_pmf(Params const& params, vector<3, T> const& pos, int light)
+{
+    return detail::light_index_pmf_impl(
+            typename detail::has_light_sampler<Params>::type{},
+            params,
+            pos,
+            light
+            );
+}
+
+} // visionaray
@@ -0,0 +1,58 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_DETAIL_MAPPED_FILE_H
+#define VSNRAY_DETAIL_MAPPED_FILE_H 1
+
+#include <cstddef>
+#include <string>
+
+#include "../export.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Read-only memory mapped file
+//
+// The operating system pages the file in on first access and may drop clean pages under
+// memory pressure, so files larger than physical memory can be mapped.
+//
+
+class mapped_file
+{
+public:
+
+    mapped_file() = default;
+    VSNRAY_EXPORT ~mapped_file();
+
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+
+    // Returns false if the file cannot be opened or mapped
+    VSNRAY_EXPORT bool open(std::string const& filename);
+
+    VSNRAY_EXPORT void close();
+
+    bool is_open() const { return data_ != nullptr; }
+
+    char const* data() const { return data_; }
+
+    size_t size() const { return size_; }
+
+private:
+
+    char const* data_ = nullptr;
+    size_t      size_ = 0;
+
+    // Platform specific handles
+    void*       file_ = nullptr;
+    void*       mapping_ = nullptr;
+
+};
+
+} // visionaray
+
+#endif // VSNRAY_DETAIL_MAPPED_FILE_H
@@ -180,6 +180,68 @@ inline auto unpack(mirror<FloatT> const& mat)
     return result;
 }
 
+// glass --------------------------------------------------
+
+template <size_t N>
+VSNRAY_FUNC
+inline glass<float_from_simd_width_t<N>> pack(array<glass<float>, N> const& mats)
+{
+    using T = float_from_simd_width_t<N>;
+
+    glass<T> result;
+
+    float* kt = reinterpret_cast<float*>(&result.kt());
+    float* kr = reinterpret_cast<float*>(&result.kr());
+
+    for (size_t i = 0; i < N; ++i)
+    {
+        for (int j = 0; j < spectrum<float>::num_samples; ++j)
+        {
+            float* ct_j = reinterpret_cast<float*>(&result.ct()[j]);
+            float* cr_j = reinterpret_cast<float*>(&result.cr()[j]);
+            float* ior_j = reinterpret_cast<float*>(&result.ior()[j]);
+            ct_j[i] = mats[i].ct()[j];
+            cr_j[i] = mats[i].cr()[j];
+            ior_j[i] = mats[i].ior()[j];
+        }
+        kt[i] = mats[i].kt();
+        kr[i] = mats[i].kr();
+    }
+
+    return result;
+}
+
+template <
+    typename FloatT,
+    typename = typename std::enable_if<is_simd_vector<FloatT>::value>::type
+    >
+VSNRAY_FUNC
+inline auto unpack(glass<FloatT> const& mat)
+    -> array<glass<float>, num_elements<FloatT>::value>
+{
+    array<glass<float>, num_elements<FloatT>::value> result;
+
+    float const* kt = reinterpret_cast<float const*>(&mat.kt());
+    float const* kr = reinterpret_cast<float const*>(&mat.kr());
+
+    for (size_t i = 0; i < num_elements<FloatT>::value; ++i)
+    {
+        for (int j = 0; j < spectrum<float>::num_samples; ++j)
+        {
+            float const* ct_j = reinterpret_cast<float const*>(&mat.ct()[j]);
+            float const* cr_j = reinterpret_cast<float const*>(&mat.cr()[j]);
+            float const* ior_j = reinterpret_cast<float const*>(&mat.ior()[j]);
+            result[i].ct()[j] = ct_j[i];
+            result[i].cr()[j] = cr_j[i];
+            result[i].ior()[j] = ior_j[i];
+        }
+        result[i].kt() = kt[i];
+        result[i].kr() = kr[i];
+    }
+
+    return result;
+}
+
 // plastic ------------------------------------------------
 
 template <size_t N>
@@ -0,0 +1,644 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "../math/simd/simd.h"
+#include "../math/detail/math.h"
+
+namespace visionaray
+{
+namespace detail
+{
+
+static const char paged_volume_magic[8] = { 'V', 'S', 'N', 'R', 'P', 'V', 'O', 'L' };
+static const std::uint32_t paged_volume_version = 1;
+
+// Bricks start after the header, padded to 64 bytes
+static const size_t paged_volume_header_size = 64;
+
+
+//-------------------------------------------------------------------------------------------------
+// LOD levels of a paged volume, halve the resolution until the level fits into one brick
+//
+
+template <typename Level>
+inline std::vector<Level> make_paged_volume_levels(vec3i dims, int brick_size)
+{
+    std::vector<Level> levels;
+
+    int first_brick = 0;
+
+    for (;;)
+    {
+        Level l;
+        l.dims = dims;
+        l.bricks = vec3i(div_up(dims.x, brick_size), div_up(dims.y, brick_size), div_up(dims.z, brick_size));
+        l.first_brick = first_brick;
+        levels.push_back(l);
+
+        first_brick += l.bricks.x * l.bricks.y * l.bricks.z;
+
+        if (l.bricks == vec3i(1))
+        {
+            break;
+        }
+
+        dims = vec3i(div_up(dims.x, 2), div_up(dims.y, 2), div_up(dims.z, 2));
+    }
+
+    return levels;
+}
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// Write paged volume file
+//
+
+template <typename Texture>
+inline bool write_paged_volume(std::string const& filename, Texture const& volume, int brick_size)
+{
+    using T = typename Texture::value_type;
+
+    struct level
+    {
+        vec3i dims;
+        vec3i bricks;
+        int first_brick;
+    };
+
+    vec3i dims(
+        static_cast<int>(volume.width()),
+        static_cast<int>(volume.height()),
+        static_cast<int>(volume.depth())
+        );
+
+    auto levels = detail::make_paged_volume_levels<level>(dims, brick_size);
+
+    std::ofstream file(filename, std::ios::binary);
+
+    if (!file.good())
+    {
+        return false;
+    }
+
+    paged_volume_header header;
+    std::memcpy(header.magic, detail::paged_volume_magic, sizeof(header.magic));
+    header.version    = detail::paged_volume_version;
+    header.voxel_size = static_cast<std::uint32_t>(sizeof(T));
+    header.width      = static_cast<std::uint32_t>(dims.x);
+    header.height     = static_cast<std::uint32_t>(dims.y);
+    header.depth      = static_cast<std::uint32_t>(dims.z);
+    header.brick_size = static_cast<std::uint32_t>(brick_size);
+    header.num_levels = static_cast<std::uint32_t>(levels.size());
+
+    char padded_header[detail::paged_volume_header_size] = { 0 };
+    std::memcpy(padded_header, &header, sizeof(header));
+    file.write(padded_header, sizeof(padded_header));
+
+    int n = brick_size + 2;
+    std::vector<T> brick(n * n * n);
+
+    // Coarser levels are built from the previous one
+    std::vector<T> prev;
+    std::vector<T> curr;
+
+    for (size_t l = 0; l < levels.size(); ++l)
+    {
+        vec3i ldims = levels[l].dims;
+
+        auto voxel = [&](int x, int y, int z) -> T
+        {
+            x = clamp(x, 0, ldims.x - 1);
+            y = clamp(y, 0, ldims.y - 1);
+            z = clamp(z, 0, ldims.z - 1);
+
+            return l == 0 ? volume(x, y, z) : prev[(z * ldims.y + y) * ldims.x + x];
+        };
+
+        vec3i bricks = levels[l].bricks;
+
+        for (int bz = 0; bz < bricks.z; ++bz)
+        {
+            for (int by = 0; by < bricks.y; ++by)
+            {
+                for (int bx = 0; bx < bricks.x; ++bx)
+                {
+                    // Including the halo
+                    vec3i origin = vec3i(bx, by, bz) * brick_size - vec3i(1);
+
+                    for (int z = 0; z < n; ++z)
+                    {
+                        for (int y = 0; y < n; ++y)
+                        {
+                            for (int x = 0; x < n; ++x)
+                            {
+                                brick[(z * n + y) * n + x] = voxel(origin.x + x, origin.y + y, origin.z + z);
+                            }
+                        }
+                    }
+
+                    file.write(reinterpret_cast<char const*>(brick.data()), brick.size() * sizeof(T));
+                }
+            }
+        }
+
+        if (l + 1 < levels.size())
+        {
+            // 2x2x2 box filter
+            vec3i cdims = levels[l + 1].dims;
+            curr.resize(cdims.x * cdims.y * cdims.z);
+
+            for (int z = 0; z < cdims.z; ++z)
+            {
+                for (int y = 0; y < cdims.y; ++y)
+                {
+                    for (int x = 0; x < cdims.x; ++x)
+                    {
+                        float sum = 0.0f;
+
+                        for (int i = 0; i < 8; ++i)
+                        {
+                            sum += static_cast<float>(voxel(x * 2 + (i & 1), y * 2 + ((i >> 1) & 1), z * 2 + (i >> 2)));
+                        }
+
+                        curr[(z * cdims.y + y) * cdims.x + x] = T(sum / 8.0f);
+                    }
+                }
+            }
+
+            std::swap(prev, curr);
+        }
+    }
+
+    return file.good();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// paged_volume_ref members
+//
+
+template <typename T>
+inline float paged_volume_ref<T>::sample(vec3 const& coord) const
+{
+    for (int l = 0; l < num_levels; ++l)
+    {
+        level const& lev = levels[l];
+
+        // Clamp address mode
+        vec3 size(lev.dims);
+        vec3 texel = clamp(coord * size, vec3(0.5f), size - vec3(0.5f));
+
+        vec3i b(texel / static_cast<float>(brick_size));
+        int brick = lev.first_brick + (b.z * lev.bricks.y + b.y) * lev.bricks.x + b.x;
+
+        int slot = page_table[brick];
+
+        if (slot < 0)
+        {
+            // Also request the coarser bricks on the way, so they can serve as fallback
+            // until the finer ones were loaded
+            request(brick);
+            continue;
+        }
+
+        // Avoid writing to shared cache lines if the slot was already marked
+        if (last_used[slot].load(std::memory_order_relaxed) != *frame)
+        {
+            last_used[slot].store(*frame, std::memory_order_relaxed);
+        }
+
+        // Texel coordinates relative to the brick's halo
+        return sample_brick(slot, texel - vec3(b * brick_size) + vec3(1.0f));
+    }
+
+    // Not reached, the coarsest level is always resident
+    return 0.0f;
+}
+
+template <typename T>
+inline void paged_volume_ref<T>::request(int brick) const
+{
+    if (requested[brick].load(std::memory_order_relaxed) != 0
+     || requested[brick].exchange(1, std::memory_order_relaxed) != 0)
+    {
+        return;
+    }
+
+    int index = num_requests->fetch_add(1, std::memory_order_relaxed);
+
+    if (index < max_requests)
+    {
+        requests[index] = brick;
+    }
+    else
+    {
+        // Request list is full, try again next frame
+        requested[brick].store(0, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+inline float paged_volume_ref<T>::sample_brick(int slot, vec3 const& texel) const
+{
+    int n = brick_size + 2;
+    T const* data = cache + static_cast<size_t>(slot) * n * n * n;
+
+    auto voxel = [&](int x, int y, int z)
+    {
+        return static_cast<float>(data[(z * n + y) * n + x]);
+    };
+
+    if (filter_mode == Nearest)
+    {
+        vec3i i(texel);
+        return voxel(i.x, i.y, i.z);
+    }
+
+    vec3 p = texel - vec3(0.5f);
+    vec3i i(floor(p));
+    vec3 f = p - vec3(i);
+
+    float c00 = lerp(voxel(i.x, i.y,     i.z    ), voxel(i.x + 1, i.y,     i.z    ), f.x);
+    float c10 = lerp(voxel(i.x, i.y + 1, i.z    ), voxel(i.x + 1, i.y + 1, i.z    ), f.x);
+    float c01 = lerp(voxel(i.x, i.y,     i.z + 1), voxel(i.x + 1, i.y,     i.z + 1), f.x);
+    float c11 = lerp(voxel(i.x, i.y + 1, i.z + 1), voxel(i.x + 1, i.y + 1, i.z + 1), f.x);
+
+    return lerp(lerp(c00, c10, f.y), lerp(c01, c11, f.y), f.z);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// tex3D() with SIMD coordinates, sample per lane
+//
+
+template <typename T, typename F, typename>
+inline F tex3D(paged_volume_ref<T> const& tex, vector<3, F> const& coord)
+{
+    using float_array = simd::aligned_array_t<F>;
+
+    float_array x;
+    float_array y;
+    float_array z;
+    float_array result;
+
+    store(x, coord.x);
+    store(y, coord.y);
+    store(z, coord.z);
+
+    for (int i = 0; i < simd::num_elements<F>::value; ++i)
+    {
+        result[i] = tex.sample(vec3(x[i], y[i], z[i]));
+    }
+
+    return F(result);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// paged_volume members
+//
+
+template <typename T>
+inline paged_volume<T>::~paged_volume()
+{
+    close();
+}
+
+template <typename T>
+inline bool paged_volume<T>::open(std::string const& filename, size_t cache_size)
+{
+    close();
+
+    if (!file_.open(filename) || file_.size() < detail::paged_volume_header_size)
+    {
+        file_.close();
+        return false;
+    }
+
+    paged_volume_header header;
+    std::memcpy(&header, file_.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, detail::paged_volume_magic, sizeof(header.magic)) != 0
+     || header.version != detail::paged_volume_version
+     || header.voxel_size != sizeof(T)
+     || header.brick_size == 0)
+    {
+        file_.close();
+        return false;
+    }
+
+    brick_size_ = static_cast<int>(header.brick_size);
+    brick_voxels_ = static_cast<size_t>(brick_size_ + 2) * (brick_size_ + 2) * (brick_size_ + 2);
+
+    levels_ = detail::make_paged_volume_levels<level>(
+            vec3i(static_cast<int>(header.width), static_cast<int>(header.height), static_cast<int>(header.depth)),
+            brick_size_
+            );
+
+    level const& coarsest = levels_.back();
+    int num_bricks = coarsest.first_brick + coarsest.bricks.x * coarsest.bricks.y * coarsest.bricks.z;
+
+    if (levels_.size() != header.num_levels
+     || file_.size() < detail::paged_volume_header_size + num_bricks * brick_voxels_ * sizeof(T))
+    {
+        file_.close();
+        return false;
+    }
+
+    // The coarsest level is pinned to the first slots
+    num_pinned_ = num_bricks - coarsest.first_brick;
+    num_slots_ = num_pinned_ + std::max(static_cast<int>(cache_size / (brick_voxels_ * sizeof(T))), 1);
+
+    page_table_.assign(num_bricks, -1);
+    cache_.resize(num_slots_ * brick_voxels_);
+    slot_owner_.assign(num_slots_, -1);
+    last_used_.reset(new std::atomic<unsigned>[num_slots_]);
+
+    for (int i = 0; i < num_slots_; ++i)
+    {
+        last_used_[i] = 0;
+    }
+
+    for (int i = 0; i < num_pinned_; ++i)
+    {
+        commit(coarsest.first_brick + i, i, file_brick(coarsest.first_brick + i));
+    }
+
+    requested_.reset(new std::atomic<int>[num_bricks]);
+
+    for (int i = 0; i < num_bricks; ++i)
+    {
+        requested_[i] = 0;
+    }
+
+    requests_.resize(num_slots_ - num_pinned_);
+    num_requests_ = 0;
+
+    frame_ = 1;
+    stop_ = false;
+    loader_ = std::thread([this]() { loader_loop(); });
+
+    return true;
+}
+
+template <typename T>
+inline void paged_volume<T>::close()
+{
+    if (loader_.joinable())
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+
+        queue_cond_.notify_all();
+        loader_.join();
+    }
+
+    queue_.clear();
+    done_.clear();
+    num_loading_ = 0;
+
+    file_.close();
+}
+
+template <typename T>
+inline void paged_volume<T>::update()
+{
+    std::vector<loaded_brick> done;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::swap(done, done_);
+    }
+
+    if (!done.empty())
+    {
+        // Replace slots that were not used in the last frame, free slots first, then the
+        // least recently used ones
+        std::vector<int> candidates;
+
+        for (int i = num_pinned_; i < num_slots_; ++i)
+        {
+            if (last_used_[i].load() < frame_)
+            {
+                candidates.push_back(i);
+            }
+        }
+
+        std::sort(
+                candidates.begin(),
+                candidates.end(),
+                [this](int a, int b)
+                {
+                    unsigned ua = slot_owner_[a] < 0 ? 0 : last_used_[a].load() + 1;
+                    unsigned ub = slot_owner_[b] < 0 ? 0 : last_used_[b].load() + 1;
+                    return ua < ub;
+                }
+                );
+
+        size_t next = 0;
+
+        for (auto const& lb : done)
+        {
+            if (next < candidates.size())
+            {
+                commit(lb.brick, candidates[next++], lb.data.data());
+            }
+
+            // Request again if there was no room
+            requested_[lb.brick] = 0;
+        }
+    }
+
+    // Issue the requests of the last frame
+    int n = std::min(num_requests_.exchange(0), static_cast<int>(requests_.size()));
+
+    if (n > 0)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queue_.insert(queue_.end(), requests_.begin(), requests_.begin() + n);
+            num_loading_ += n;
+        }
+
+        queue_cond_.notify_one();
+    }
+
+    ++frame_;
+}
+
+template <typename T>
+inline void paged_volume<T>::finish()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cond_.wait(lock, [this]() { return num_loading_ == 0; });
+    }
+
+    update();
+}
+
+template <typename T>
+inline int paged_volume<T>::num_pending() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return num_loading_ + static_cast<int>(done_.size());
+}
+
+template <typename T>
+inline paged_volume_ref<T> paged_volume<T>::ref() const
+{
+    paged_volume_ref<T> result;
+
+    result.levels       = levels_.data();
+    result.num_levels   = static_cast<int>(levels_.size());
+    result.brick_size   = brick_size_;
+    result.filter_mode  = filter_mode_;
+    result.page_table   = page_table_.data();
+    result.cache        = cache_.data();
+    result.last_used    = last_used_.get();
+    result.frame        = &frame_;
+    result.requested    = requested_.get();
+    result.requests     = requests_.data();
+    result.num_requests = &num_requests_;
+    result.max_requests = static_cast<int>(requests_.size());
+
+    return result;
+}
+
+template <typename T>
+inline size_t paged_volume<T>::width() const
+{
+    return levels_.empty() ? 0 : static_cast<size_t>(levels_[0].dims.x);
+}
+
+template <typename T>
+inline size_t paged_volume<T>::height() const
+{
+    return levels_.empty() ? 0 : static_cast<size_t>(levels_[0].dims.y);
+}
+
+template <typename T>
+inline size_t paged_volume<T>::depth() const
+{
+    return levels_.empty() ? 0 : static_cast<size_t>(levels_[0].dims.z);
+}
+
+template <typename T>
+inline int paged_volume<T>::num_levels() const
+{
+    return static_cast<int>(levels_.size());
+}
+
+template <typename T>
+inline int paged_volume<T>::brick_size() const
+{
+    return brick_size_;
+}
+
+template <typename T>
+inline int paged_volume<T>::num_cache_slots() const
+{
+    return num_slots_;
+}
+
+template <typename T>
+inline void paged_volume<T>::set_filter_mode(tex_filter_mode mode)
+{
+    assert((mode == Nearest || mode == Linear) && "Paged volumes only support nearest and linear filtering");
+
+    filter_mode_ = mode;
+}
+
+template <typename T>
+inline tex_filter_mode paged_volume<T>::get_filter_mode() const
+{
+    return filter_mode_;
+}
+
+template <typename T>
+inline T paged_volume<T>::operator()(size_t x, size_t y, size_t z) const
+{
+    level const& lev = levels_[0];
+
+    int bs = brick_size_;
+    vec3i b(static_cast<int>(x) / bs, static_cast<int>(y) / bs, static_cast<int>(z) / bs);
+    vec3i i = vec3i(static_cast<int>(x), static_cast<int>(y), static_cast<int>(z)) - b * bs + vec3i(1);
+
+    T const* data = file_brick((b.z * lev.bricks.y + b.y) * lev.bricks.x + b.x);
+
+    int n = bs + 2;
+    return data[(i.z * n + i.y) * n + i.x];
+}
+
+template <typename T>
+inline T const* paged_volume<T>::file_brick(int brick) const
+{
+    return reinterpret_cast<T const*>(
+            file_.data() + detail::paged_volume_header_size + brick * brick_voxels_ * sizeof(T)
+            );
+}
+
+template <typename T>
+inline void paged_volume<T>::commit(int brick, int slot, T const* data)
+{
+    if (slot_owner_[slot] >= 0)
+    {
+        page_table_[slot_owner_[slot]] = -1;
+    }
+
+    std::copy(data, data + brick_voxels_, cache_.data() + slot * brick_voxels_);
+
+    page_table_[brick] = slot;
+    slot_owner_[slot] = brick;
+    last_used_[slot] = frame_;
+}
+
+template <typename T>
+inline void paged_volume<T>::loader_loop()
+{
+    for (;;)
+    {
+        int brick = -1;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queue_cond_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+
+            if (stop_)
+            {
+                return;
+            }
+
+            brick = queue_.front();
+            queue_.pop_front();
+        }
+
+        // Page faults happen here and not in the render threads
+        loaded_brick lb;
+        lb.brick = brick;
+        lb.data.resize(brick_voxels_);
+
+        T const* src = file_brick(brick);
+        std::copy(src, src + brick_voxels_, lb.data.begin());
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.push_back(std::move(lb));
+            --num_loading_;
+        }
+
+        done_cond_.notify_all();
+    }
+}
+
+} // visionaray
@@ -83,6 +83,28 @@ void parallel_for(thread_pool& pool, tiled_range2d<I> const& range, Func const&
         }, static_cast<long>(num_tiles_x * num_tiles_y));
 }
 
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Call func(range1d) for the tiles of range on the pool, or once for the whole range in the
+// calling thread if there is no pool or it only has one thread
+//
+
+template <typename I, typename Func>
+void optional_parallel_for(thread_pool* pool, tiled_range1d<I> const& range, Func const& func)
+{
+    if (pool != nullptr && pool->num_threads > 1)
+    {
+        parallel_for(*pool, range, func);
+    }
+    else
+    {
+        func(range1d<I>(range.begin(), range.end()));
+    }
+}
+
+} // detail
 } // visionaray
 
 #endif // VSNRAY_DETAIL_PARALLEL_FOR_H
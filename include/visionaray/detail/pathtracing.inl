@@ -6,8 +6,11 @@
 #ifndef VSNRAY_DETAIL_PATHTRACING_INL
 #define VSNRAY_DETAIL_PATHTRACING_INL 1
 
+#include <visionaray/environment_light.h>
 #include <visionaray/get_area.h>
 #include <visionaray/get_surface.h>
+#include <visionaray/hero_spectrum.h>
+#include <visionaray/light_sampler.h>
 #include <visionaray/result_record.h>
 #include <visionaray/sampling.h>
 #include <visionaray/spectrum.h>
@@ -26,7 +29,7 @@ struct kernel
     Params params;
 
     template <typename Intersector, typename R, typename Generator>
-    VSNRAY_FUNC result_record<typename R::scalar_type> operator()(
+    VSNRAY_FUNC aov_result_record<typename R::scalar_type> operator()(
             Intersector& isect,
             R ray,
             Generator& gen
@@ -35,7 +38,7 @@ struct kernel
         using S = typename R::scalar_type;
         using I = simd::int_type_t<S>;
         using V = typename result_record<S>::vec_type;
-        using C = spectrum<S>;
+        using C = typename visionaray::detail::path_spectrum<Params, S>::type;
 
         simd::mask_type_t<S> active_rays = true;
         simd::mask_type_t<S> last_specular = true;
@@ -43,7 +46,14 @@ struct kernel
         C intensity(0.0);
         C throughput(1.0);
 
-        result_record<S> result;
+        // pdf of the BRDF sample that generated the current ray
+        S last_brdf_pdf(0.0);
+
+        // Wavelengths of hero wavelength paths, colors are converted to C with them
+        typename visionaray::detail::path_spectrum<Params, S>::wavelengths_type wl;
+        visionaray::detail::sample_wavelengths(wl, gen);
+
+        aov_result_record<S> result;
         result.color = params.bg_color;
 
         for (unsigned bounce = 0; bounce < params.num_bounces; ++bounce)
@@ -54,7 +64,10 @@ struct kernel
             auto exited = active_rays & !hit_rec.hit;
             intensity += select(
                 exited,
-                C(from_rgba(params.ambient_color)) * throughput,
+                visionaray::detail::to_path_spectrum(
+                        escaped_radiance(params, ray, bounce > 0 && !last_specular, last_brdf_pdf),
+                        wl
+                        ) * throughput,
                 C(0.0)
                 );
 
@@ -82,7 +95,7 @@ struct kernel
 
             hit_rec.isect_pos = ray.ori + ray.dir * hit_rec.t;
 
-            auto surf = get_surface(hit_rec, params);
+            auto surf = get_surface(hit_rec, params, ray);
 
             S brdf_pdf(0.0);
 
@@ -90,7 +103,10 @@ struct kernel
             // If the last interaction was not diffuse, we have
             // to include light from emissive surfaces.
             I inter = 0;
-            auto src = surf.sample(view_dir, refl_dir, brdf_pdf, inter, gen);
+            auto src = visionaray::detail::to_path_spectrum(
+                    surf.sample(view_dir, refl_dir, brdf_pdf, inter, gen),
+                    wl
+                    );
 
             auto zero_pdf = brdf_pdf <= S(0.0);
 
@@ -115,7 +131,7 @@ struct kernel
 
             S mis_weight = select(
                 bounce > 0 && num_lights > 0 && !last_specular,
-                power_heuristic(brdf_pdf, light_pdf / static_cast<float>(num_lights)),
+                power_heuristic(brdf_pdf, light_pdf * light_pmf(params, ray.ori, hit_rec.prim_id)),
                 S(1.0)
                 );
 
@@ -135,7 +151,8 @@ struct kernel
 
             if (num_lights > 0)
             {
-                auto ls = sample_random_light(params.lights.begin, params.lights.end, gen);
+                S light_select_pdf(0.0);
+                auto ls = sample_light(params, hit_rec.isect_pos, gen, light_select_pdf);
 
                 auto ld = select(ls.delta_light, S(1.0), length(ls.pos - hit_rec.isect_pos));
                 auto L = normalize(ls.pos - hit_rec.isect_pos);
@@ -159,22 +176,40 @@ struct kernel
                 brdf_pdf *= prob;
 
                 // TODO: inv_pi / dot(n, wi) factor only valid for plastic and matte
-                auto src = surf.shade(view_dir, L, ls.intensity) * constants::inv_pi<S>() / ldotn;
+                auto src = visionaray::detail::to_path_spectrum(
+                        surf.shade(view_dir, L, ls.intensity) * constants::inv_pi<S>() / ldotn,
+                        wl
+                        );
                 auto solid_angle = (ldotln * ls.area) / (ld * ld);
                 auto light_pdf = S(1.0) / solid_angle;
 
-                S mis_weight = power_heuristic(light_pdf / static_cast<float>(num_lights), brdf_pdf);
+                S mis_weight = power_heuristic(light_pdf * light_select_pdf, brdf_pdf);
 
                 intensity += select(
-                    active_rays && !lhr.hit && ldotn > S(0.0) && ldotln > S(0.0),
-                    mis_weight * throughput * src * (ldotn / light_pdf) * S(static_cast<float>(num_lights)),
+                    active_rays && !lhr.hit && ldotn > S(0.0) && ldotln > S(0.0) && light_select_pdf > S(0.0),
+                    mis_weight * throughput * src * (ldotn / (light_pdf * light_select_pdf)),
                     C(0.0)
                     );
             }
 
+            // Scaled like the BRDF pdf used for MIS with light samples
+            last_brdf_pdf = brdf_pdf * max_element(throughput.samples());
+
             throughput *= src * (dot(n, refl_dir) / brdf_pdf);
             throughput = select(zero_pdf, C(0.0), throughput);
 
+            // AOVs are taken from the first hit, the albedo estimate is the
+            // sample weight (converges to the reflectance) or the emission
+            if (bounce == 0)
+            {
+                auto albedo = select(inter == surface_interaction::Emission, src, throughput);
+
+                result.normal  = select(hit_rec.hit, n, V(0.0));
+                result.albedo  = select(hit_rec.hit, visionaray::detail::path_to_rgba(albedo, wl).xyz(), V(0.0));
+                result.prim_id = select(hit_rec.hit, I(hit_rec.prim_id), I(-1));
+                result.geom_id = select(hit_rec.hit, I(hit_rec.geom_id), I(-1));
+            }
+
             // Russian roulette
             auto prob = max_element(throughput.samples());
             auto terminate = gen.next() > prob;
@@ -186,21 +221,31 @@ struct kernel
                 break;
             }
 
-            ray.ori = hit_rec.isect_pos + refl_dir * S(params.epsilon);
-            ray.dir = refl_dir;
+            // Rebuild the ray, this resets differentials after the first bounce
+            ray = R(hit_rec.isect_pos + refl_dir * S(params.epsilon), refl_dir);
 
             last_specular = inter == surface_interaction::SpecularReflection ||
                             inter == surface_interaction::SpecularTransmission;
 
         }
 
-        result.color = select( result.hit, to_rgba(intensity), result.color );
+        auto color = visionaray::detail::path_to_rgba(intensity, wl);
+
+        result.color = select(
+                result.hit,
+                color,
+                visionaray::detail::primary_miss_color(
+                        typename visionaray::detail::has_environment_light<Params>::type{},
+                        params,
+                        color
+                        )
+                );
 
         return result;
     }
 
     template <typename R, typename Generator>
-    VSNRAY_FUNC result_record<typename R::scalar_type> operator()(
+    VSNRAY_FUNC aov_result_record<typename R::scalar_type> operator()(
             R ray,
             Generator& gen
             ) const
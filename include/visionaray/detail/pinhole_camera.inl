@@ -116,4 +116,25 @@ inline R pinhole_camera::primary_ray(R /* */, T const& x, T const& y, T const& w
     return r;
 }
 
+template <typename T>
+VSNRAY_FUNC
+inline basic_ray_differential<T> pinhole_camera::primary_ray(
+        basic_ray_differential<T>   /* */,
+        T const&                    x,
+        T const&                    y,
+        T const&                    width,
+        T const&                    height
+        ) const
+{
+    using R = basic_ray<T>;
+
+    basic_ray_differential<T> r(primary_ray(R{}, x, y, width, height));
+
+    // All rays start at the eye, dodx and dody are zero
+    r.dddx = primary_ray(R{}, x + T(1.0), y, width, height).dir - r.dir;
+    r.dddy = primary_ray(R{}, x, y + T(1.0), width, height).dir - r.dir;
+
+    return r;
+}
+
 } // visionaray
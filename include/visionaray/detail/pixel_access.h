@@ -6,9 +6,12 @@
 #ifndef VSNRAY_DETAIL_PIXEL_ACCESS_H
 #define VSNRAY_DETAIL_PIXEL_ACCESS_H 1
 
+#include <cstring>
 #include <type_traits>
 
+#include <visionaray/math/simd/type_traits.h>
 #include <visionaray/math/array.h>
+#include <visionaray/aov.h>
 #include <visionaray/packet_traits.h>
 #include <visionaray/pixel_format.h>
 #include <visionaray/result_record.h>
@@ -16,11 +19,41 @@
 #include "color_conversion.h"
 #include "macros.h"
 
+
+//-------------------------------------------------------------------------------------------------
+// If set to 1, full SIMD packets are written to RGBA32F color buffers with non-temporal stores
+// Only pays off if the color buffer is not read back while rendering, i.e. not with blending
+// pixel samplers. Requires SSE and 16-byte aligned color buffers
+//
+
+#ifndef VSNRAY_NON_TEMPORAL_STORES
+#define VSNRAY_NON_TEMPORAL_STORES 0
+#endif
+
 namespace visionaray
 {
 namespace detail
 {
 
+//-------------------------------------------------------------------------------------------------
+// Access individual lanes of SIMD vectors, also compiles for scalar types
+//
+
+template <typename T>
+VSNRAY_FUNC
+inline simd::element_type_t<T>& lane(T& v, int i)
+{
+    return reinterpret_cast<simd::element_type_t<T>*>(&v)[i];
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline simd::element_type_t<T> const& lane(T const& v, int i)
+{
+    return reinterpret_cast<simd::element_type_t<T> const*>(&v)[i];
+}
+
+
 //-------------------------------------------------------------------------------------------------
 // Store, get and blend pixel values (color and depth)
 //
@@ -28,6 +61,82 @@ namespace detail
 namespace pixel_access
 {
 
+//-------------------------------------------------------------------------------------------------
+// Full packets lie completely inside the viewport. Those are accessed row by row w/o
+// per-lane bounds checks, only packets that straddle the viewport edge take the slow path
+//
+
+template <typename T>
+VSNRAY_FUNC
+inline bool is_full_packet(int x, int y, int width, int height)
+{
+    return x + packet_size<T>::w <= width && y + packet_size<T>::h <= height;
+}
+
+// Copy the rows of a packet from lane order to the buffer
+template <typename T, typename Array, typename Pixel>
+VSNRAY_FUNC
+inline void store_rows(int x, int y, int width, Array const& lanes, Pixel* buffer)
+{
+    const int w = packet_size<T>::w;
+    const int h = packet_size<T>::h;
+
+    for (int row = 0; row < h; ++row)
+    {
+        std::memcpy(&buffer[(y + row) * width + x], &lanes[row * w], w * sizeof(Pixel));
+    }
+}
+
+// Copy the rows of a packet from the buffer to lane order
+template <typename T, typename Array, typename Pixel>
+VSNRAY_FUNC
+inline void get_rows(int x, int y, int width, Array& lanes, Pixel const* buffer)
+{
+    const int w = packet_size<T>::w;
+    const int h = packet_size<T>::h;
+
+    for (int row = 0; row < h; ++row)
+    {
+        std::memcpy(&lanes[row * w], &buffer[(y + row) * width + x], w * sizeof(Pixel));
+    }
+}
+
+// Store a single RGBA32F pixel from a float4 register
+VSNRAY_FUNC
+inline void store_pixel(vector<4, float>& dst, simd::float4 const& v)
+{
+#if VSNRAY_NON_TEMPORAL_STORES && VSNRAY_SIMD_ISA_GE(VSNRAY_SIMD_ISA_SSE2)
+    simd::store_non_temporal(dst.data(), v);
+#else
+    simd::store_unaligned(dst.data(), v);
+#endif
+}
+
+// Load a single pixel into a float4 register
+VSNRAY_FUNC
+inline simd::float4 load_pixel(vector<4, float> const& src)
+{
+    return simd::load_unaligned(src.data());
+}
+
+template <typename Pixel>
+VSNRAY_FUNC
+inline simd::float4 load_pixel(Pixel const& src)
+{
+    vector<4, float> v(src);
+    return simd::float4(v.x, v.y, v.z, v.w);
+}
+
+// Non-temporal stores are weakly ordered, make them visible before the packet is done
+VSNRAY_FUNC
+inline void store_fence()
+{
+#if VSNRAY_NON_TEMPORAL_STORES && VSNRAY_SIMD_ISA_GE(VSNRAY_SIMD_ISA_SSE2)
+    _mm_sfence();
+#endif
+}
+
+
 // Store ------------------------------------------------------------------
 
 
@@ -247,6 +356,28 @@ inline void store(
         OutputColor*                        buffer
         )
 {
+    if (is_full_packet<FloatT>(x, y, width, height))
+    {
+        using int_type = simd::int_type_t<FloatT>;
+
+        static_assert(sizeof(OutputColor) == sizeof(int), "RGBA8 pixels must be 32-bit");
+
+        // Truncates like float_to_unorm(), then packs one pixel per
+        // lane with r in the lowest byte (little endian)
+        FloatT scale(255.0f);
+
+        int_type rgba = convert_to_int(saturate(color.x) * scale)
+                     | (convert_to_int(saturate(color.y) * scale) << 8)
+                     | (convert_to_int(saturate(color.z) * scale) << 16)
+                     | (convert_to_int(saturate(color.w) * scale) << 24);
+
+        simd::aligned_array_t<int_type> lanes;
+        store(lanes, rgba);
+
+        store_rows<FloatT>(x, y, width, lanes, buffer);
+        return;
+    }
+
     using float_array = simd::aligned_array_t<FloatT>;
 
     float_array r;
@@ -376,6 +507,28 @@ inline void store(
     auto w = packet_size<FloatT>::w;
     auto h = packet_size<FloatT>::h;
 
+    if (is_full_packet<FloatT>(x, y, width, height))
+    {
+        // Convert from SoA to AoS, four lanes at a time
+        for (int i = 0; i < simd::num_elements<FloatT>::value; i += 4)
+        {
+            auto c = transpose(vector<4, simd::float4>(
+                    simd::float4(&r[i]),
+                    simd::float4(&g[i]),
+                    simd::float4(&b[i]),
+                    simd::float4(&a[i])
+                    ));
+
+            store_pixel(buffer[(y + (i    ) / w) * width + x + (i    ) % w], c.x);
+            store_pixel(buffer[(y + (i + 1) / w) * width + x + (i + 1) % w], c.y);
+            store_pixel(buffer[(y + (i + 2) / w) * width + x + (i + 2) % w], c.z);
+            store_pixel(buffer[(y + (i + 3) / w) * width + x + (i + 3) % w], c.w);
+        }
+
+        store_fence();
+        return;
+    }
+
     for (auto row = 0; row < h; ++row)
     {
         for (auto col = 0; col < w; ++col)
@@ -414,6 +567,16 @@ inline void store(
 {
     auto c = transpose(color);
 
+    if (is_full_packet<simd::float4>(x, y, width, height))
+    {
+        store_pixel(buffer[ y      * width +  x     ], c.x);
+        store_pixel(buffer[ y      * width + (x + 1)], c.y);
+        store_pixel(buffer[(y + 1) * width +  x     ], c.z);
+        store_pixel(buffer[(y + 1) * width + (x + 1)], c.w);
+        store_fence();
+        return;
+    }
+
     if ( x      < width &&  y      < height) store( buffer[ y      * width +  x     ].data(), c.x);
     if ((x + 1) < width &&  y      < height) store( buffer[ y      * width + (x + 1)].data(), c.y);
     if ( x      < width && (y + 1) < height) store( buffer[(y + 1) * width +  x     ].data(), c.z);
@@ -447,6 +610,12 @@ inline void store(
 
     store(v, value);
 
+    if (is_full_packet<FloatT>(x, y, width, height))
+    {
+        store_rows<FloatT>(x, y, width, v, buffer);
+        return;
+    }
+
     auto w = packet_size<FloatT>::w;
     auto h = packet_size<FloatT>::h;
 
@@ -536,6 +705,12 @@ inline void store(
 
     store(v, value);
 
+    if (is_full_packet<FloatT>(x, y, width, height))
+    {
+        store_rows<FloatT>(x, y, width, v, buffer);
+        return;
+    }
+
     auto w = packet_size<FloatT>::w;
     auto h = packet_size<FloatT>::h;
 
@@ -586,6 +761,35 @@ inline void store(
         );
 }
 
+//-------------------------------------------------------------------------------------------------
+// Store color from AOV result record to output color buffer, AOVs are stored separately
+//
+
+template <pixel_format DF, pixel_format SF, typename T, typename OutputColor>
+VSNRAY_FUNC
+inline void store(
+        pixel_format_constant<DF>   /* dst format */,
+        pixel_format_constant<SF>   /* src format */,
+        int                         x,
+        int                         y,
+        int                         width,
+        int                         height,
+        aov_result_record<T> const& rr,
+        OutputColor*                buffer
+        )
+{
+    store(
+        pixel_format_constant<DF>{},
+        pixel_format_constant<SF>{},
+        x,
+        y,
+        width,
+        height,
+        rr.color,
+        buffer
+        );
+}
+
 //-------------------------------------------------------------------------------------------------
 // Store color and depth from result record to output buffers
 //
@@ -716,6 +920,17 @@ inline void get(
         OutputColor const*                  buffer
         )
 {
+    if (is_full_packet<simd::float4>(x, y, width, height))
+    {
+        color = transpose(vector<4, simd::float4>(
+                load_pixel(buffer[ y      * width +  x     ]),
+                load_pixel(buffer[ y      * width + (x + 1)]),
+                load_pixel(buffer[(y + 1) * width +  x     ]),
+                load_pixel(buffer[(y + 1) * width + (x + 1)])
+                ));
+        return;
+    }
+
     array<OutputColor, 4> out;
 
     out[0] = ( x      < width &&  y      < height) ? buffer[ y      * width +  x     ] : OutputColor();
@@ -745,6 +960,13 @@ inline void get(
 {
     simd::aligned_array_t<simd::float4> out;
 
+    if (is_full_packet<simd::float4>(x, y, width, height))
+    {
+        get_rows<simd::float4>(x, y, width, out, buffer);
+        result = simd::float4(out);
+        return;
+    }
+
     out[0] = ( x      < width &&  y      < height) ? buffer[ y      * width +  x     ] : T();
     out[1] = ((x + 1) < width &&  y      < height) ? buffer[ y      * width + (x + 1)] : T();
     out[2] = ( x      < width && (y + 1) < height) ? buffer[(y + 1) * width +  x     ] : T();
@@ -770,6 +992,13 @@ inline void get(
 {
     simd::aligned_array_t<simd::float4> out;
 
+    if (is_full_packet<simd::float4>(x, y, width, height))
+    {
+        get_rows<simd::float4>(x, y, width, out, buffer);
+        result = simd::float4(out);
+        return;
+    }
+
     out[0] = ( x      < width &&  y      < height) ? buffer[ y      * width +  x     ] : T();
     out[1] = ((x + 1) < width &&  y      < height) ? buffer[ y      * width + (x + 1)] : T();
     out[2] = ( x      < width && (y + 1) < height) ? buffer[(y + 1) * width +  x     ] : T();
@@ -825,6 +1054,40 @@ inline void get(
     const int w = packet_size<simd::float8>::w;
     const int h = packet_size<simd::float8>::h;
 
+    if (is_full_packet<simd::float8>(x, y, width, height))
+    {
+        // Convert from AoS to SoA, four pixels (one row) at a time
+        simd::aligned_array_t<simd::float8> r;
+        simd::aligned_array_t<simd::float8> g;
+        simd::aligned_array_t<simd::float8> b;
+        simd::aligned_array_t<simd::float8> a;
+
+        for (int row = 0; row < h; ++row)
+        {
+            OutputColor const* src = buffer + (y + row) * width + x;
+
+            auto c = transpose(vector<4, simd::float4>(
+                    load_pixel(src[0]),
+                    load_pixel(src[1]),
+                    load_pixel(src[2]),
+                    load_pixel(src[3])
+                    ));
+
+            store(&r[row * w], c.x);
+            store(&g[row * w], c.y);
+            store(&b[row * w], c.z);
+            store(&a[row * w], c.w);
+        }
+
+        color = vector<4, simd::float8>(
+                simd::float8(r),
+                simd::float8(g),
+                simd::float8(b),
+                simd::float8(a)
+                );
+        return;
+    }
+
     vec4 v[w * h];
 
     for (auto row = 0; row < h; ++row)
@@ -870,6 +1133,13 @@ inline void get(
 
     simd::aligned_array_t<simd::float8> out;
 
+    if (is_full_packet<simd::float8>(x, y, width, height))
+    {
+        get_rows<simd::float8>(x, y, width, out, buffer);
+        result = simd::float8(out);
+        return;
+    }
+
     for (auto row = 0; row < h; ++row)
     {
         for (auto col = 0; col < w; ++col)
@@ -903,6 +1173,13 @@ inline void get(
 
     simd::aligned_array_t<simd::float8> out;
 
+    if (is_full_packet<simd::float8>(x, y, width, height))
+    {
+        get_rows<simd::float8>(x, y, width, out, buffer);
+        result = simd::float8(out);
+        return;
+    }
+
     for (auto row = 0; row < h; ++row)
     {
         for (auto col = 0; col < w; ++col)
@@ -1178,6 +1455,39 @@ inline void blend(
         );
 }
 
+//-------------------------------------------------------------------------------------------------
+// Blend color from AOV result record on top of output color buffer
+//
+
+template <pixel_format DF, pixel_format SF, typename S, typename OutputColor, typename T>
+VSNRAY_FUNC
+inline void blend(
+        pixel_format_constant<DF>   /* dst format */,
+        pixel_format_constant<SF>   /* src format */,
+        int                         x,
+        int                         y,
+        int                         width,
+        int                         height,
+        aov_result_record<S> const& rr,
+        OutputColor*                color_buffer,
+        T                           sfactor,
+        T                           dfactor
+        )
+{
+    blend(
+        pixel_format_constant<DF>{},
+        pixel_format_constant<SF>{},
+        x,
+        y,
+        width,
+        height,
+        rr.color,
+        color_buffer,
+        sfactor,
+        dfactor
+        );
+}
+
 //-------------------------------------------------------------------------------------------------
 // Blend color and depth from result record on top of output buffers
 //
@@ -1238,6 +1548,140 @@ inline void blend(
         );
 }
 
+
+// AOVs -------------------------------------------------------------------
+
+
+//-------------------------------------------------------------------------------------------------
+// Update the sample count layer, return the weight of the new sample for each lane
+// counts(px, py) is the number of samples blended into the pixel, including the new one
+//
+
+template <typename S, typename Counts>
+VSNRAY_FUNC
+inline void update_sample_count(
+        int                         x,
+        int                         y,
+        int                         width,
+        int                         height,
+        Counts const&               counts,
+        aov_ref const&              aovs,
+        float*                      weights
+        )
+{
+    const int num_lanes = simd::num_elements<S>::value;
+    const int pw        = packet_size<S>::w;
+
+    for (int i = 0; i < num_lanes; ++i)
+    {
+        int px = x + i % pw;
+        int py = y + i / pw;
+
+        if (px >= width || py >= height)
+        {
+            continue;
+        }
+
+        unsigned count = counts(px, py);
+
+        if (aovs.sample_count)
+        {
+            aovs.sample_count[py * width + px] = count;
+        }
+
+        weights[i] = 1.0f / count;
+    }
+}
+
+
+// Running average, the first sample has weight 1.0
+VSNRAY_FUNC
+inline void blend_aov(float& dst, float src, float weight)
+{
+    dst += (src - dst) * weight;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Store AOVs, results w/o AOVs only contribute to the sample count
+//
+
+template <typename S, typename Counts, typename Result>
+VSNRAY_FUNC
+inline void store_aovs(
+        int                         x,
+        int                         y,
+        int                         width,
+        int                         height,
+        Counts const&               counts,
+        Result const&               /* result */,
+        aov_ref const&              aovs
+        )
+{
+    float weights[simd::num_elements<S>::value];
+    update_sample_count<S>(x, y, width, height, counts, aovs, weights);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Store AOVs from AOV result record
+// Floating point layers are averaged over all samples, ids are overwritten
+//
+
+template <typename S, typename Counts>
+VSNRAY_FUNC
+inline void store_aovs(
+        int                         x,
+        int                         y,
+        int                         width,
+        int                         height,
+        Counts const&               counts,
+        aov_result_record<S> const& rr,
+        aov_ref const&              aovs
+        )
+{
+    const int num_lanes = simd::num_elements<S>::value;
+    const int pw        = packet_size<S>::w;
+
+    float weights[num_lanes];
+    update_sample_count<S>(x, y, width, height, counts, aovs, weights);
+
+    for (int i = 0; i < num_lanes; ++i)
+    {
+        int px = x + i % pw;
+        int py = y + i / pw;
+
+        if (px >= width || py >= height)
+        {
+            continue;
+        }
+
+        int idx = py * width + px;
+
+        for (int c = 0; c < 3; ++c)
+        {
+            if (aovs.normal[c])
+            {
+                blend_aov(aovs.normal[c][idx], lane(rr.normal[c], i), weights[i]);
+            }
+
+            if (aovs.albedo[c])
+            {
+                blend_aov(aovs.albedo[c][idx], lane(rr.albedo[c], i), weights[i]);
+            }
+        }
+
+        if (aovs.prim_id)
+        {
+            aovs.prim_id[idx] = lane(rr.prim_id, i);
+        }
+
+        if (aovs.geom_id)
+        {
+            aovs.geom_id[idx] = lane(rr.geom_id, i);
+        }
+    }
+}
+
 } // pixel_access
 
 } // detail
@@ -22,6 +22,11 @@ inline vector<3, U> point_light<T>::intensity(vector<3, U> const& pos) const
              + linear_attenuation_    * dist
              + quadratic_attenuation_ * dist * dist)
         );
+
+    // Window, 1 near the light and 0 at the influence radius
+    auto r = dist / U(influence_radius_);
+    auto window = max(U(1.0) - r * r * r * r, U(0.0));
+    att *= window * window;
 #endif
 
     return vector<3, U>(cl_ * kl_) * att;
@@ -77,6 +82,13 @@ inline T point_light<T>::quadratic_attenuation() const
     return quadratic_attenuation_;
 }
 
+template <typename T>
+VSNRAY_FUNC
+inline T point_light<T>::influence_radius() const
+{
+    return influence_radius_;
+}
+
 template <typename T>
 VSNRAY_FUNC
 inline void point_light<T>::set_cl(vector<3, T> const& cl)
@@ -119,4 +131,11 @@ inline void point_light<t>::set_quadratic_attenuation(t att)
     quadratic_attenuation_ = att;
 }
 
+template <typename t>
+VSNRAY_FUNC
+inline void point_light<t>::set_influence_radius(t radius)
+{
+    influence_radius_ = radius;
+}
+
 } // visionaray
@@ -0,0 +1,148 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "../math/simd/simd.h"
+#include "../aligned_vector.h"
+#include "parallel_for.h"
+#include "range.h"
+
+namespace visionaray
+{
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Integrate one row of the pre-integration table (fixed back value), SIMD over front values
+//
+// Each segment is split into one sub-segment per transfer function entry it crosses, the
+// sub-segments are classified at their centers and composited front to back.
+//
+
+template <typename TransFunc>
+inline void preintegrate_row(
+        vec4*               row,
+        int                 y,
+        int                 width,
+        int                 height,
+        TransFunc const&    transfunc,
+        float               relative_step
+        )
+{
+    using F = simd::float4;
+    using C = vector<4, F>;
+
+    const int L = simd::num_elements<F>::value;
+
+    float tf_size = static_cast<float>(transfunc.width());
+    float back_value = (y + 0.5f) / height;
+    F back(back_value);
+
+    for (int x = 0; x < width; x += L)
+    {
+        simd::aligned_array_t<F> fronts;
+
+        for (int i = 0; i < L; ++i)
+        {
+            fronts[i] = (std::min(x + i, width - 1) + 0.5f) / width;
+        }
+
+        F front(fronts);
+
+        // Same number of sub-segments for all lanes
+        int num_steps = 1;
+
+        for (int i = 0; i < L; ++i)
+        {
+            float delta = std::abs(back_value - fronts[i]) * tf_size;
+            num_steps = std::max(num_steps, static_cast<int>(std::ceil(delta)) + 1);
+        }
+
+        F opacity_exponent(relative_step / num_steps);
+
+        C dst(F(0.0f));
+
+        for (int m = 0; m < num_steps; ++m)
+        {
+            F s = front + (back - front) * F((m + 0.5f) / num_steps);
+
+            C color = tex1D(transfunc, s);
+            color.w = F(1.0f) - pow(F(1.0f) - color.w, opacity_exponent);
+            color.xyz() *= color.w;
+
+            dst += color * (F(1.0f) - dst.w);
+        }
+
+        simd::aligned_array_t<F> r;
+        simd::aligned_array_t<F> g;
+        simd::aligned_array_t<F> b;
+        simd::aligned_array_t<F> a;
+
+        store(r, dst.x);
+        store(g, dst.y);
+        store(b, dst.z);
+        store(a, dst.w);
+
+        for (int i = 0; i < L && x + i < width; ++i)
+        {
+            row[x + i] = vec4(r[i], g[i], b[i], a[i]);
+        }
+    }
+}
+
+template <typename TransFunc>
+inline void preintegrate_impl(
+        texture<vec4, 2>&   table,
+        TransFunc const&    transfunc,
+        float               relative_step,
+        thread_pool*        pool
+        )
+{
+    int width = static_cast<int>(table.width());
+    int height = static_cast<int>(table.height());
+
+    aligned_vector<vec4> data(table.width() * table.height());
+
+    auto func = [&](range1d<int> const& r)
+    {
+        for (int y = r.begin(); y != r.end(); ++y)
+        {
+            preintegrate_row(data.data() + static_cast<size_t>(y) * width, y, width, height, transfunc, relative_step);
+        }
+    };
+
+    optional_parallel_for(pool, tiled_range1d<int>(0, height, 4), func);
+
+    table.reset(data.data());
+    table.set_filter_mode(Linear);
+    table.set_address_mode(Clamp);
+}
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// Build pre-integration tables
+//
+
+template <typename TransFunc>
+inline void preintegrate(texture<vec4, 2>& table, TransFunc const& transfunc, float relative_step)
+{
+    detail::preintegrate_impl(table, transfunc, relative_step, nullptr);
+}
+
+template <typename TransFunc>
+inline void preintegrate(
+        texture<vec4, 2>&   table,
+        TransFunc const&    transfunc,
+        float               relative_step,
+        thread_pool&        pool
+        )
+{
+    detail::preintegrate_impl(table, transfunc, relative_step, &pool);
+}
+
+} // visionaray
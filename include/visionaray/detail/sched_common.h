@@ -6,6 +6,7 @@
 #ifndef VSNRAY_DETAIL_SCHED_COMMON_H
 #define VSNRAY_DETAIL_SCHED_COMMON_H 1
 
+#include <type_traits>
 #include <utility>
 
 #include <visionaray/math/array.h>
@@ -15,6 +16,7 @@
 #include <visionaray/result_record.h>
 #include <visionaray/tags.h>
 
+#include "adaptive_sampling.h"
 #include "macros.h"
 #include "pixel_access.h"
 #include "tags.h"
@@ -72,6 +74,21 @@ inline auto invoke_kernel(K kernel, R r, Generator& gen, int x, int y)
     return kernel(r, x, y);
 }
 
+template <
+    typename K,
+    typename R,
+    typename Generator,
+    typename = void,
+    typename = void,
+    typename = void
+    >
+VSNRAY_FUNC
+inline auto invoke_kernel(K kernel, R r, Generator& gen, int x, int y)
+    -> decltype(kernel(r, gen, x, y))
+{
+    return kernel(r, gen, x, y);
+}
+
 
 //-------------------------------------------------------------------------------------------------
 // Invoke cam::primary_ray()
@@ -539,6 +556,220 @@ inline void sample_pixel_impl(
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Adaptive pixel sampler, blends with per-pixel sample counts, skips converged packets
+//
+
+template <typename S>
+VSNRAY_FUNC
+inline vector<4, S> const& result_color(vector<4, S> const& color)
+{
+    return color;
+}
+
+template <typename S>
+VSNRAY_FUNC
+inline vector<4, S> const& result_color(result_record<S> const& rr)
+{
+    return rr.color;
+}
+
+template <typename Result, typename S, pixel_format CF, typename Camera>
+VSNRAY_FUNC
+inline void blend_adaptive_sample(
+        Result                          result,
+        S const&                        alpha,
+        render_target_ref<CF>           rt_ref,
+        int                             x,
+        int                             y,
+        int                             width,
+        int                             height,
+        Camera const&                   cam
+        )
+{
+    VSNRAY_UNUSED(cam);
+
+    pixel_access::blend(
+            pixel_format_constant<CF>{},
+            pixel_format_constant<PF_RGBA32F>{},
+            x,
+            y,
+            width,
+            height,
+            result,
+            rt_ref.color(),
+            alpha, S(1.0) - alpha
+            );
+}
+
+template <typename Result, typename S, pixel_format CF, pixel_format DF, typename Camera>
+VSNRAY_FUNC
+inline void blend_adaptive_sample(
+        Result                          result,
+        S const&                        alpha,
+        render_target_ref<CF, DF>       rt_ref,
+        int                             x,
+        int                             y,
+        int                             width,
+        int                             height,
+        Camera const&                   cam
+        )
+{
+    result.depth = select( result.hit, depth_transform(result.isect_pos, cam), S(1.0) );
+
+    pixel_access::blend(
+            pixel_format_constant<CF>{},
+            pixel_format_constant<PF_RGBA32F>{},
+            pixel_format_constant<DF>{},
+            pixel_format_constant<PF_DEPTH32F>{},
+            x,
+            y,
+            width,
+            height,
+            result,
+            rt_ref.color(),
+            rt_ref.depth(),
+            alpha, S(1.0) - alpha
+            );
+}
+
+// Statistics, rays and the kernel use image coordinates (x,y), color and depth are blended
+// into storage at (sx,sy) with size (sw,sh), e.g. a tile of a tiled render target
+template <
+    typename K,
+    typename R,
+    typename Generator,
+    pixel_format CF,
+    pixel_format DF,
+    typename Camera
+    >
+VSNRAY_FUNC
+inline void sample_pixel_adaptive(
+        K                                   kernel,
+        adaptive_blend_params               params,
+        R const&                            r,
+        Generator&                          gen,
+        render_target_ref<CF, DF>           storage,
+        int                                 x,
+        int                                 y,
+        int                                 width,
+        int                                 height,
+        int                                 sx,
+        int                                 sy,
+        int                                 sw,
+        int                                 sh,
+        Camera const&                       cam
+        )
+{
+    using S = typename R::scalar_type;
+
+    const int num_lanes = simd::num_elements<S>::value;
+    const int pw        = packet_size<S>::w;
+
+    // Skip the packet if all its pixels have converged
+    bool all_converged = true;
+    bool have_estimate = true;
+    float max_error = 0.0f;
+
+    for (int i = 0; i < num_lanes; ++i)
+    {
+        int px = x + i % pw;
+        int py = y + i / pw;
+
+        if (px >= width || py >= height)
+        {
+            continue;
+        }
+
+        auto const& pv = params.variance[py * width + px];
+
+        if (!converged(pv, params))
+        {
+            all_converged = false;
+            have_estimate &= pv.count >= params.min_samples;
+            max_error = max(max_error, relative_error(pv) / params.tolerance);
+        }
+    }
+
+    if (all_converged)
+    {
+        return;
+    }
+
+    // Packets that are far from converging receive additional samples
+    unsigned num_samples = 1;
+
+    if (have_estimate)
+    {
+        num_samples = static_cast<unsigned>(min(max_error, float(params.max_samples_per_frame)));
+        num_samples = max(num_samples, 1U);
+    }
+
+    for (unsigned s = 0; s < num_samples; ++s)
+    {
+        auto result = s == 0
+            ? invoke_kernel(kernel, r, gen, x, y)
+            : invoke_kernel(
+                    kernel,
+                    make_primary_rays(R{}, pixel_sampler::jittered_type{}, gen, x, y, width, height, cam),
+                    gen,
+                    x,
+                    y
+                    );
+
+        auto const& color = result_color(result);
+        auto lum = dot(color.xyz(), vector<3, S>(0.2126f, 0.7152f, 0.0722f));
+
+        S alpha(1.0);
+
+        for (int i = 0; i < num_lanes; ++i)
+        {
+            int px = x + i % pw;
+            int py = y + i / pw;
+
+            if (px >= width || py >= height)
+            {
+                continue;
+            }
+
+            auto& pv = params.variance[py * width + px];
+            update(pv, lane(lum, i));
+            lane(alpha, i) = 1.0f / pv.count;
+        }
+
+        blend_adaptive_sample(result, alpha, storage, sx, sy, sw, sh, cam);
+    }
+}
+
+template <
+    typename K,
+    typename R,
+    typename Generator,
+    pixel_format CF,
+    pixel_format DF,
+    typename Camera
+    >
+VSNRAY_FUNC
+inline void sample_pixel_impl(
+        K                                   kernel,
+        adaptive_blend_params               params,
+        R const&                            r,
+        Generator&                          gen,
+        unsigned                            frame_num,
+        render_target_ref<CF, DF>           rt_ref,
+        int                                 x,
+        int                                 y,
+        int                                 width,
+        int                                 height,
+        Camera const&                       cam
+        )
+{
+    VSNRAY_UNUSED(frame_num);
+
+    sample_pixel_adaptive(kernel, params, r, gen, rt_ref, x, y, width, height, x, y, width, height, cam);
+}
+
+
 //-------------------------------------------------------------------------------------------------
 // jittered pixel sampler, blends several samples at once
 //
@@ -731,6 +962,289 @@ inline void sample_pixel_impl(
     }
 }
 
+//-------------------------------------------------------------------------------------------------
+// Render targets with AOV layers
+//
+// The kernel is wrapped so that AOVs are stored right after each sample was computed.
+// Color and depth are then handled by the pixel sampler as usual.
+//
+
+// Number of samples the pixel sampler has blended into a pixel, including the current one.
+// AOVs are averaged with the same weights as color. Blending samplers accumulate over
+// frames (sample s of the frame has weight 1 / (frame_num + s)), the others start over
+// in each frame
+struct frame_sample_count
+{
+    unsigned    first;
+    unsigned    sample;
+
+    VSNRAY_FUNC unsigned operator()(int /* px */, int /* py */) const
+    {
+        return first + sample;
+    }
+};
+
+// The adaptive sampler keeps a per-pixel count, updated after the sample was blended
+struct adaptive_sample_count
+{
+    pixel_variance const*   variance;
+    int                     width;
+
+    VSNRAY_FUNC unsigned operator()(int px, int py) const
+    {
+        return variance[py * width + px].count + 1;
+    }
+};
+
+template <typename PxSamplerT>
+VSNRAY_FUNC
+inline frame_sample_count make_sample_count(PxSamplerT /* */, unsigned frame_num, unsigned sample, int /* width */)
+{
+    bool blend = std::is_base_of<pixel_sampler::jittered_blend_type, PxSamplerT>::value;
+    return { blend ? max(frame_num, 1U) : 1U, sample };
+}
+
+VSNRAY_FUNC
+inline adaptive_sample_count make_sample_count(adaptive_blend_params const& params, unsigned, unsigned, int width)
+{
+    return { params.variance, width };
+}
+
+template <typename K, typename PxSamplerT>
+struct store_aovs_kernel
+{
+    K           kernel;
+    PxSamplerT  sampler;
+    aov_ref     aovs;
+    unsigned    frame_num;
+    int         width;
+    int         height;
+
+    // Index of the sample that is computed next for this packet
+    unsigned*   sample;
+
+    template <typename R, typename Generator>
+    VSNRAY_FUNC
+    auto operator()(R const& r, Generator& gen, int x, int y) const
+        -> decltype(invoke_kernel(std::declval<K>(), r, gen, x, y))
+    {
+        using S = typename R::scalar_type;
+
+        auto result = invoke_kernel(kernel, r, gen, x, y);
+        auto counts = make_sample_count(sampler, frame_num, (*sample)++, width);
+        pixel_access::store_aovs<S>(x, y, width, height, counts, result, aovs);
+        return result;
+    }
+};
+
+template <
+    typename K,
+    typename PxSamplerT,
+    typename R,
+    typename Generator,
+    pixel_format CF,
+    pixel_format DF,
+    typename Camera
+    >
+VSNRAY_FUNC
+inline void sample_pixel_impl(
+        K                                   kernel,
+        PxSamplerT                          sampler,
+        R const&                            r,
+        Generator&                          gen,
+        unsigned                            frame_num,
+        render_target_aov_ref<CF, DF>       rt_ref,
+        int                                 x,
+        int                                 y,
+        int                                 width,
+        int                                 height,
+        Camera const&                       cam
+        )
+{
+    unsigned sample = 0;
+    store_aovs_kernel<K, PxSamplerT> k{ kernel, sampler, rt_ref.aovs(), frame_num, width, height, &sample };
+
+    sample_pixel_impl(
+            k,
+            sampler,
+            r,
+            gen,
+            frame_num,
+            static_cast<render_target_ref<CF, DF> const&>(rt_ref),
+            x,
+            y,
+            width,
+            height,
+            cam
+            );
+}
+
+//-------------------------------------------------------------------------------------------------
+// Render targets with tile-major storage
+//
+// Pixel samplers address a single tile with tile-local coordinates, pixel_access thus writes
+// straight into the tiled storage. The kernel is wrapped so that it (and the AOV writer,
+// AOVs are stored in row-major order) still receives image coordinates.
+//
+// Packets must not straddle tile boundaries, i.e. the scissor box origin must be a multiple
+// of the packet size.
+//
+
+template <typename K>
+struct pixel_offset_kernel
+{
+    K           kernel;
+    int         x0;
+    int         y0;
+
+    template <typename R, typename Generator>
+    VSNRAY_FUNC
+    auto operator()(R const& r, Generator& gen, int x, int y) const
+        -> decltype(invoke_kernel(std::declval<K>(), r, gen, x, y))
+    {
+        return invoke_kernel(kernel, r, gen, x + x0, y + y0);
+    }
+};
+
+template <
+    typename K,
+    typename PxSamplerT,
+    typename R,
+    typename Generator,
+    pixel_format CF,
+    pixel_format DF,
+    typename Camera
+    >
+VSNRAY_FUNC
+inline void sample_pixel_impl(
+        K                                   kernel,
+        PxSamplerT                          sampler,
+        R const&                            r,
+        Generator&                          gen,
+        unsigned                            frame_num,
+        render_target_tiled_ref<CF, DF>     rt_ref,
+        int                                 x,
+        int                                 y,
+        int                                 width,
+        int                                 height,
+        Camera const&                       cam
+        )
+{
+    using ref_type = render_target_tiled_ref<CF, DF>;
+
+    if (!rt_ref.tiled())
+    {
+        sample_pixel_impl(
+                kernel,
+                sampler,
+                r,
+                gen,
+                frame_num,
+                static_cast<typename ref_type::base_type const&>(rt_ref),
+                x,
+                y,
+                width,
+                height,
+                cam
+                );
+        return;
+    }
+
+    int x0 = x - x % ref_type::tile_width;
+    int y0 = y - y % ref_type::tile_height;
+
+    unsigned sample = 0;
+
+    using aov_kernel = store_aovs_kernel<K, PxSamplerT>;
+    aov_kernel k1{ kernel, sampler, rt_ref.aovs(), frame_num, width, height, &sample };
+    pixel_offset_kernel<aov_kernel> k2{ k1, x0, y0 };
+
+    // Pixels outside the image are written to the padding of border tiles
+    sample_pixel_impl(
+            k2,
+            sampler,
+            r,
+            gen,
+            frame_num,
+            rt_ref.tile(x, y),
+            x - x0,
+            y - y0,
+            int(ref_type::tile_width),
+            int(ref_type::tile_height),
+            cam
+            );
+}
+
+// The adaptive sampler maintains statistics in image coordinates and only blends into the
+// tile, the kernel and the AOV writer receive image coordinates directly
+template <
+    typename K,
+    typename R,
+    typename Generator,
+    pixel_format CF,
+    pixel_format DF,
+    typename Camera
+    >
+VSNRAY_FUNC
+inline void sample_pixel_impl(
+        K                                   kernel,
+        adaptive_blend_params               params,
+        R const&                            r,
+        Generator&                          gen,
+        unsigned                            frame_num,
+        render_target_tiled_ref<CF, DF>     rt_ref,
+        int                                 x,
+        int                                 y,
+        int                                 width,
+        int                                 height,
+        Camera const&                       cam
+        )
+{
+    using ref_type = render_target_tiled_ref<CF, DF>;
+
+    if (!rt_ref.tiled())
+    {
+        sample_pixel_impl(
+                kernel,
+                params,
+                r,
+                gen,
+                frame_num,
+                static_cast<typename ref_type::base_type const&>(rt_ref),
+                x,
+                y,
+                width,
+                height,
+                cam
+                );
+        return;
+    }
+
+    int x0 = x - x % ref_type::tile_width;
+    int y0 = y - y % ref_type::tile_height;
+
+    unsigned sample = 0;
+    store_aovs_kernel<K, adaptive_blend_params> k{ kernel, params, rt_ref.aovs(), frame_num, width, height, &sample };
+
+    // Pixels outside the image are written to the padding of border tiles
+    sample_pixel_adaptive(
+            k,
+            params,
+            r,
+            gen,
+            rt_ref.tile(x, y),
+            x,
+            y,
+            width,
+            height,
+            x - x0,
+            y - y0,
+            int(ref_type::tile_width),
+            int(ref_type::tile_height),
+            cam
+            );
+}
+
 //-------------------------------------------------------------------------------------------------
 // w/o intersector
 //
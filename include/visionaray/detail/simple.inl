@@ -7,6 +7,7 @@
 #define VSNRAY_DETAIL_SIMPLE_INL 1
 
 #include <visionaray/get_surface.h>
+#include <visionaray/light_culling.h>
 #include <visionaray/result_record.h>
 #include <visionaray/spectrum.h>
 #include <visionaray/traverse.h>
@@ -38,18 +39,20 @@ struct kernel
         {
             hit_rec.isect_pos = ray.ori + ray.dir * hit_rec.t;
 
-            auto surf = get_surface(hit_rec, params);
+            auto surf = get_surface(hit_rec, params, ray);
             auto ambient = surf.material.ambient() * C(from_rgba(params.ambient_color));
             auto shaded_clr = select( hit_rec.hit, ambient, C(from_rgba(params.bg_color)) );
             auto view_dir = -ray.dir;
 
-            for (auto it = params.lights.begin; it != params.lights.end; ++it)
+            auto lights = culled_lights(params, hit_rec.isect_pos);
+
+            for (auto it = lights.begin(); it != lights.end(); ++it)
             {
                 auto light_dir = normalize( V(it->position()) - hit_rec.isect_pos );
 
                 auto clr = surf.shade(view_dir, light_dir, it->intensity(hit_rec.isect_pos));
 
-                shaded_clr  += select( hit_rec.hit, clr, C(0.0) );
+                shaded_clr  += select( hit_rec.hit & it.active(), clr, C(0.0) );
             }
 
             result.color     = select( hit_rec.hit, to_rgba(shaded_clr), params.bg_color );
@@ -3,6 +3,8 @@
 
 #include <algorithm>
 
+#include "tiled_layout.h"
+
 namespace visionaray
 {
 
@@ -34,6 +36,40 @@ typename simple_buffer_rt<ColorFormat, DepthFormat>::depth_type const* simple_bu
     return depth_buffer.data();
 }
 
+template <pixel_format ColorFormat, pixel_format DepthFormat>
+aov_buffer& simple_buffer_rt<ColorFormat, DepthFormat>::aovs()
+{
+    return aov_buffer_;
+}
+
+template <pixel_format ColorFormat, pixel_format DepthFormat>
+aov_buffer const& simple_buffer_rt<ColorFormat, DepthFormat>::aovs() const
+{
+    return aov_buffer_;
+}
+
+template <pixel_format ColorFormat, pixel_format DepthFormat>
+void simple_buffer_rt<ColorFormat, DepthFormat>::set_layout(render_target_layout layout, thread_pool* pool)
+{
+    layout_ = layout;
+    pool_ = pool;
+
+    size_t tiled_size = layout_ == RT_TILED ? detail::tiled_buffer_size<ref_type>(width(), height()) : 0;
+
+    tiled_color_buffer.resize(tiled_size);
+
+    if (DepthFormat != PF_UNSPECIFIED)
+    {
+        tiled_depth_buffer.resize(tiled_size);
+    }
+}
+
+template <pixel_format ColorFormat, pixel_format DepthFormat>
+render_target_layout simple_buffer_rt<ColorFormat, DepthFormat>::get_layout() const
+{
+    return layout_;
+}
+
 
 //-------------------------------------------------------------------------------------------------
 // Interface
@@ -42,7 +78,11 @@ typename simple_buffer_rt<ColorFormat, DepthFormat>::depth_type const* simple_bu
 template <pixel_format ColorFormat, pixel_format DepthFormat>
 typename simple_buffer_rt<ColorFormat, DepthFormat>::ref_type simple_buffer_rt<ColorFormat, DepthFormat>::ref()
 {
-    return { color(), depth(), width(), height() };
+    return {
+        { { color(), depth(), width(), height() }, aov_buffer_.ref() },
+        tiled_color_buffer.empty() ? nullptr : tiled_color_buffer.data(),
+        tiled_depth_buffer.empty() ? nullptr : tiled_depth_buffer.data()
+        };
 }
 
 template <pixel_format ColorFormat, pixel_format DepthFormat>
@@ -58,6 +98,9 @@ void simple_buffer_rt<ColorFormat, DepthFormat>::clear_color_buffer(vec4 const&
         );
 
     std::fill(color_buffer.begin(), color_buffer.end(), cc);
+    std::fill(tiled_color_buffer.begin(), tiled_color_buffer.end(), cc);
+
+    aov_buffer_.clear();
 }
 
 template <pixel_format ColorFormat, pixel_format DepthFormat>
@@ -73,6 +116,7 @@ void simple_buffer_rt<ColorFormat, DepthFormat>::clear_depth_buffer(float d)
         );
 
     std::fill(depth_buffer.begin(), depth_buffer.end(), dd);
+    std::fill(tiled_depth_buffer.begin(), tiled_depth_buffer.end(), dd);
 }
 
 template <pixel_format ColorFormat, pixel_format DepthFormat>
@@ -83,6 +127,16 @@ void simple_buffer_rt<ColorFormat, DepthFormat>::begin_frame()
 template <pixel_format ColorFormat, pixel_format DepthFormat>
 void simple_buffer_rt<ColorFormat, DepthFormat>::end_frame()
 {
+    // Resolve tiles
+    if (layout_ == RT_TILED)
+    {
+        detail::linearize_tiles<ref_type>(tiled_color_buffer.data(), color_buffer.data(), width(), height(), pool_);
+
+        if (DepthFormat != PF_UNSPECIFIED)
+        {
+            detail::linearize_tiles<ref_type>(tiled_depth_buffer.data(), depth_buffer.data(), width(), height(), pool_);
+        }
+    }
 }
 
 template <pixel_format ColorFormat, pixel_format DepthFormat>
@@ -97,6 +151,17 @@ void simple_buffer_rt<ColorFormat, DepthFormat>::resize(int w, int h)
     {
         depth_buffer.resize(w * h);
     }
+
+    aov_buffer_.resize(w, h);
+
+    size_t tiled_size = layout_ == RT_TILED ? detail::tiled_buffer_size<ref_type>(w, h) : 0;
+
+    tiled_color_buffer.resize(tiled_size);
+
+    if (DepthFormat != PF_UNSPECIFIED)
+    {
+        tiled_depth_buffer.resize(tiled_size);
+    }
 }
 
 } // visionaray
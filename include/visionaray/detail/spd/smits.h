@@ -0,0 +1,56 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_DETAIL_SPD_SMITS_H
+#define VSNRAY_DETAIL_SPD_SMITS_H 1
+
+#include "../../math/vector.h"
+#include "../macros.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Basis spectra to convert RGB reflectances to spectra
+// See: Smits, An RGB-to-spectrum conversion for reflectances (1999)
+// Ten bins from 380 to 720 nm, interpolated between bin centers
+//
+
+class spd_smits
+{
+public:
+
+    enum basis { White, Cyan, Magenta, Yellow, Red, Green, Blue };
+
+    // Bins per basis spectrum
+    static const int num_bins = 10;
+
+    spd_smits(basis b = White) : basis_(b) {}
+
+    VSNRAY_FUNC float operator()(float lambda /* nm */) const
+    {
+        float x = (lambda - 380.0f) / 34.0f - 0.5f;
+        x = clamp(x, 0.0f, 9.0f);
+
+        int i = min(static_cast<int>(x), 8);
+        float s = x - i;
+
+        return lerp( table_[basis_][i], table_[basis_][i + 1], s );
+    }
+
+    // All basis spectra, num_bins values per basis in the order of the basis enum
+    static float const* table() { return table_[0]; }
+
+private:
+
+    basis basis_;
+
+    static const float table_[7][num_bins];
+
+};
+
+} // visionaray
+
+#endif // VSNRAY_DETAIL_SPD_SMITS_H
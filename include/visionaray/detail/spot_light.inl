@@ -26,6 +26,11 @@ inline vector<3, U> spot_light<T>::intensity(vector<3, U> const& pos) const
              + linear_attenuation_    * dist
              + quadratic_attenuation_ * dist * dist)
         );
+
+    // Window, 1 near the light and 0 at the influence radius
+    auto r = dist / U(influence_radius_);
+    auto window = max(U(1.0) - r * r * r * r, U(0.0));
+    att *= window * window;
 #endif
 
     auto spot = dot(V(spot_direction_), normalize(-light_dir));
@@ -97,6 +102,13 @@ inline T spot_light<T>::quadratic_attenuation() const
     return quadratic_attenuation_;
 }
 
+template <typename T>
+VSNRAY_FUNC
+inline T spot_light<T>::influence_radius() const
+{
+    return influence_radius_;
+}
+
 template <typename T>
 VSNRAY_FUNC
 inline void spot_light<T>::set_cl(vector<3, T> const& cl)
@@ -161,4 +173,11 @@ inline void spot_light<T>::set_quadratic_attenuation(T att)
     quadratic_attenuation_ = att;
 }
 
+template <typename T>
+VSNRAY_FUNC
+inline void spot_light<T>::set_influence_radius(T radius)
+{
+    influence_radius_ = radius;
+}
+
 } // visionaray
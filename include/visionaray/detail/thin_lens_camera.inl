@@ -30,4 +30,35 @@ inline R thin_lens_camera::primary_ray(
     return r;
 }
 
+template <typename T, typename Generator>
+VSNRAY_FUNC
+inline basic_ray_differential<T> thin_lens_camera::primary_ray(
+        basic_ray_differential<T>   /* */,
+        Generator                   gen,
+        T const&                    x,
+        T const&                    y,
+        T const&                    width,
+        T const&                    height
+        ) const
+{
+    using R = basic_ray<T>;
+
+    R c  = pinhole_camera::primary_ray(R{}, x, y, width, height);
+    R cx = pinhole_camera::primary_ray(R{}, x + T(1.0), y, width, height);
+    R cy = pinhole_camera::primary_ray(R{}, x, y + T(1.0), width, height);
+
+    auto f = T(focal_distance_);
+
+    auto lens_sample = concentric_sample_disk(gen.next(), gen.next()) * T(lens_radius_);
+
+    basic_ray_differential<T> r;
+    r.ori = c.ori + vector<3, T>(lens_sample.x, lens_sample.y, T(0.0));
+    r.dir = normalize(c.ori + c.dir * f - r.ori);
+
+    r.dddx = normalize(cx.ori + cx.dir * f - r.ori) - r.dir;
+    r.dddy = normalize(cy.ori + cy.dir * f - r.ori) - r.dir;
+
+    return r;
+}
+
 } // visionaray
@@ -0,0 +1,80 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_DETAIL_TILED_LAYOUT_H
+#define VSNRAY_DETAIL_TILED_LAYOUT_H 1
+
+#include <algorithm>
+#include <cstddef>
+
+#include "../math/detail/math.h"
+#include "parallel_for.h"
+#include "range.h"
+#include "thread_pool.h"
+
+namespace visionaray
+{
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Number of pixels to allocate for tile-major storage, including padding
+//
+
+template <typename Ref>
+inline size_t tiled_buffer_size(int width, int height)
+{
+    size_t num_tiles_x = div_up(width, Ref::tile_width);
+    size_t num_tiles_y = div_up(height, Ref::tile_height);
+
+    return num_tiles_x * num_tiles_y * Ref::tile_width * Ref::tile_height;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Copy tile-major storage to a row-major buffer, one task per row of tiles
+//
+
+template <typename Ref, typename T>
+inline void linearize_tiles(T const* tiles, T* linear, int width, int height, thread_pool* pool = nullptr)
+{
+    const int tw = Ref::tile_width;
+    const int th = Ref::tile_height;
+
+    int num_tiles_x = div_up(width, tw);
+    int num_tiles_y = div_up(height, th);
+
+    auto copy_tile_rows = [=](range1d<int> const& r)
+    {
+        for (int ty = r.begin(); ty != r.end(); ++ty)
+        {
+            for (int tx = 0; tx < num_tiles_x; ++tx)
+            {
+                T const* tile = tiles + (static_cast<size_t>(ty) * num_tiles_x + tx) * tw * th;
+
+                int x0 = tx * tw;
+                int y0 = ty * th;
+                int w  = std::min(tw, width - x0);
+                int h  = std::min(th, height - y0);
+
+                for (int y = 0; y < h; ++y)
+                {
+                    std::copy(
+                        tile + y * tw,
+                        tile + y * tw + w,
+                        linear + static_cast<size_t>(y0 + y) * width + x0
+                        );
+                }
+            }
+        }
+    };
+
+    optional_parallel_for(pool, tiled_range1d<int>(0, num_tiles_y, 1), copy_tile_rows);
+}
+
+} // detail
+} // visionaray
+
+#endif // VSNRAY_DETAIL_TILED_LAYOUT_H
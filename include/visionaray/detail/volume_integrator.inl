@@ -0,0 +1,464 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "../math/simd/simd.h"
+#include "../math/intersect.h"
+#include "../math/limits.h"
+#include "grid_traversal.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// macrocell_grid members
+//
+
+template <typename Texture>
+inline void macrocell_grid::build(Texture const& volume, int cell_size)
+{
+    int w = static_cast<int>(volume.width());
+    int h = static_cast<int>(volume.height());
+    int d = static_cast<int>(volume.depth());
+
+    ref_.dims = vec3i(div_up(w, cell_size), div_up(h, cell_size), div_up(d, cell_size));
+    ref_.cells_per_texcoord = vec3(w, h, d) / static_cast<float>(cell_size);
+
+    value_ranges_.resize(ref_.dims.x * ref_.dims.y * ref_.dims.z);
+
+    // Voxels beyond the cell that the filter reads from
+    int margin = volume.get_filter_mode() == BSpline || volume.get_filter_mode() == CardinalSpline ? 2 : 1;
+
+    // Cardinal spline weights become negative and overshoot the voxel values. The negative
+    // weights of one dimension sum up to at most 1/8, the negative products of the 3D
+    // tensor product weights to ((1 + 1/4)^3 - 1) / 2
+    float overshoot = volume.get_filter_mode() == CardinalSpline ? 61.0f / 128.0f : 0.0f;
+
+    for (int z = 0; z < ref_.dims.z; ++z)
+    {
+        for (int y = 0; y < ref_.dims.y; ++y)
+        {
+            for (int x = 0; x < ref_.dims.x; ++x)
+            {
+                int x0 = std::max(x * cell_size - margin, 0);
+                int y0 = std::max(y * cell_size - margin, 0);
+                int z0 = std::max(z * cell_size - margin, 0);
+                int x1 = std::min((x + 1) * cell_size + margin - 1, w - 1);
+                int y1 = std::min((y + 1) * cell_size + margin - 1, h - 1);
+                int z1 = std::min((z + 1) * cell_size + margin - 1, d - 1);
+
+                vec2 range(numeric_limits<float>::max(), -numeric_limits<float>::max());
+
+                for (int k = z0; k <= z1; ++k)
+                {
+                    for (int j = y0; j <= y1; ++j)
+                    {
+                        for (int i = x0; i <= x1; ++i)
+                        {
+                            float v = static_cast<float>(volume(i, j, k));
+                            range.x = std::min(range.x, v);
+                            range.y = std::max(range.y, v);
+                        }
+                    }
+                }
+
+                float extent = (range.y - range.x) * overshoot;
+                range.x -= extent;
+                range.y += extent;
+
+                value_ranges_[(z * ref_.dims.y + y) * ref_.dims.x + x] = range;
+            }
+        }
+    }
+
+    // All cells are visible until classified
+    active_.assign(value_ranges_.size(), 1);
+
+    ref_.value_ranges = value_ranges_.data();
+    ref_.active = active_.data();
+}
+
+template <typename TransFunc>
+inline void macrocell_grid::classify(TransFunc const& transfunc)
+{
+    int n = static_cast<int>(transfunc.width());
+
+    // Number of transfer function entries with non-zero opacity in [0, i)
+    std::vector<int> visible(n + 1, 0);
+
+    for (int i = 0; i < n; ++i)
+    {
+        visible[i + 1] = visible[i] + (transfunc.data()[i].w > 0.0f ? 1 : 0);
+    }
+
+    for (size_t c = 0; c < value_ranges_.size(); ++c)
+    {
+        // Entries that nearest and linear filtering read for coordinates in the value range
+        vec2 range = value_ranges_[c];
+        float lo = std::floor(range.x * n - 0.5f);
+        float hi = std::floor(range.y * n + 0.5f);
+
+        int first = static_cast<int>(clamp(lo, 0.0f, static_cast<float>(n - 1)));
+        int last  = static_cast<int>(clamp(hi, 0.0f, static_cast<float>(n - 1)));
+
+        active_[c] = visible[last + 1] - visible[first] > 0 ? 1 : 0;
+    }
+}
+
+inline macrocell_grid_ref macrocell_grid::ref() const
+{
+    return ref_;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// volume_integrator members
+//
+
+template <typename T, typename Volume>
+VSNRAY_FUNC
+inline vector<4, T> volume_integrator<T, Volume>::integrate(
+        basic_ray<T> const& ray,
+        T                   tmin,
+        T                   tmax
+        ) const
+{
+    vector<4, T> result(T(0.0));
+
+    auto hr = intersect(ray, bounds_);
+
+    if (!hr.hit)
+    {
+        return result;
+    }
+
+    // Sample positions are relative to the entry point so they don't depend on skipping
+    T t0 = max(tmin, hr.tnear);
+    tmax = min(tmax, hr.tfar);
+
+    if (t0 >= tmax)
+    {
+        return result;
+    }
+
+    T k(0.0);
+
+    // Value at the end of the last pre-integrated segment
+    T back_k(-1.0);
+    T back(0.0);
+
+    detail::traverse_grid(
+            ray,
+            bounds_,
+            cells_.dims,
+            cells_.cells_per_texcoord,
+            t0,
+            tmax,
+            [&](vec3i const& cell, T t_enter, T t_exit) -> bool
+            {
+                if (cells_.empty(cell.x, cell.y, cell.z))
+                {
+                    return true;
+                }
+
+                T first = ceil((t_enter - t0) / step_size_);
+
+                if (preintegrated_)
+                {
+                    // Also the segment that ends in this cell
+                    first = max(first - T(1.0), T(0.0));
+                }
+
+                k = max(k, first);
+
+                for (T t = t0 + k * step_size_; t < t_exit; t = t0 + k * step_size_)
+                {
+                    vector<3, T> pos = ray.ori + ray.dir * t;
+
+                    if (preintegrated_)
+                    {
+                        T front = k == back_k ? back : sample(pos);
+                        back = sample(pos + ray.dir * step_size_);
+                        back_k = k + T(1.0);
+
+                        composite_segment(front, back, T(1.0), result);
+                    }
+                    else
+                    {
+                        composite(pos, result);
+                    }
+
+                    k += T(1.0);
+
+                    if (result.w >= opacity_threshold_)
+                    {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+            );
+
+    return result;
+}
+
+template <typename T, typename Volume>
+template <typename U, typename>
+inline vector<4, U> volume_integrator<T, Volume>::integrate(
+        basic_ray<U> const& ray,
+        U const&            tmin,
+        U const&            tmax
+        ) const
+{
+    using float_array = simd::aligned_array_t<U>;
+
+    auto rays = simd::unpack(ray);
+
+    float_array tmins;
+    float_array tmaxs;
+    float_array r;
+    float_array g;
+    float_array b;
+    float_array a;
+
+    store(tmins, tmin);
+    store(tmaxs, tmax);
+
+    for (int i = 0; i < simd::num_elements<U>::value; ++i)
+    {
+        auto c = integrate(rays[i], tmins[i], tmaxs[i]);
+        r[i] = c.x;
+        g[i] = c.y;
+        b[i] = c.z;
+        a[i] = c.w;
+    }
+
+    return vector<4, U>(U(r), U(g), U(b), U(a));
+}
+
+template <typename T, typename Volume>
+VSNRAY_FUNC
+inline vector<4, T> volume_integrator<T, Volume>::integrate(
+        basic_ray_differential<T> const&    ray,
+        T                                   tmin,
+        T                                   tmax
+        ) const
+{
+    vector<4, T> result(T(0.0));
+
+    auto hr = intersect(ray, bounds_);
+
+    if (!hr.hit)
+    {
+        return result;
+    }
+
+    T t = max(tmin, hr.tnear);
+    tmax = min(tmax, hr.tfar);
+
+    if (t >= tmax)
+    {
+        return result;
+    }
+
+    // World space size of the voxels of the finest level
+    vector<3, T> voxel = vector<3, T>(bounds_.size()) / vector<3, T>(
+            T(volume_.width()),
+            T(volume_.height()),
+            T(volume_.depth())
+            );
+    T voxel_size = min(min(voxel.x, voxel.y), voxel.z);
+
+    T max_level(volume_.num_levels() - 1);
+    T reference = reference_step_size_ > T(0.0) ? reference_step_size_ : step_size_;
+
+    auto texcoord = [&](T t)
+    {
+        return (ray.ori + ray.dir * t - vector<3, T>(bounds_.min)) / vector<3, T>(bounds_.size());
+    };
+
+    // Value at the end of the last pre-integrated segment
+    T back_t(-1.0);
+    T back(0.0);
+
+    detail::traverse_grid(
+            ray,
+            bounds_,
+            cells_.dims,
+            cells_.cells_per_texcoord,
+            t,
+            tmax,
+            [&](vec3i const& cell, T t_enter, T t_exit) -> bool
+            {
+                if (cells_.empty(cell.x, cell.y, cell.z))
+                {
+                    return true;
+                }
+
+                t = max(t, t_enter);
+
+                while (t < t_exit)
+                {
+                    // Voxels of level l are 2^l times as large as those of level 0
+                    T lod = clamp(log2(ray_footprint(ray, t) / voxel_size), T(0.0), max_level);
+                    T dt = step_size_ * pow(T(2.0), floor(lod));
+
+                    if (preintegrated_)
+                    {
+                        // The table was built for segments of length step_size
+                        T front = t == back_t ? back : T(tex3D(volume_, texcoord(t), lod));
+                        back = T(tex3D(volume_, texcoord(t + dt), lod));
+                        back_t = t + dt;
+
+                        composite_segment(front, back, dt / step_size_, result);
+                    }
+                    else
+                    {
+                        composite_value(T(tex3D(volume_, texcoord(t), lod)), dt / reference, result);
+                    }
+
+                    t += dt;
+
+                    if (result.w >= opacity_threshold_)
+                    {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+            );
+
+    return result;
+}
+
+template <typename T, typename Volume>
+template <typename U, typename>
+inline vector<4, U> volume_integrator<T, Volume>::integrate(
+        basic_ray_differential<U> const&    ray,
+        U const&                            tmin,
+        U const&                            tmax
+        ) const
+{
+    using float_array = simd::aligned_array_t<U>;
+
+    auto rays = simd::unpack(ray);
+
+    float_array tmins;
+    float_array tmaxs;
+    float_array r;
+    float_array g;
+    float_array b;
+    float_array a;
+
+    store(tmins, tmin);
+    store(tmaxs, tmax);
+
+    for (int i = 0; i < simd::num_elements<U>::value; ++i)
+    {
+        auto c = integrate(rays[i], tmins[i], tmaxs[i]);
+        r[i] = c.x;
+        g[i] = c.y;
+        b[i] = c.z;
+        a[i] = c.w;
+    }
+
+    return vector<4, U>(U(r), U(g), U(b), U(a));
+}
+
+template <typename T, typename Volume>
+inline void volume_integrator<T, Volume>::set_volume(Volume const& volume, macrocell_grid_ref const& cells)
+{
+    volume_ = volume;
+    cells_ = cells;
+}
+
+template <typename T, typename Volume>
+inline void volume_integrator<T, Volume>::set_transfunc(texture_ref<vec4, 1> const& transfunc)
+{
+    transfunc_ = transfunc;
+}
+
+template <typename T, typename Volume>
+inline void volume_integrator<T, Volume>::set_bounds(aabb const& bounds)
+{
+    bounds_ = bounds;
+}
+
+template <typename T, typename Volume>
+inline void volume_integrator<T, Volume>::set_preintegration_table(texture_ref<vec4, 2> const& table)
+{
+    preintegration_table_ = table;
+    preintegrated_ = true;
+}
+
+template <typename T, typename Volume>
+VSNRAY_FUNC
+inline void volume_integrator<T, Volume>::composite(vector<3, T> const& pos, vector<4, T>& dst) const
+{
+    T opacity_exponent = reference_step_size_ > T(0.0) ? step_size_ / reference_step_size_ : T(1.0);
+
+    composite_value(sample(pos), opacity_exponent, dst);
+}
+
+template <typename T, typename Volume>
+VSNRAY_FUNC
+inline T volume_integrator<T, Volume>::sample(vector<3, T> const& pos) const
+{
+    vector<3, T> coord = (pos - vector<3, T>(bounds_.min)) / vector<3, T>(bounds_.size());
+
+    return T(tex3D(volume_, coord));
+}
+
+template <typename T, typename Volume>
+VSNRAY_FUNC
+inline void volume_integrator<T, Volume>::composite_value(
+        T               value,
+        T               opacity_exponent,
+        vector<4, T>&   dst
+        ) const
+{
+    vector<4, T> color = tex1D(transfunc_, value);
+
+    // alpha' = 1 - (1 - alpha)^(step / reference)
+    if (opacity_exponent != T(1.0))
+    {
+        color.w = T(1.0) - pow(T(1.0) - color.w, opacity_exponent);
+    }
+
+    // premultiplied alpha
+    color.xyz() *= color.w;
+
+    // front-to-back alpha compositing
+    dst += color * (T(1.0) - dst.w);
+}
+
+template <typename T, typename Volume>
+VSNRAY_FUNC
+inline void volume_integrator<T, Volume>::composite_segment(
+        T               front,
+        T               back,
+        T               opacity_exponent,
+        vector<4, T>&   dst
+        ) const
+{
+    // premultiplied
+    vector<4, T> color = preintegrated_segment(preintegration_table_, front, back);
+
+    if (opacity_exponent != T(1.0) && color.w > T(0.0))
+    {
+        T alpha = T(1.0) - pow(T(1.0) - color.w, opacity_exponent);
+        color.xyz() *= alpha / color.w;
+        color.w = alpha;
+    }
+
+    // front-to-back alpha compositing
+    dst += color * (T(1.0) - dst.w);
+}
+
+} // visionaray
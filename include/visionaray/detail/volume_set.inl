@@ -0,0 +1,333 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cstddef>
+
+#include "../math/intersect.h"
+#include "../math/limits.h"
+#include "stack.h"
+
+namespace visionaray
+{
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// BVH interface of volume box proxies
+//
+
+inline aabb get_bounds(volume_box_proxy const& proxy)
+{
+    return proxy.bounds;
+}
+
+inline void split_primitive(aabb& L, aabb& R, float plane, int axis, volume_box_proxy const& proxy)
+{
+    L.invalidate();
+    R.invalidate();
+
+    if (proxy.bounds.min[axis] <= plane)
+    {
+        L = proxy.bounds;
+        L.max[axis] = std::min(L.max[axis], plane);
+    }
+
+    if (proxy.bounds.max[axis] >= plane)
+    {
+        R = proxy.bounds;
+        R.min[axis] = std::max(R.min[axis], plane);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test the ray against one volume box and insert the clipped overlap, sorted by tnear
+//
+
+template <size_t MaxHits>
+VSNRAY_FUNC
+inline void insert_volume_hit(
+        volume_hits<MaxHits>&   hits,
+        basic_ray<float> const& ray,
+        volume_box const&       box,
+        int                     index,
+        float                   tmin,
+        float                   tmax
+        )
+{
+    // Affine transform, distances along the ray don't change
+    basic_ray<float> r;
+    r.ori = (box.transform_inv * vec4(ray.ori, 1.0f)).xyz();
+    r.dir = (box.transform_inv * vec4(ray.dir, 0.0f)).xyz();
+
+    auto hr = intersect(r, box.bounds);
+
+    float tnear = max(hr.tnear, tmin);
+    float tfar = min(hr.tfar, tmax);
+
+    if (!hr.hit || tnear >= tfar)
+    {
+        return;
+    }
+
+    int n = hits.size;
+
+    if (n == static_cast<int>(MaxHits))
+    {
+        if (tnear >= hits.tnear[n - 1])
+        {
+            return;
+        }
+
+        // Drop the farthest volume
+        --n;
+    }
+
+    int i = n;
+
+    for (; i > 0 && hits.tnear[i - 1] > tnear; --i)
+    {
+        hits.tnear[i] = hits.tnear[i - 1];
+        hits.tfar[i] = hits.tfar[i - 1];
+        hits.volume[i] = hits.volume[i - 1];
+    }
+
+    hits.tnear[i] = tnear;
+    hits.tfar[i] = tfar;
+    hits.volume[i] = index;
+    hits.size = n + 1;
+}
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// volume_set members
+//
+
+inline void volume_set::build(volume_box const* boxes, size_t count)
+{
+    boxes_.assign(boxes, boxes + count);
+
+    if (count < min_bvh_volumes)
+    {
+        bvh_ = index_bvh<detail::volume_box_proxy>();
+        return;
+    }
+
+    aligned_vector<detail::volume_box_proxy> proxies(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        mat4 transform = inverse(boxes[i].transform_inv);
+
+        proxies[i].bounds.invalidate();
+
+        for (int c = 0; c < 8; ++c)
+        {
+            vec3 corner(
+                    c & 1 ? boxes[i].bounds.max.x : boxes[i].bounds.min.x,
+                    c & 2 ? boxes[i].bounds.max.y : boxes[i].bounds.min.y,
+                    c & 4 ? boxes[i].bounds.max.z : boxes[i].bounds.min.z
+                    );
+
+            proxies[i].bounds.insert((transform * vec4(corner, 1.0f)).xyz());
+        }
+
+        proxies[i].index = static_cast<unsigned>(i);
+    }
+
+    bvh_ = visionaray::build<index_bvh<detail::volume_box_proxy>>(proxies.data(), proxies.size());
+}
+
+inline volume_set::ref_type volume_set::ref() const
+{
+    ref_type result;
+    result.boxes = boxes_.data();
+    result.num_boxes = static_cast<unsigned>(boxes_.size());
+    result.has_bvh = has_bvh();
+
+    if (result.has_bvh)
+    {
+        result.bvh = bvh_.ref();
+    }
+
+    return result;
+}
+
+inline size_t volume_set::size() const
+{
+    return boxes_.size();
+}
+
+inline bool volume_set::has_bvh() const
+{
+    return bvh_.num_nodes() > 0;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Ray / volume set intersection
+//
+
+template <size_t MaxHits>
+VSNRAY_FUNC
+inline volume_hits<MaxHits> intersect(
+        basic_ray<float> const& ray,
+        volume_set_ref const&   set,
+        float                   tmin,
+        float                   tmax
+        )
+{
+    volume_hits<MaxHits> hits;
+
+    if (!set.has_bvh)
+    {
+        for (unsigned i = 0; i < set.num_boxes; ++i)
+        {
+            detail::insert_volume_hit(hits, ray, set.boxes[i], static_cast<int>(i), tmin, tmax);
+        }
+
+        return hits;
+    }
+
+    // Visit all leaves whose bounds overlap [tmin,tmax)
+    detail::stack<64> st;
+    st.push(0);
+
+    vec3 inv_dir = 1.0f / ray.dir;
+
+    while (!st.empty())
+    {
+        auto const& node = set.bvh.node(st.pop());
+
+        auto hr = intersect(ray, node.get_bounds(), inv_dir);
+
+        if (!hr.hit || hr.tfar < tmin || hr.tnear >= tmax)
+        {
+            continue;
+        }
+
+        if (is_inner(node))
+        {
+            st.push(node.get_child(0));
+            st.push(node.get_child(1));
+        }
+        else
+        {
+            for (unsigned i = node.get_indices().first; i != node.get_indices().last; ++i)
+            {
+                unsigned index = set.bvh.primitive(i).index;
+                detail::insert_volume_hit(hits, ray, set.boxes[index], static_cast<int>(index), tmin, tmax);
+            }
+        }
+    }
+
+    return hits;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// March through the intervals of a volume set
+//
+
+template <size_t MaxHits, typename Func>
+VSNRAY_FUNC
+inline bool march_volumes(
+        basic_ray<float> const& ray,
+        volume_set_ref const&   set,
+        float                   tmin,
+        float                   tmax,
+        float                   dt,
+        Func                    func
+        )
+{
+    auto hits = intersect<MaxHits>(ray, set, tmin, tmax);
+
+    if (hits.size == 0)
+    {
+        return false;
+    }
+
+    // Active volumes, ascending indices, and their exit distances
+    int active[MaxHits];
+    float active_tfar[MaxHits];
+    int num_active = 0;
+
+    int next = 0;
+
+    float t0 = hits.tnear[0];
+    float t_begin = t0;
+    float k = 0.0f;
+
+    while (next < hits.size || num_active > 0)
+    {
+        // Skip the gap to the next volume
+        if (num_active == 0)
+        {
+            t_begin = hits.tnear[next];
+        }
+
+        // Enter
+        while (next < hits.size && hits.tnear[next] <= t_begin)
+        {
+            int i = num_active++;
+
+            for (; i > 0 && active[i - 1] > hits.volume[next]; --i)
+            {
+                active[i] = active[i - 1];
+                active_tfar[i] = active_tfar[i - 1];
+            }
+
+            active[i] = hits.volume[next];
+            active_tfar[i] = hits.tfar[next];
+            ++next;
+        }
+
+        // The interval ends at the next entry or exit
+        float t_end = next < hits.size ? hits.tnear[next] : tmax;
+
+        for (int i = 0; i < num_active; ++i)
+        {
+            t_end = min(t_end, active_tfar[i]);
+        }
+
+        k = max(k, ceil((t_begin - t0) / dt));
+
+        if (t0 + k * dt < t_begin)
+        {
+            k += 1.0f;
+        }
+
+        for (float t = t0 + k * dt; t < t_end; t = t0 + k * dt)
+        {
+            if (!func(t, static_cast<int const*>(active), num_active))
+            {
+                return true;
+            }
+
+            k += 1.0f;
+        }
+
+        // Exit
+        int n = 0;
+
+        for (int i = 0; i < num_active; ++i)
+        {
+            if (active_tfar[i] > t_end)
+            {
+                active[n] = active[i];
+                active_tfar[n] = active_tfar[i];
+                ++n;
+            }
+        }
+
+        num_active = n;
+        t_begin = t_end;
+    }
+
+    return true;
+}
+
+} // visionaray
@@ -0,0 +1,195 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_ENVIRONMENT_LIGHT_H
+#define VSNRAY_ENVIRONMENT_LIGHT_H 1
+
+#include <cstddef>
+#include <type_traits>
+
+#include "detail/macros.h"
+#include "math/simd/type_traits.h"
+#include "math/aabb.h"
+#include "math/vector.h"
+#include "aligned_vector.h"
+#include "light_sample.h"
+
+namespace visionaray
+{
+
+class environment_map;
+
+//-------------------------------------------------------------------------------------------------
+// Environment light
+//
+// Radiance from an equirectangular image at infinity. The image is parameterized by
+// u = phi / 2pi and v = theta / pi, theta is measured from +y, row 0 is the zenith.
+// Directions are sampled proportional to luminance (times sin(theta)).
+//
+// Environment lights are created by environment_map::light() and reference its data. For
+// kernels that sample lights (pathtracing), sample() returns a point on a distant sphere
+// around the scene whose area is chosen so that the solid angle pdf of the sample is exact.
+// intensity() is zero, kernels that only evaluate lights at positions ignore the light.
+//
+
+template <typename T>
+class environment_light
+{
+public:
+
+    using scalar_type   = T;
+    using vec_type      = vector<3, T>;
+    using color_type    = vector<3, T>;
+
+public:
+
+    // Radiance arriving from direction dir (pointing away from the scene).
+    VSNRAY_FUNC color_type radiance(vec_type const& dir) const;
+
+    template <
+        typename U,
+        typename = typename std::enable_if<simd::is_simd_vector<U>::value>::type
+        >
+    vector<3, U> radiance(vector<3, U> const& dir) const;
+
+    // Solid angle density of the directions generated by sample().
+    VSNRAY_FUNC T pdf(vec_type const& dir) const;
+
+    template <
+        typename U,
+        typename = typename std::enable_if<simd::is_simd_vector<U>::value>::type
+        >
+    U pdf(vector<3, U> const& dir) const;
+
+    // Sample a direction, returns the radiance from that direction.
+    VSNRAY_FUNC color_type sample_direction(T u1, T u2, vec_type& dir, T& pdf) const;
+
+    // Zero, the light has no position.
+    template <typename U>
+    VSNRAY_FUNC vector<3, U> intensity(vector<3, U> const& pos) const;
+
+    // Point on a distant sphere around the scene.
+    template <typename Generator, typename U = typename Generator::value_type>
+    VSNRAY_FUNC light_sample<U> sample(Generator& gen) const;
+
+    // Center of the scene.
+    VSNRAY_FUNC vec_type position() const;
+
+    VSNRAY_FUNC T scene_radius() const;
+
+    // Solid angle weighted average radiance.
+    VSNRAY_FUNC color_type average_radiance() const;
+
+    VSNRAY_FUNC void set_scale(T scale);
+    VSNRAY_FUNC void set_scene_bounds(aabb const& bounds);
+
+private:
+
+    friend class environment_map;
+
+    // Equirectangular image, RGBA
+    vector<4, T> const* texels_;
+    int                 width_;
+    int                 height_;
+
+    // Piecewise-constant sampling density, conditional CDFs per row (width + 1 entries each)
+    // and the marginal CDF over rows (height + 1 entries)
+    T const*            func_;
+    T const*            conditional_cdf_;
+    T const*            marginal_cdf_;
+    T                   inv_func_integral_;
+
+    color_type          average_;
+    T                   scale_;
+
+    vec_type            center_;
+    T                   radius_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Environment map, builds the sampling distribution on the host
+//
+// Usage:
+//
+//  texture<vec4, 2> sky(width, height);
+//  sky.reset(hdr_data);
+//
+//  environment_map env;
+//  env.build(sky);
+//
+//  using light_type = generic_light<area_light<float, basic_triangle<3, float>>, environment_light<float>>;
+//  aligned_vector<light_type> lights = { ..., env.light(scene_bounds) };
+//
+//  auto kparams = make_kernel_params(..., lights.data(), lights.data() + lights.size(), ...);
+//  pathtracing::kernel<...> kernel;
+//  kernel.params = with_environment_light(kparams, env.light(scene_bounds), lights.size() - 1);
+//
+// The texture must outlive the environment map.
+//
+
+class environment_map
+{
+public:
+
+    template <typename Texture>
+    void build(Texture const& tex);
+
+    environment_light<float> light(aabb const& scene_bounds, float scale = 1.0f) const;
+
+private:
+
+    vec4 const*             texels_ = nullptr;
+    int                     width_  = 0;
+    int                     height_ = 0;
+
+    aligned_vector<float>   func_;
+    aligned_vector<float>   conditional_cdf_;
+    aligned_vector<float>   marginal_cdf_;
+    float                   inv_func_integral_ = 0.0f;
+
+    vec3                    average_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Kernel params with an environment light
+//
+// Rays that leave the scene return the radiance of the environment light instead of the
+// ambient color. If the light is also in the light list (index >= 0), the path tracer
+// combines light and BRDF samples with multiple importance sampling.
+//
+
+template <typename Params>
+struct environment_light_params : Params
+{
+    struct
+    {
+        environment_light<float> light;
+        int index;
+    } environment;
+};
+
+template <typename Params>
+inline environment_light_params<Params> with_environment_light(
+        Params const&                   params,
+        environment_light<float> const& light,
+        int                             index = -1
+        )
+{
+    environment_light_params<Params> result;
+    static_cast<Params&>(result) = params;
+    result.environment.light = light;
+    result.environment.index = index;
+    return result;
+}
+
+} // visionaray
+
+#include "detail/environment_light.inl"
+
+#endif // VSNRAY_ENVIRONMENT_LIGHT_H
@@ -19,6 +19,7 @@
 #include "get_shading_normal.h"
 #include "get_tex_coord.h"
 #include "prim_traits.h"
+#include "ray_differential.h"
 #include "surface.h"
 #include "tags.h"
 
@@ -378,16 +379,244 @@ inline auto get_normal_dispatch(
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Texture level of detail
+//
+// no_tex_lod samples the finest mip level. Ray differentials provide a level of detail for
+// 2D textures on triangles (also in BVHs, but not in instances).
+//
+
+struct no_tex_lod
+{
+    VSNRAY_FUNC no_tex_lod operator[](int) const { return {}; }
+};
+
+template <typename Params, typename Enable = void>
+struct has_2d_textures : std::false_type {};
+
+template <typename Params>
+struct has_2d_textures<Params, typename std::enable_if<has_textures<Params>::value>::type>
+    : std::integral_constant<bool, texture_dimensions<typename Params::texture_type>::value == 2>
+{
+};
+
+template <typename T>
+inline array<float, simd::num_elements<T>::value> unpack_tex_lod(T const& lod)
+{
+    simd::aligned_array_t<T> lods;
+    store(lods, lod);
+
+    array<float, simd::num_elements<T>::value> result;
+
+    for (int i = 0; i < simd::num_elements<T>::value; ++i)
+    {
+        result[i] = lods[i];
+    }
+
+    return result;
+}
+
+inline no_tex_lod unpack_tex_lod(no_tex_lod lod)
+{
+    return lod;
+}
+
+template <typename Params, typename HR, typename T, typename Triangle>
+VSNRAY_FUNC
+inline T triangle_tex_lod(
+        Params const&                       params,
+        HR const&                           hr,
+        basic_ray_differential<T> const&    ray,
+        Triangle const&                     tri
+        )
+{
+    auto const& tex = params.textures[hr.geom_id];
+
+    vector<2, T> duvdx;
+    vector<2, T> duvdy;
+
+    tex_coord_derivatives(
+            ray,
+            tri,
+            params.tex_coords[hr.prim_id * 3],
+            params.tex_coords[hr.prim_id * 3 + 1],
+            params.tex_coords[hr.prim_id * 3 + 2],
+            duvdx,
+            duvdy
+            );
+
+    return texture_lod(duvdx, duvdy, T(tex.width()), T(tex.height()));
+}
+
+// primitive list of triangles
+template <
+    typename Params,
+    typename HR,
+    typename T,
+    typename = typename std::enable_if<
+        std::is_same<typename Params::primitive_type, basic_triangle<3, T>>::value
+        >::type
+    >
+VSNRAY_FUNC
+inline T get_tex_lod_impl(
+        Params const&                       params,
+        HR const&                           hr,
+        basic_ray_differential<T> const&    ray,
+        int                                 /* prefer */
+        )
+{
+    return triangle_tex_lod(params, hr, ray, params.prims.begin[hr.prim_id]);
+}
+
+// BVHs of triangles
+template <
+    typename Params,
+    typename R,
+    typename Base,
+    typename T,
+    typename Primitive = typename Params::primitive_type,
+    typename = typename std::enable_if<
+        is_any_bvh<Primitive>::value && !is_any_bvh_inst<Primitive>::value
+        >::type,
+    typename = typename std::enable_if<
+        std::is_same<typename Primitive::primitive_type, basic_triangle<3, T>>::value
+        >::type
+    >
+VSNRAY_FUNC
+inline T get_tex_lod_impl(
+        Params const&                       params,
+        hit_record_bvh<R, Base> const&      hr,
+        basic_ray_differential<T> const&    ray,
+        int                                 /* prefer */
+        )
+{
+    // Find the BVH that contains prim_id
+    size_t num_primitives_total = 0;
+
+    size_t i = 0;
+    while (static_cast<size_t>(hr.prim_id) >= num_primitives_total + params.prims.begin[i].num_primitives())
+    {
+        num_primitives_total += params.prims.begin[i++].num_primitives();
+    }
+
+    return triangle_tex_lod(params, hr, ray, params.prims.begin[i].primitive(hr.primitive_list_index));
+}
+
+// Other primitives
+template <typename Params, typename HR, typename T>
+VSNRAY_FUNC
+inline no_tex_lod get_tex_lod_impl(
+        Params const&                       /* */,
+        HR const&                           /* */,
+        basic_ray_differential<T> const&    /* */,
+        long                                /* fallback */
+        )
+{
+    return {};
+}
+
+template <typename Params, typename HR, typename T>
+VSNRAY_FUNC
+inline no_tex_lod get_tex_lod_simd(
+        Params const&                       /* */,
+        HR const&                           /* */,
+        basic_ray_differential<T> const&    /* */,
+        no_tex_lod                          /* */
+        )
+{
+    return {};
+}
+
+template <typename Params, typename HR, typename T>
+VSNRAY_FUNC
+inline T get_tex_lod_simd(
+        Params const&                       params,
+        HR const&                           hr,
+        basic_ray_differential<T> const&    ray,
+        float                               /* */
+        )
+{
+    auto hrs = unpack(hr);
+    auto rays = unpack(ray);
+
+    simd::aligned_array_t<T> lods;
+
+    for (int i = 0; i < simd::num_elements<T>::value; ++i)
+    {
+        lods[i] = hrs[i].hit ? get_tex_lod_impl(params, hrs[i], rays[i], 0) : 0.0f;
+    }
+
+    return T(lods);
+}
+
+template <
+    typename Params,
+    typename HR,
+    typename T,
+    typename = typename std::enable_if<!simd::is_simd_vector<T>::value>::type
+    >
+VSNRAY_FUNC
+inline auto get_tex_lod(
+        Params const&                       params,
+        HR const&                           hr,
+        basic_ray_differential<T> const&    ray,
+        has_textures_tag                    /* */
+        )
+    -> decltype( get_tex_lod_impl(params, hr, ray, 0) )
+{
+    return get_tex_lod_impl(params, hr, ray, 0);
+}
+
+template <
+    typename Params,
+    typename HR,
+    typename T,
+    typename = typename std::enable_if<simd::is_simd_vector<T>::value>::type,
+    typename = void
+    >
+VSNRAY_FUNC
+inline auto get_tex_lod(
+        Params const&                       params,
+        HR const&                           hr,
+        basic_ray_differential<T> const&    ray,
+        has_textures_tag                    /* */
+        )
+    -> decltype( get_tex_lod_simd(
+            params,
+            hr,
+            ray,
+            get_tex_lod_impl(params, unpack(hr)[0], unpack(ray)[0], 0)
+            ) )
+{
+    using L = decltype( get_tex_lod_impl(params, unpack(hr)[0], unpack(ray)[0], 0) );
+
+    return get_tex_lod_simd(params, hr, ray, L{});
+}
+
+template <typename Params, typename HR, typename T>
+VSNRAY_FUNC
+inline no_tex_lod get_tex_lod(
+        Params const&                       /* */,
+        HR const&                           /* */,
+        basic_ray_differential<T> const&    /* */,
+        has_no_textures_tag                 /* */
+        )
+{
+    return {};
+}
+
+
 //-------------------------------------------------------------------------------------------------
 // Sample textures with range check
 //
 
-template <typename HR, typename Params>
+template <typename HR, typename Params, typename Lod>
 VSNRAY_FUNC
 inline typename Params::color_type get_tex_color(
         HR const&                      hr,
         Params const&                  params,
-        std::integral_constant<int, 1> /* */
+        std::integral_constant<int, 1> /* */,
+        Lod const&                     /* */
         )
 {
     using P = typename Params::primitive_type;
@@ -404,7 +633,8 @@ VSNRAY_FUNC
 inline typename Params::color_type get_tex_color(
         HR const&                      hr,
         Params const&                  params,
-        std::integral_constant<int, 2> /* */
+        std::integral_constant<int, 2> /* */,
+        no_tex_lod const&              /* */
         )
 {
     using P = typename Params::primitive_type;
@@ -421,7 +651,26 @@ VSNRAY_FUNC
 inline typename Params::color_type get_tex_color(
         HR const&                      hr,
         Params const&                  params,
-        std::integral_constant<int, 3> /* */
+        std::integral_constant<int, 2> /* */,
+        typename HR::scalar_type       lod
+        )
+{
+    using P = typename Params::primitive_type;
+    using C = typename Params::color_type;
+
+    auto coord = get_tex_coord(params.tex_coords, hr, P{});
+
+    auto const& tex = params.textures[hr.geom_id];
+    return C(tex2D(tex, coord, lod));
+}
+
+template <typename HR, typename Params, typename Lod>
+VSNRAY_FUNC
+inline typename Params::color_type get_tex_color(
+        HR const&                      hr,
+        Params const&                  params,
+        std::integral_constant<int, 3> /* */,
+        Lod const&                     /* */
         )
 {
     using P = typename Params::primitive_type;
@@ -438,14 +687,15 @@ inline typename Params::color_type get_tex_color(
 //
 //
 
-template <typename HR, typename Params>
+template <typename HR, typename Params, typename Lod>
 VSNRAY_FUNC
 inline auto get_surface_impl(
         has_no_normals_tag  /* */,
         has_no_colors_tag   /* */,
         has_no_textures_tag /* */,
         HR const&           hr,
-        Params const&       params
+        Params const&       params,
+        Lod const&          /* */
         )
     -> surface<typename Params::normal_type, typename Params::material_type>
 {
@@ -457,14 +707,15 @@ inline auto get_surface_impl(
         };
 }
 
-template <typename HR, typename Params>
+template <typename HR, typename Params, typename Lod>
 VSNRAY_FUNC
 inline auto get_surface_impl(
         has_normals_tag     /* */,
         has_no_colors_tag   /* */,
         has_no_textures_tag /* */,
         HR const&           hr,
-        Params const&       params
+        Params const&       params,
+        Lod const&          /* */
         )
     -> surface<typename Params::normal_type, typename Params::material_type>
 {
@@ -476,14 +727,15 @@ inline auto get_surface_impl(
         };
 }
 
-template <typename HR, typename Params>
+template <typename HR, typename Params, typename Lod>
 VSNRAY_FUNC
 inline auto get_surface_impl(
         has_normals_tag     /* */,
         has_no_colors_tag   /* */,
         has_textures_tag    /* */,
         HR const&           hr,
-        Params const&       params
+        Params const&       params,
+        Lod const&          lod
         )
     -> surface<
             typename Params::normal_type,
@@ -495,7 +747,8 @@ inline auto get_surface_impl(
     auto tc = get_tex_color(
                     hr,
                     params,
-                    std::integral_constant<int, texture_dimensions<typename Params::texture_type>::value>{}
+                    std::integral_constant<int, texture_dimensions<typename Params::texture_type>::value>{},
+                    lod
                     );
 
     return {
@@ -506,14 +759,15 @@ inline auto get_surface_impl(
         };
 }
 
-template <typename HR, typename Params>
+template <typename HR, typename Params, typename Lod>
 VSNRAY_FUNC
 inline auto get_surface_impl(
         has_no_normals_tag  /* */,
         has_colors_tag      /* */,
         has_textures_tag    /* */,
         HR const&           hr,
-        Params const&       params
+        Params const&       params,
+        Lod const&          lod
         )
     -> surface<
             typename Params::normal_type,
@@ -528,7 +782,8 @@ inline auto get_surface_impl(
     auto tc    = get_tex_color(
                         hr,
                         params,
-                        std::integral_constant<int, texture_dimensions<typename Params::texture_type>::value>{}
+                        std::integral_constant<int, texture_dimensions<typename Params::texture_type>::value>{},
+                        lod
                         );
 
     return {
@@ -539,14 +794,15 @@ inline auto get_surface_impl(
         };
 }
 
-template <typename HR, typename Params>
+template <typename HR, typename Params, typename Lod>
 VSNRAY_FUNC
 inline auto get_surface_impl(
         has_normals_tag     /* */,
         has_colors_tag      /* */,
         has_textures_tag    /* */,
         HR const&           hr,
-        Params const&       params
+        Params const&       params,
+        Lod const&          lod
         )
     -> surface<
             typename Params::normal_type,
@@ -561,7 +817,8 @@ inline auto get_surface_impl(
     auto tc    = get_tex_color(
                         hr,
                         params,
-                        std::integral_constant<int, texture_dimensions<typename Params::texture_type>::value>{}
+                        std::integral_constant<int, texture_dimensions<typename Params::texture_type>::value>{},
+                        lod
                         );
 
     return {
@@ -583,6 +840,7 @@ template <
     typename TexturesTag,
     typename HR,
     typename Params,
+    typename Lod,
     typename = typename std::enable_if<simd::is_simd_vector<typename HR::scalar_type>::value>::type
     >
 VSNRAY_FUNC
@@ -591,13 +849,15 @@ inline auto get_surface_impl(
         ColorsTag     /* */,
         TexturesTag   /* */,
         HR const&     hr,
-        Params const& params
+        Params const& params,
+        Lod const&    lod
         )
     -> typename simd_decl_surface<Params, typename HR::scalar_type>::type
 {
     using T = typename HR::scalar_type;
 
     auto hrs = unpack(hr);
+    auto lods = unpack_tex_lod(lod);
 
     typename simd_decl_surface<Params, T>::array_type surfs = {};
 
@@ -610,7 +870,8 @@ inline auto get_surface_impl(
                     ColorsTag{},
                     TexturesTag{},
                     hrs[i],
-                    params
+                    params,
+                    lods[i]
                     );
         }
     }
@@ -629,7 +890,8 @@ inline auto get_surface(HR const& hr, Params const& p)
             detail::has_colors<Params>{},
             detail::has_textures<Params>{},
             hr,
-            p
+            p,
+            detail::no_tex_lod{}
             ) )
 {
     return detail::get_surface_impl(
@@ -637,7 +899,33 @@ inline auto get_surface(HR const& hr, Params const& p)
             detail::has_colors<Params>{},
             detail::has_textures<Params>{},
             hr,
-            p
+            p,
+            detail::no_tex_lod{}
+            );
+}
+
+// Rays without differentials sample the finest mip level
+template <typename HR, typename Params, typename R>
+VSNRAY_FUNC
+inline auto get_surface(HR const& hr, Params const& p, R const& /* */)
+    -> decltype( get_surface(hr, p) )
+{
+    return get_surface(hr, p);
+}
+
+// Ray differentials select the mip level of 2D textures
+template <typename HR, typename Params, typename T>
+VSNRAY_FUNC
+inline auto get_surface(HR const& hr, Params const& p, basic_ray_differential<T> const& ray)
+    -> decltype( get_surface(hr, p) )
+{
+    return detail::get_surface_impl(
+            detail::has_normals<Params>{},
+            detail::has_colors<Params>{},
+            detail::has_textures<Params>{},
+            hr,
+            p,
+            detail::get_tex_lod(p, hr, ray, detail::has_2d_textures<Params>{})
             );
 }
 
@@ -0,0 +1,214 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_GRADIENT_VOLUME_H
+#define VSNRAY_GRADIENT_VOLUME_H 1
+
+#include <cstddef>
+#include <type_traits>
+
+#include "detail/macros.h"
+#include "detail/thread_pool.h"
+#include "math/simd/type_traits.h"
+#include "math/snorm.h"
+#include "math/unorm.h"
+#include "math/vector.h"
+#include "texture/forward.h"
+#include "aligned_vector.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Octahedral unit vector encoding
+// See: Cigolle et al., A Survey of Efficient Representations for Independent Unit Vectors (2014)
+//
+// Maps unit vectors to [-1,1]^2 by projecting them onto the octahedron |x|+|y|+|z|=1 and
+// folding the lower hemisphere over the diagonals.
+//
+
+template <typename T>
+VSNRAY_FUNC
+inline vector<2, T> oct_encode(vector<3, T> const& n)
+{
+    vector<3, T> p = n / (abs(n.x) + abs(n.y) + abs(n.z));
+
+    vector<2, T> folded(
+            (T(1.0) - abs(p.y)) * select(p.x >= T(0.0), T(1.0), T(-1.0)),
+            (T(1.0) - abs(p.x)) * select(p.y >= T(0.0), T(1.0), T(-1.0))
+            );
+
+    return vector<2, T>(
+            select(p.z < T(0.0), folded.x, p.x),
+            select(p.z < T(0.0), folded.y, p.y)
+            );
+}
+
+template <typename T>
+VSNRAY_FUNC
+inline vector<3, T> oct_decode(vector<2, T> const& e)
+{
+    vector<3, T> n(e.x, e.y, T(1.0) - abs(e.x) - abs(e.y));
+
+    T t = max(-n.z, T(0.0));
+    n.x += select(n.x >= T(0.0), -t, t);
+    n.y += select(n.y >= T(0.0), -t, t);
+
+    return normalize(n);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Quantized gradient, 6 bytes per voxel
+//
+
+struct packed_gradient
+{
+    // Octahedral encoded direction
+    snorm<16> normal[2];
+
+    // Length relative to the maximum gradient length of the volume
+    unorm<16> magnitude;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Gradient volume reference, pass to kernels
+//
+// Gradients are derivatives with respect to normalized texture coordinates. Sampling
+// supports nearest and linear filtering (of the decoded gradients) with clamp address mode.
+//
+
+class gradient_volume_ref
+{
+public:
+
+    // Decoded gradient of voxel (x,y,z)
+    VSNRAY_FUNC vec3 value(int x, int y, int z) const;
+
+    // Sample with normalized texture coordinates
+    VSNRAY_FUNC vec3 sample(vec3 const& coord) const;
+
+public:
+
+    packed_gradient const*  data;
+    vec3i                   dims;
+    float                   max_magnitude;
+    tex_filter_mode         filter_mode;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Gradient volume, build on the host after the volume changes
+//
+// Precomputes central differences at the voxels of a volume and stores them quantized, so
+// that shading a sample costs one gradient lookup instead of six additional volume fetches.
+// Central differences at the sample position (central_difference_gradient()) don't require
+// extra memory and remain available as a fallback. With linear filtering, both yield the
+// same gradients up to quantization, except for half a voxel at the volume's borders.
+//
+// Usage:
+//
+//  gradient_volume gradients;
+//  gradients.build(volume, pool);
+//
+//  // In the kernel
+//  auto grad = gradient(gradients.ref(), tex_coord);
+//
+
+class gradient_volume
+{
+public:
+
+    using ref_type = gradient_volume_ref;
+
+public:
+
+    // Texture (or anything with width(), height(), depth() and operator()(x,y,z)) with scalar voxels
+    template <typename Texture>
+    void build(Texture const& volume);
+
+    // Parallelize over slices
+    template <typename Texture>
+    void build(Texture const& volume, thread_pool& pool);
+
+    ref_type ref() const;
+
+    size_t width() const;
+    size_t height() const;
+    size_t depth() const;
+
+    // Nearest or Linear
+    void set_filter_mode(tex_filter_mode mode);
+    tex_filter_mode get_filter_mode() const;
+
+    // Decoded gradient of voxel (x,y,z)
+    vec3 operator()(size_t x, size_t y, size_t z) const;
+
+private:
+
+    template <typename Texture>
+    void build_impl(Texture const& volume, thread_pool* pool);
+
+    aligned_vector<packed_gradient> data_;
+    vec3i dims_ = vec3i(0);
+    float max_magnitude_ = 0.0f;
+    tex_filter_mode filter_mode_ = Linear;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Sample precomputed gradients
+//
+
+VSNRAY_FUNC
+inline vec3 gradient(gradient_volume_ref const& grad, vec3 const& coord)
+{
+    return grad.sample(coord);
+}
+
+template <
+    typename F,
+    typename = typename std::enable_if<simd::is_simd_vector<F>::value>::type
+    >
+inline vector<3, F> gradient(gradient_volume_ref const& grad, vector<3, F> const& coord);
+
+
+//-------------------------------------------------------------------------------------------------
+// Central differences of a volume texture at the sample position, six fetches
+//
+
+template <typename Tex, typename T>
+VSNRAY_FUNC
+inline vector<3, T> central_difference_gradient(Tex const& tex, vector<3, T> const& coord)
+{
+    vector<3, T> h(
+            T(1.0f / tex.width()),
+            T(1.0f / tex.height()),
+            T(1.0f / tex.depth())
+            );
+
+    vector<3, T> s1(
+            T(tex3D(tex, coord - vector<3, T>(h.x, T(0.0), T(0.0)))),
+            T(tex3D(tex, coord - vector<3, T>(T(0.0), h.y, T(0.0)))),
+            T(tex3D(tex, coord - vector<3, T>(T(0.0), T(0.0), h.z)))
+            );
+
+    vector<3, T> s2(
+            T(tex3D(tex, coord + vector<3, T>(h.x, T(0.0), T(0.0)))),
+            T(tex3D(tex, coord + vector<3, T>(T(0.0), h.y, T(0.0)))),
+            T(tex3D(tex, coord + vector<3, T>(T(0.0), T(0.0), h.z)))
+            );
+
+    return (s2 - s1) / (T(2.0) * h);
+}
+
+} // visionaray
+
+#include "detail/gradient_volume.inl"
+
+#endif // VSNRAY_GRADIENT_VOLUME_H
@@ -0,0 +1,145 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_HERO_SPECTRUM_H
+#define VSNRAY_HERO_SPECTRUM_H 1
+
+#include <cstddef>
+#include <type_traits>
+
+#include "detail/macros.h"
+#include "math/simd/type_traits.h"
+#include "math/vector.h"
+#include "spectrum.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Hero wavelength sampling
+// See: Wilkie et al., Hero wavelength spectral sampling (2014)
+//
+// A path carries N wavelengths: a randomly chosen hero wavelength and N - 1 wavelengths
+// that are equally spaced from it (wrapping around in [lambda_min, lambda_max)). With
+// SIMD types, every wavelength is one SIMD vector over the lanes of a ray packet.
+//
+
+template <typename T, size_t N = 4>
+struct hero_wavelengths
+{
+    static constexpr float lambda_min = 360.0f;
+    static constexpr float lambda_max = 830.0f;
+
+    // Wavelengths (nm)
+    vector<N, T> lambda;
+
+    // Density of each of the wavelengths
+    VSNRAY_FUNC static T pdf() { return T(1.0f / (lambda_max - lambda_min)); }
+};
+
+template <size_t N, typename T>
+VSNRAY_FUNC
+inline hero_wavelengths<T, N> sample_hero_wavelengths(T const& u);
+
+
+//-------------------------------------------------------------------------------------------------
+// Spectral samples at the wavelengths of a path
+//
+// Has the same interface as spectrum<T> so that kernels can use it as throughput and
+// radiance type. Convert to and from colors with the path's hero_wavelengths.
+//
+
+template <typename T, size_t N = 4>
+class hero_spectrum
+{
+public:
+
+    enum { num_samples = N };
+
+public:
+
+    hero_spectrum() = default;
+
+    VSNRAY_FUNC explicit hero_spectrum(T const& c);
+    VSNRAY_FUNC explicit hero_spectrum(vector<N, T> const& samples);
+
+    VSNRAY_FUNC T& operator[](size_t i);
+    VSNRAY_FUNC T const& operator[](size_t i) const;
+
+    VSNRAY_FUNC vector<N, T>&       samples()       { return samples_; }
+    VSNRAY_FUNC vector<N, T> const& samples() const { return samples_; }
+
+private:
+
+    vector<N, T> samples_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Conversions
+//
+
+// Evaluate a spectral power distribution (e.g. blackbody, spd_d65) at the wavelengths
+template <typename SPD, typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> from_spd(SPD const& spd, hero_wavelengths<T, N> const& wl);
+
+// Smooth spectrum with the given RGB reflectance
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> from_rgb(vector<3, T> const& rgb, hero_wavelengths<T, N> const& wl);
+
+// RGB spectra are upsampled with from_rgb(), sampled spectra are interpolated
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline hero_spectrum<T, N> from_spectrum(spectrum<T> const& s, hero_wavelengths<T, N> const& wl);
+
+// Monte Carlo estimate of CIE XYZ, normalized so that Y of a constant 1 spectrum is 1
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline vector<3, T> to_xyz(hero_spectrum<T, N> const& s, hero_wavelengths<T, N> const& wl);
+
+// Linear sRGB, white balanced so that a constant 1 spectrum maps to (1,1,1) on average
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline vector<3, T> to_rgb(hero_spectrum<T, N> const& s, hero_wavelengths<T, N> const& wl);
+
+template <typename T, size_t N>
+VSNRAY_FUNC
+inline vector<4, T> to_rgba(hero_spectrum<T, N> const& s, hero_wavelengths<T, N> const& wl);
+
+
+//-------------------------------------------------------------------------------------------------
+// Kernel params for hero wavelength rendering
+//
+// Usage:
+//
+//  pathtracing::kernel<...> kernel;
+//  kernel.params = with_hero_wavelengths<4>(kparams);
+//
+// The path tracer then samples N wavelengths per path, converts the RGB values of materials
+// and lights to spectra at these wavelengths and accumulates the result to RGB via CIE XYZ.
+//
+
+template <typename Params, size_t N>
+struct hero_wavelength_params : Params
+{
+    std::integral_constant<size_t, N> hero_wavelengths;
+};
+
+template <size_t N, typename Params>
+inline hero_wavelength_params<Params, N> with_hero_wavelengths(Params const& params)
+{
+    hero_wavelength_params<Params, N> result;
+    static_cast<Params&>(result) = params;
+    return result;
+}
+
+} // visionaray
+
+#include "detail/hero_spectrum.inl"
+
+#endif // VSNRAY_HERO_SPECTRUM_H
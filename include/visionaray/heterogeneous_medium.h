@@ -0,0 +1,219 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_HETEROGENEOUS_MEDIUM_H
+#define VSNRAY_HETEROGENEOUS_MEDIUM_H 1
+
+#include <type_traits>
+
+#include "detail/macros.h"
+#include "math/simd/type_traits.h"
+#include "math/aabb.h"
+#include "math/ray.h"
+#include "math/vector.h"
+#include "texture/texture.h"
+#include "aligned_vector.h"
+#include "phase_function.h"
+#include "spectrum.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Majorant grid reference, pass to kernels
+//
+// Stores the maximum density of coarse cells of a density texture. Cell (i,j,k) covers the
+// texture coordinates [i,i+1) * cell_size / width etc.
+//
+
+class majorant_grid_ref
+{
+public:
+
+    VSNRAY_FUNC float majorant(int x, int y, int z) const
+    {
+        return data[(z * dims.y + y) * dims.x + x];
+    }
+
+public:
+
+    // Number of cells
+    vec3i           dims;
+
+    // Cells per unit texture coordinate
+    vec3            cells_per_texcoord;
+
+    // Maximum of all cells
+    float           max_majorant;
+
+    float const*    data;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Majorant grid, build on the host after the density texture changes
+//
+// The majorant of a cell is the maximum of the voxels that trilinear interpolation inside
+// the cell reads from, so it bounds the filtered density. The texture must use clamp
+// address mode.
+//
+
+class majorant_grid
+{
+public:
+
+    template <typename Texture>
+    void build(Texture const& density, int cell_size = 8);
+
+    majorant_grid_ref ref() const;
+
+private:
+
+    majorant_grid_ref ref_;
+
+    aligned_vector<float> data_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Heterogeneous participating medium
+//
+// The extinction coefficient is density_scale times a density texture mapped onto an
+// axis-aligned box, the single scattering albedo is constant. Free-flight distances are
+// sampled with delta tracking, transmittance is estimated with ratio tracking. Both walk
+// the majorant grid and skip empty cells, so that the step size adapts to the density.
+//
+// Usage:
+//
+//  texture<float, 3> density(w, h, d);
+//  density.reset(data);
+//  density.set_filter_mode(Linear);
+//  density.set_address_mode(Clamp);
+//
+//  majorant_grid grid;
+//  grid.build(density);
+//
+//  heterogeneous_medium<float> medium;
+//  medium.set_density(texture_ref<float, 3>(density), grid.ref());
+//  medium.set_bounds(bbox);
+//  medium.density_scale() = 10.0f;
+//
+//  // In the kernel
+//  S t;
+//  auto scattered = medium.sample_free_flight(ray, tnear, tfar, t, gen);
+//  auto tr = medium.transmittance(shadow_ray, S(0.0), light_dist, gen);
+//
+
+template <typename T>
+class heterogeneous_medium
+{
+public:
+
+    using scalar_type = T;
+
+public:
+
+    // Phase function, see anisotropic_medium
+
+    template <typename U>
+    VSNRAY_FUNC spectrum<U> tr(vector<3, U> const& wo, vector<3, U> const& wi) const;
+
+    template <typename U, typename Generator>
+    VSNRAY_FUNC spectrum<U> sample(vector<3, U> const& wo, vector<3, U>& wi, U& pdf, Generator& gen) const;
+
+    // Extinction coefficient at a world space position
+    VSNRAY_FUNC T extinction(vector<3, T> const& pos) const;
+
+    // Delta tracking, true if the ray collides with the medium in [tmin, tmax), t is the
+    // distance of the collision. Scattering events are weighted with albedo().
+    template <typename Generator>
+    VSNRAY_FUNC bool sample_free_flight(
+            basic_ray<T> const& ray,
+            T                   tmin,
+            T                   tmax,
+            T&                  t,
+            Generator&          gen
+            ) const;
+
+    template <
+        typename U,
+        typename Generator,
+        typename = typename std::enable_if<simd::is_simd_vector<U>::value>::type
+        >
+    simd::mask_type_t<U> sample_free_flight(
+            basic_ray<U> const& ray,
+            U const&            tmin,
+            U const&            tmax,
+            U&                  t,
+            Generator&          gen
+            ) const;
+
+    // Ratio tracking, unbiased estimate of the transmittance in [tmin, tmax)
+    template <typename Generator>
+    VSNRAY_FUNC T transmittance(
+            basic_ray<T> const& ray,
+            T                   tmin,
+            T                   tmax,
+            Generator&          gen
+            ) const;
+
+    template <
+        typename U,
+        typename Generator,
+        typename = typename std::enable_if<simd::is_simd_vector<U>::value>::type
+        >
+    U transmittance(
+            basic_ray<U> const& ray,
+            U const&            tmin,
+            U const&            tmax,
+            Generator&          gen
+            ) const;
+
+    void set_density(texture_ref<float, 3> const& density, majorant_grid_ref const& majorants);
+    void set_bounds(aabb const& bounds);
+
+    // Extinction coefficient for density 1
+    T& density_scale() { return density_scale_; }
+    VSNRAY_FUNC T const& density_scale() const { return density_scale_; }
+
+    // Ratio of scattering to extinction
+    T& albedo() { return albedo_; }
+    VSNRAY_FUNC T const& albedo() const { return albedo_; }
+
+    // Anisotropy in [-1.0..1.0], where -1.0 scatters all light backwards
+    T& anisotropy() { return phase_.g; }
+    VSNRAY_FUNC T const& anisotropy() const { return phase_.g; }
+
+private:
+
+    template <bool Ratio, typename Generator>
+    VSNRAY_FUNC bool track(
+            basic_ray<T> const& ray,
+            T                   tmin,
+            T                   tmax,
+            T&                  t,
+            T&                  tr,
+            Generator&          gen
+            ) const;
+
+    texture_ref<float, 3>   density_;
+    majorant_grid_ref       majorants_;
+
+    aabb                    bounds_;
+
+    T                       density_scale_ = T(1.0);
+    T                       albedo_ = T(1.0);
+
+    henyey_greenstein<T>    phase_;
+
+};
+
+} // visionaray
+
+#include "detail/heterogeneous_medium.inl"
+
+#endif // VSNRAY_HETEROGENEOUS_MEDIUM_H
@@ -0,0 +1,184 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_ISOSURFACE_H
+#define VSNRAY_ISOSURFACE_H 1
+
+#include <cstddef>
+#include <type_traits>
+
+#include "detail/macros.h"
+#include "detail/thread_pool.h"
+#include "math/simd/type_traits.h"
+#include "math/aabb.h"
+#include "math/intersect.h"
+#include "math/primitive.h"
+#include "math/ray.h"
+#include "math/vector.h"
+#include "texture/texture.h"
+#include "aligned_vector.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Min/max octree reference, pass to kernels
+//
+// Level 0 stores the value ranges of the trilinear cells between voxel centers, a volume with
+// w x h x d voxels has (w-1) x (h-1) x (d-1) cells. Node (x,y,z) of level l covers the cells
+// [x,y,z] * 2^l to ([x,y,z] + 1) * 2^l, the top level has a single node.
+//
+
+class minmax_octree_ref
+{
+public:
+
+    enum { max_levels = 16 };
+
+public:
+
+    // Min (x) and max (y) value of node (x,y,z) of level
+    VSNRAY_FUNC vec2 const& range(int level, vec3i const& node) const;
+
+public:
+
+    vec2 const* ranges;
+
+    // Nodes per level and offsets into ranges
+    vec3i       dims[max_levels];
+    size_t      offsets[max_levels];
+    int         num_levels;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Min/max octree, build on the host after the volume changes
+//
+
+class minmax_octree
+{
+public:
+
+    using ref_type = minmax_octree_ref;
+
+public:
+
+    // Texture (or anything with width(), height(), depth() and operator()(x,y,z)) with scalar voxels
+    template <typename Texture>
+    void build(Texture const& volume);
+
+    // Parallelize over slices
+    template <typename Texture>
+    void build(Texture const& volume, thread_pool& pool);
+
+    ref_type ref() const;
+
+    // 0 if the volume has less than two voxels along any axis
+    int num_levels() const;
+
+    // Min (x) and max (y) value of node (x,y,z) of level
+    vec2 range(int level, int x, int y, int z) const;
+
+private:
+
+    template <typename Texture>
+    void build_impl(Texture const& volume, thread_pool* pool);
+
+    aligned_vector<vec2> ranges_;
+    vec3i dims_[minmax_octree_ref::max_levels];
+    size_t offsets_[minmax_octree_ref::max_levels];
+    int num_levels_ = 0;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Isosurface of a volume, primitive for closest_hit(), BVHs, and get_surface()
+//
+// The volume is placed in the world space box bounds, texture coordinates [0,1]^3 map to
+// bounds. The isosurface is the surface where the trilinear interpolant of the voxels equals
+// isovalue. It is defined between the outermost voxel centers, where the interpolant does not
+// depend on the texture's address mode.
+//
+// Rays descend the min/max octree front to back and skip all nodes whose value range does not
+// contain the isovalue. Inside candidate cells, the interpolant along the ray is a cubic
+// polynomial. Its extrema split the ray segment into monotonic intervals, the first interval
+// with a sign change is refined with repeated linear interpolation.
+// See: Marmitt et al., Fast and Accurate Ray-Voxel Intersection Techniques for Iso-Surface
+// Ray Tracing (2004)
+//
+// Normals are the normalized negative gradients of the interpolant, they point towards lower
+// values.
+//
+// Usage:
+//
+//  minmax_octree octree;
+//  octree.build(volume, pool);
+//
+//  isosurface iso(texture_ref<float, 3>(volume), octree.ref(), bbox, 0.5f);
+//  iso.prim_id = 0;
+//  iso.geom_id = 0;
+//
+//  // In the kernel
+//  auto hr = intersect(ray, iso);
+//
+
+class isosurface : public primitive<unsigned>
+{
+public:
+
+    isosurface() = default;
+
+    isosurface(
+            texture_ref<float, 3> const&    volume,
+            minmax_octree_ref const&        octree,
+            aabb const&                     bounds,
+            float                           isovalue
+            );
+
+    texture_ref<float, 3>   volume;
+    minmax_octree_ref       octree;
+    aabb                    bounds;
+    float                   isovalue;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Ray / isosurface
+//
+
+inline hit_record<basic_ray<float>, primitive<unsigned>> intersect(
+        basic_ray<float> const& ray,
+        isosurface const&       iso
+        );
+
+template <
+    typename F,
+    typename = typename std::enable_if<simd::is_simd_vector<F>::value>::type
+    >
+inline hit_record<basic_ray<F>, primitive<unsigned>> intersect(
+        basic_ray<F> const&     ray,
+        isosurface const&       iso
+        );
+
+
+//-------------------------------------------------------------------------------------------------
+// Geometric functions
+//
+
+inline aabb get_bounds(isosurface const& iso);
+
+inline void split_primitive(aabb& L, aabb& R, float plane, int axis, isosurface const& iso);
+
+template <typename HR>
+inline vec3 get_normal(HR const& hr, isosurface const& iso);
+
+} // visionaray
+
+#include "detail/isosurface.inl"
+
+#endif // VSNRAY_ISOSURFACE_H
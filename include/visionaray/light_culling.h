@@ -0,0 +1,284 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_LIGHT_CULLING_H
+#define VSNRAY_LIGHT_CULLING_H 1
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "detail/macros.h"
+#include "math/simd/type_traits.h"
+#include "math/matrix.h"
+#include "math/rectangle.h"
+#include "math/vector.h"
+#include "aligned_vector.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Light cluster grid reference, pass to kernels
+//
+// The view frustum is divided into screen-space tiles and exponentially spaced depth slices.
+// Each cluster stores the indices of the lights whose influence sphere overlaps it. Positions
+// outside the view frustum (e.g. secondary hits) map to an extra cluster with all lights.
+//
+
+class light_clusters_ref
+{
+public:
+
+    // Cluster that contains the world space position pos
+    VSNRAY_FUNC int cluster_index(vec3 const& pos) const;
+
+    // Index of the cluster with all lights
+    VSNRAY_FUNC int overflow_cluster() const;
+
+    // Tile and depth slice of normalized device / view space coordinates
+    VSNRAY_FUNC int tile_x(float ndc_x) const;
+    VSNRAY_FUNC int tile_y(float ndc_y) const;
+    VSNRAY_FUNC int slice(float depth) const;
+
+public:
+
+    mat4    view;
+    mat4    view_proj;
+
+    int     num_tiles_x;
+    int     num_tiles_y;
+    int     num_slices;
+
+    float   tiles_per_ndc_x;
+    float   tiles_per_ndc_y;
+    float   z_near;
+    float   slices_per_log_depth;
+
+    // Lights of cluster i are indices[offsets[i]..offsets[i + 1])
+    int const* offsets;
+    int const* indices;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Light cluster grid, rebuild on the host before each frame that changes camera or lights
+//
+// Usage:
+//
+//  light_clusters clusters(16 /* tile size */, 16 /* depth slices */);
+//  clusters.build(cam, lights.data(), lights.data() + lights.size());
+//  auto kparams = make_kernel_params(..., lights.data(), lights.data() + lights.size(), ...);
+//  whitted::kernel<...> kernel;
+//  kernel.params = with_light_clusters(kparams, clusters.ref());
+//  sched.frame(kernel, sparams);
+//
+// Point and spot lights are culled by their influence radius, all other lights are added to
+// every cluster.
+//
+
+class light_clusters
+{
+public:
+
+    explicit light_clusters(int tile_size = 16, int num_slices = 16);
+
+    template <typename Camera, typename Lights>
+    void build(Camera const& cam, Lights begin, Lights end);
+
+    template <typename Lights>
+    void build(
+            mat4 const&     view,
+            mat4 const&     proj,
+            recti const&    viewport,
+            float           z_near,
+            float           z_far,
+            Lights          begin,
+            Lights          end
+            );
+
+    light_clusters_ref ref() const;
+
+    // Including the cluster with all lights
+    size_t num_clusters() const;
+
+    // Total number of light indices in all clusters
+    size_t num_indices() const;
+
+private:
+
+    int tile_size_;
+    int num_slices_;
+
+    light_clusters_ref ref_;
+
+    aligned_vector<int> offsets_;
+    aligned_vector<int> indices_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Kernel params with light clusters
+//
+
+template <typename Params>
+struct light_cluster_params : Params
+{
+    light_clusters_ref light_clusters;
+};
+
+template <typename Params>
+inline light_cluster_params<Params> with_light_clusters(Params const& params, light_clusters_ref const& lc)
+{
+    light_cluster_params<Params> result;
+    static_cast<Params&>(result) = params;
+    result.light_clusters = lc;
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Iterators over the lights that may affect a position, active() returns the mask of SIMD
+// lanes that see the light
+//
+
+// All lights
+template <typename Lights, typename T>
+class light_iterator
+{
+public:
+
+    using mask_type = simd::mask_type_t<T>;
+
+    VSNRAY_FUNC light_iterator(Lights it);
+
+    VSNRAY_FUNC auto operator*() const -> decltype(*Lights());
+    VSNRAY_FUNC Lights operator->() const;
+    VSNRAY_FUNC light_iterator& operator++();
+    VSNRAY_FUNC bool operator!=(light_iterator const& rhs) const;
+
+    VSNRAY_FUNC mask_type active() const;
+
+private:
+
+    Lights it_;
+
+};
+
+// Lights of the clusters that contain the SIMD lanes
+template <typename Lights, typename T>
+class cluster_light_iterator
+{
+public:
+
+    using int_type  = simd::int_type_t<T>;
+    using mask_type = simd::mask_type_t<T>;
+
+    enum { Size = simd::num_elements<T>::value };
+
+    // End iterator
+    VSNRAY_FUNC cluster_light_iterator();
+
+    VSNRAY_FUNC cluster_light_iterator(
+            Lights                      lights,
+            light_clusters_ref const&   clusters,
+            vector<3, T> const&         pos
+            );
+
+    VSNRAY_FUNC auto operator*() const -> decltype(*Lights());
+    VSNRAY_FUNC Lights operator->() const;
+    VSNRAY_FUNC cluster_light_iterator& operator++();
+    VSNRAY_FUNC bool operator!=(cluster_light_iterator const& rhs) const;
+
+    VSNRAY_FUNC mask_type active() const;
+
+private:
+
+    // Advance to the next lane with a cluster that was not visited yet
+    VSNRAY_FUNC void next_lane();
+
+    Lights      lights_;
+    int const*  offsets_;
+    int const*  indices_;
+
+    int         clusters_[Size];
+    int         lane_;
+    int         index_;
+    int         end_;
+
+};
+
+template <typename Iterator>
+struct light_range
+{
+    Iterator first;
+    Iterator last;
+
+    VSNRAY_FUNC Iterator begin() const { return first; }
+    VSNRAY_FUNC Iterator end() const { return last; }
+};
+
+
+namespace detail
+{
+
+template <typename Params>
+struct has_light_clusters
+{
+    template <typename U>
+    static std::true_type test(decltype(&U::light_clusters));
+
+    template <typename U>
+    static std::false_type test(...);
+
+    using type = decltype( test<Params>(nullptr) );
+    static const bool value = type::value;
+};
+
+template <typename Params, typename T, bool = has_light_clusters<Params>::value>
+struct culled_lights_result
+{
+    using lights_type = decltype(std::declval<Params>().lights.begin);
+    using type = light_range<light_iterator<lights_type, T>>;
+};
+
+template <typename Params, typename T>
+struct culled_lights_result<Params, T, true>
+{
+    using lights_type = decltype(std::declval<Params>().lights.begin);
+    using type = light_range<cluster_light_iterator<lights_type, T>>;
+};
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// Lights that may affect pos, all lights if params have no light clusters
+//
+// Usage:
+//
+//  auto lights = culled_lights(params, pos);
+//
+//  for (auto it = lights.begin(); it != lights.end(); ++it)
+//  {
+//      auto clr = surf.shade(view_dir, normalize(V(it->position()) - pos), it->intensity(pos));
+//      shaded_clr += select(it.active(), clr, C(0.0));
+//  }
+//
+
+template <typename Params, typename T>
+VSNRAY_FUNC
+inline typename detail::culled_lights_result<Params, T>::type culled_lights(
+        Params const&       params,
+        vector<3, T> const& pos
+        );
+
+} // visionaray
+
+#include "detail/light_culling.inl"
+
+#endif // VSNRAY_LIGHT_CULLING_H
@@ -0,0 +1,202 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_LIGHT_SAMPLER_H
+#define VSNRAY_LIGHT_SAMPLER_H 1
+
+#include <cstddef>
+#include <type_traits>
+
+#include "detail/macros.h"
+#include "math/simd/type_traits.h"
+#include "math/aabb.h"
+#include "math/vector.h"
+#include "aligned_vector.h"
+#include "light_sample.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Light BVH node, children are stored next to each other
+//
+
+struct light_bvh_node
+{
+    aabb  bbox;
+    float power;
+    int   first_child;  // inner nodes, -1 for leaves
+    int   light;        // leaves, -1 for inner nodes
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Light sampler reference, pass to kernels
+//
+// Picks lights proportional to their power. If a light BVH was built, the choice also
+// accounts for the distance between the shading position and the lights.
+//
+
+class light_sampler_ref
+{
+public:
+
+    // Pick a light for the shading position pos, u in [0..1)
+    // Returns the light index and the probability that the light was picked
+    VSNRAY_FUNC int sample_index(vec3 const& pos, float u, float& pmf) const;
+
+    // Probability that sample_index() picks light at pos
+    VSNRAY_FUNC float pmf(vec3 const& pos, int light) const;
+
+    template <
+        typename T,
+        typename = typename std::enable_if<simd::is_simd_vector<T>::value>::type
+        >
+    T pmf(vector<3, T> const& pos, int light) const;
+
+    // Index of the area light that wraps primitive prim_id, -1 if there is none
+    VSNRAY_FUNC int light_index(int prim_id) const;
+
+    // Sample a light from [lights..), pmf is the probability that the light was picked
+    template <
+        typename Lights,
+        typename Generator,
+        typename T = typename Generator::value_type,
+        typename = typename std::enable_if<!simd::is_simd_vector<T>::value>::type
+        >
+    VSNRAY_FUNC light_sample<T> sample(Lights lights, vector<3, T> const& pos, Generator& gen, T& pmf) const;
+
+    template <
+        typename Lights,
+        typename Generator,
+        typename T = typename Generator::value_type,
+        typename = typename std::enable_if<simd::is_simd_vector<T>::value>::type,
+        typename = void
+        >
+    light_sample<T> sample(Lights lights, vector<3, T> const& pos, Generator& gen, T& pmf) const;
+
+    // Probability that the emissive primitive prim_id was picked as a light at pos
+    VSNRAY_FUNC float pmf_for_primitive(vec3 const& pos, int prim_id) const;
+
+    template <
+        typename T,
+        typename I,
+        typename = typename std::enable_if<simd::is_simd_vector<T>::value>::type
+        >
+    T pmf_for_primitive(vector<3, T> const& pos, I const& prim_id) const;
+
+public:
+
+    int                     num_lights;
+
+    // Alias table over light power
+    float const*            alias_prob;
+    int const*              alias;
+    float const*            light_pmf;
+
+    // Light BVH, null if not built
+    light_bvh_node const*   nodes;
+
+    // Per light, path from the root to the leaf, bit i is set for right turns at depth i
+    unsigned const*         paths;
+    int const*              depths;
+
+    // Primitive ID to light index
+    int const*              prim_to_light;
+    int                     num_prims;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Light sampler, built once per scene on the host
+//
+// Usage:
+//
+//  light_sampler ls;
+//  ls.build(lights.data(), lights.data() + lights.size(), true /* light BVH */);
+//  auto kparams = make_kernel_params(..., lights.data(), lights.data() + lights.size(), ...);
+//  pathtracing::kernel<...> kernel;
+//  kernel.params = with_light_sampler(kparams, ls.ref());
+//
+// Light power is estimated from a single light sample (intensity times area). Area lights
+// are mapped to their primitive IDs so that the path tracer can evaluate the pmf for MIS
+// when it hits an emissive surface.
+//
+
+class light_sampler
+{
+public:
+
+    template <typename Lights>
+    void build(Lights begin, Lights end, bool build_bvh = false);
+
+    light_sampler_ref ref() const;
+
+    size_t num_lights() const;
+    bool has_bvh() const;
+
+private:
+
+    void build_alias_table(aligned_vector<float> const& power);
+
+    void build_bvh(aligned_vector<float> const& power, aligned_vector<aabb> const& bounds);
+
+    aligned_vector<float>           alias_prob_;
+    aligned_vector<int>             alias_;
+    aligned_vector<float>           pmf_;
+
+    aligned_vector<light_bvh_node>  nodes_;
+    aligned_vector<unsigned>        paths_;
+    aligned_vector<int>             depths_;
+
+    aligned_vector<int>             prim_to_light_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Kernel params with a light sampler
+//
+
+template <typename Params>
+struct light_sampler_params : Params
+{
+    light_sampler_ref light_sampler;
+};
+
+template <typename Params>
+inline light_sampler_params<Params> with_light_sampler(Params const& params, light_sampler_ref const& ls)
+{
+    light_sampler_params<Params> result;
+    static_cast<Params&>(result) = params;
+    result.light_sampler = ls;
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Sample a light for kernel params, uniform if params have no light sampler
+//
+
+template <typename Params, typename T, typename Generator>
+VSNRAY_FUNC
+inline light_sample<T> sample_light(Params const& params, vector<3, T> const& pos, Generator& gen, T& pmf);
+
+// Probability that sample_light() picks the emissive primitive prim_id at pos
+template <typename Params, typename T, typename I>
+VSNRAY_FUNC
+inline T light_pmf(Params const& params, vector<3, T> const& pos, I const& prim_id);
+
+// Probability that sample_light() picks the light with index light at pos
+template <typename Params, typename T>
+VSNRAY_FUNC
+inline T light_index_pmf(Params const& params, vector<3, T> const& pos, int light);
+
+} // visionaray
+
+#include "detail/light_sampler.inl"
+
+#endif // VSNRAY_LIGHT_SAMPLER_H
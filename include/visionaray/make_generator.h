@@ -45,6 +45,12 @@ struct make_generator_impl<T, pixel_sampler::jittered_blend_type>
     using generator_type = random_generator<T>;
 };
 
+template <typename T>
+struct make_generator_impl<T, pixel_sampler::jittered_adaptive_blend_type>
+{
+    using generator_type = random_generator<T>;
+};
+
 } // detail
 
 
@@ -84,6 +84,12 @@ VSNRAY_FORCE_INLINE float4 select(mask4 const& m, float4 const& a, float4 const&
 //    return float4(src[0], src[1], src[2], src[3]);
 //}
 
+MATH_FUNC
+VSNRAY_FORCE_INLINE float4 load_unaligned(float const src[4])
+{
+    return float4(src[0], src[1], src[2], src[3]);
+}
+
 MATH_FUNC
 VSNRAY_FORCE_INLINE void store(float dst[4], float4 const& v)
 {
@@ -93,6 +99,12 @@ VSNRAY_FORCE_INLINE void store(float dst[4], float4 const& v)
     dst[3] = v.value[3];
 }
 
+MATH_FUNC
+VSNRAY_FORCE_INLINE void store_unaligned(float dst[4], float4 const& v)
+{
+    store(dst, v);
+}
+
 template <size_t I>
 MATH_FUNC
 VSNRAY_FORCE_INLINE float& get(float4& v)
@@ -84,11 +84,21 @@ VSNRAY_FORCE_INLINE float4 load(float const src[4])
     return vld1q_f32(src);
 }
 
+VSNRAY_FORCE_INLINE float4 load_unaligned(float const src[4])
+{
+    return vld1q_f32(src);
+}
+
 VSNRAY_FORCE_INLINE void store(float dst[4], float4 const& v)
 {
     vst1q_f32(dst, v);
 }
 
+VSNRAY_FORCE_INLINE void store_unaligned(float dst[4], float4 const& v)
+{
+    vst1q_f32(dst, v);
+}
+
 template <size_t I>
 VSNRAY_FORCE_INLINE float& get(float4& v)
 {
@@ -0,0 +1,270 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_PAGED_VOLUME_H
+#define VSNRAY_PAGED_VOLUME_H 1
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "detail/mapped_file.h"
+#include "math/simd/type_traits.h"
+#include "math/vector.h"
+#include "texture/forward.h"
+#include "aligned_vector.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Paged volume file format
+//
+// A header followed by the bricks of all LOD levels, finest level first. Each level halves
+// the resolution of the previous one, the coarsest level fits into a single brick. Bricks
+// are stored in z/y/x order. A brick stores (brick_size + 2)^3 voxels in row major order,
+// including a one voxel halo copied from the neighboring bricks (clamped at the volume
+// border), so that nearest and linear filtering never access more than one brick.
+//
+
+struct paged_volume_header
+{
+    char            magic[8];
+    std::uint32_t   version;
+    std::uint32_t   voxel_size;
+    std::uint32_t   width;
+    std::uint32_t   height;
+    std::uint32_t   depth;
+    std::uint32_t   brick_size;
+    std::uint32_t   num_levels;
+};
+
+// Write a 3D texture (or anything with width(), height(), depth() and operator()(x,y,z))
+// with scalar voxels to a paged volume file. The coarser LOD levels are built in memory,
+// they require about 1/7 of the volume's size. Returns false if the file cannot be written.
+template <typename Texture>
+bool write_paged_volume(std::string const& filename, Texture const& volume, int brick_size = 32);
+
+
+//-------------------------------------------------------------------------------------------------
+// Paged volume reference, pass to kernels
+//
+// CPU only. Sampling consults the page table: if the brick at the finest level is resident,
+// it is sampled directly, otherwise the finest resident coarser level is sampled instead.
+// The missing bricks of all levels on the way are requested. The coarsest level is always
+// resident. Supports nearest and linear
+// filtering with clamp address mode.
+//
+
+template <typename T>
+class paged_volume_ref
+{
+public:
+
+    using value_type = T;
+
+    struct level
+    {
+        // Voxels
+        vec3i dims;
+
+        // Bricks
+        vec3i bricks;
+
+        // Index of the first brick in the page table
+        int first_brick;
+    };
+
+public:
+
+    // Sample with normalized texture coordinates
+    float sample(vec3 const& coord) const;
+
+public:
+
+    level const*            levels;
+    int                     num_levels;
+    int                     brick_size;
+    tex_filter_mode         filter_mode;
+
+    // Cache slot per brick, -1 if the brick is not resident
+    int const*              page_table;
+
+    // Cache slots with (brick_size + 2)^3 voxels each
+    T const*                cache;
+
+    // Frame in which a cache slot was last sampled
+    std::atomic<unsigned>*  last_used;
+    unsigned const*         frame;
+
+    // Non-zero per brick that was requested and is not yet resident
+    std::atomic<int>*       requested;
+
+    // Bricks requested in the current frame
+    int*                    requests;
+    std::atomic<int>*       num_requests;
+    int                     max_requests;
+
+private:
+
+    void request(int brick) const;
+
+    float sample_brick(int slot, vec3 const& texel) const;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// tex3D() overloads for paged volumes
+//
+
+template <typename T>
+inline float tex3D(paged_volume_ref<T> const& tex, vector<3, float> const& coord)
+{
+    return tex.sample(coord);
+}
+
+template <
+    typename T,
+    typename F,
+    typename = typename std::enable_if<simd::is_simd_vector<F>::value>::type
+    >
+inline F tex3D(paged_volume_ref<T> const& tex, vector<3, F> const& coord);
+
+
+//-------------------------------------------------------------------------------------------------
+// Paged volume
+//
+// Memory maps a paged volume file and keeps a fixed budget of bricks in a cache with least
+// recently used replacement. Bricks that kernels request are copied from the mapped file by
+// a background thread, so that page faults don't stall rendering. Call update() between
+// frames to move loaded bricks into the cache and to issue the requests of the last frame,
+// the cache is not modified while kernels are running.
+//
+// Usage:
+//
+//  write_paged_volume("volume.pvol", volume);
+//
+//  paged_volume<float> paged;
+//  paged.open("volume.pvol", 1ULL << 30);
+//
+//  for (;;)
+//  {
+//      render(paged.ref());
+//      paged.update();
+//  }
+//
+
+template <typename T>
+class paged_volume
+{
+public:
+
+    using value_type = T;
+    using ref_type = paged_volume_ref<T>;
+
+public:
+
+    paged_volume() = default;
+   ~paged_volume();
+
+    paged_volume(paged_volume const&) = delete;
+    paged_volume& operator=(paged_volume const&) = delete;
+
+    // Open file and allocate cache_size bytes for bricks (at least one brick, plus the
+    // coarsest level). Returns false if the file cannot be mapped or doesn't store voxels of type T
+    bool open(std::string const& filename, size_t cache_size);
+
+    void close();
+
+    // Commit loaded bricks to the cache and issue new requests, call between frames
+    void update();
+
+    // Wait until all issued requests were loaded, then update()
+    void finish();
+
+    // Number of bricks issued to the loader that are not yet in the cache
+    int num_pending() const;
+
+    // Valid until the file is closed
+    ref_type ref() const;
+
+    size_t width() const;
+    size_t height() const;
+    size_t depth() const;
+
+    int num_levels() const;
+    int brick_size() const;
+    int num_cache_slots() const;
+
+    // Nearest or Linear
+    void set_filter_mode(tex_filter_mode mode);
+    tex_filter_mode get_filter_mode() const;
+
+    // Voxel at the finest level, read from the mapped file
+    T operator()(size_t x, size_t y, size_t z) const;
+
+private:
+
+    using level = typename paged_volume_ref<T>::level;
+
+    struct loaded_brick
+    {
+        int brick;
+        aligned_vector<T> data;
+    };
+
+    mapped_file                             file_;
+
+    std::vector<level>                      levels_;
+    int                                     brick_size_ = 0;
+    size_t                                  brick_voxels_ = 0;
+    tex_filter_mode                         filter_mode_ = Linear;
+
+    // Cache
+    aligned_vector<int>                     page_table_;
+    aligned_vector<T>                       cache_;
+    std::vector<int>                        slot_owner_;
+    std::unique_ptr<std::atomic<unsigned>[]> last_used_;
+    int                                     num_slots_ = 0;
+    int                                     num_pinned_ = 0;
+    unsigned                                frame_ = 1;
+
+    // Requests
+    std::unique_ptr<std::atomic<int>[]>     requested_;
+    mutable std::vector<int>                requests_;
+    mutable std::atomic<int>                num_requests_;
+
+    // Loader thread
+    std::thread                             loader_;
+    mutable std::mutex                      mutex_;
+    std::condition_variable                 queue_cond_;
+    std::condition_variable                 done_cond_;
+    std::deque<int>                         queue_;
+    std::vector<loaded_brick>               done_;
+    int                                     num_loading_ = 0;
+    bool                                    stop_ = false;
+
+    T const* file_brick(int brick) const;
+
+    void commit(int brick, int slot, T const* data);
+
+    void loader_loop();
+
+};
+
+} // visionaray
+
+#include "detail/paged_volume.inl"
+
+#endif // VSNRAY_PAGED_VOLUME_H
@@ -10,6 +10,7 @@
 #include "math/matrix.h"
 #include "math/rectangle.h"
 #include "math/vector.h"
+#include "ray_differential.h"
 
 namespace visionaray
 {
@@ -85,6 +86,17 @@ public:
     VSNRAY_FUNC
     R primary_ray(R /* */, T const& x, T const& y, T const& width, T const& height) const;
 
+    // Generate primary ray at (x,y) with differentials to the rays at (x+1,y) and (x,y+1).
+    template <typename T>
+    VSNRAY_FUNC
+    basic_ray_differential<T> primary_ray(
+            basic_ray_differential<T>   /* */,
+            T const&                    x,
+            T const&                    y,
+            T const&                    width,
+            T const&                    height
+            ) const;
+
 private:
 
     mat4 view_;
@@ -8,6 +8,7 @@
 
 #include "detail/macros.h"
 #include "math/array.h"
+#include "math/limits.h"
 #include "math/vector.h"
 #include "light_sample.h"
 
@@ -38,12 +39,18 @@ public:
     VSNRAY_FUNC T linear_attenuation() const;
     VSNRAY_FUNC T quadratic_attenuation() const;
 
+    // Distance beyond which the light is ignored by light culling (see light_culling.h).
+    // The attenuation is windowed to fall off smoothly to zero at that distance.
+    // Unbounded (numeric_limits<T>::max()) by default.
+    VSNRAY_FUNC T influence_radius() const;
+
     VSNRAY_FUNC void set_cl(color_type const& cl);
     VSNRAY_FUNC void set_kl(scalar_type kl);
     VSNRAY_FUNC void set_position(vec_type const& pos);
     VSNRAY_FUNC void set_constant_attenuation(T att);
     VSNRAY_FUNC void set_linear_attenuation(T att);
     VSNRAY_FUNC void set_quadratic_attenuation(T att);
+    VSNRAY_FUNC void set_influence_radius(T radius);
 
 private:
 
@@ -54,6 +61,8 @@ private:
     T constant_attenuation_;
     T linear_attenuation_;
     T quadratic_attenuation_;
+
+    T influence_radius_ = numeric_limits<T>::max();
 };
 
 } // visionaray
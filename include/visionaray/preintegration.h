@@ -0,0 +1,69 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_PREINTEGRATION_H
+#define VSNRAY_PREINTEGRATION_H 1
+
+#include "detail/macros.h"
+#include "detail/thread_pool.h"
+#include "math/vector.h"
+#include "texture/texture.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Pre-integrated transfer functions
+// See: Engel et al., High-Quality Pre-Integrated Volume Rendering Using Hardware-Accelerated
+// Pixel Shading (2001)
+//
+// Entry (front, back) of the table stores the premultiplied color and opacity of a ray
+// segment of one step length along which the volume value changes linearly from front to
+// back. Classifying segments instead of samples captures features of the transfer function
+// that lie between two samples, so that high frequency transfer functions don't require
+// small steps.
+//
+// The transfer function's opacities refer to a segment of length reference, relative_step
+// is step / reference (1 if the integrator doesn't correct opacities). The table is sampled
+// with texture coordinates (front, back), preintegrate() sets linear filtering and clamp
+// address mode. Rebuild after the transfer function or the step size changes.
+//
+// Usage:
+//
+//  texture<vec4, 2> table(256, 256);
+//  preintegrate(table, transfunc, step_size / reference_step_size, pool);
+//
+//  integrator.set_preintegration_table(texture_ref<vec4, 2>(table));
+//
+
+template <typename TransFunc>
+void preintegrate(texture<vec4, 2>& table, TransFunc const& transfunc, float relative_step = 1.0f);
+
+// Parallelize over rows
+template <typename TransFunc>
+void preintegrate(
+        texture<vec4, 2>&   table,
+        TransFunc const&    transfunc,
+        float               relative_step,
+        thread_pool&        pool
+        );
+
+
+//-------------------------------------------------------------------------------------------------
+// Color and opacity of a ray segment from the volume values at its ends
+//
+
+template <typename Table, typename T>
+VSNRAY_FUNC
+inline vector<4, T> preintegrated_segment(Table const& table, T const& front, T const& back)
+{
+    return tex2D(table, vector<2, T>(front, back));
+}
+
+} // visionaray
+
+#include "detail/preintegration.inl"
+
+#endif // VSNRAY_PREINTEGRATION_H
@@ -0,0 +1,196 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_RAY_DIFFERENTIAL_H
+#define VSNRAY_RAY_DIFFERENTIAL_H 1
+
+#include <type_traits>
+
+#include "detail/macros.h"
+#include "math/simd/type_traits.h"
+#include "math/array.h"
+#include "math/ray.h"
+#include "math/triangle.h"
+#include "math/vector.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Ray with differentials
+// See: Igehy, Tracing Ray Differentials (1999)
+//
+// Stores the offsets of origin and direction to the rays through the neighboring pixels in
+// x and y. Cameras fill in the differentials when the scheduler's ray type is a ray
+// differential, kernels use them to select texture mip levels. Rays constructed from origin
+// and direction have zero differentials, i.e. they sample the finest mip level.
+//
+
+template <typename T>
+class basic_ray_differential : public basic_ray<T>
+{
+public:
+
+    using base_type = basic_ray<T>;
+    using vec_type  = vector<3, T>;
+
+public:
+
+    vec_type dodx = vec_type(T(0.0));
+    vec_type dody = vec_type(T(0.0));
+    vec_type dddx = vec_type(T(0.0));
+    vec_type dddy = vec_type(T(0.0));
+
+    basic_ray_differential() = default;
+
+    VSNRAY_FUNC basic_ray_differential(vector<3, T> const& o, vector<3, T> const& d)
+        : base_type(o, d)
+    {
+    }
+
+    VSNRAY_FUNC explicit basic_ray_differential(basic_ray<T> const& r)
+        : base_type(r)
+    {
+    }
+
+};
+
+using ray_differential = basic_ray_differential<float>;
+
+
+//-------------------------------------------------------------------------------------------------
+// Texture coordinate derivatives at a triangle hit
+//
+// Intersects the offset rays with the plane of the triangle and interpolates the texture
+// coordinates at the intersection points. Derivatives are zero if the offset rays are
+// parallel to the plane.
+//
+
+template <typename T, typename TexCoord>
+VSNRAY_FUNC
+inline void tex_coord_derivatives(
+        basic_ray_differential<T> const&    ray,
+        basic_triangle<3, T> const&         tri,
+        TexCoord const&                     tc1,
+        TexCoord const&                     tc2,
+        TexCoord const&                     tc3,
+        vector<2, T>&                       duvdx,
+        vector<2, T>&                       duvdy
+        )
+{
+    using V = vector<3, T>;
+
+    V n = cross(tri.e1, tri.e2);
+
+    T d00 = dot(tri.e1, tri.e1);
+    T d01 = dot(tri.e1, tri.e2);
+    T d11 = dot(tri.e2, tri.e2);
+    T denom = d00 * d11 - d01 * d01;
+
+    auto tex_coord_at = [&](V const& ori, V const& dir, vector<2, T>& uv) -> bool
+    {
+        T ndir = dot(n, dir);
+
+        if (ndir == T(0.0) || denom == T(0.0))
+        {
+            return false;
+        }
+
+        V p = ori + dir * (dot(n, tri.v1 - ori) / ndir) - tri.v1;
+
+        T d20 = dot(p, tri.e1);
+        T d21 = dot(p, tri.e2);
+        T b1 = (d11 * d20 - d01 * d21) / denom;
+        T b2 = (d00 * d21 - d01 * d20) / denom;
+
+        uv = vector<2, T>(tc1) * (T(1.0) - b1 - b2) + vector<2, T>(tc2) * b1 + vector<2, T>(tc3) * b2;
+        return true;
+    };
+
+    vector<2, T> uv;
+    vector<2, T> uvx;
+    vector<2, T> uvy;
+
+    if (tex_coord_at(ray.ori, ray.dir, uv)
+     && tex_coord_at(ray.ori + ray.dodx, ray.dir + ray.dddx, uvx)
+     && tex_coord_at(ray.ori + ray.dody, ray.dir + ray.dddy, uvy))
+    {
+        duvdx = uvx - uv;
+        duvdy = uvy - uv;
+    }
+    else
+    {
+        duvdx = vector<2, T>(T(0.0));
+        duvdy = vector<2, T>(T(0.0));
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Mip level for a texture of size width x height, the larger footprint determines the level
+//
+
+template <typename T>
+VSNRAY_FUNC
+inline T texture_lod(vector<2, T> const& duvdx, vector<2, T> const& duvdy, T width, T height)
+{
+    vector<2, T> size(width, height);
+
+    T footprint = max(length(duvdx * size), length(duvdy * size));
+
+    return log2(footprint);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Width of the pixel footprint of a ray differential at distance t along the ray
+//
+
+template <typename T>
+VSNRAY_FUNC
+inline T ray_footprint(basic_ray_differential<T> const& ray, T t)
+{
+    return max(length(ray.dodx + ray.dddx * t), length(ray.dody + ray.dddy * t));
+}
+
+
+namespace simd
+{
+
+//-------------------------------------------------------------------------------------------------
+// SIMD conversions
+//
+
+template <
+    typename FloatT,
+    typename = typename std::enable_if<is_simd_vector<FloatT>::value>::type
+    >
+inline auto unpack(basic_ray_differential<FloatT> const& ray)
+    -> array<basic_ray_differential<float>, num_elements<FloatT>::value>
+{
+    auto rays  = unpack(static_cast<basic_ray<FloatT> const&>(ray));
+    auto dodxs = unpack(ray.dodx);
+    auto dodys = unpack(ray.dody);
+    auto dddxs = unpack(ray.dddx);
+    auto dddys = unpack(ray.dddy);
+
+    array<basic_ray_differential<float>, num_elements<FloatT>::value> result;
+
+    for (int i = 0; i < num_elements<FloatT>::value; ++i)
+    {
+        result[i] = basic_ray_differential<float>(rays[i]);
+        result[i].dodx = dodxs[i];
+        result[i].dody = dodys[i];
+        result[i].dddx = dddxs[i];
+        result[i].dddy = dddys[i];
+    }
+
+    return result;
+}
+
+} // simd
+} // visionaray
+
+#endif // VSNRAY_RAY_DIFFERENTIAL_H
@@ -7,11 +7,27 @@
 #define VSNRAY_RENDER_TARGET_H 1
 
 #include "detail/macros.h"
+#include "aov.h"
 #include "pixel_traits.h"
 
 namespace visionaray
 {
 
+//-------------------------------------------------------------------------------------------------
+// Memory layout of host render targets
+//
+//  RT_LINEAR:  pixels are stored in row-major order
+//  RT_TILED:   kernels write to tiles that are stored contiguously (tile-major order),
+//              the tiles are resolved to row-major order at the end of each frame
+//
+
+enum render_target_layout
+{
+    RT_LINEAR,
+    RT_TILED
+};
+
+
 //-------------------------------------------------------------------------------------------------
 // Render target base
 //
@@ -31,8 +47,8 @@ public:
 
 private:
 
-    int width_;
-    int height_;
+    int width_  = 0;
+    int height_ = 0;
 
 };
 
@@ -47,6 +63,9 @@ struct render_target_ref
     using color_type = typename pixel_traits<ColorFormat>::type;
     using depth_type = typename pixel_traits<DepthFormat>::type;
 
+    static const pixel_format color_format = ColorFormat;
+    static const pixel_format depth_format = DepthFormat;
+
     VSNRAY_FUNC color_type* color()
     {
         return color_;
@@ -86,6 +105,92 @@ struct render_target_ref
 
 };
 
+
+//-------------------------------------------------------------------------------------------------
+// Render target ref with additional AOV layers
+//
+
+template <pixel_format ColorFormat, pixel_format DepthFormat = PF_UNSPECIFIED>
+struct render_target_aov_ref : render_target_ref<ColorFormat, DepthFormat>
+{
+    using base_type = render_target_ref<ColorFormat, DepthFormat>;
+
+    render_target_aov_ref() = default;
+
+    VSNRAY_FUNC render_target_aov_ref(base_type const& base, aov_ref const& aovs)
+        : base_type(base)
+        , aovs_(aovs)
+    {
+    }
+
+    VSNRAY_FUNC aov_ref const& aovs() const
+    {
+        return aovs_;
+    }
+
+    aov_ref aovs_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Render target ref with optional tile-major storage
+//
+// If tiled color (and depth) storage is present, schedulers write to that storage. Tiles
+// have a fixed size of tile_width x tile_height pixels and are aligned with the 16x16 tiles
+// of the CPU schedulers. Tiles at the right and bottom border are padded.
+//
+
+template <pixel_format ColorFormat, pixel_format DepthFormat = PF_UNSPECIFIED>
+struct render_target_tiled_ref : render_target_aov_ref<ColorFormat, DepthFormat>
+{
+    using base_type  = render_target_aov_ref<ColorFormat, DepthFormat>;
+    using tile_type  = render_target_ref<ColorFormat, DepthFormat>;
+    using color_type = typename base_type::color_type;
+    using depth_type = typename base_type::depth_type;
+
+    static const int tile_width  = 16;
+    static const int tile_height = 16;
+
+    render_target_tiled_ref() = default;
+
+    VSNRAY_FUNC render_target_tiled_ref(base_type const& base, color_type* tiled_color, depth_type* tiled_depth)
+        : base_type(base)
+        , tiled_color_(tiled_color)
+        , tiled_depth_(tiled_depth)
+    {
+    }
+
+    VSNRAY_FUNC bool tiled() const
+    {
+        return tiled_color_ != nullptr;
+    }
+
+    // Index of the first pixel of the tile that contains pixel (x, y)
+    VSNRAY_FUNC int tile_offset(int x, int y) const
+    {
+        int num_tiles_x = (this->width_ + tile_width - 1) / tile_width;
+        return ((y / tile_height) * num_tiles_x + x / tile_width) * tile_width * tile_height;
+    }
+
+    // Ref to the tile that contains pixel (x, y), addressed with tile-local coordinates
+    VSNRAY_FUNC tile_type tile(int x, int y) const
+    {
+        int offset = tile_offset(x, y);
+
+        return {
+            tiled_color_ + offset,
+            tiled_depth_ ? tiled_depth_ + offset : nullptr,
+            tile_width,
+            tile_height
+            };
+    }
+
+    color_type* tiled_color_;
+    depth_type* tiled_depth_;
+
+};
+
 } // visionaray
 
 #endif // VSNRAY_RENDER_TARGET_H
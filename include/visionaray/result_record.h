@@ -30,6 +30,24 @@ struct result_record
     vec_type    isect_pos = vec_type(0.0);
 };
 
+
+//-------------------------------------------------------------------------------------------------
+// Result record with additional arbitrary output variables (AOVs, see aov.h)
+// Kernels return this type to fill the AOV layers of a render target
+//
+
+template <typename T>
+struct aov_result_record : result_record<T>
+{
+    using int_type    = simd::int_type_t<T>;
+    using vec_type    = vector<3, T>;
+
+    vec_type    normal    = vec_type(0.0);
+    vec_type    albedo    = vec_type(0.0);
+    int_type    prim_id   = int_type(-1);
+    int_type    geom_id   = int_type(-1);
+};
+
 } // visionaray
 
 #endif // VSNRAY_RESULT_RECORD_H
@@ -6,7 +6,9 @@
 #ifndef VSNRAY_SIMPLE_BUFFER_RT_H
 #define VSNRAY_SIMPLE_BUFFER_RT_H 1
 
+#include "detail/thread_pool.h"
 #include "aligned_vector.h"
+#include "aov.h"
 #include "pixel_traits.h"
 #include "render_target.h"
 
@@ -26,7 +28,7 @@ public:
     using color_type    = typename pixel_traits<ColorFormat>::type;
     using depth_type    = typename pixel_traits<DepthFormat>::type;
 
-    using ref_type      = render_target_ref<ColorFormat, DepthFormat>;
+    using ref_type      = render_target_tiled_ref<ColorFormat, DepthFormat>;
 
 public:
 
@@ -36,6 +38,17 @@ public:
     color_type const* color() const;
     depth_type const* depth() const;
 
+    // AOV layers, disabled by default
+    aov_buffer& aovs();
+    aov_buffer const& aovs() const;
+
+    // Memory layout kernels write to, RT_LINEAR by default
+    // Contents are discarded, clear the buffers after changing the layout
+    // end_frame() resolves tiles on the threads of pool if not null, the pool must outlive
+    // the render target or the next call to set_layout()
+    void set_layout(render_target_layout layout, thread_pool* pool = nullptr);
+    render_target_layout get_layout() const;
+
     ref_type ref();
 
     void clear_color_buffer(vec4 const& color = vec4(0.0f));
@@ -49,6 +62,15 @@ private:
     aligned_vector<color_type> color_buffer;
     aligned_vector<depth_type> depth_buffer;
 
+    aov_buffer aov_buffer_;
+
+    render_target_layout layout_ = RT_LINEAR;
+    thread_pool* pool_ = nullptr;
+
+    // Tile-major storage, only allocated in tiled mode
+    aligned_vector<color_type> tiled_color_buffer;
+    aligned_vector<depth_type> tiled_depth_buffer;
+
 };
 
 } // visionaray
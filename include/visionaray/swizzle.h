@@ -6,8 +6,15 @@
 #ifndef VSNRAY_SWIZZLE_H
 #define VSNRAY_SWIZZLE_H 1
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <cstring>
 
+#include "detail/parallel_for.h"
+#include "detail/range.h"
+#include "detail/thread_pool.h"
+#include "math/simd/simd.h"
 #include "math/unorm.h"
 #include "math/vector.h"
 #include "pixel_format.h"
@@ -20,13 +27,113 @@ enum swizzle_hint
     PremultiplyAlpha,
     TruncateAlpha,
     AlphaIsZero,
-    AlphaIsOne
+    AlphaIsOne,
+    DecodeSRGB,     // 8-bit sRGB to linear float, alpha is linear
+    EncodeSRGB      // Linear float to 8-bit sRGB, alpha is linear
 };
 
 
 namespace detail
 {
 
+//-------------------------------------------------------------------------------------------------
+// Run a conversion in parallel over chunks of [0..len) on the caller's threads,
+// large inputs only
+//
+
+template <typename Func>
+inline void swizzle_chunked(size_t len, thread_pool* pool, Func const& func)
+{
+    // Threads are only worth waking up for multi-megabyte images and volumes
+    const size_t min_parallel_len = size_t(1) << 20;
+    const size_t chunk_size       = size_t(1) << 16;
+
+    optional_parallel_for(
+        len >= min_parallel_len ? pool : nullptr,
+        tiled_range1d<size_t>(0, len, chunk_size),
+        [&](range1d<size_t> const& r)
+        {
+            func(r.begin(), r.end());
+        });
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// sRGB transfer function
+//
+
+inline float srgb_to_linear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+// Lookup tables for 8-bit sRGB values
+struct srgb8_tables
+{
+    srgb8_tables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            to_linear[i] = srgb_to_linear(i / 255.0f);
+        }
+
+        // Linear values where rounding to the nearest 8-bit sRGB code switches to the next code,
+        // code i covers [bounds[i]..bounds[i + 1]). Sentinels are outside [0..1]
+        bounds[0] = -1.0f;
+
+        for (int i = 1; i < 256; ++i)
+        {
+            bounds[i] = srgb_to_linear((i - 0.5f) / 255.0f);
+        }
+
+        bounds[256] = 2.0f;
+    }
+
+    float to_linear[256];
+    float bounds[257];
+};
+
+inline srgb8_tables const& get_srgb8_tables()
+{
+    static const srgb8_tables tables;
+    return tables;
+}
+
+inline unsigned char linear_to_srgb8(srgb8_tables const& tables, float c)
+{
+    return static_cast<unsigned char>(
+            std::upper_bound(tables.bounds + 1, tables.bounds + 256, c) - (tables.bounds + 1)
+            );
+}
+
+// Nearest 8-bit sRGB code for linear values in [0..1]
+// Polynomial approximation in x^(1/2), x^(1/4) and x^(1/8), off by at most one code,
+// then corrected against the code boundaries
+inline simd::int4 linear_to_srgb8(srgb8_tables const& tables, simd::float4 const& x)
+{
+    using simd::float4;
+    using simd::int4;
+
+    float4 s1 = sqrt(x);
+    float4 s2 = sqrt(s1);
+    float4 s3 = sqrt(s2);
+
+    float4 srgb = select(
+            x <= float4(0.0031308f),
+            x * float4(12.92f),
+            float4(0.585122381f) * s1 + float4(0.783140355f) * s2 - float4(0.368262736f) * s3
+            );
+
+    int4 code = convert_to_int(srgb * float4(255.0f) + float4(0.5f));
+    code = min(max(code, int4(0)), int4(255));
+
+    code = select(x >= gather(tables.bounds + 1, code), code + int4(1), code);
+    code = select(x <  gather(tables.bounds, code), code - int4(1), code);
+
+    return code;
+}
+
+
 //-------------------------------------------------------------------------------------------------
 // Swizzle into 2nd data array
 //
@@ -98,13 +205,206 @@ inline void swizzle_RGBA32F_to_RGBA8(
         size_t                      len
         )
 {
-    for (size_t i = 0; i < len; ++i)
+    using simd::float4;
+    using simd::int4;
+
+    size_t i = 0;
+
+    // Four pixels per iteration, transpose to SoA and pack one pixel per 32-bit lane
+    // (r in the lowest byte). Truncates like float_to_unorm()
+    for (; i + 4 <= len; i += 4)
+    {
+        auto c = transpose(vector<4, float4>(
+                simd::load_unaligned(src[i    ].data()),
+                simd::load_unaligned(src[i + 1].data()),
+                simd::load_unaligned(src[i + 2].data()),
+                simd::load_unaligned(src[i + 3].data())
+                ));
+
+        float4 scale(255.0f);
+
+        int4 rgba = convert_to_int(saturate(c.x) * scale)
+                 | (convert_to_int(saturate(c.y) * scale) << 8)
+                 | (convert_to_int(saturate(c.z) * scale) << 16)
+                 | (convert_to_int(saturate(c.w) * scale) << 24);
+
+        VSNRAY_ALIGN(16) int packed[4];
+        store(packed, rgba);
+        std::memcpy(dst + i, packed, sizeof(packed));
+    }
+
+    for (; i < len; ++i)
     {
         auto rgba = src[i];
         dst[i] = vector<4, unorm<8>>( rgba.x, rgba.y, rgba.z, rgba.w );
     }
 }
 
+inline void swizzle_RGBA8_to_RGBA32F(
+        vector<4, float>*                   dst,
+        vector<4, unorm<8>> const*          src,
+        size_t                              len
+        )
+{
+    using simd::float4;
+    using simd::int4;
+
+    size_t i = 0;
+
+    // Four pixels per iteration, unpack the channels from 32-bit lanes and transpose to AoS
+    for (; i + 4 <= len; i += 4)
+    {
+        VSNRAY_ALIGN(16) int packed[4];
+        std::memcpy(packed, src + i, sizeof(packed));
+
+        int4 rgba(packed);
+        int4 mask(0xFF);
+        float4 scale(255.0f);
+
+        auto c = transpose(vector<4, float4>(
+                convert_to_float( rgba        & mask) / scale,
+                convert_to_float((rgba >>  8) & mask) / scale,
+                convert_to_float((rgba >> 16) & mask) / scale,
+                convert_to_float((rgba >> 24) & mask) / scale
+                ));
+
+        simd::store_unaligned(dst[i    ].data(), c.x);
+        simd::store_unaligned(dst[i + 1].data(), c.y);
+        simd::store_unaligned(dst[i + 2].data(), c.z);
+        simd::store_unaligned(dst[i + 3].data(), c.w);
+    }
+
+    for (; i < len; ++i)
+    {
+        dst[i] = vector<4, float>(src[i]);
+    }
+}
+
+inline void swizzle_SRGBA8_to_RGBA32F(
+        vector<4, float>*                   dst,
+        vector<4, unorm<8>> const*          src,
+        size_t                              len
+        )
+{
+    using simd::float4;
+    using simd::int4;
+
+    auto const& tables = get_srgb8_tables();
+
+    size_t i = 0;
+
+    // Four pixels per iteration, color channels are gathered from the lookup table
+    for (; i + 4 <= len; i += 4)
+    {
+        VSNRAY_ALIGN(16) int packed[4];
+        std::memcpy(packed, src + i, sizeof(packed));
+
+        int4 rgba(packed);
+        int4 mask(0xFF);
+
+        auto c = transpose(vector<4, float4>(
+                gather(tables.to_linear,  rgba        & mask),
+                gather(tables.to_linear, (rgba >>  8) & mask),
+                gather(tables.to_linear, (rgba >> 16) & mask),
+                convert_to_float((rgba >> 24) & mask) / float4(255.0f)
+                ));
+
+        simd::store_unaligned(dst[i    ].data(), c.x);
+        simd::store_unaligned(dst[i + 1].data(), c.y);
+        simd::store_unaligned(dst[i + 2].data(), c.z);
+        simd::store_unaligned(dst[i + 3].data(), c.w);
+    }
+
+    for (; i < len; ++i)
+    {
+        auto rgba = src[i];
+        dst[i] = vector<4, float>(
+                tables.to_linear[rgba.x.value],
+                tables.to_linear[rgba.y.value],
+                tables.to_linear[rgba.z.value],
+                static_cast<float>(rgba.w)
+                );
+    }
+}
+
+inline void swizzle_RGBA32F_to_SRGBA8(
+        vector<4, unorm<8>>*                dst,
+        vector<4, float> const*             src,
+        size_t                              len
+        )
+{
+    using simd::float4;
+    using simd::int4;
+
+    auto const& tables = get_srgb8_tables();
+
+    size_t i = 0;
+
+    // Four pixels per iteration, packed like swizzle_RGBA32F_to_RGBA8()
+    for (; i + 4 <= len; i += 4)
+    {
+        auto c = transpose(vector<4, float4>(
+                simd::load_unaligned(src[i    ].data()),
+                simd::load_unaligned(src[i + 1].data()),
+                simd::load_unaligned(src[i + 2].data()),
+                simd::load_unaligned(src[i + 3].data())
+                ));
+
+        int4 rgba = linear_to_srgb8(tables, saturate(c.x))
+                 | (linear_to_srgb8(tables, saturate(c.y)) << 8)
+                 | (linear_to_srgb8(tables, saturate(c.z)) << 16)
+                 | (convert_to_int(saturate(c.w) * float4(255.0f)) << 24);
+
+        VSNRAY_ALIGN(16) int packed[4];
+        store(packed, rgba);
+        std::memcpy(dst + i, packed, sizeof(packed));
+    }
+
+    for (; i < len; ++i)
+    {
+        auto rgba = src[i];
+        dst[i].x.value = linear_to_srgb8(tables, rgba.x);
+        dst[i].y.value = linear_to_srgb8(tables, rgba.y);
+        dst[i].z.value = linear_to_srgb8(tables, rgba.z);
+        dst[i].w = unorm<8>(rgba.w);
+    }
+}
+
+// 16-bit volumes to float
+inline void swizzle_R16UI_to_R32F(
+        float*                              dst,
+        unorm<16> const*                    src,
+        size_t                              len
+        )
+{
+    using simd::float4;
+    using simd::int4;
+
+    size_t i = 0;
+
+    // Eight values per iteration, even and odd values are in the low and high halves of 32-bit lanes
+    for (; i + 8 <= len; i += 8)
+    {
+        VSNRAY_ALIGN(16) int packed[4];
+        std::memcpy(packed, src + i, sizeof(packed));
+
+        int4 v(packed);
+        int4 mask(0xFFFF);
+        float4 scale(65535.0f);
+
+        float4 even = convert_to_float( v        & mask) / scale;
+        float4 odd  = convert_to_float((v >> 16) & mask) / scale;
+
+        simd::store_unaligned(dst + i,     interleave_lo(even, odd));
+        simd::store_unaligned(dst + i + 4, interleave_hi(even, odd));
+    }
+
+    for (; i < len; ++i)
+    {
+        dst[i] = static_cast<float>(src[i]);
+    }
+}
+
 template <typename T, typename U>
 inline void swizzle_RGBA_to_RGB(
         vector<3, T>*       dst,
@@ -136,6 +436,33 @@ inline void swizzle_RGBA_to_RGB(
     }
 }
 
+// RGBA8 -> RGB8 with SSSE3 byte shuffles when alpha is truncated
+inline void swizzle_RGBA_to_RGB(
+        vector<3, unorm<8>>*        dst,
+        vector<4, unorm<8>> const*  src,
+        size_t                      len,
+        swizzle_hint                hint
+        )
+{
+    size_t i = 0;
+
+#if VSNRAY_SIMD_ISA_GE(VSNRAY_SIMD_ISA_SSSE3)
+    if (hint == TruncateAlpha)
+    {
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+        // Four pixels per iteration, the 16-byte store overlaps the next two pixels
+        for (; i + 6 <= len; i += 4)
+        {
+            __m128i rgba = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(rgba, shuffle));
+        }
+    }
+#endif
+
+    swizzle_RGBA_to_RGB<unorm<8>, unorm<8>>(dst + i, src + i, len - i, hint);
+}
+
 // Cast between unorm types with different bit depth
 template <unsigned BitsDst, unsigned BitsSrc>
 inline void swizzle_RGBA_to_RGB_cast_unorm(
@@ -217,7 +544,23 @@ inline void swizzle_RGB8_to_RGBA8(
         )
 {
     unsigned char a = hint == AlphaIsZero ? 0U : 255U;
-    for (size_t i = 0; i < len; ++i)
+
+    size_t i = 0;
+
+#if VSNRAY_SIMD_ISA_GE(VSNRAY_SIMD_ISA_SSSE3)
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha   = _mm_set1_epi32(static_cast<int>(static_cast<unsigned>(a) << 24));
+
+    // Four pixels per iteration, the 16-byte load overlaps the next two pixels
+    for (; i + 6 <= len; i += 4)
+    {
+        __m128i rgb = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+        __m128i rgba = _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), rgba);
+    }
+#endif
+
+    for (; i < len; ++i)
     {
         auto rgb = src[i];
         dst[i] = vector<4, unorm<8>>( rgb.x, rgb.y, rgb.z, a );
@@ -429,6 +772,86 @@ inline void swizzle_expand_types(
     }
 }
 
+// RGBA32F -> RGBA8 (sRGB), 8-bit type is unorm<8>
+
+inline void swizzle_expand_types(
+        vector<4, unorm<8>>*    dst,
+        pixel_format            format_dst,
+        vector<4, float> const* src,
+        pixel_format            format_src,
+        size_t                  len,
+        swizzle_hint            hint
+        )
+{
+    if (format_dst == PF_RGBA8 && format_src == PF_RGBA32F)
+    {
+        if (hint == EncodeSRGB)
+        {
+            detail::swizzle_RGBA32F_to_SRGBA8( dst, src, len );
+        }
+        else
+        {
+            detail::swizzle_RGBA32F_to_RGBA8( dst, src, len );
+        }
+    }
+}
+
+// RGBA8 -> RGBA32F, 8-bit type is unorm<8>
+
+inline void swizzle_expand_types(
+        vector<4, float>*           dst,
+        pixel_format                format_dst,
+        vector<4, unorm<8>> const*  src,
+        pixel_format                format_src,
+        size_t                      len
+        )
+{
+    if (format_dst == PF_RGBA32F && format_src == PF_RGBA8)
+    {
+        detail::swizzle_RGBA8_to_RGBA32F( dst, src, len );
+    }
+}
+
+// RGBA8 (sRGB) -> RGBA32F, 8-bit type is unorm<8>
+
+inline void swizzle_expand_types(
+        vector<4, float>*           dst,
+        pixel_format                format_dst,
+        vector<4, unorm<8>> const*  src,
+        pixel_format                format_src,
+        size_t                      len,
+        swizzle_hint                hint
+        )
+{
+    if (format_dst == PF_RGBA32F && format_src == PF_RGBA8)
+    {
+        if (hint == DecodeSRGB)
+        {
+            detail::swizzle_SRGBA8_to_RGBA32F( dst, src, len );
+        }
+        else
+        {
+            detail::swizzle_RGBA8_to_RGBA32F( dst, src, len );
+        }
+    }
+}
+
+// R16UI -> R32F, 16-bit type is unorm<16>
+
+inline void swizzle_expand_types(
+        float*                      dst,
+        pixel_format                format_dst,
+        unorm<16> const*            src,
+        pixel_format                format_src,
+        size_t                      len
+        )
+{
+    if (format_dst == PF_R32F && format_src == PF_R16UI)
+    {
+        detail::swizzle_R16UI_to_R32F( dst, src, len );
+    }
+}
+
 // RGB8 <-> BGR8, 8-bit type is unorm<8>
 
 inline void swizzle_expand_types(
@@ -486,6 +909,23 @@ inline void swizzle(
     detail::swizzle_expand_types( dst, format_dst, src, format_src, len );
 }
 
+// Large arrays are converted in parallel on the threads of pool, in chunks of 64K elements
+template <typename T, typename U>
+inline void swizzle(
+        T*              dst,
+        pixel_format    format_dst,
+        U const*        src,
+        pixel_format    format_src,
+        size_t          len,
+        thread_pool&    pool
+        )
+{
+    detail::swizzle_chunked(len, &pool, [&](size_t begin, size_t end)
+    {
+        detail::swizzle_expand_types( dst + begin, format_dst, src + begin, format_src, end - begin );
+    });
+}
+
 
 //-------------------------------------------------------------------------------------------------
 // Dispatch function with two arrays and a hint about how to handle alpha (etc.)
@@ -504,6 +944,23 @@ inline void swizzle(
     detail::swizzle_expand_types( dst, format_dst, src, format_src, len, hint );
 }
 
+template <typename T, typename U>
+inline void swizzle(
+        T*              dst,
+        pixel_format    format_dst,
+        U const*        src,
+        pixel_format    format_src,
+        size_t          len,
+        swizzle_hint    hint,
+        thread_pool&    pool
+        )
+{
+    detail::swizzle_chunked(len, &pool, [&](size_t begin, size_t end)
+    {
+        detail::swizzle_expand_types( dst + begin, format_dst, src + begin, format_src, end - begin, hint );
+    });
+}
+
 
 //-------------------------------------------------------------------------------------------------
 // Dispatch function for in-place swizzling
@@ -520,6 +977,21 @@ inline void swizzle(
     detail::swizzle_expand_types( data, format_dst, format_src, len );
 }
 
+template <typename T>
+inline void swizzle(
+        T*              data,
+        pixel_format    format_dst,
+        pixel_format    format_src,
+        size_t          len,
+        thread_pool&    pool
+        )
+{
+    detail::swizzle_chunked(len, &pool, [&](size_t begin, size_t end)
+    {
+        detail::swizzle_expand_types( data + begin, format_dst, format_src, end - begin );
+    });
+}
+
 } // visionaray
 
 #endif // VSNRAY_SWIZZLE_H
@@ -93,6 +93,11 @@ struct jittered_type : base_type {};
 // Jittered and successive blending
 struct jittered_blend_type : jittered_type {};
 
+// Jittered and successive blending, pixels whose running variance
+// has converged are skipped in subsequent frames
+// Schedulers w/o support for adaptive sampling fall back to jittered_blend_type
+struct jittered_adaptive_blend_type : jittered_blend_type {};
+
 } // pixel_sampler
 
 } // visionaray
@@ -146,6 +146,9 @@ public:
         , filter_mode_(host_tex.get_filter_mode())
         , normalized_coords_(host_tex.get_normalized_coords())
     {
+        // CUDA arrays have their own (opaque) layout, upload row major data
+        assert(host_tex.get_storage_layout() == RowMajor);
+
         if (width_ == 0 || height_ == 0 || depth_ == 0)
         {
             return;
@@ -180,6 +183,9 @@ public:
         , filter_mode_(host_tex.get_filter_mode())
         , normalized_coords_(host_tex.get_normalized_coords())
     {
+        // CUDA arrays have their own (opaque) layout, upload row major data
+        assert(host_tex.get_storage_layout() == RowMajor);
+
         if (width_ == 0 || height_ == 0 || depth_ == 0)
         {
             return;
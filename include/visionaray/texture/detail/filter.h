@@ -20,6 +20,7 @@ namespace detail
 
 //-------------------------------------------------------------------------------------------------
 // Dispatch function to choose among filtering algorithms
+// 3D textures additionally pass their storage layout
 //
 
 template <
@@ -28,7 +29,8 @@ template <
     typename TexelT,
     typename FloatT,
     typename SizeT,
-    typename AddressMode
+    typename AddressMode,
+    typename ...Layout
     >
 inline ReturnT choose_filter(
         ReturnT             /* */,
@@ -37,7 +39,8 @@ inline ReturnT choose_filter(
         FloatT              coord,
         SizeT               texsize,
         tex_filter_mode     filter_mode,
-        AddressMode const&  address_mode
+        AddressMode const&  address_mode,
+        Layout const&...    layout
         )
 {
     switch (filter_mode)
@@ -52,7 +55,8 @@ inline ReturnT choose_filter(
                 tex,
                 coord,
                 texsize,
-                address_mode
+                address_mode,
+                layout...
                 );
 
     case visionaray::Linear:
@@ -62,7 +66,8 @@ inline ReturnT choose_filter(
                 tex,
                 coord,
                 texsize,
-                address_mode
+                address_mode,
+                layout...
                 );
 
     case visionaray::BSpline:
@@ -72,7 +77,8 @@ inline ReturnT choose_filter(
                 tex,
                 coord,
                 texsize,
-                address_mode
+                address_mode,
+                layout...
                 );
 
     case visionaray::CardinalSpline:
@@ -86,7 +92,8 @@ inline ReturnT choose_filter(
                 cspline::w0_func(),
                 cspline::w1_func(),
                 cspline::w2_func(),
-                cspline::w3_func()
+                cspline::w3_func(),
+                layout...
                 );
 
     }
@@ -93,6 +93,46 @@ inline T index(T x, T y, T z, vector<3, T> texsize)
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Storage layouts of 3D textures, passed to the 3D filters to compute voxel indices
+//
+// row_major_layout: x varies fastest, then y, then z
+// bricked_layout: bricks of 8^3 voxels are stored consecutively in row major order, voxels
+// inside a brick are also row major. Trilinear fetches mostly touch a single brick, i.e. one
+// or two cache lines instead of up to four distant ones. Storage is padded to whole bricks.
+//
+
+struct row_major_layout
+{
+};
+
+struct bricked_layout
+{
+    enum { log_brick_size = 3, brick_size = 1 << log_brick_size };
+};
+
+template <typename T>
+inline T index(T x, T y, T z, vector<3, T> texsize, row_major_layout /* */)
+{
+    return index(x, y, z, texsize);
+}
+
+template <typename T>
+inline T index(T x, T y, T z, vector<3, T> texsize, bricked_layout /* */)
+{
+    const int L = bricked_layout::log_brick_size;
+    const T mask(bricked_layout::brick_size - 1);
+
+    T num_bricks_x = (texsize[0] + mask) >> L;
+    T num_bricks_y = (texsize[1] + mask) >> L;
+
+    T brick = ((z >> L) * num_bricks_y + (y >> L)) * num_bricks_x + (x >> L);
+    T voxel = ((z & mask) << (2 * L)) + ((y & mask) << L) + (x & mask);
+
+    return (brick << (3 * L)) + voxel;
+}
+
+
 
 //-------------------------------------------------------------------------------------------------
 // Array access functions for scalar and SIMD types
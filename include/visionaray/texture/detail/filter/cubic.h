@@ -182,7 +182,8 @@ template <
     typename W0,
     typename W1,
     typename W2,
-    typename W3
+    typename W3,
+    typename Layout = row_major_layout
     >
 inline ReturnT cubic(
         ReturnT                                 /* */,
@@ -194,7 +195,8 @@ inline ReturnT cubic(
         W0                                      w0,
         W1                                      w1,
         W2                                      w2,
-        W3                                      w3
+        W3                                      w3,
+        Layout const&                           layout = Layout()
         )
 {
     auto coord1 = map_tex_coord(
@@ -235,7 +237,7 @@ inline ReturnT cubic(
     {
         return InternalT( point(
                 tex,
-                index(pos[i].x, pos[j].y, pos[k].z, texsize),
+                index(pos[i].x, pos[j].y, pos[k].z, texsize, layout),
                 ReturnT{}
                 ) );
     };
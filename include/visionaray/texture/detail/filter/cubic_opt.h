@@ -129,7 +129,8 @@ template <
     typename InternalT,
     typename TexelT,
     typename FloatT,
-    typename SizeT
+    typename SizeT,
+    typename Layout = row_major_layout
     >
 inline ReturnT cubic_opt(
         ReturnT                                 /* */,
@@ -137,7 +138,8 @@ inline ReturnT cubic_opt(
         TexelT const*                           tex,
         vector<3, FloatT>                       coord,
         vector<3, SizeT>                        texsize,
-        std::array<tex_address_mode, 3> const&  address_mode
+        std::array<tex_address_mode, 3> const&  address_mode,
+        Layout const&                           layout = Layout()
         )
 {
     bspline::w0_func w0;
@@ -177,15 +179,15 @@ inline ReturnT cubic_opt(
     auto h_101  = ( floorz + FloatT(1.5) + tmp101 ) / convert_to_float(texsize.z);
 
 
-    auto f_000  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_000, h_010, h_001), texsize, address_mode) );
-    auto f_100  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_100, h_010, h_001), texsize, address_mode) );
-    auto f_010  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_000, h_110, h_001), texsize, address_mode) );
-    auto f_110  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_100, h_110, h_001), texsize, address_mode) );
+    auto f_000  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_000, h_010, h_001), texsize, address_mode, layout) );
+    auto f_100  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_100, h_010, h_001), texsize, address_mode, layout) );
+    auto f_010  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_000, h_110, h_001), texsize, address_mode, layout) );
+    auto f_110  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_100, h_110, h_001), texsize, address_mode, layout) );
 
-    auto f_001  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_000, h_010, h_101), texsize, address_mode) );
-    auto f_101  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_100, h_010, h_101), texsize, address_mode) );
-    auto f_011  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_000, h_110 ,h_101), texsize, address_mode) );
-    auto f_111  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_100, h_110, h_101), texsize, address_mode) );
+    auto f_001  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_000, h_010, h_101), texsize, address_mode, layout) );
+    auto f_101  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_100, h_010, h_101), texsize, address_mode, layout) );
+    auto f_011  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_000, h_110 ,h_101), texsize, address_mode, layout) );
+    auto f_111  = InternalT( linear(ReturnT{}, InternalT{}, tex, vector<3, FloatT>(h_100, h_110, h_101), texsize, address_mode, layout) );
 
     auto f_00   = g0(fracx) * f_000 + g1(fracx) * f_100;
     auto f_10   = g0(fracx) * f_010 + g1(fracx) * f_110;
@@ -128,7 +128,8 @@ template <
     typename InternalT,
     typename TexelT,
     typename FloatT,
-    typename SizeT
+    typename SizeT,
+    typename Layout = row_major_layout
     >
 inline ReturnT linear(
         ReturnT                                 /* */,
@@ -136,7 +137,8 @@ inline ReturnT linear(
         TexelT const*                           tex,
         vector<3, FloatT>                       coord,
         vector<3, SizeT>                        texsize,
-        std::array<tex_address_mode, 3> const&  address_mode
+        std::array<tex_address_mode, 3> const&  address_mode,
+        Layout const&                           layout = Layout()
         )
 {
     auto coord1 = map_tex_coord(
@@ -156,14 +158,14 @@ inline ReturnT linear(
 
     InternalT samples[8] =
     {
-        InternalT( point(tex, index( lo.x, lo.y, lo.z, texsize ), ReturnT{}) ),
-        InternalT( point(tex, index( hi.x, lo.y, lo.z, texsize ), ReturnT{}) ),
-        InternalT( point(tex, index( lo.x, hi.y, lo.z, texsize ), ReturnT{}) ),
-        InternalT( point(tex, index( hi.x, hi.y, lo.z, texsize ), ReturnT{}) ),
-        InternalT( point(tex, index( lo.x, lo.y, hi.z, texsize ), ReturnT{}) ),
-        InternalT( point(tex, index( hi.x, lo.y, hi.z, texsize ), ReturnT{}) ),
-        InternalT( point(tex, index( lo.x, hi.y, hi.z, texsize ), ReturnT{}) ),
-        InternalT( point(tex, index( hi.x, hi.y, hi.z, texsize ), ReturnT{}) )
+        InternalT( point(tex, index( lo.x, lo.y, lo.z, texsize, layout ), ReturnT{}) ),
+        InternalT( point(tex, index( hi.x, lo.y, lo.z, texsize, layout ), ReturnT{}) ),
+        InternalT( point(tex, index( lo.x, hi.y, lo.z, texsize, layout ), ReturnT{}) ),
+        InternalT( point(tex, index( hi.x, hi.y, lo.z, texsize, layout ), ReturnT{}) ),
+        InternalT( point(tex, index( lo.x, lo.y, hi.z, texsize, layout ), ReturnT{}) ),
+        InternalT( point(tex, index( hi.x, lo.y, hi.z, texsize, layout ), ReturnT{}) ),
+        InternalT( point(tex, index( lo.x, hi.y, hi.z, texsize, layout ), ReturnT{}) ),
+        InternalT( point(tex, index( hi.x, hi.y, hi.z, texsize, layout ), ReturnT{}) )
     };
 
 
@@ -83,7 +83,8 @@ template <
     typename InternalT,
     typename TexelT,
     typename FloatT,
-    typename SizeT
+    typename SizeT,
+    typename Layout = row_major_layout
     >
 inline ReturnT nearest(
         ReturnT                                 /* */,
@@ -91,14 +92,15 @@ inline ReturnT nearest(
         TexelT const*                           tex,
         vector<3, FloatT>                       coord,
         vector<3, SizeT>                        texsize,
-        std::array<tex_address_mode, 3> const&  address_mode
+        std::array<tex_address_mode, 3> const&  address_mode,
+        Layout const&                           layout = Layout()
         )
 {
     coord = map_tex_coord(coord, texsize, address_mode);
 
     auto lo = convert_to_int(coord * convert_to_float(texsize));
 
-    auto idx = index(lo[0], lo[1], lo[2], texsize);
+    auto idx = index(lo[0], lo[1], lo[2], texsize, layout);
     return point(tex, idx, ReturnT{});
 }
 
@@ -0,0 +1,348 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_TEXTURE_DETAIL_MIPMAP_H
+#define VSNRAY_TEXTURE_DETAIL_MIPMAP_H 1
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include <visionaray/detail/parallel_for.h>
+#include <visionaray/math/simd/simd.h>
+#include <visionaray/math/vector.h>
+
+namespace visionaray
+{
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Mip level layout
+//
+// Level 0 is the texture itself, levels 1..N-1 are stored consecutively in a second buffer.
+// Level l has size max(1, w >> l) x max(1, h >> l).
+//
+
+inline size_t mip_level_size(size_t size, unsigned level)
+{
+    return std::max(size >> level, size_t(1));
+}
+
+inline unsigned num_mip_levels(size_t width, size_t height)
+{
+    unsigned result = 1;
+
+    for (size_t s = std::max(width, height); s > 1; s >>= 1)
+    {
+        ++result;
+    }
+
+    return result;
+}
+
+inline unsigned num_mip_levels(size_t width, size_t height, size_t depth)
+{
+    return num_mip_levels(std::max(width, height), depth);
+}
+
+// Number of texels in levels 1..num_levels-1
+inline size_t mip_chain_size(size_t width, size_t height, unsigned num_levels)
+{
+    size_t result = 0;
+
+    for (unsigned l = 1; l < num_levels; ++l)
+    {
+        result += mip_level_size(width, l) * mip_level_size(height, l);
+    }
+
+    return result;
+}
+
+inline size_t mip_chain_size(size_t width, size_t height, size_t depth, unsigned num_levels)
+{
+    size_t result = 0;
+
+    for (unsigned l = 1; l < num_levels; ++l)
+    {
+        result += mip_level_size(width, l) * mip_level_size(height, l) * mip_level_size(depth, l);
+    }
+
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Type to accumulate filtered texels in
+//
+
+template <typename T>
+struct mip_accum_type
+{
+    using type = float;
+};
+
+template <size_t Dim, typename T>
+struct mip_accum_type<vector<Dim, T>>
+{
+    using type = vector<Dim, float>;
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Box filter weights along one axis
+//
+// Destination texel i covers the source interval [i * s, (i + 1) * s) with s = src / dst.
+// For even sizes that's two texels with weight 1/2, odd sizes also cover parts of a third.
+//
+
+struct box_footprint
+{
+    int   first;
+    int   count;
+    float weights[3];
+};
+
+inline box_footprint make_box_footprint(int i, int src_size, int dst_size)
+{
+    box_footprint result;
+
+    if (src_size == 1)
+    {
+        result.first = 0;
+        result.count = 1;
+        result.weights[0] = 1.0f;
+        return result;
+    }
+
+    float s = static_cast<float>(src_size) / dst_size;
+    float a = i * s;
+    float b = (i + 1) * s;
+
+    result.first = static_cast<int>(a);
+    result.count = std::min(static_cast<int>(std::ceil(b)), src_size) - result.first;
+    result.count = std::min(result.count, 3);
+
+    for (int j = 0; j < result.count; ++j)
+    {
+        float lo = std::max(a, static_cast<float>(result.first + j));
+        float hi = std::min(b, static_cast<float>(result.first + j + 1));
+        result.weights[j] = (hi - lo) / s;
+    }
+
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Downsample one row of a mip level
+//
+
+template <typename T>
+inline void downsample_row(
+        T*          dst,
+        T const*    src,
+        int         y,
+        int         src_width,
+        int         src_height,
+        int         dst_width,
+        int         dst_height
+        )
+{
+    using A = typename mip_accum_type<T>::type;
+
+    auto fy = make_box_footprint(y, src_height, dst_height);
+
+    for (int x = 0; x < dst_width; ++x)
+    {
+        auto fx = make_box_footprint(x, src_width, dst_width);
+
+        A sum(0.0f);
+
+        for (int j = 0; j < fy.count; ++j)
+        {
+            T const* row = src + static_cast<size_t>(fy.first + j) * src_width;
+
+            for (int i = 0; i < fx.count; ++i)
+            {
+                sum += A(row[fx.first + i]) * (fx.weights[i] * fy.weights[j]);
+            }
+        }
+
+        dst[static_cast<size_t>(y) * dst_width + x] = T(sum);
+    }
+}
+
+// RGBA32F, even sizes: average 2x2 blocks with SIMD
+inline void downsample_row(
+        vector<4, float>*       dst,
+        vector<4, float> const* src,
+        int                     y,
+        int                     src_width,
+        int                     src_height,
+        int                     dst_width,
+        int                     dst_height
+        )
+{
+    if (src_width != 2 * dst_width || src_height != 2 * dst_height)
+    {
+        downsample_row<vector<4, float>>(dst, src, y, src_width, src_height, dst_width, dst_height);
+        return;
+    }
+
+    vector<4, float> const* row0 = src + static_cast<size_t>(2 * y) * src_width;
+    vector<4, float> const* row1 = row0 + src_width;
+
+    for (int x = 0; x < dst_width; ++x)
+    {
+        simd::float4 sum = simd::float4(row0[2 * x].data())
+                         + simd::float4(row0[2 * x + 1].data())
+                         + simd::float4(row1[2 * x].data())
+                         + simd::float4(row1[2 * x + 1].data());
+
+        store(dst[static_cast<size_t>(y) * dst_width + x].data(), sum * simd::float4(0.25f));
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Generate levels 1..num_levels-1 from level 0, parallelize over rows if pool is not null
+//
+
+template <typename T>
+inline void generate_mip_chain(
+        T*              chain,
+        T const*        level0,
+        size_t          width,
+        size_t          height,
+        unsigned        num_levels,
+        thread_pool*    pool
+        )
+{
+    T const* src = level0;
+    T* dst = chain;
+
+    for (unsigned l = 1; l < num_levels; ++l)
+    {
+        int src_width  = static_cast<int>(mip_level_size(width, l - 1));
+        int src_height = static_cast<int>(mip_level_size(height, l - 1));
+        int dst_width  = static_cast<int>(mip_level_size(width, l));
+        int dst_height = static_cast<int>(mip_level_size(height, l));
+
+        auto func = [=](range1d<int> const& r)
+        {
+            for (int y = r.begin(); y != r.end(); ++y)
+            {
+                downsample_row(dst, src, y, src_width, src_height, dst_width, dst_height);
+            }
+        };
+
+        optional_parallel_for(dst_height >= 16 ? pool : nullptr, tiled_range1d<int>(0, dst_height, 8), func);
+
+        src = dst;
+        dst += static_cast<size_t>(dst_width) * dst_height;
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Downsample one slice of a 3D mip level
+//
+
+template <typename T>
+inline void downsample_slice(
+        T*                          dst,
+        T const*                    src,
+        int                         z,
+        vector<3, int> const&       src_size,
+        vector<3, int> const&       dst_size
+        )
+{
+    using A = typename mip_accum_type<T>::type;
+
+    auto fz = make_box_footprint(z, src_size.z, dst_size.z);
+
+    for (int y = 0; y < dst_size.y; ++y)
+    {
+        auto fy = make_box_footprint(y, src_size.y, dst_size.y);
+
+        for (int x = 0; x < dst_size.x; ++x)
+        {
+            auto fx = make_box_footprint(x, src_size.x, dst_size.x);
+
+            A sum(0.0f);
+
+            for (int k = 0; k < fz.count; ++k)
+            {
+                for (int j = 0; j < fy.count; ++j)
+                {
+                    T const* row = src + (static_cast<size_t>(fz.first + k) * src_size.y + fy.first + j) * src_size.x;
+
+                    for (int i = 0; i < fx.count; ++i)
+                    {
+                        sum += A(row[fx.first + i]) * (fx.weights[i] * fy.weights[j] * fz.weights[k]);
+                    }
+                }
+            }
+
+            dst[(static_cast<size_t>(z) * dst_size.y + y) * dst_size.x + x] = T(sum);
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Generate 3D levels 1..num_levels-1 from row major level 0, parallelize over slices if pool
+// is not null
+//
+
+template <typename T>
+inline void generate_mip_chain(
+        T*              chain,
+        T const*        level0,
+        size_t          width,
+        size_t          height,
+        size_t          depth,
+        unsigned        num_levels,
+        thread_pool*    pool
+        )
+{
+    T const* src = level0;
+    T* dst = chain;
+
+    for (unsigned l = 1; l < num_levels; ++l)
+    {
+        vector<3, int> src_size(
+                static_cast<int>(mip_level_size(width, l - 1)),
+                static_cast<int>(mip_level_size(height, l - 1)),
+                static_cast<int>(mip_level_size(depth, l - 1))
+                );
+
+        vector<3, int> dst_size(
+                static_cast<int>(mip_level_size(width, l)),
+                static_cast<int>(mip_level_size(height, l)),
+                static_cast<int>(mip_level_size(depth, l))
+                );
+
+        auto func = [=](range1d<int> const& r)
+        {
+            for (int z = r.begin(); z != r.end(); ++z)
+            {
+                downsample_slice(dst, src, z, src_size, dst_size);
+            }
+        };
+
+        optional_parallel_for(dst_size.z >= 4 ? pool : nullptr, tiled_range1d<int>(0, dst_size.z, 1), func);
+
+        src = dst;
+        dst += static_cast<size_t>(dst_size.x) * dst_size.y * dst_size.z;
+    }
+}
+
+} // detail
+} // visionaray
+
+#endif // VSNRAY_TEXTURE_DETAIL_MIPMAP_H
@@ -6,10 +6,16 @@
 #ifndef VSNRAY_TEXTURE_DETAIL_PREFILTER_H
 #define VSNRAY_TEXTURE_DETAIL_PREFILTER_H 1
 
+#include <algorithm>
+#include <cstddef>
 #include <limits>
 #include <stdexcept>
 
+#include <visionaray/detail/parallel_for.h>
 #include <visionaray/math/detail/math.h>
+#include <visionaray/math/simd/simd.h>
+#include <visionaray/math/unorm.h>
+#include <visionaray/aligned_vector.h>
 
 #include "texture1d.h"
 #include "texture2d.h"
@@ -90,9 +96,228 @@ inline void convert_to_bspline_coeffs(short* c, size_t len, size_t stride)
 
 }
 
+
+//-------------------------------------------------------------------------------------------------
+// Convert voxels to and from float
+//
+
+inline float prefilter_load(float const& voxel)
+{
+    return voxel;
+}
+
+inline float prefilter_load(unorm<16> const& voxel)
+{
+    return static_cast<float>(voxel);
+}
+
+inline void prefilter_store(float& voxel, float value)
+{
+    voxel = value;
+}
+
+// Coefficients outside [0,1] saturate
+inline void prefilter_store(unorm<16>& voxel, float value)
+{
+    voxel = unorm<16>(value);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Convert up to four lines at once to B-spline coefficients, one line per SIMD lane
+//
+// Line l starts at first + l * lane_stride, its samples are stride elements apart. Same
+// recursive filters as convert_to_bspline_coeffs(), evaluated in float in buf.
+//
+
+template <typename T>
+inline void convert_to_bspline_coeffs(
+        T*              first,
+        size_t          len,
+        size_t          stride,
+        size_t          lane_stride,
+        int             lanes,
+        simd::float4*   buf
+        )
+{
+    using F = simd::float4;
+
+    for (size_t k = 0; k < len; ++k)
+    {
+        simd::aligned_array_t<F> v = {};
+
+        for (int l = 0; l < lanes; ++l)
+        {
+            v[l] = prefilter_load(first[k * stride + l * lane_stride]);
+        }
+
+        buf[k] = F(v);
+    }
+
+    F const pole(Pole);
+    F const lambda(6.0f);
+
+    // causal
+
+    size_t const Horizon = std::min<size_t>(12, len);
+
+    F zk = pole;
+    F sum = buf[0];
+
+    for (size_t k = 0; k < Horizon; ++k)
+    {
+        sum += zk * buf[k];
+        zk *= pole;
+    }
+
+    buf[0] = lambda * sum;
+
+    for (size_t k = 1; k < len; ++k)
+    {
+        buf[k] = lambda * buf[k] + pole * buf[k - 1];
+    }
+
+    // anticausal
+
+    buf[len - 1] = (pole / (pole - F(1.0f))) * buf[len - 1];
+
+    for (ptrdiff_t k = len - 2; 0 <= k; --k)
+    {
+        buf[k] = pole * (buf[k + 1] - buf[k]);
+    }
+
+    for (size_t k = 0; k < len; ++k)
+    {
+        simd::aligned_array_t<F> v;
+        store(v, buf[k]);
+
+        for (int l = 0; l < lanes; ++l)
+        {
+            prefilter_store(first[k * stride + l * lane_stride], v[l]);
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Filter groups of lines, groups are independent and processed in parallel if pool is not null
+//
+// group(g, first, lanes) returns the first voxel and the number of lines of group g.
+//
+
+template <typename T, typename Group>
+inline void convert_line_groups(
+        thread_pool*    pool,
+        int             num_groups,
+        size_t          len,
+        size_t          stride,
+        size_t          lane_stride,
+        Group           group
+        )
+{
+    if (len < 2)
+    {
+        return;
+    }
+
+    auto func = [&](range1d<int> const& r)
+    {
+        aligned_vector<simd::float4> buf(len);
+
+        for (int g = r.begin(); g != r.end(); ++g)
+        {
+            T* first = nullptr;
+            int lanes = 0;
+            group(g, first, lanes);
+
+            convert_to_bspline_coeffs(first, len, stride, lane_stride, lanes, buf.data());
+        }
+    };
+
+    optional_parallel_for(pool, tiled_range1d<int>(0, num_groups, 16), func);
+}
+
+template <typename T>
+inline void convert_for_bspline_interpol_impl(
+        T*              data,
+        size_t          width,
+        size_t          height,
+        size_t          depth,
+        thread_pool*    pool
+        )
+{
+    // x, four consecutive rows per group
+    size_t rows = height * depth;
+
+    convert_line_groups<T>(pool, static_cast<int>(div_up(rows, size_t(4))), width, 1, width,
+        [&](int g, T*& first, int& lanes)
+        {
+            size_t row = static_cast<size_t>(g) * 4;
+            first = data + row * width;
+            lanes = static_cast<int>(std::min(rows - row, size_t(4)));
+        });
+
+    // y and z, four consecutive columns per group
+    size_t groups_x = div_up(width, size_t(4));
+
+    convert_line_groups<T>(pool, static_cast<int>(groups_x * depth), height, width, 1,
+        [&](int g, T*& first, int& lanes)
+        {
+            size_t z = g / groups_x;
+            size_t x = (g % groups_x) * 4;
+            first = data + z * width * height + x;
+            lanes = static_cast<int>(std::min(width - x, size_t(4)));
+        });
+
+    convert_line_groups<T>(pool, static_cast<int>(groups_x * height), depth, width * height, 1,
+        [&](int g, T*& first, int& lanes)
+        {
+            size_t y = g / groups_x;
+            size_t x = (g % groups_x) * 4;
+            first = data + y * width + x;
+            lanes = static_cast<int>(std::min(width - x, size_t(4)));
+        });
+}
+
 } // detail
 
 
+//-------------------------------------------------------------------------------------------------
+// Convert voxels in place to B-spline coefficients
+//
+// Sampling the coefficients with BSpline filtering interpolates the original voxels. data
+// holds width x height x depth voxels in row major order, use depth = 1 for 2D and
+// height = depth = 1 for 1D data. Supports float and unorm<16> voxels. Filters run in
+// float, unorm<16> coefficients saturate to [0,1]. Four lines are filtered per SIMD vector.
+//
+// Usage:
+//
+//  convert_for_bspline_interpol(voxels.data(), w, h, d, pool);
+//
+//  texture<float, 3> volume(w, h, d);
+//  volume.reset(voxels.data());
+//  volume.set_filter_mode(BSpline);
+//
+
+template <typename T>
+inline void convert_for_bspline_interpol(T* data, size_t width, size_t height, size_t depth)
+{
+    detail::convert_for_bspline_interpol_impl(data, width, height, depth, nullptr);
+}
+
+// Parallelize over lines
+template <typename T>
+inline void convert_for_bspline_interpol(
+        T*              data,
+        size_t          width,
+        size_t          height,
+        size_t          depth,
+        thread_pool&    pool
+        )
+{
+    detail::convert_for_bspline_interpol_impl(data, width, height, depth, &pool);
+}
+
 template <typename T>
 inline void convert_for_bspline_interpol(texture_ref<T, 1>* tex)
 {
@@ -196,6 +196,64 @@ inline auto tex2D_impl(Tex const& tex, vector<2, FloatT> coord)
             );
 }
 
+
+
+//-------------------------------------------------------------------------------------------------
+// tex2D() with level of detail, trilinear interpolation between the two nearest mip levels
+//
+
+template <typename Tex, typename FloatT>
+inline auto tex2D_level(Tex const& tex, vector<2, FloatT> const& coord, unsigned level)
+    -> decltype( tex2D_impl(tex, coord) )
+{
+    vector<2, int> texsize(
+            static_cast<int>(tex.level_width(level)),
+            static_cast<int>(tex.level_height(level))
+            );
+
+    return tex2D_impl_expand_types(
+            tex.level_data(level),
+            coord,
+            texsize,
+            tex.get_filter_mode(),
+            tex.get_address_mode()
+            );
+}
+
+template <
+    typename Tex,
+    typename FloatT,
+    typename = typename std::enable_if<!simd::is_simd_vector<FloatT>::value>::type
+    >
+inline auto tex2D_lod_impl(Tex const& tex, vector<2, FloatT> const& coord, FloatT lod)
+    -> decltype( tex2D_impl(tex, coord) )
+{
+    static_assert(Tex::dimensions == 2, "Incompatible texture type");
+
+    using return_type = decltype( tex2D_impl(tex, coord) );
+
+    FloatT max_lod(tex.num_levels() - 1);
+
+    // Also catches NaN
+    if (!(lod > FloatT(0.0)))
+    {
+        return tex2D_level(tex, coord, 0);
+    }
+
+    if (lod >= max_lod)
+    {
+        return tex2D_level(tex, coord, tex.num_levels() - 1);
+    }
+
+    auto level = static_cast<unsigned>(lod);
+    FloatT frac = lod - FloatT(level);
+
+    auto s0 = tex2D_level(tex, coord, level);
+    auto s1 = tex2D_level(tex, coord, level + 1);
+
+    return return_type(s0 * (FloatT(1.0) - frac) + s1 * frac);
+}
+
 } // detail
 } // visionaray
 
@@ -34,6 +34,7 @@ namespace detail
 template <
     typename T,
     typename FloatT,
+    typename Layout,
     typename = typename std::enable_if<std::is_floating_point<FloatT>::value>::type,
     typename = typename std::enable_if<!simd::is_simd_vector<FloatT>::value>::type
     >
@@ -42,7 +43,8 @@ inline T tex3D_impl_expand_types(
         vector<3, FloatT> const&                coord,
         vector<3, int> const&                   texsize,
         tex_filter_mode                         filter_mode,
-        std::array<tex_address_mode, 3> const&  address_mode
+        std::array<tex_address_mode, 3> const&  address_mode,
+        Layout const&                           layout
         )
 {
     using return_type   = T;
@@ -55,7 +57,8 @@ inline T tex3D_impl_expand_types(
             coord,
             texsize,
             filter_mode,
-            address_mode
+            address_mode,
+            layout
             );
 }
 
@@ -63,6 +66,7 @@ template <
     size_t Dim,
     typename T,
     typename FloatT,
+    typename Layout,
     typename = typename std::enable_if<std::is_floating_point<FloatT>::value>::type,
     typename = typename std::enable_if<!simd::is_simd_vector<FloatT>::value>::type
     >
@@ -71,7 +75,8 @@ inline vector<Dim, T> tex3D_impl_expand_types(
         vector<3, FloatT> const&                coord,
         vector<3, int> const&                   texsize,
         tex_filter_mode                         filter_mode,
-        std::array<tex_address_mode, 3> const&  address_mode
+        std::array<tex_address_mode, 3> const&  address_mode,
+        Layout const&                           layout
         )
 {
     using return_type   = vector<Dim, T>;
@@ -84,7 +89,8 @@ inline vector<Dim, T> tex3D_impl_expand_types(
             coord,
             texsize,
             filter_mode,
-            address_mode
+            address_mode,
+            layout
             );
 }
 
@@ -94,6 +100,7 @@ inline vector<Dim, T> tex3D_impl_expand_types(
 template <
     unsigned Bits,
     typename FloatT,
+    typename Layout,
     typename = typename std::enable_if<std::is_floating_point<FloatT>::value>::type,
     typename = typename std::enable_if<!simd::is_simd_vector<FloatT>::value>::type
     >
@@ -102,7 +109,8 @@ inline FloatT tex3D_impl_expand_types(
         vector<3, FloatT> const&                coord,
         vector<3, int> const&                   texsize,
         tex_filter_mode                         filter_mode,
-        std::array<tex_address_mode, 3> const&  address_mode
+        std::array<tex_address_mode, 3> const&  address_mode,
+        Layout const&                           layout
         )
 {
     using return_type   = int;
@@ -117,7 +125,8 @@ inline FloatT tex3D_impl_expand_types(
             coord,
             texsize,
             filter_mode,
-            address_mode
+            address_mode,
+            layout
             );
 
     // normalize only once upon return
@@ -130,6 +139,7 @@ inline FloatT tex3D_impl_expand_types(
 template <
     typename T,
     typename FloatT,
+    typename Layout,
     typename = typename std::enable_if<!std::is_integral<T>::value>::type,
     typename = typename std::enable_if<simd::is_simd_vector<FloatT>::value>::type
     >
@@ -138,7 +148,8 @@ inline FloatT tex3D_impl_expand_types(
         vector<3, FloatT> const&                    coord,
         vector<3, simd::int_type_t<FloatT>> const&  texsize,
         tex_filter_mode                             filter_mode,
-        std::array<tex_address_mode, 3> const&      address_mode
+        std::array<tex_address_mode, 3> const&      address_mode,
+        Layout const&                               layout
         )
 {
     using return_type   = FloatT;
@@ -151,7 +162,8 @@ inline FloatT tex3D_impl_expand_types(
             coord,
             texsize,
             filter_mode,
-            address_mode
+            address_mode,
+            layout
             );
 }
 
@@ -161,6 +173,7 @@ inline FloatT tex3D_impl_expand_types(
 template <
     unsigned Bits,
     typename FloatT,
+    typename Layout,
     typename = typename std::enable_if<simd::is_simd_vector<FloatT>::value>::type
     >
 inline FloatT tex3D_impl_expand_types(
@@ -168,7 +181,8 @@ inline FloatT tex3D_impl_expand_types(
         vector<3, FloatT> const&                    coord,
         vector<3, simd::int_type_t<FloatT>> const&  texsize,
         tex_filter_mode                             filter_mode,
-        std::array<tex_address_mode, 3> const&      address_mode
+        std::array<tex_address_mode, 3> const&      address_mode,
+        Layout const&                               layout
         )
 {
     using return_type   = simd::int_type_t<FloatT>;
@@ -183,7 +197,8 @@ inline FloatT tex3D_impl_expand_types(
             coord,
             texsize,
             filter_mode,
-            address_mode
+            address_mode,
+            layout
             );
 
     // normalize only once upon return
@@ -196,6 +211,7 @@ inline FloatT tex3D_impl_expand_types(
 template <
     typename T,
     typename FloatT,
+    typename Layout,
     typename = typename std::enable_if<std::is_integral<T>::value>::type,
     typename = typename std::enable_if<simd::is_simd_vector<FloatT>::value>::type
     >
@@ -204,7 +220,8 @@ inline simd::int_type_t<FloatT> tex3D_impl_expand_types(
         vector<3, FloatT> const&                    coord,
         vector<3, simd::int_type_t<FloatT>> const&  texsize,
         tex_filter_mode                             filter_mode,
-        std::array<tex_address_mode, 3> const&      address_mode
+        std::array<tex_address_mode, 3> const&      address_mode,
+        Layout const&                               layout
         )
 {
     using return_type   = simd::int_type_t<FloatT>;
@@ -217,7 +234,8 @@ inline simd::int_type_t<FloatT> tex3D_impl_expand_types(
             coord,
             texsize,
             filter_mode,
-            address_mode
+            address_mode,
+            layout
             );
 }
 
@@ -233,7 +251,8 @@ inline auto tex3D_impl(Tex const& tex, vector<3, FloatT> coord)
             coord,
             vector<3, decltype(convert_to_int(std::declval<FloatT>()))>(),
             tex.get_filter_mode(),
-            tex.get_address_mode()
+            tex.get_address_mode(),
+            row_major_layout{}
             ) )
 {
     static_assert(Tex::dimensions == 3, "Incompatible texture type");
@@ -246,15 +265,94 @@ inline auto tex3D_impl(Tex const& tex, vector<3, FloatT> coord)
             static_cast<int>(tex.depth())
             );
 
+    if (tex.get_storage_layout() == Bricked)
+    {
+        return tex3D_impl_expand_types(
+                tex.data(),
+                coord,
+                texsize,
+                tex.get_filter_mode(),
+                tex.get_address_mode(),
+                bricked_layout{}
+                );
+    }
+
     return tex3D_impl_expand_types(
             tex.data(),
             coord,
             texsize,
             tex.get_filter_mode(),
-            tex.get_address_mode()
+            tex.get_address_mode(),
+            row_major_layout{}
+            );
+}
+
+
+
+//-------------------------------------------------------------------------------------------------
+// tex3D() with level of detail, quadrilinear interpolation between the two nearest mip levels
+//
+
+template <typename Tex, typename FloatT>
+inline auto tex3D_level(Tex const& tex, vector<3, FloatT> const& coord, unsigned level)
+    -> decltype( tex3D_impl(tex, coord) )
+{
+    if (level == 0)
+    {
+        return tex3D_impl(tex, coord);
+    }
+
+    // Coarser levels are always row major
+    vector<3, int> texsize(
+            static_cast<int>(tex.level_width(level)),
+            static_cast<int>(tex.level_height(level)),
+            static_cast<int>(tex.level_depth(level))
+            );
+
+    return tex3D_impl_expand_types(
+            tex.level_data(level),
+            coord,
+            texsize,
+            tex.get_filter_mode(),
+            tex.get_address_mode(),
+            row_major_layout{}
             );
 }
 
+template <
+    typename Tex,
+    typename FloatT,
+    typename = typename std::enable_if<!simd::is_simd_vector<FloatT>::value>::type
+    >
+inline auto tex3D_lod_impl(Tex const& tex, vector<3, FloatT> const& coord, FloatT lod)
+    -> decltype( tex3D_impl(tex, coord) )
+{
+    static_assert(Tex::dimensions == 3, "Incompatible texture type");
+
+    using return_type = decltype( tex3D_impl(tex, coord) );
+
+    FloatT max_lod(tex.num_levels() - 1);
+
+    // Also catches NaN
+    if (!(lod > FloatT(0.0)))
+    {
+        return tex3D_level(tex, coord, 0);
+    }
+
+    if (lod >= max_lod)
+    {
+        return tex3D_level(tex, coord, tex.num_levels() - 1);
+    }
+
+    auto level = static_cast<unsigned>(lod);
+    FloatT frac = lod - FloatT(level);
+
+    auto s0 = tex3D_level(tex, coord, level);
+    auto s1 = tex3D_level(tex, coord, level + 1);
+
+    return return_type(s0 * (FloatT(1.0) - frac) + s1 * frac);
+}
+
 } // detail
 } // visionaray
 
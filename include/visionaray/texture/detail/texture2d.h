@@ -8,6 +8,7 @@
 
 #include <cstddef>
 
+#include "mipmap.h"
 #include "texture_common.h"
 
 
@@ -40,6 +41,7 @@ public:
         : Base(rhs)
         , width_(rhs.width())
         , height_(rhs.height())
+        , num_levels_(rhs.num_levels())
     {
     }
 
@@ -62,10 +64,58 @@ public:
     size_t width() const { return width_; }
     size_t height() const { return height_; }
 
+
+    // Mip maps -------------------------------------------
+
+    // Build the mip chain with a box filter, call again after the texture data changed.
+    // Create texture_refs afterwards.
+    void generate_mipmaps()
+    {
+        generate_mipmaps_impl(nullptr);
+    }
+
+    void generate_mipmaps(thread_pool& pool)
+    {
+        generate_mipmaps_impl(&pool);
+    }
+
+    // 1 if the texture has no mip maps
+    unsigned num_levels() const { return num_levels_; }
+
+    size_t level_width(unsigned level) const { return detail::mip_level_size(width_, level); }
+    size_t level_height(unsigned level) const { return detail::mip_level_size(height_, level); }
+
+    value_type const* level_data(unsigned level) const
+    {
+        if (level == 0)
+        {
+            return base_type::data();
+        }
+
+        return base_type::mip_data() + detail::mip_chain_size(width_, height_, level);
+    }
+
 private:
 
+    void generate_mipmaps_impl(thread_pool* pool)
+    {
+        num_levels_ = detail::num_mip_levels(width_, height_);
+
+        base_type::mip_data_.resize(detail::mip_chain_size(width_, height_, num_levels_));
+
+        detail::generate_mip_chain(
+                base_type::mip_data_.data(),
+                base_type::data(),
+                width_,
+                height_,
+                num_levels_,
+                pool
+                );
+    }
+
     size_t width_;
     size_t height_;
+    unsigned num_levels_ = 1;
 
 };
 
@@ -6,13 +6,88 @@
 #ifndef VSNRAY_TEXTURE_DETAIL_TEXTURE3D_H
 #define VSNRAY_TEXTURE_DETAIL_TEXTURE3D_H 1
 
+#include <algorithm>
 #include <cstddef>
+#include <type_traits>
 
+#include <visionaray/math/detail/math.h>
+
+#include "filter/common.h"
+#include "mipmap.h"
 #include "texture_common.h"
 
 
 namespace visionaray
 {
+namespace detail
+{
+
+//-------------------------------------------------------------------------------------------------
+// Conversion between row major and bricked storage
+//
+
+inline size_t bricked_storage_size(size_t w, size_t h, size_t d)
+{
+    const size_t B = bricked_layout::brick_size;
+    return div_up(w, B) * div_up(h, B) * div_up(d, B) * B * B * B;
+}
+
+// Call func(row_major_offset, bricked_offset, count) for each contiguous run of voxels
+template <typename Func>
+inline void for_each_brick_row(size_t w, size_t h, size_t d, Func func)
+{
+    const size_t B = bricked_layout::brick_size;
+
+    size_t num_bricks_x = div_up(w, B);
+    size_t num_bricks_y = div_up(h, B);
+    size_t num_bricks_z = div_up(d, B);
+
+    size_t brick_offset = 0;
+
+    for (size_t bz = 0; bz < num_bricks_z; ++bz)
+    {
+        for (size_t by = 0; by < num_bricks_y; ++by)
+        {
+            for (size_t bx = 0; bx < num_bricks_x; ++bx)
+            {
+                size_t x = bx * B;
+                size_t count = std::min(B, w - x);
+
+                for (size_t z = bz * B; z < std::min(bz * B + B, d); ++z)
+                {
+                    for (size_t y = by * B; y < std::min(by * B + B, h); ++y)
+                    {
+                        size_t voxel = ((z % B) * B + (y % B)) * B;
+                        func((z * h + y) * w + x, brick_offset + voxel, count);
+                    }
+                }
+
+                brick_offset += B * B * B;
+            }
+        }
+    }
+}
+
+template <typename T>
+inline void row_major_to_bricked(T* dst, T const* src, size_t w, size_t h, size_t d)
+{
+    for_each_brick_row(w, h, d, [=](size_t row_major, size_t bricked, size_t count)
+    {
+        std::copy(src + row_major, src + row_major + count, dst + bricked);
+    });
+}
+
+template <typename T>
+inline void bricked_to_row_major(T* dst, T const* src, size_t w, size_t h, size_t d)
+{
+    for_each_brick_row(w, h, d, [=](size_t row_major, size_t bricked, size_t count)
+    {
+        std::copy(src + bricked, src + bricked + count, dst + row_major);
+    });
+}
+
+} // detail
+
 
 template <typename Base, typename T>
 class texture_iface<Base, T, 3> : public Base
@@ -42,17 +117,173 @@ public:
         , width_(rhs.width())
         , height_(rhs.height())
         , depth_(rhs.depth())
+        , num_levels_(rhs.num_levels())
+        , storage_layout_(rhs.get_storage_layout())
     {
     }
 
     value_type& operator()(size_t x, size_t y, size_t z)
     {
-        return base_type::data()[z * width_ * height_ + y * width_ + x];
+        return base_type::data()[voxel_index(x, y, z)];
     }
 
     value_type const& operator()(size_t x, size_t y, size_t z) const
     {
-        return base_type::data()[z * width_ * height_ + y * width_ + x];
+        return base_type::data()[voxel_index(x, y, z)];
+    }
+
+
+    // Storage layout -------------------------------------
+
+    // Textures reorder their data, texture refs assume that the data they point to
+    // already has the new layout
+    void set_storage_layout(tex_storage_layout layout)
+    {
+        set_storage_layout_impl(layout, owns_data{});
+    }
+
+    tex_storage_layout get_storage_layout() const
+    {
+        return storage_layout_;
+    }
+
+    // Textures convert row major data to the storage layout, texture refs reference data
+    // with the storage layout. The pixel format converting overloads expect row major data.
+    using Base::reset;
+
+    void reset(value_type const* data)
+    {
+        reset_impl(data, owns_data{});
+    }
+
+    void reset(
+            value_type const* data,
+            pixel_format format,
+            pixel_format internal_format
+            )
+    {
+        if (storage_layout_ == Bricked)
+        {
+            // Swizzle a row major copy, then reorder
+            aligned_vector<T> row_major(data, data + width_ * height_ * depth_);
+
+            if (format != internal_format)
+            {
+                swizzle(row_major.data(), internal_format, format, row_major.size());
+            }
+
+            reset_impl(row_major.data(), owns_data{});
+        }
+        else
+        {
+            Base::reset(data, format, internal_format);
+        }
+    }
+
+    template <typename U>
+    void reset(
+            U const* data,
+            pixel_format format,
+            pixel_format internal_format
+            )
+    {
+        if (storage_layout_ == Bricked)
+        {
+            aligned_vector<T> row_major(width_ * height_ * depth_);
+            swizzle(row_major.data(), internal_format, data, format, row_major.size());
+            reset_impl(row_major.data(), owns_data{});
+        }
+        else
+        {
+            Base::reset(data, format, internal_format);
+        }
+    }
+
+    template <typename U>
+    void reset(
+            U const* data,
+            pixel_format format,
+            pixel_format internal_format,
+            swizzle_hint hint
+            )
+    {
+        if (storage_layout_ == Bricked)
+        {
+            aligned_vector<T> row_major(width_ * height_ * depth_);
+            swizzle(row_major.data(), internal_format, data, format, row_major.size(), hint);
+            reset_impl(row_major.data(), owns_data{});
+        }
+        else
+        {
+            Base::reset(data, format, internal_format, hint);
+        }
+    }
+
+    // Convert large volumes in parallel on the threads of pool
+
+    void reset(
+            value_type const* data,
+            pixel_format format,
+            pixel_format internal_format,
+            thread_pool& pool
+            )
+    {
+        if (storage_layout_ == Bricked)
+        {
+            aligned_vector<T> row_major(data, data + width_ * height_ * depth_);
+
+            if (format != internal_format)
+            {
+                swizzle(row_major.data(), internal_format, format, row_major.size(), pool);
+            }
+
+            reset_impl(row_major.data(), owns_data{});
+        }
+        else
+        {
+            Base::reset(data, format, internal_format, pool);
+        }
+    }
+
+    template <typename U>
+    void reset(
+            U const* data,
+            pixel_format format,
+            pixel_format internal_format,
+            thread_pool& pool
+            )
+    {
+        if (storage_layout_ == Bricked)
+        {
+            aligned_vector<T> row_major(width_ * height_ * depth_);
+            swizzle(row_major.data(), internal_format, data, format, row_major.size(), pool);
+            reset_impl(row_major.data(), owns_data{});
+        }
+        else
+        {
+            Base::reset(data, format, internal_format, pool);
+        }
+    }
+
+    template <typename U>
+    void reset(
+            U const* data,
+            pixel_format format,
+            pixel_format internal_format,
+            swizzle_hint hint,
+            thread_pool& pool
+            )
+    {
+        if (storage_layout_ == Bricked)
+        {
+            aligned_vector<T> row_major(width_ * height_ * depth_);
+            swizzle(row_major.data(), internal_format, data, format, row_major.size(), hint, pool);
+            reset_impl(row_major.data(), owns_data{});
+        }
+        else
+        {
+            Base::reset(data, format, internal_format, hint, pool);
+        }
     }
 
 
@@ -65,11 +296,132 @@ public:
     size_t height() const { return height_; }
     size_t depth() const { return depth_; }
 
+
+    // Mip maps -------------------------------------------
+
+    // Build the volume pyramid with a box filter, call again after the texture data changed.
+    // Create texture_refs afterwards. Levels 1..N-1 are stored in row major order regardless
+    // of the storage layout.
+    void generate_mipmaps()
+    {
+        generate_mipmaps_impl(nullptr);
+    }
+
+    void generate_mipmaps(thread_pool& pool)
+    {
+        generate_mipmaps_impl(&pool);
+    }
+
+    // 1 if the texture has no mip maps
+    unsigned num_levels() const { return num_levels_; }
+
+    size_t level_width(unsigned level) const { return detail::mip_level_size(width_, level); }
+    size_t level_height(unsigned level) const { return detail::mip_level_size(height_, level); }
+    size_t level_depth(unsigned level) const { return detail::mip_level_size(depth_, level); }
+
+    value_type const* level_data(unsigned level) const
+    {
+        if (level == 0)
+        {
+            return base_type::data();
+        }
+
+        return base_type::mip_data() + detail::mip_chain_size(width_, height_, depth_, level);
+    }
+
 private:
 
+    void generate_mipmaps_impl(thread_pool* pool)
+    {
+        num_levels_ = detail::num_mip_levels(width_, height_, depth_);
+
+        base_type::mip_data_.resize(detail::mip_chain_size(width_, height_, depth_, num_levels_));
+
+        value_type const* level0 = base_type::data();
+        aligned_vector<T> row_major;
+
+        if (storage_layout_ == Bricked)
+        {
+            row_major.resize(width_ * height_ * depth_);
+            detail::bricked_to_row_major(row_major.data(), level0, width_, height_, depth_);
+            level0 = row_major.data();
+        }
+
+        detail::generate_mip_chain(
+                base_type::mip_data_.data(),
+                level0,
+                width_,
+                height_,
+                depth_,
+                num_levels_,
+                pool
+                );
+    }
+
+    using owns_data = std::is_same<Base, texture_base<T, 3>>;
+
+    size_t voxel_index(size_t x, size_t y, size_t z) const
+    {
+        if (storage_layout_ == Bricked)
+        {
+            vector<3, size_t> texsize(width_, height_, depth_);
+            return detail::index(x, y, z, texsize, detail::bricked_layout{});
+        }
+
+        return z * width_ * height_ + y * width_ + x;
+    }
+
+    void set_storage_layout_impl(tex_storage_layout layout, std::true_type /* owns data */)
+    {
+        if (layout == storage_layout_)
+        {
+            return;
+        }
+
+        if (layout == Bricked)
+        {
+            aligned_vector<T> bricked(detail::bricked_storage_size(width_, height_, depth_));
+            detail::row_major_to_bricked(bricked.data(), base_type::data_.data(), width_, height_, depth_);
+            base_type::data_.swap(bricked);
+        }
+        else
+        {
+            aligned_vector<T> row_major(width_ * height_ * depth_);
+            detail::bricked_to_row_major(row_major.data(), base_type::data_.data(), width_, height_, depth_);
+            base_type::data_.swap(row_major);
+        }
+
+        storage_layout_ = layout;
+    }
+
+    void set_storage_layout_impl(tex_storage_layout layout, std::false_type /* owns data */)
+    {
+        storage_layout_ = layout;
+    }
+
+    void reset_impl(value_type const* data, std::true_type /* owns data */)
+    {
+        if (storage_layout_ == Bricked)
+        {
+            detail::row_major_to_bricked(base_type::data_.data(), data, width_, height_, depth_);
+        }
+        else
+        {
+            Base::reset(data);
+        }
+    }
+
+    void reset_impl(value_type const* data, std::false_type /* owns data */)
+    {
+        Base::reset(data);
+    }
+
     size_t width_;
     size_t height_;
     size_t depth_;
+    unsigned num_levels_ = 1;
+
+    tex_storage_layout storage_layout_ = RowMajor;
 
 };
 
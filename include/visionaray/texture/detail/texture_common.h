@@ -120,10 +120,9 @@ public:
     {
         if (format != internal_format)
         {
-            // Swizzle in-place
-            aligned_vector<T> tmp(data, data + data_.size());
-            swizzle(tmp.data(), internal_format, format, tmp.size());
-            reset(tmp.data());
+            // Copy, then swizzle in-place
+            reset(data);
+            swizzle(data_.data(), internal_format, format, data_.size());
         }
         else
         {
@@ -139,10 +138,8 @@ public:
             pixel_format internal_format
             )
     {
-        // Copy to temporary array, then swizzle
-        aligned_vector<T> dst(data_.size());
-        swizzle(dst.data(), internal_format, data, format, dst.size());
-        reset(dst.data());
+        // Swizzle directly into texture memory
+        swizzle(data_.data(), internal_format, data, format, data_.size());
     }
 
     template <typename U>
@@ -153,10 +150,48 @@ public:
             swizzle_hint hint
             )
     {
-        // Copy with temporary array, hint about how to handle alpha
-        aligned_vector<T> dst(data_.size());
-        swizzle(dst.data(), internal_format, data, format, dst.size(), hint);
-        reset(dst.data());
+        // Swizzle directly into texture memory, hint about how to handle alpha
+        swizzle(data_.data(), internal_format, data, format, data_.size(), hint);
+    }
+
+    // Convert large textures in parallel on the threads of pool
+
+    void reset(
+            T const* data,
+            pixel_format format,
+            pixel_format internal_format,
+            thread_pool& pool
+            )
+    {
+        reset(data);
+
+        if (format != internal_format)
+        {
+            swizzle(data_.data(), internal_format, format, data_.size(), pool);
+        }
+    }
+
+    template <typename U>
+    void reset(
+            U const* data,
+            pixel_format format,
+            pixel_format internal_format,
+            thread_pool& pool
+            )
+    {
+        swizzle(data_.data(), internal_format, data, format, data_.size(), pool);
+    }
+
+    template <typename U>
+    void reset(
+            U const* data,
+            pixel_format format,
+            pixel_format internal_format,
+            swizzle_hint hint,
+            thread_pool& pool
+            )
+    {
+        swizzle(data_.data(), internal_format, data, format, data_.size(), hint, pool);
     }
 
     value_type const* data() const
@@ -164,9 +199,16 @@ public:
         return data_.data();
     }
 
+    // Mip levels 1..N-1, empty if the texture has no mip maps
+    value_type const* mip_data() const
+    {
+        return mip_data_.empty() ? nullptr : mip_data_.data();
+    }
+
 protected:
 
     aligned_vector<T> data_;
+    aligned_vector<T> mip_data_;
 
 };
 
@@ -191,6 +233,7 @@ public:
     texture_ref_base(texture_base<T, Dim> const& tex)
         : base_type(tex)
         , data_(tex.data())
+        , mip_data_(tex.mip_data())
     {
     }
 
@@ -204,9 +247,15 @@ public:
         return data_;
     }
 
+    T const* mip_data() const
+    {
+        return mip_data_;
+    }
+
 protected:
 
     T const* data_;
+    T const* mip_data_ = nullptr;
 
 };
 
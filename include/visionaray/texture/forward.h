@@ -34,6 +34,13 @@ enum tex_filter_mode
 };
 
 
+enum tex_storage_layout
+{
+    RowMajor = 0,
+    Bricked
+};
+
+
 template <typename T, size_t Dim>
 class texture_base;
 
@@ -48,6 +48,20 @@ inline auto tex2D(Tex const& tex, vector<2, FloatT> const& coord)
 }
 
 
+// Sample mip level lod (fractional levels are interpolated), lod is typically computed
+// from ray differentials. Textures without mip maps ignore lod.
+template <typename Tex, typename FloatT>
+inline auto tex2D(Tex const& tex, vector<2, FloatT> const& coord, FloatT lod)
+    -> decltype( detail::tex2D_lod_impl(tex, coord, lod) )
+{
+    static_assert(Tex::dimensions == 2, "Incompatible texture type");
+
+    assert(tex.get_normalized_coords() && "Unnormalized coordinates on CPU not implemented yet");
+
+    return detail::tex2D_lod_impl( tex, coord, lod );
+}
+
+
 template <typename Tex, typename FloatT>
 inline auto tex3D(Tex const& tex, vector<3, FloatT> const& coord)
     -> decltype( detail::tex3D_impl(tex, coord) )
@@ -60,6 +74,20 @@ inline auto tex3D(Tex const& tex, vector<3, FloatT> const& coord)
 }
 
 
+// Sample mip level lod (fractional levels are interpolated), lod is typically computed
+// from the footprint of a ray differential. Textures without mip maps ignore lod.
+template <typename Tex, typename FloatT>
+inline auto tex3D(Tex const& tex, vector<3, FloatT> const& coord, FloatT lod)
+    -> decltype( detail::tex3D_lod_impl(tex, coord, lod) )
+{
+    static_assert(Tex::dimensions == 3, "Incompatible texture type");
+
+    assert(tex.get_normalized_coords() && "Unnormalized coordinates on CPU not implemented yet");
+
+    return detail::tex3D_lod_impl( tex, coord, lod );
+}
+
+
 #ifdef __CUDACC__
 
 template <
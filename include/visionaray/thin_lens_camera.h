@@ -32,6 +32,19 @@ public:
     VSNRAY_FUNC
     R primary_ray(R /* */, Generator gen, T const& x, T const& y, T const& width, T const& height) const;
 
+    // Generate primary ray at (x,y) with differentials. The offset rays pass through the
+    // same point on the lens.
+    template <typename T, typename Generator>
+    VSNRAY_FUNC
+    basic_ray_differential<T> primary_ray(
+            basic_ray_differential<T>   /* */,
+            Generator                   gen,
+            T const&                    x,
+            T const&                    y,
+            T const&                    width,
+            T const&                    height
+            ) const;
+
 private:
 
     float lens_radius_;
@@ -6,6 +6,7 @@
 #ifndef VSNRAY_VARIANT_H
 #define VSNRAY_VARIANT_H 1
 
+#include <cstdint>
 #include <type_traits>
 
 #include "detail/macros.h"
@@ -78,6 +79,17 @@ template <unsigned I>
 using type_index = std::integral_constant<unsigned, I>;
 
 
+//-------------------------------------------------------------------------------------------------
+// Smallest unsigned type that can store the 1-based type index of N alternatives
+//
+
+template <unsigned N>
+using variant_tag = typename std::conditional<
+        (N < 256),
+        uint8_t,
+        typename std::conditional<(N < 65536), uint16_t, uint32_t>::type
+        >::type;
+
 
 //-------------------------------------------------------------------------------------------------
 // Recursive union storage
@@ -94,6 +106,10 @@ union variant_storage<T, Ts...>
     T element;
     variant_storage<Ts...> elementN;
 
+    // Uninitialized, alternatives are assigned. Also compiles for alternatives
+    // with default member initializers (non-trivial default constructors)
+    VSNRAY_FUNC variant_storage() {}
+
     // access
 
     VSNRAY_FUNC T& get(type_index<1>)
@@ -160,14 +176,63 @@ public:
             : nullptr;
     }
 
+    // 1-based index of the stored alternative
+    VSNRAY_FUNC unsigned which() const
+    {
+        return type_index_;
+    }
+
+    // Unchecked access to the alternative with 1-based index I
+    template <unsigned I>
+    VSNRAY_FUNC detail::type_at<I, Ts...>& get(detail::type_index<I> index)
+    {
+        return storage_.get(index);
+    }
+
+    template <unsigned I>
+    VSNRAY_FUNC detail::type_at<I, Ts...> const& get(detail::type_index<I> index) const
+    {
+        return storage_.get(index);
+    }
+
 private:
 
+    using tag_type = detail::variant_tag<sizeof...(Ts)>;
+
     detail::variant_storage<Ts...>  storage_;
-    unsigned                        type_index_;
+    tag_type                        type_index_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Test if T is a variant or derived from one (e.g. generic_primitive)
+//
 
+namespace detail
+{
+
+template <typename ...Ts>
+std::true_type is_variant_impl(variant<Ts...> const*);
+
+std::false_type is_variant_impl(...);
+
+} // detail
+
+template <typename T>
+struct is_variant : decltype(detail::is_variant_impl(static_cast<T const*>(nullptr)))
+{
 };
 
 
+//-------------------------------------------------------------------------------------------------
+// Visitor dispatch
+//
+// Variants with up to 16 alternatives dispatch with a single switch over the type tag,
+// which compilers lower to a jump table. Larger variants fall back to a linear chain of
+// type tests.
+//
+
 template <unsigned I, typename ...Ts>
 struct apply_visitor_impl;
 
@@ -203,13 +268,126 @@ struct apply_visitor_impl<0>
     }
 };
 
+namespace detail
+{
+
+enum { max_switch_alternatives = 16 };
+
+// Call visitor with alternative I, switch cases beyond the number of alternatives are empty
+template <unsigned I, bool Valid>
+struct visit_alternative
+{
+    template <typename Visitor, typename Variant>
+    VSNRAY_FUNC
+    static typename Visitor::return_type apply(Visitor const& visitor, Variant const& var)
+    {
+        return visitor(var.get(type_index<I>{}));
+    }
+};
+
+template <unsigned I>
+struct visit_alternative<I, false>
+{
+    template <typename Visitor, typename Variant>
+    VSNRAY_FUNC
+    static typename Visitor::return_type apply(Visitor const&, Variant const&)
+    {
+        return typename Visitor::return_type();
+    }
+};
+
+// Single alternative, no tag test
 template <typename Visitor, typename ...Ts>
 VSNRAY_FUNC
-typename Visitor::return_type apply_visitor(Visitor const& visitor, variant<Ts...> const& var)
+inline typename Visitor::return_type apply_visitor_switch(
+        Visitor const&                  visitor,
+        variant<Ts...> const&           var,
+        std::integral_constant<int, 1>  /* */
+        )
+{
+    return visitor(var.get(type_index<1>{}));
+}
+
+template <typename Visitor, typename ...Ts>
+VSNRAY_FUNC
+inline typename Visitor::return_type apply_visitor_switch(
+        Visitor const&                  visitor,
+        variant<Ts...> const&           var,
+        std::integral_constant<int, 2>  /* */
+        )
+{
+    enum { N = sizeof...(Ts) };
+
+#define VSNRAY_VARIANT_CASE(I)                                                  \
+    case I:                                                                     \
+        return visit_alternative<I, (I <= N)>::apply(visitor, var);
+
+    switch (var.which())
+    {
+    VSNRAY_VARIANT_CASE(1)
+    VSNRAY_VARIANT_CASE(2)
+    VSNRAY_VARIANT_CASE(3)
+    VSNRAY_VARIANT_CASE(4)
+    VSNRAY_VARIANT_CASE(5)
+    VSNRAY_VARIANT_CASE(6)
+    VSNRAY_VARIANT_CASE(7)
+    VSNRAY_VARIANT_CASE(8)
+    VSNRAY_VARIANT_CASE(9)
+    VSNRAY_VARIANT_CASE(10)
+    VSNRAY_VARIANT_CASE(11)
+    VSNRAY_VARIANT_CASE(12)
+    VSNRAY_VARIANT_CASE(13)
+    VSNRAY_VARIANT_CASE(14)
+    VSNRAY_VARIANT_CASE(15)
+    VSNRAY_VARIANT_CASE(16)
+    default:
+        return typename Visitor::return_type();
+    }
+
+#undef VSNRAY_VARIANT_CASE
+}
+
+// Many alternatives, linear search
+template <typename Visitor, typename ...Ts>
+VSNRAY_FUNC
+inline typename Visitor::return_type apply_visitor_switch(
+        Visitor const&                  visitor,
+        variant<Ts...> const&           var,
+        std::integral_constant<int, 3>  /* */
+        )
 {
     return apply_visitor_impl<sizeof...(Ts), Ts...>()(visitor, var);
 }
 
+} // detail
+
+template <typename Visitor, typename ...Ts>
+VSNRAY_FUNC
+typename Visitor::return_type apply_visitor(Visitor const& visitor, variant<Ts...> const& var)
+{
+    using strategy = std::integral_constant<
+            int,
+            sizeof...(Ts) == 1 ? 1 : sizeof...(Ts) <= detail::max_switch_alternatives ? 2 : 3
+            >;
+
+    return detail::apply_visitor_switch(visitor, var, strategy{});
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Visit a variant that is known to store a T, e.g. when all primitives of a BVH leaf have
+// the same type. Skips the type test altogether.
+//
+
+template <typename T, typename Visitor, typename ...Ts>
+VSNRAY_FUNC
+typename Visitor::return_type apply_visitor_as(Visitor const& visitor, variant<Ts...> const& var)
+{
+    static_assert(detail::index_of<T, Ts...>::value != 0, "Type is not an alternative of the variant");
+
+    return visitor(var.get(detail::type_index<detail::index_of<T, Ts...>::value>{}));
+}
+
 } // visionaray
 
 #endif // VSNRAY_VARIANT_H
@@ -0,0 +1,220 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_VOLUME_INTEGRATOR_H
+#define VSNRAY_VOLUME_INTEGRATOR_H 1
+
+#include <type_traits>
+
+#include "detail/macros.h"
+#include "math/simd/type_traits.h"
+#include "math/aabb.h"
+#include "math/ray.h"
+#include "math/vector.h"
+#include "texture/texture.h"
+#include "aligned_vector.h"
+#include "preintegration.h"
+#include "ray_differential.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Macrocell grid reference, pass to kernels
+//
+// Stores the value range of coarse cells of a volume texture and whether the current
+// transfer function maps any value in that range to a non-zero opacity. Cell (i,j,k) covers
+// the texture coordinates [i,i+1) * cell_size / width etc.
+//
+
+class macrocell_grid_ref
+{
+public:
+
+    VSNRAY_FUNC vec2 value_range(int x, int y, int z) const
+    {
+        return value_ranges[(z * dims.y + y) * dims.x + x];
+    }
+
+    VSNRAY_FUNC bool empty(int x, int y, int z) const
+    {
+        return active[(z * dims.y + y) * dims.x + x] == 0;
+    }
+
+public:
+
+    // Number of cells
+    vec3i                   dims;
+
+    // Cells per unit texture coordinate
+    vec3                    cells_per_texcoord;
+
+    // Minimum and maximum voxel value per cell
+    vec2 const*             value_ranges;
+
+    // Non-zero if the transfer function classifies the cell as visible
+    unsigned char const*    active;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Macrocell grid, build on the host after the volume changes, classify after the transfer
+// function changes
+//
+// The value range of a cell includes the voxels that the volume's filter reads from inside
+// the cell, widened by the overshoot of cardinal spline filtering. Classification assumes
+// that volume values are used as transfer function coordinates and that the transfer
+// function uses nearest or linear filtering with clamp address mode.
+//
+
+class macrocell_grid
+{
+public:
+
+    template <typename Texture>
+    void build(Texture const& volume, int cell_size = 8);
+
+    template <typename TransFunc>
+    void classify(TransFunc const& transfunc);
+
+    macrocell_grid_ref ref() const;
+
+private:
+
+    macrocell_grid_ref ref_;
+
+    aligned_vector<vec2> value_ranges_;
+    aligned_vector<unsigned char> active_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Direct volume rendering integrator
+//
+// Emission-absorption model with post-classification: samples the volume at equidistant
+// positions along the ray, classifies the samples with a 1D RGBA transfer function and
+// composites them front to back. Samples are taken at tnear + k * step_size, where tnear
+// is the entry point into the volume's bounding box. Macrocells that the transfer function
+// classifies as empty are skipped with a 3D DDA, this does not change the image.
+//
+// Ray differentials select the level of detail: with a mipmapped volume texture, each sample
+// reads the level whose voxels match the ray's pixel footprint at that distance, and the
+// step size grows with the voxel size of the level (step_size * 2^level). Opacities are
+// corrected for the larger steps. Macrocells are classified with the value ranges of the
+// finest level, so coarse samples close to empty cells may be skipped.
+//
+// With a pre-integration table (see preintegration.h), the integrator classifies the ray
+// segments between consecutive samples instead of the samples, which allows for larger
+// steps with high frequency transfer functions. Segments that end in a non-empty macrocell
+// are also composited, so skipping still doesn't change the image.
+//
+// Usage:
+//
+//  texture<float, 3> volume(w, h, d);
+//  volume.reset(data);
+//  volume.set_filter_mode(Linear);
+//  volume.set_address_mode(Clamp);
+//
+//  macrocell_grid cells;
+//  cells.build(volume);
+//  cells.classify(transfunc);
+//
+//  volume_integrator<float> integrator;
+//  integrator.set_volume(texture_ref<float, 3>(volume), cells.ref());
+//  integrator.set_transfunc(texture_ref<vec4, 1>(transfunc));
+//  integrator.set_bounds(bbox);
+//  integrator.step_size() = 0.01f;
+//
+//  // In the kernel, returns premultiplied RGBA
+//  auto color = integrator.integrate(ray, S(0.0), S(numeric_limits<float>::max()));
+//
+//  // Level of detail: call volume.generate_mipmaps() before creating the texture_ref
+//  // and integrate ray differentials
+//
+
+template <typename T, typename Volume = texture_ref<float, 3>>
+class volume_integrator
+{
+public:
+
+    using scalar_type = T;
+    using volume_type = Volume;
+
+public:
+
+    // Integrate over [tmin, tmax), clipped against the bounding box
+    VSNRAY_FUNC vector<4, T> integrate(basic_ray<T> const& ray, T tmin, T tmax) const;
+
+    template <
+        typename U,
+        typename = typename std::enable_if<simd::is_simd_vector<U>::value>::type
+        >
+    vector<4, U> integrate(basic_ray<U> const& ray, U const& tmin, U const& tmax) const;
+
+    // Select the level of detail from the ray's footprint, requires a mipmapped volume texture
+    VSNRAY_FUNC vector<4, T> integrate(basic_ray_differential<T> const& ray, T tmin, T tmax) const;
+
+    template <
+        typename U,
+        typename = typename std::enable_if<simd::is_simd_vector<U>::value>::type
+        >
+    vector<4, U> integrate(basic_ray_differential<U> const& ray, U const& tmin, U const& tmax) const;
+
+    void set_volume(Volume const& volume, macrocell_grid_ref const& cells);
+    void set_transfunc(texture_ref<vec4, 1> const& transfunc);
+    void set_bounds(aabb const& bounds);
+
+    // Classify segments with a pre-integration table built for the step size
+    void set_preintegration_table(texture_ref<vec4, 2> const& table);
+
+    // Distance between samples in world space
+    T& step_size() { return step_size_; }
+    VSNRAY_FUNC T const& step_size() const { return step_size_; }
+
+    // Adjust sample opacities to the step size if > 0: alpha' = 1 - (1 - alpha)^(step / reference)
+    // where reference is the step size that the transfer function opacities refer to
+    T& reference_step_size() { return reference_step_size_; }
+    VSNRAY_FUNC T const& reference_step_size() const { return reference_step_size_; }
+
+    // Stop integrating once the accumulated opacity reaches the threshold, > 1 disables
+    // early ray termination
+    T& opacity_threshold() { return opacity_threshold_; }
+    VSNRAY_FUNC T const& opacity_threshold() const { return opacity_threshold_; }
+
+    // Classify and composite one sample
+    VSNRAY_FUNC void composite(vector<3, T> const& pos, vector<4, T>& dst) const;
+
+private:
+
+    // Volume value at a world space position
+    VSNRAY_FUNC T sample(vector<3, T> const& pos) const;
+
+    // Classify a volume value and composite, opacity_exponent adjusts the opacity to the step
+    VSNRAY_FUNC void composite_value(T value, T opacity_exponent, vector<4, T>& dst) const;
+
+    // Classify a segment with the pre-integration table and composite
+    VSNRAY_FUNC void composite_segment(T front, T back, T opacity_exponent, vector<4, T>& dst) const;
+
+    Volume                  volume_;
+    macrocell_grid_ref      cells_;
+    texture_ref<vec4, 1>    transfunc_;
+    texture_ref<vec4, 2>    preintegration_table_;
+    bool                    preintegrated_ = false;
+
+    aabb                    bounds_;
+
+    T                       step_size_ = T(0.01);
+    T                       reference_step_size_ = T(0.0);
+    T                       opacity_threshold_ = T(0.999);
+
+};
+
+} // visionaray
+
+#include "detail/volume_integrator.inl"
+
+#endif // VSNRAY_VOLUME_INTEGRATOR_H
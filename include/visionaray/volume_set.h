@@ -0,0 +1,179 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#pragma once
+
+#ifndef VSNRAY_VOLUME_SET_H
+#define VSNRAY_VOLUME_SET_H 1
+
+#include <cstddef>
+
+#include "detail/macros.h"
+#include "math/aabb.h"
+#include "math/matrix.h"
+#include "math/ray.h"
+#include "aligned_vector.h"
+#include "bvh.h"
+
+namespace visionaray
+{
+
+//-------------------------------------------------------------------------------------------------
+// Placement of a volume: object space bounding box and object to world transform
+//
+
+struct volume_box
+{
+    volume_box() = default;
+
+    volume_box(aabb const& b, mat4 const& transform)
+        : bounds(b)
+        , transform_inv(inverse(transform))
+    {
+    }
+
+    // Object space
+    aabb bounds;
+
+    // World to object
+    mat4 transform_inv;
+};
+
+namespace detail
+{
+
+// BVH primitive: world space bounds of a volume box
+struct volume_box_proxy
+{
+    aabb bounds;
+    unsigned index;
+};
+
+} // detail
+
+
+//-------------------------------------------------------------------------------------------------
+// Volume set reference, pass to kernels
+//
+
+class volume_set_ref
+{
+public:
+
+    using bvh_ref = index_bvh<detail::volume_box_proxy>::bvh_ref;
+
+public:
+
+    volume_box const*   boxes;
+    unsigned            num_boxes;
+
+    // BVH over the world space bounds, only valid if has_bvh
+    bvh_ref             bvh;
+    bool                has_bvh;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Volume set, build on the host after the volume transforms change
+//
+// Sets with at least min_bvh_volumes volumes get a BVH over the world space bounds of the
+// volumes, so that finding the volumes that a ray overlaps costs O(log n) instead of O(n).
+//
+
+class volume_set
+{
+public:
+
+    using ref_type = volume_set_ref;
+
+    static const size_t min_bvh_volumes = 8;
+
+public:
+
+    void build(volume_box const* boxes, size_t count);
+
+    ref_type ref() const;
+
+    size_t size() const;
+
+    bool has_bvh() const;
+
+private:
+
+    aligned_vector<volume_box> boxes_;
+    index_bvh<detail::volume_box_proxy> bvh_;
+
+};
+
+
+//-------------------------------------------------------------------------------------------------
+// Entry and exit distances of the volumes that a ray overlaps, sorted by entry distance
+//
+// Holds at most MaxHits volumes, the nearest ones are kept.
+//
+
+template <size_t MaxHits>
+struct volume_hits
+{
+    VSNRAY_FUNC volume_hits() : size(0) {}
+
+    int     size;
+    float   tnear[MaxHits];
+    float   tfar[MaxHits];
+    int     volume[MaxHits];
+};
+
+// Intersect the ray with all volumes of the set and clip the overlaps to [tmin,tmax)
+template <size_t MaxHits>
+VSNRAY_FUNC
+inline volume_hits<MaxHits> intersect(
+        basic_ray<float> const& ray,
+        volume_set_ref const&   set,
+        float                   tmin,
+        float                   tmax
+        );
+
+
+//-------------------------------------------------------------------------------------------------
+// March along a ray through a set of possibly overlapping volumes
+//
+// The overlaps of the ray with the volumes split it into intervals in which the same volumes
+// are active. Samples are taken at t = tnear + k * dt, where tnear is the first entry point
+// into any volume. For each sample inside at least one volume, func(t, volumes, count) is
+// called with the indices of the volumes whose overlap [tnear,tfar) contains t, in
+// ascending order. Samples in gaps between volumes are skipped, sampling costs O(active
+// volumes) instead of O(volumes). func returns false to terminate the ray.
+//
+// Returns true if the ray overlaps any volume. Considers the MaxHits nearest volumes.
+//
+// Usage:
+//
+//  volume_set volumes;
+//  volumes.build(boxes.data(), boxes.size());
+//
+//  // In the kernel
+//  march_volumes(ray, volumes.ref(), 0.0f, numeric_limits<float>::max(), dt,
+//      [&](float t, int const* indices, int count)
+//      {
+//          // Sample volumes indices[0..count), composite
+//          return color.w < 0.999f;
+//      });
+//
+
+template <size_t MaxHits = 32, typename Func>
+VSNRAY_FUNC
+inline bool march_volumes(
+        basic_ray<float> const& ray,
+        volume_set_ref const&   set,
+        float                   tmin,
+        float                   tmax,
+        float                   dt,
+        Func                    func
+        );
+
+} // visionaray
+
+#include "detail/volume_set.inl"
+
+#endif // VSNRAY_VOLUME_SET_H
@@ -5,6 +5,8 @@
 #include <iostream>
 #include <memory>
 #include <ostream>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 #ifdef __CUDACC__
@@ -12,17 +14,20 @@
 #endif
 
 #include <visionaray/detail/platform.h>
+#include <visionaray/detail/thread_pool.h>
 
 #include <visionaray/math/math.h>
 
 #include <visionaray/texture/texture.h>
 
 #include <visionaray/cpu_buffer_rt.h>
+#include <visionaray/gradient_volume.h>
 #include <visionaray/material.h>
 #include <visionaray/pinhole_camera.h>
 #include <visionaray/point_light.h>
 #include <visionaray/scheduler.h>
 #include <visionaray/shade_record.h>
+#include <visionaray/volume_set.h>
 
 #ifdef __CUDACC__
 #include <visionaray/pixel_unpack_buffer_rt.h>
@@ -91,30 +96,6 @@ VSNRAY_ALIGN(32) static const vec4 tfdata[3 * 5] = {
         };
 
 
-//-------------------------------------------------------------------------------------------------
-// Helpers
-//
-
-template <typename T, typename Tex>
-VSNRAY_FUNC
-vector<3, T> gradient(Tex const& tex, vector<3, T> tex_coord)
-{
-    vector<3, T> s1;
-    vector<3, T> s2;
-
-    float DELTA = 0.01f;
-
-    s1.x = tex3D(tex, tex_coord - vector<3, T>(DELTA, 0.0f, 0.0f));
-    s2.x = tex3D(tex, tex_coord + vector<3, T>(DELTA, 0.0f, 0.0f));
-    s1.y = tex3D(tex, tex_coord + vector<3, T>(0.0f, DELTA, 0.0f));
-    s2.y = tex3D(tex, tex_coord - vector<3, T>(0.0f, DELTA, 0.0f));
-    s1.z = tex3D(tex, tex_coord + vector<3, T>(0.0f, 0.0f, DELTA));
-    s2.z = tex3D(tex, tex_coord - vector<3, T>(0.0f, 0.0f, DELTA));
-
-    return s2 - s1;
-}
-
-
 //-------------------------------------------------------------------------------------------------
 // struct with state variables
 //
@@ -216,6 +197,20 @@ struct renderer : viewer_type
             transforms.push_back(t * r * s);
         }
 
+#ifndef __CUDACC__
+        // Precompute gradients for shading, central differences would require six
+        // additional volume fetches per sample
+        thread_pool pool(std::thread::hardware_concurrency());
+
+        gradient_volumes.resize(volumes.size());
+
+        for (size_t i = 0; i < volumes.size(); ++i)
+        {
+            gradient_volumes[i].build(volumes[i], pool);
+            gradient_refs.push_back(gradient_volumes[i].ref());
+        }
+#endif
+
         for (size_t i = 0; i < volumes.size(); ++i)
         {
             model_manips.emplace_back( std::make_shared<rotate_manipulator>(
@@ -392,6 +387,13 @@ struct renderer : viewer_type
     std::vector<texture_ref<float, 3>>                          volumes;
     std::vector<texture_ref<vec4, 1>>                           transfuncs;
 
+#ifndef __CUDACC__
+    // Precomputed gradients, on the GPU we use central differences instead
+    std::vector<gradient_volume>                                gradient_volumes;
+    std::vector<gradient_volume_ref>                            gradient_refs;
+    bool                                                        precomputed_gradients = true;
+#endif
+
 #ifdef __CUDACC__
     // On the GPU, we need permanent storage in texture memory
     // and will create references later on
@@ -404,6 +406,7 @@ struct renderer : viewer_type
 
     std::vector<aabb>                                           bboxes;
     std::vector<mat4>                                           transforms;
+    volume_set                                                  volume_boxes;
 
 protected:
 
@@ -425,150 +428,156 @@ protected:
 
 struct kernel
 {
-    using R    = renderer::ray_type;
-    using S    = R::scalar_type;
-    using V    = vector<3, S>;
-    using C    = vector<4, S>;
-    using Mat4 = matrix<4, 4, S>;
-    using HR   = hit_record<R, aabb>;
-
+    // Samples the volumes that overlap a position along the ray, called by march_volumes()
 
-    VSNRAY_GPU_FUNC
-    result_record<S> operator()(R ray)
+    struct sample_volumes
     {
-        result_record<S> result;
-
-        // visionaray::numeric_limits is compatible with
-        // CUDA and with x86 SIMD types, prefer this in
-        // a cross-platform kernel.
-
-        S tmin =  numeric_limits<float>::max();
-        S tmax = -numeric_limits<float>::max();
-
-
-        // tnear and tfar for each volume
-
-        vector<2, S> range[MAX_VOLS];
-
-        for (size_t i = 0; i < num_volumes; ++i)
-        {
-            R inv_ray;
-            inv_ray.ori = (Mat4(transforms_inv[i]) * vector<4, S>(ray.ori, S(1.0))).xyz();
-            inv_ray.dir = (Mat4(transforms_inv[i]) * vector<4, S>(ray.dir, S(0.0))).xyz();
-
-            auto hit_rec = intersect(inv_ray, bboxes[i]);
-
-            tmin = select(
-                    hit_rec.hit && hit_rec.tnear < tmin,
-                    hit_rec.tnear,
-                    tmin
-                    );
-
-            tmax = select(
-                    hit_rec.hit && hit_rec.tfar > tmax,
-                    hit_rec.tfar,
-                    tmax
-                    );
-
-            range[i].x = hit_rec.tnear;
-            range[i].y = hit_rec.tfar;
-        }
-
-        auto t = tmin;
-        auto delta_t = 0.007f;
+        kernel const&           k;
+        basic_ray<float> const& ray;
+        result_record<float>&   result;
 
-        result.color = C(0.0);
-
-        while ( visionaray::any(t < tmax) )
+        VSNRAY_GPU_FUNC
+        bool operator()(float t, int const* indices, int count) const
         {
-            auto color = C(0.0f);
+            vec4 color(0.0f);
 
-            for (size_t i = 0; i < num_volumes; ++i)
+            for (int j = 0; j < count; ++j)
             {
-                auto inside = t >= range[i].x && t < range[i].y;
+                int i = indices[j];
 
-                if (visionaray::any(inside))
-                {
-                    auto pos = ray.ori + ray.dir * t;
-                         pos = (Mat4(transforms_inv[i]) * vector<4, S>(pos, S(1.0f))).xyz();
+                mat4 const& transform_inv = k.volume_boxes.boxes[i].transform_inv;
+
+                vec3 pos = ray.ori + ray.dir * t;
+                     pos = (transform_inv * vec4(pos, 1.0f)).xyz();
 
-                    auto tex_coord = vector<3, S>(
-                            ( pos.x + 1.0f ) / 2.0f,
-                            (-pos.y + 1.0f ) / 2.0f,
-                            (-pos.z + 1.0f ) / 2.0f
-                            );
+                vec3 tex_coord(
+                        ( pos.x + 1.0f ) / 2.0f,
+                        (-pos.y + 1.0f ) / 2.0f,
+                        (-pos.z + 1.0f ) / 2.0f
+                        );
 
-                    // sample volume and do post-classification
-                    auto voxel = tex3D(volumes[i], tex_coord);
-                    C colori = tex1D(transfuncs[i], voxel);
+                // sample volume and do post-classification
+                float voxel = tex3D(k.volumes[i], tex_coord);
+                vec4 colori = tex1D(k.transfuncs[i], voxel);
 
+                if (colori.w >= 0.1f)
+                {
+                    vec3 grad = k.gradients != nullptr
+                        ? gradient(k.gradients[i], tex_coord)
+                        : central_difference_gradient(k.volumes[i], tex_coord);
 
-                    auto do_shade = colori.w >= 0.1f;
+                    // Texture coordinates are flipped in y and z
+                    grad = vec3(grad.x, -grad.y, -grad.z);
 
-                    if (visionaray::any(do_shade))
+                    if (length(grad) != 0.0f)
                     {
-                        auto grad = gradient(volumes[i], tex_coord);
-                        do_shade &= length(grad) != 0.0f;
-
-                        auto light_pos = ( Mat4(transforms_inv[i]) * vector<4, S>(V(light.position()), S(1.0)) ).xyz();
+                        vec3 light_pos = (transform_inv * vec4(k.light.position(), 1.0f)).xyz();
 
-                        shade_record<S> sr;
+                        shade_record<float> sr;
                         sr.normal           = normalize(grad);
                         sr.geometric_normal = sr.normal;
                         sr.view_dir         = -ray.dir;
-                        sr.tex_color        = vector<3, S>(1.0); // TODO: maybe have a default value in shade_record..
+                        sr.tex_color        = vec3(1.0f);
                         sr.light_dir        = normalize(light_pos);
-                        sr.light_intensity  = light.intensity(pos);
-
-                        auto shaded_clr = materials[i].shade(sr);
-                        colori.xyz() = mul(
-                                colori.xyz(),
-                                to_rgb(shaded_clr),
-                                do_shade,
-                                colori.xyz()
-                                );
+                        sr.light_intensity  = k.light.intensity(pos);
+
+                        colori.xyz() *= to_rgb(k.materials[i].shade(sr));
                     }
+                }
 
 
-                    // opacity correction
-//                    colori.w = 1.0f - pow(1.0f - colori.w, delta_t);
+                // opacity correction
+//                colori.w = 1.0f - pow(1.0f - colori.w, delta_t);
 
-                    // premultiplied alpha
-                    colori.xyz() *= colori.w;
+                // premultiplied alpha
+                colori.xyz() *= colori.w;
 
-                    color += select(inside, colori, C(0.0f));
-                }
+                color += colori;
             }
 
 
             // front-to-back alpha compositing
-            result.color += select(
-                    t < tmax,
-                    color * (1.0f - result.color.w),
-                    C(0.0)
-                    );
+            result.color += color * (1.0f - result.color.w);
 
 
             // early-ray termination - don't traverse w/o a contribution
-            if ( visionaray::all(result.color.w >= 0.999) )
-            {
-                break;
-            }
+            return result.color.w < 0.999f;
+        }
+    };
 
-            // step on
-            t += delta_t;
+
+    // March through the volumes that the ray overlaps, only the volumes that
+    // overlap a sample position are sampled
+
+    VSNRAY_GPU_FUNC
+    result_record<float> integrate(basic_ray<float> const& ray) const
+    {
+        result_record<float> result;
+        result.color = vec4(0.0f);
+
+        // visionaray::numeric_limits is compatible with
+        // CUDA and with x86 SIMD types, prefer this in
+        // a cross-platform kernel.
+
+        result.hit = march_volumes<MAX_VOLS>(
+                ray,
+                volume_boxes,
+                0.0f,
+                numeric_limits<float>::max(),
+                delta_t,
+                sample_volumes{*this, ray, result}
+                );
+
+        return result;
+    }
+
+    VSNRAY_GPU_FUNC
+    result_record<float> operator()(basic_ray<float> const& ray) const
+    {
+        return integrate(ray);
+    }
+
+    // SIMD ray packets: the rays of a packet overlap different volumes,
+    // integrate them one by one
+
+    template <
+        typename F,
+        typename = typename std::enable_if<simd::is_simd_vector<F>::value>::type
+        >
+    result_record<F> operator()(basic_ray<F> const& ray) const
+    {
+        using float_array = simd::aligned_array_t<F>;
+
+        auto rays = simd::unpack(ray);
+
+        float_array r;
+        float_array g;
+        float_array b;
+        float_array a;
+        float_array hit;
+
+        for (int i = 0; i < simd::num_elements<F>::value; ++i)
+        {
+            auto res = integrate(rays[i]);
+            r[i] = res.color.x;
+            g[i] = res.color.y;
+            b[i] = res.color.z;
+            a[i] = res.color.w;
+            hit[i] = res.hit ? 1.0f : 0.0f;
         }
 
-        result.hit = tmax > tmin;
+        result_record<F> result;
+        result.color = vector<4, F>(F(r), F(g), F(b), F(a));
+        result.hit = F(hit) != F(0.0f);
         return result;
     }
 
 
-    // Kernel parameters: textures, bounding boxes, inverse transforms...
+    // Kernel parameters: textures, volume placements, materials...
 
     static const int MAX_VOLS = 32;
 
-    size_t num_volumes;
+    float delta_t = 0.007f;
 
 #ifdef __CUDACC__
     cuda_texture_ref<float, 3> const*   volumes;
@@ -578,9 +587,13 @@ struct kernel
     texture_ref<vec4, 1> const*         transfuncs;
 #endif
 
-    matrix<4, 4, S> const*              transforms_inv;
-    aabb const*                         bboxes;
-    plastic<S> const*                   materials;
+    // Bounding boxes and inverse transforms of the volumes
+    volume_set_ref                      volume_boxes;
+
+    // Precomputed gradients, or null to compute central differences
+    gradient_volume_ref const*          gradients;
+
+    plastic<float> const*               materials;
     point_light<float>                  light;
 };
 
@@ -593,10 +606,6 @@ void renderer::on_display()
 {
     // some setup
 
-    using R = renderer::ray_type;
-    using S = R::scalar_type;
-    using C = vector<3, S>;
-
 #ifdef __CUDACC__
     auto sparams = make_sched_params(
             cam,
@@ -612,36 +621,32 @@ void renderer::on_display()
 
     // setup kernel parameters
 
-#ifdef __CUDACC__
-    thrust::device_vector<matrix<4, 4, S>>  param_transforms_inv;
-    thrust::device_vector<aabb>             param_bboxes;
-    thrust::device_vector<plastic<S>>       param_materials;
-#else
-    aligned_vector<matrix<4, 4, S>>         param_transforms_inv;
-    aligned_vector<aabb>                    param_bboxes;
-    aligned_vector<plastic<S>>              param_materials;
-#endif
+    // Find the volumes along each ray once instead of testing all volumes
+    // at every step, rebuild because the manipulators change the transforms
 
-    param_transforms_inv.resize(transforms.size());
-    param_bboxes.resize(bboxes.size());
-    param_materials.resize(transforms.size());
+    std::vector<volume_box> boxes;
 
     for (size_t i = 0; i < transforms.size(); ++i)
     {
-        param_transforms_inv[i] = inverse(transforms[i]);
+        boxes.emplace_back(bboxes[i], transforms[i]);
     }
 
-    for (size_t i = 0; i < bboxes.size(); ++i)
-    {
-        param_bboxes[i] = bboxes[i];
-    }
+    volume_boxes.build(boxes.data(), boxes.size());
+
+#ifdef __CUDACC__
+    thrust::device_vector<plastic<float>>   param_materials;
+#else
+    aligned_vector<plastic<float>>          param_materials;
+#endif
+
+    param_materials.resize(transforms.size());
 
     for (size_t i = 0; i < transforms.size(); ++i)
     {
-        plastic<S> mat;
-        mat.ca() = from_rgb(C(0.2f, 0.2f, 0.2f));
-        mat.cd() = from_rgb(C(0.8f, 0.8f, 0.8f));
-        mat.cs() = from_rgb(C(0.8f, 0.8f, 0.8f));
+        plastic<float> mat;
+        mat.ca() = from_rgb(vec3(0.2f, 0.2f, 0.2f));
+        mat.cd() = from_rgb(vec3(0.8f, 0.8f, 0.8f));
+        mat.cs() = from_rgb(vec3(0.8f, 0.8f, 0.8f));
         mat.ka() = 1.0f;
         mat.kd() = 1.0f;
         mat.ks() = 1.0f;
@@ -676,23 +681,25 @@ void renderer::on_display()
         device_transfuncs[i] = transfunc_ref(device_transfuncs_storage[i]);
     }
 
+    // Few volumes, the set has no BVH and only the boxes need to be copied
+    thrust::device_vector<volume_box> device_boxes(boxes.begin(), boxes.end());
+
 
-    kern.num_volumes    = device_volumes.size();
     kern.volumes        = thrust::raw_pointer_cast(device_volumes.data());
     kern.transfuncs     = thrust::raw_pointer_cast(device_transfuncs.data());
-    kern.transforms_inv = thrust::raw_pointer_cast(param_transforms_inv.data());
-    kern.bboxes         = thrust::raw_pointer_cast(param_bboxes.data());
+    kern.volume_boxes   = volume_boxes.ref();
+    kern.volume_boxes.boxes = thrust::raw_pointer_cast(device_boxes.data());
     kern.materials      = thrust::raw_pointer_cast(param_materials.data());
+    kern.gradients      = nullptr;
 #else
 
     // Nothing to copy with x86, just pass along some pointers
 
-    kern.num_volumes    = volumes.size();
     kern.volumes        = volumes.data();
     kern.transfuncs     = transfuncs.data();
-    kern.transforms_inv = param_transforms_inv.data();
-    kern.bboxes         = param_bboxes.data();
+    kern.volume_boxes   = volume_boxes.ref();
     kern.materials      = param_materials.data();
+    kern.gradients      = precomputed_gradients ? gradient_refs.data() : nullptr;
 #endif
 
     kern.light.set_cl( vec3(1.0f, 1.0f, 1.0f) );
@@ -734,6 +741,13 @@ void renderer::on_display()
 
 void renderer::on_key_press(key_event const& event)
 {
+#ifndef __CUDACC__
+    if (event.key() == keyboard::g)
+    {
+        precomputed_gradients = !precomputed_gradients;
+    }
+#endif
+
     if (event.key() == keyboard::r)
     {
         for (auto it = model_manips.begin(); it != model_manips.end(); ++it)
@@ -15,6 +15,7 @@
 #include <visionaray/cpu_buffer_rt.h>
 #include <visionaray/pinhole_camera.h>
 #include <visionaray/scheduler.h>
+#include <visionaray/volume_integrator.h>
 
 #include <common/manip/arcball_manipulator.h>
 #include <common/manip/pan_manipulator.h>
@@ -78,6 +79,9 @@ struct renderer : viewer_type
         transfunc.reset(tfdata);
         transfunc.set_filter_mode(Linear);
         transfunc.set_address_mode(Clamp);
+
+        cells.build(volume);
+        cells.classify(transfunc);
     }
 
     aabb                                        bbox;
@@ -92,6 +96,10 @@ struct renderer : viewer_type
     texture_ref<float, 3>                       volume;
     texture_ref<vec4, 1>                        transfunc;
 
+    // empty space skipping
+
+    macrocell_grid                              cells;
+
 protected:
 
     void on_display();
@@ -110,7 +118,6 @@ void renderer::on_display()
 
     using R = renderer::host_ray_type;
     using S = R::scalar_type;
-    using C = vector<4, S>;
 
     auto sparams = make_sched_params(
             cam,
@@ -118,6 +125,13 @@ void renderer::on_display()
             );
 
 
+    volume_integrator<float> integrator;
+    integrator.set_volume(volume, cells.ref());
+    integrator.set_transfunc(transfunc);
+    integrator.set_bounds(bbox);
+    integrator.step_size() = 0.01f;
+
+
     // call kernel in schedulers' frame() method
 
     host_sched.frame([&](R ray) -> result_record<S>
@@ -125,42 +139,19 @@ void renderer::on_display()
         result_record<S> result;
 
         auto hit_rec = intersect(ray, bbox);
-        auto t = hit_rec.tnear;
-
-        result.color = C(0.0);
-
-        while ( any(t < hit_rec.tfar) )
-        {
-            auto pos = ray.ori + ray.dir * t;
-            auto tex_coord = vector<3, S>(
-                    ( pos.x + 1.0f ) / 2.0f,
-                    (-pos.y + 1.0f ) / 2.0f,
-                    (-pos.z + 1.0f ) / 2.0f
-                    );
-
-            // sample volume and do post-classification
-            auto voxel = tex3D(volume, tex_coord);
-            C color = tex1D(transfunc, voxel);
-
-            // premultiplied alpha
-            color.xyz() *= color.w;
-
-            // front-to-back alpha compositing
-            result.color += select(
-                    t < hit_rec.tfar,
-                    color * (1.0f - result.color.w),
-                    C(0.0)
-                    );
-
-            // early-ray termination - don't traverse w/o a contribution
-            if ( all(result.color.w >= 0.999) )
-            {
-                break;
-            }
-
-            // step on
-            t += 0.01f;
-        }
+
+        // the volume's y and z axes point down and into the screen, the integrator
+        // maps bbox.min to texture coordinate (0,0,0): mirror the ray about the
+        // (symmetric) bbox instead
+        R local_ray = ray;
+        local_ray.ori.y = -ray.ori.y;
+        local_ray.ori.z = -ray.ori.z;
+        local_ray.dir.y = -ray.dir.y;
+        local_ray.dir.z = -ray.dir.z;
+
+        // sample volume, do post-classification and front-to-back alpha compositing,
+        // skips macrocells that the transfer function classifies as empty
+        result.color = integrator.integrate(local_ray, S(0.0), S(numeric_limits<float>::max()));
 
         result.hit = hit_rec.hit;
         return result;
@@ -0,0 +1,128 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <visionaray/detail/mapped_file.h>
+#include <visionaray/detail/platform.h>
+
+#if defined(VSNRAY_OS_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace visionaray
+{
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+bool mapped_file::open(std::string const& filename)
+{
+    close();
+
+#if defined(VSNRAY_OS_WIN32)
+    HANDLE file = CreateFileA(
+            filename.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+            nullptr
+            );
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (data == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_ = file;
+    mapping_ = mapping;
+    data_ = static_cast<char const*>(data);
+    size_ = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping stays valid after closing the descriptor
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    // Bricks are accessed in no particular order, don't read ahead
+    madvise(data, st.st_size, MADV_RANDOM);
+
+    data_ = static_cast<char const*>(data);
+    size_ = static_cast<size_t>(st.st_size);
+#endif
+
+    return true;
+}
+
+void mapped_file::close()
+{
+    if (data_ == nullptr)
+    {
+        return;
+    }
+
+#if defined(VSNRAY_OS_WIN32)
+    UnmapViewOfFile(data_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+    CloseHandle(static_cast<HANDLE>(file_));
+#else
+    munmap(const_cast<char*>(data_), size_);
+#endif
+
+    data_ = nullptr;
+    size_ = 0;
+    file_ = nullptr;
+    mapping_ = nullptr;
+}
+
+} // visionaray
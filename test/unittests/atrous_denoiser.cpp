@@ -0,0 +1,132 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <random>
+
+#include <visionaray/math/math.h>
+#include <visionaray/atrous_denoiser.h>
+#include <visionaray/simple_buffer_rt.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helpers
+//
+
+// Left half of the image faces +z, right half faces +x
+// Color is 0.2 resp. 0.8 with additive noise
+template <typename RT>
+void make_noisy_image(RT& rt)
+{
+    std::default_random_engine rng(0);
+    std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+
+    auto ref = rt.ref();
+    auto const& aovs = ref.aovs();
+
+    for (int y = 0; y < rt.height(); ++y)
+    {
+        for (int x = 0; x < rt.width(); ++x)
+        {
+            int idx = y * rt.width() + x;
+            bool left = x < rt.width() / 2;
+
+            float c = (left ? 0.2f : 0.8f) + noise(rng);
+            rt.color()[idx] = vec4(c, c, c, 1.0f);
+
+            aovs.normal[0][idx] = left ? 0.0f : 1.0f;
+            aovs.normal[1][idx] = 0.0f;
+            aovs.normal[2][idx] = left ? 1.0f : 0.0f;
+        }
+    }
+}
+
+template <typename RT>
+float mean_abs_error(RT const& rt)
+{
+    float err = 0.0f;
+
+    for (int y = 0; y < rt.height(); ++y)
+    {
+        for (int x = 0; x < rt.width(); ++x)
+        {
+            bool left = x < rt.width() / 2;
+            err += abs(rt.color()[y * rt.width() + x].x - (left ? 0.2f : 0.8f));
+        }
+    }
+
+    return err / (rt.width() * rt.height());
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that noise is removed and that edges in the guide layers are preserved
+//
+
+TEST(AtrousDenoiser, Denoise)
+{
+    // Width is not a multiple of the SIMD width
+    simple_buffer_rt<PF_RGBA32F, PF_UNSPECIFIED> rt;
+    rt.aovs().set_layers(AOV_NORMAL);
+    rt.resize(37, 29);
+
+    make_noisy_image(rt);
+
+    float err_before = mean_abs_error(rt);
+
+    thread_pool pool(4);
+    atrous_denoiser denoiser(&pool);
+    denoiser.set_num_iterations(3);
+    denoiser.denoise(rt);
+
+    float err_after = mean_abs_error(rt);
+
+    EXPECT_LT(err_after, err_before * 0.5f);
+
+    for (int y = 0; y < rt.height(); ++y)
+    {
+        // Pixels next to the edge do not bleed
+        int x0 = rt.width() / 2 - 1;
+        int x1 = rt.width() / 2;
+        EXPECT_LT(rt.color()[y * rt.width() + x0].x, 0.35f);
+        EXPECT_GT(rt.color()[y * rt.width() + x1].x, 0.65f);
+
+        // Alpha is not filtered
+        EXPECT_FLOAT_EQ(rt.color()[y * rt.width() + x0].w, 1.0f);
+    }
+}
+
+TEST(AtrousDenoiser, AccumBuffer)
+{
+    accum_buffer_rt<simple_buffer_rt<PF_RGBA32F, PF_DEPTH32F>> rt;
+    rt.aovs().set_layers(AOV_NORMAL);
+    rt.resize(16, 16);
+    rt.clear_color_buffer();
+    rt.clear_depth_buffer();
+
+    auto ref = rt.ref();
+    auto const& aovs = ref.aovs();
+
+    for (int i = 0; i < rt.width() * rt.height(); ++i)
+    {
+        rt.accum()[i] = vec4(i % 2 == 0 ? 0.4f : 0.6f);
+        aovs.normal[2][i] = 1.0f;
+    }
+
+    // Filter in the calling thread
+    atrous_denoiser denoiser;
+    denoiser.denoise(rt);
+
+    for (int i = 0; i < rt.width() * rt.height(); ++i)
+    {
+        // Accumulation buffer is left untouched
+        EXPECT_FLOAT_EQ(rt.accum()[i].x, i % 2 == 0 ? 0.4f : 0.6f);
+
+        // Filtered image is written to the wrapped render target
+        EXPECT_GT(rt.color()[i].x, 0.45f);
+        EXPECT_LT(rt.color()[i].x, 0.55f);
+    }
+}
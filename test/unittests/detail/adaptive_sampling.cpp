@@ -0,0 +1,180 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <atomic>
+
+#include <visionaray/math/math.h>
+#include <visionaray/scheduler.h>
+#include <visionaray/simple_buffer_rt.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Test running statistics
+//
+
+TEST(AdaptiveSampling, PixelVariance)
+{
+    detail::pixel_variance pv{ 0, 0.0f, 0.0f };
+
+    float values[] = { 1.0f, 2.0f, 3.0f, 4.0f };
+
+    for (float v : values)
+    {
+        detail::update(pv, v);
+    }
+
+    EXPECT_EQ(pv.count, 4U);
+    EXPECT_FLOAT_EQ(pv.mean, 2.5f);
+    EXPECT_FLOAT_EQ(pv.m2 / (pv.count - 1), 5.0f / 3.0f);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Converged pixels must not invoke the kernel anymore
+//
+
+template <typename R>
+void test_skip_converged(R /* */)
+{
+    using S = typename R::scalar_type;
+
+    mat4 mv = mat4::identity();
+    mat4 pr = mat4::identity();
+
+    simple_buffer_rt<PF_RGBA32F, PF_UNSPECIFIED> rt;
+    rt.resize(17, 9);
+
+    auto sparams = make_sched_params(pixel_sampler::jittered_adaptive_blend_type{}, mv, pr, rt);
+
+    tiled_sched<R> sched(2);
+    sched.set_convergence_tolerance(0.01f, 4);
+
+    std::atomic<int> num_calls(0);
+
+    auto kernel = [&](R) -> result_record<S>
+    {
+        ++num_calls;
+        result_record<S> result;
+        result.color = vector<4, S>(0.5f);
+        return result;
+    };
+
+    for (unsigned frame_num = 1; frame_num <= 4; ++frame_num)
+    {
+        sched.frame(kernel, sparams, frame_num);
+    }
+
+    EXPECT_GT(num_calls, 0);
+
+    num_calls = 0;
+    sched.frame(kernel, sparams, 5);
+    EXPECT_EQ(num_calls, 0);
+
+    // Restarting accumulation discards the statistics
+    sched.frame(kernel, sparams, 1);
+    EXPECT_GT(num_calls, 0);
+
+    for (int i = 0; i < rt.width() * rt.height(); ++i)
+    {
+        EXPECT_FLOAT_EQ(rt.color()[i].x, 0.5f);
+    }
+}
+
+TEST(AdaptiveSampling, SkipConverged)
+{
+    test_skip_converged(ray{});
+    test_skip_converged(basic_ray<simd::float4>{});
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Tile-major storage must not change statistics, colors or AOVs
+//
+
+template <typename R>
+void test_tiled_layout(R /* */)
+{
+    using S = typename R::scalar_type;
+
+    const int pw = packet_size<S>::w;
+    const int ph = packet_size<S>::h;
+
+    mat4 mv = mat4::identity();
+    mat4 pr = mat4::identity();
+
+    simple_buffer_rt<PF_RGBA32F, PF_DEPTH32F> linear;
+    simple_buffer_rt<PF_RGBA32F, PF_DEPTH32F> tiled;
+    tiled.set_layout(RT_TILED);
+
+    for (auto* rt : { &linear, &tiled })
+    {
+        rt->aovs().set_layers(AOV_SAMPLE_COUNT);
+        rt->resize(37, 21);
+        rt->clear_color_buffer();
+        rt->clear_depth_buffer();
+    }
+
+    auto linear_params = make_sched_params(pixel_sampler::jittered_adaptive_blend_type{}, mv, pr, linear);
+    auto tiled_params = make_sched_params(pixel_sampler::jittered_adaptive_blend_type{}, mv, pr, tiled);
+
+    tiled_sched<R> sched_linear(2);
+    tiled_sched<R> sched_tiled(2);
+    sched_linear.set_convergence_tolerance(0.01f, 4);
+    sched_tiled.set_convergence_tolerance(0.01f, 4);
+
+    std::atomic<int> num_calls(0);
+
+    // Kernel receives image coordinates of the packet
+    auto kernel = [&](R, int x, int y) -> result_record<S>
+    {
+        ++num_calls;
+        result_record<S> result;
+        result.color = vector<4, S>(
+                S(static_cast<float>(x)),
+                S(static_cast<float>(y)),
+                S(0.5f),
+                S(1.0f)
+                );
+        return result;
+    };
+
+    for (unsigned frame_num = 1; frame_num <= 4; ++frame_num)
+    {
+        sched_linear.frame(kernel, linear_params, frame_num);
+        sched_tiled.frame(kernel, tiled_params, frame_num);
+    }
+
+    // Converged in image coordinates
+    num_calls = 0;
+    sched_tiled.frame(kernel, tiled_params, 5);
+    EXPECT_EQ(num_calls, 0);
+
+    for (int y = 0; y < tiled.height(); ++y)
+    {
+        for (int x = 0; x < tiled.width(); ++x)
+        {
+            int i = y * tiled.width() + x;
+
+            vec4 c = tiled.color()[i];
+            EXPECT_FLOAT_EQ(c.x, static_cast<float>(x - x % pw));
+            EXPECT_FLOAT_EQ(c.y, static_cast<float>(y - y % ph));
+            EXPECT_FLOAT_EQ(c.z, 0.5f);
+            EXPECT_FLOAT_EQ(c.x, linear.color()[i].x);
+            EXPECT_FLOAT_EQ(c.y, linear.color()[i].y);
+
+            EXPECT_EQ(tiled.aovs().sample_count()[i], linear.aovs().sample_count()[i]);
+            EXPECT_EQ(tiled.aovs().sample_count()[i], 4U);
+        }
+    }
+}
+
+TEST(AdaptiveSampling, TiledLayout)
+{
+    test_tiled_layout(ray{});
+    test_tiled_layout(basic_ray<simd::float4>{});
+    test_tiled_layout(basic_ray<simd::float8>{});
+}
@@ -0,0 +1,251 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <visionaray/math/math.h>
+#include <visionaray/texture/texture.h>
+#include <visionaray/environment_light.h>
+#include <visionaray/random_generator.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+// Bright spot near the horizon on a dim background
+static texture<vec4, 2> make_sky(int width, int height)
+{
+    std::vector<vec4> data(width * height);
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            float dx = (x - width * 0.3f) / width;
+            float dy = (y - height * 0.4f) / height;
+            float spot = 50.0f * std::exp(-(dx * dx + dy * dy) * 200.0f);
+            data[y * width + x] = vec4(0.1f + spot, 0.2f + spot * 0.5f, 0.3f, 1.0f);
+        }
+    }
+
+    texture<vec4, 2> tex(width, height);
+    tex.reset(data.data());
+    return tex;
+}
+
+static vec3 sample_sphere(float u1, float u2)
+{
+    float z = 1.0f - 2.0f * u1;
+    float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+    float phi = constants::two_pi<float>() * u2;
+    return vec3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+static aabb make_bounds()
+{
+    return aabb(vec3(-1.0f), vec3(1.0f));
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that the equirect mapping and its inverse agree
+//
+
+TEST(EnvironmentLight, Equirect)
+{
+    random_generator<float> gen(1);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        vec3 dir = sample_sphere(gen.next(), gen.next());
+        vec2 uv = detail::direction_to_equirect(dir);
+
+        EXPECT_GE(uv.x, 0.0f);
+        EXPECT_LE(uv.x, 1.0f);
+        EXPECT_GE(uv.y, 0.0f);
+        EXPECT_LE(uv.y, 1.0f);
+
+        vec3 d = detail::equirect_to_direction(uv);
+        EXPECT_NEAR(d.x, dir.x, 1e-4f);
+        EXPECT_NEAR(d.y, dir.y, 1e-4f);
+        EXPECT_NEAR(d.z, dir.z, 1e-4f);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that the sampling density is normalized and consistent with sample_direction()
+//
+
+TEST(EnvironmentLight, Pdf)
+{
+    auto sky = make_sky(64, 32);
+
+    environment_map env;
+    env.build(sky);
+    auto light = env.light(make_bounds());
+
+    random_generator<float> gen(2);
+
+    // Integral of the pdf over the sphere
+    const int N = 200000;
+    double integral = 0.0;
+
+    for (int i = 0; i < N; ++i)
+    {
+        vec3 dir = sample_sphere(gen.next(), gen.next());
+        integral += light.pdf(dir) * 4.0f * constants::pi<float>();
+    }
+
+    EXPECT_NEAR(integral / N, 1.0, 0.02);
+
+    // Sampled pdf and pdf(dir)
+    for (int i = 0; i < 1000; ++i)
+    {
+        vec3 dir;
+        float pdf = 0.0f;
+        vec3 L = light.sample_direction(gen.next(), gen.next(), dir, pdf);
+
+        ASSERT_GT(pdf, 0.0f);
+        EXPECT_NEAR(length(dir), 1.0f, 1e-4f);
+        EXPECT_NEAR(pdf, light.pdf(dir), pdf * 1e-3f);
+        EXPECT_FLOAT_EQ(L.x, light.radiance(dir).x);
+    }
+
+    // SIMD overloads
+    using F = simd::float4;
+
+    vec3 dirs[4];
+
+    for (auto& d : dirs)
+    {
+        d = sample_sphere(gen.next(), gen.next());
+    }
+
+    vector<3, F> dir4(
+            F(dirs[0].x, dirs[1].x, dirs[2].x, dirs[3].x),
+            F(dirs[0].y, dirs[1].y, dirs[2].y, dirs[3].y),
+            F(dirs[0].z, dirs[1].z, dirs[2].z, dirs[3].z)
+            );
+
+    simd::aligned_array_t<F> pdfs;
+    simd::aligned_array_t<F> reds;
+    store(pdfs, light.pdf(dir4));
+    store(reds, light.radiance(dir4).x);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_FLOAT_EQ(pdfs[i], light.pdf(dirs[i]));
+        EXPECT_FLOAT_EQ(reds[i], light.radiance(dirs[i]).x);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that importance sampling and uniform sampling estimate the same irradiance integral
+//
+
+TEST(EnvironmentLight, Estimate)
+{
+    auto sky = make_sky(128, 64);
+
+    environment_map env;
+    env.build(sky);
+    auto light = env.light(make_bounds(), 2.0f);
+
+    random_generator<float> gen(3);
+
+    const int N = 200000;
+    double uniform = 0.0;
+    double importance = 0.0;
+    double sq_importance = 0.0;
+    double sq_uniform = 0.0;
+
+    for (int i = 0; i < N; ++i)
+    {
+        vec3 dir = sample_sphere(gen.next(), gen.next());
+        double u = light.radiance(dir).x * 4.0f * constants::pi<float>();
+        uniform += u;
+        sq_uniform += u * u;
+
+        float pdf = 0.0f;
+        double f = light.sample_direction(gen.next(), gen.next(), dir, pdf).x / pdf;
+        importance += f;
+        sq_importance += f * f;
+    }
+
+    uniform /= N;
+    importance /= N;
+
+    EXPECT_NEAR(importance / uniform, 1.0, 0.02);
+
+    // Average radiance is the integral over 4pi
+    EXPECT_NEAR(light.average_radiance().x * 4.0f * constants::pi<float>() / importance, 1.0, 0.02);
+
+    // Importance sampling reduces the variance
+    double var_uniform = sq_uniform / N - uniform * uniform;
+    double var_importance = sq_importance / N - importance * importance;
+    EXPECT_LT(var_importance, var_uniform * 0.5);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test light sample on the distant sphere and a black image
+//
+
+TEST(EnvironmentLight, Sample)
+{
+    auto sky = make_sky(32, 16);
+
+    environment_map env;
+    env.build(sky);
+    auto light = env.light(make_bounds());
+
+    random_generator<float> gen(4);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        auto ls = light.sample(gen);
+
+        vec3 dir = normalize(ls.pos - light.position());
+        float dist = length(ls.pos - light.position());
+
+        // Area pdf converts to the solid angle pdf of the direction
+        EXPECT_NEAR(dist * dist / ls.area, light.pdf(dir), light.pdf(dir) * 1e-2f);
+        EXPECT_NEAR(dot(ls.normal, -dir), 1.0f, 1e-4f);
+        EXPECT_GT(dist, light.scene_radius());
+    }
+
+    EXPECT_FLOAT_EQ(light.intensity(vec3(0.0f)).x, 0.0f);
+
+
+    // Black images are sampled (almost) uniformly, sin(theta) is constant per row
+
+    std::vector<vec4> black(64 * 32, vec4(0.0f));
+    texture<vec4, 2> tex(64, 32);
+    tex.reset(black.data());
+
+    environment_map black_env;
+    black_env.build(tex);
+    auto black_light = black_env.light(make_bounds());
+
+    for (int i = 0; i < 100; ++i)
+    {
+        vec3 dir;
+        float pdf = 0.0f;
+        black_light.sample_direction(gen.next(), gen.next(), dir, pdf);
+
+        if (std::abs(dir.y) < 0.9f)
+        {
+            float uniform_pdf = constants::inv_pi<float>() / 4.0f;
+            EXPECT_NEAR(pdf, uniform_pdf, uniform_pdf * 0.15f);
+        }
+    }
+}
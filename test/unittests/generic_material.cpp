@@ -5,6 +5,9 @@
 
 #include <visionaray/math/array.h>
 #include <visionaray/generic_material.h>
+#include <visionaray/random_generator.h>
+#include <visionaray/shade_record.h>
+#include <visionaray/surface_interaction.h>
 
 #include <gtest/gtest.h>
 
@@ -120,3 +123,143 @@ TEST(GenericMaterial, SIMD)
     }
     EXPECT_FLOAT_EQ( m4.ls(), em.ls() );
 }
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that shading SIMD packets grouped by material type matches per-lane shading
+//
+
+TEST(GenericMaterial, SIMDShade)
+{
+    using F = simd::float4;
+    using I = simd::int4;
+
+    using material_type = generic_material<
+        plastic<float>,
+        mirror<float>,
+        matte<float>,
+        emissive<float>,
+        glass<float>
+        >;
+
+    plastic<float> pl;
+    pl.ca() = from_rgb(vec3(0.0f));
+    pl.cd() = from_rgb(vec3(0.0f, 0.1f, 0.2f));
+    pl.cs() = from_rgb(vec3(0.0f, 0.2f, 0.4f));
+    pl.ka() = 0.0f;
+    pl.kd() = 1.0f;
+    pl.ks() = 0.5f;
+    pl.specular_exp() = 32.0f;
+
+    mirror<float> mi;
+    mi.cr() = from_rgb(vec3(1.0f, 1.0f, 1.0f));
+    mi.kr() = 1.0f;
+    mi.ior() = spectrum<float>(1.34f);
+    mi.absorption() = spectrum<float>(0.0f);
+
+    matte<float> ma1;
+    ma1.ca() = from_rgb(vec3(0.0f));
+    ma1.cd() = from_rgb(vec3(1.0f, 0.0f, 0.0f));
+    ma1.ka() = 0.0f;
+    ma1.kd() = 1.0f;
+
+    matte<float> ma2 = ma1;
+    ma2.cd() = from_rgb(vec3(0.0f, 0.5f, 1.0f));
+
+    emissive<float> em;
+    em.ce() = from_rgb(vec3(3.0f, 3.0f, 3.0f));
+    em.ls() = 5.0f;
+
+    glass<float> gl;
+    gl.ct() = from_rgb(vec3(1.0f));
+    gl.kt() = 1.0f;
+    gl.cr() = from_rgb(vec3(1.0f));
+    gl.kr() = 1.0f;
+    gl.ior() = spectrum<float>(1.5f);
+
+    array<material_type, 4> packets[] = {
+        {{ material_type(ma1), material_type(pl), material_type(ma2), material_type(em) }},
+        {{ material_type(ma1), material_type(ma2), material_type(ma2), material_type(ma1) }},
+        {{ material_type(gl), material_type(mi), material_type(pl), material_type(gl) }}
+        };
+
+    shade_record<F> sr;
+    sr.normal           = vector<3, F>(F(0.0f), F(0.0f), F(1.0f));
+    sr.geometric_normal = sr.normal;
+    sr.view_dir         = normalize(vector<3, F>(F(0.1f, 0.2f, -0.3f, 0.0f), F(0.2f), F(1.0f)));
+    sr.tex_color        = vector<3, F>(1.0f);
+    sr.light_dir        = normalize(vector<3, F>(F(-0.2f), F(0.1f, 0.0f, 0.3f, -0.5f), F(1.0f)));
+    sr.light_intensity  = vector<3, F>(F(1.0f), F(2.0f), F(0.5f));
+
+    auto srs = simd::unpack(sr);
+
+    for (auto const& mats : packets)
+    {
+        auto simd_material = simd::pack(mats);
+
+        // shade()
+
+        auto shaded = simd_material.shade(sr);
+
+        for (int c = 0; c < 3; ++c)
+        {
+            simd::aligned_array_t<F> lanes;
+            store(lanes, shaded[c]);
+
+            for (int i = 0; i < 4; ++i)
+            {
+                float expected = mats[i].shade(srs[i])[c];
+                EXPECT_NEAR(lanes[i], expected, 1e-4f * (1.0f + expected));
+            }
+        }
+
+
+        // sample(), then pdf() with the sampled directions
+
+        random_generator<F> gen(array<unsigned, 4>{{ 1, 2, 3, 4 }});
+
+        vector<3, F> refl_dir;
+        F pdf;
+        I inter;
+        simd_material.sample(sr, refl_dir, pdf, inter, gen);
+
+        simd::aligned_array_t<I> inters;
+        simd::aligned_array_t<F> pdfs;
+        store(inters, inter);
+        store(pdfs, pdf);
+
+        auto dirs = simd::unpack(refl_dir);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if (mats[i].as<emissive<float>>())
+            {
+                EXPECT_EQ(inters[i], static_cast<int>(surface_interaction::Emission));
+            }
+            else if (mats[i].as<mirror<float>>())
+            {
+                EXPECT_EQ(inters[i], static_cast<int>(surface_interaction::SpecularReflection));
+                EXPECT_NEAR(dirs[i].z, srs[i].view_dir.z, 1e-5f);
+            }
+            else if (mats[i].as<matte<float>>())
+            {
+                EXPECT_GT(pdfs[i], 0.0f);
+                EXPECT_GT(dirs[i].z, 0.0f);
+            }
+        }
+
+        auto sr2 = sr;
+        sr2.light_dir = refl_dir;
+        auto pdf2 = simd_material.pdf(sr2, inter);
+
+        simd::aligned_array_t<F> pdfs2;
+        store(pdfs2, pdf2);
+
+        auto srs2 = simd::unpack(sr2);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            EXPECT_NEAR(pdfs2[i], mats[i].pdf(srs2[i], inters[i]), 1e-4f * (1.0f + pdfs2[i]));
+        }
+    }
+}
@@ -1,9 +1,13 @@
 // This file is distributed under the MIT license.
 // See the LICENSE file for details.
 
+#include <cstddef>
+#include <vector>
+
 #include <visionaray/math/math.h>
 #include <visionaray/bvh.h>
 #include <visionaray/generic_primitive.h>
+#include <visionaray/random_generator.h>
 
 #include <gtest/gtest.h>
 
@@ -22,6 +26,150 @@ aabb get_bounds(custom_primitive)
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+using mixed_primitive = generic_primitive<basic_triangle<3, float>, basic_sphere<float>>;
+
+// Random mix of spheres and triangles in [-1,1]^3
+static std::vector<mixed_primitive> make_mixed_primitives(size_t count)
+{
+    random_generator<float> gen(3);
+
+    auto rand_vec = [&]()
+    {
+        return vec3(gen.next(), gen.next(), gen.next()) * 2.0f - vec3(1.0f);
+    };
+
+    std::vector<mixed_primitive> result;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (gen.next() < 0.5f)
+        {
+            basic_sphere<float> s;
+            s.center = rand_vec();
+            s.radius = gen.next() * 0.05f + 0.01f;
+            s.prim_id = static_cast<unsigned>(i);
+            s.geom_id = 0;
+            result.push_back(s);
+        }
+        else
+        {
+            basic_triangle<3, float> t;
+            t.v1 = rand_vec();
+            t.e1 = rand_vec() * 0.1f;
+            t.e2 = rand_vec() * 0.1f;
+            t.prim_id = static_cast<unsigned>(i);
+            t.geom_id = 0;
+            result.push_back(t);
+        }
+    }
+
+    return result;
+}
+
+template <typename Tree>
+static void check_leaves_grouped(Tree const& tree)
+{
+    for (size_t i = 0; i < tree.num_nodes(); ++i)
+    {
+        auto const& node = tree.node(i);
+
+        if (!is_leaf(node))
+        {
+            continue;
+        }
+
+        auto r = node.get_indices();
+
+        for (auto j = r.first + 1; j < r.last; ++j)
+        {
+            EXPECT_LE(tree.primitive(j - 1).which(), tree.primitive(j).which());
+        }
+    }
+}
+
+// Compare closest hits with a brute force search
+template <typename Tree>
+static void check_closest_hits(Tree const& tree, std::vector<mixed_primitive> const& prims)
+{
+    random_generator<float> gen(5);
+
+    for (int i = 0; i < 500; ++i)
+    {
+        ray r;
+        r.ori = vec3(gen.next(), gen.next(), 2.0f) * 2.0f - vec3(1.0f, 1.0f, 0.0f);
+        r.dir = normalize(vec3(gen.next() - 0.5f, gen.next() - 0.5f, -2.0f));
+
+        hit_record<ray, primitive<unsigned>> ref;
+        ref.hit = false;
+        ref.t = numeric_limits<float>::max();
+
+        for (auto const& p : prims)
+        {
+            auto hr = intersect(r, p);
+
+            if (hr.hit && hr.t < ref.t)
+            {
+                ref = hr;
+            }
+        }
+
+        auto hr = intersect(r, tree.ref());
+
+        EXPECT_EQ(hr.hit, ref.hit);
+
+        if (hr.hit && ref.hit)
+        {
+            EXPECT_EQ(hr.prim_id, ref.prim_id);
+            EXPECT_FLOAT_EQ(hr.t, ref.t);
+        }
+    }
+
+
+    // SIMD rays take the same code path
+
+    using F = simd::float4;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        ray rays[4];
+
+        for (int j = 0; j < 4; ++j)
+        {
+            rays[j].ori = vec3(gen.next(), gen.next(), 2.0f) * 2.0f - vec3(1.0f, 1.0f, 0.0f);
+            rays[j].dir = normalize(vec3(gen.next() - 0.5f, gen.next() - 0.5f, -2.0f));
+        }
+
+        auto hr4 = intersect(simd::pack(rays[0], rays[1], rays[2], rays[3]), tree.ref());
+
+        simd::aligned_array_t<F> ts;
+        store(ts, hr4.t);
+
+        simd::aligned_array_t<simd::int_type_t<F>> prim_ids;
+        store(prim_ids, hr4.prim_id);
+
+        simd::aligned_array_t<simd::int_type_t<F>> hits;
+        store(hits, select(hr4.hit, simd::int4(1), simd::int4(0)));
+
+        for (int j = 0; j < 4; ++j)
+        {
+            auto hr = intersect(rays[j], tree.ref());
+
+            EXPECT_EQ(hits[j] != 0, hr.hit);
+
+            if (hr.hit)
+            {
+                EXPECT_EQ(static_cast<unsigned>(prim_ids[j]), hr.prim_id);
+                EXPECT_FLOAT_EQ(ts[j], hr.t);
+            }
+        }
+    }
+}
+
+
 //-------------------------------------------------------------------------------------------------
 // Test get_bounds()
 //
@@ -141,3 +289,25 @@ TEST(GenericPrimitive, SplitPrimitive)
     EXPECT_TRUE( Lt == Lp );
     EXPECT_TRUE( Rt == Rp );
 }
+
+
+//-------------------------------------------------------------------------------------------------
+// Test BVH traversal with leaves grouped by primitive type
+//
+
+TEST(GenericPrimitive, LeafTypeRuns)
+{
+    auto prims = make_mixed_primitives(2000);
+
+    auto tree = build<bvh<mixed_primitive>>(prims.data(), prims.size());
+    check_closest_hits(tree, prims);
+
+    group_leaves_by_type(tree);
+    check_leaves_grouped(tree);
+    check_closest_hits(tree, prims);
+
+    auto index_tree = build<index_bvh<mixed_primitive>>(prims.data(), prims.size(), true);
+    group_leaves_by_type(index_tree);
+    check_leaves_grouped(index_tree);
+    check_closest_hits(index_tree, prims);
+}
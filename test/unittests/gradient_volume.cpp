@@ -0,0 +1,232 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <vector>
+
+#include <visionaray/detail/thread_pool.h>
+#include <visionaray/math/math.h>
+#include <visionaray/texture/texture.h>
+#include <visionaray/gradient_volume.h>
+#include <visionaray/random_generator.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+// Smooth function of the normalized voxel position
+static texture<float, 3> make_volume(int w, int h, int d)
+{
+    std::vector<float> data(w * h * d);
+
+    for (int z = 0; z < d; ++z)
+    {
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                vec3 p = (vec3(x, y, z) + vec3(0.5f)) / vec3(w, h, d);
+                data[(z * h + y) * w + x] = sin(p.x * 3.0f) * cos(p.y * 2.0f) + p.z * p.z;
+            }
+        }
+    }
+
+    texture<float, 3> tex(w, h, d);
+    tex.reset(data.data());
+    tex.set_filter_mode(Linear);
+    tex.set_address_mode(Clamp);
+    return tex;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test octahedral encoding
+//
+
+TEST(GradientVolume, OctahedralEncoding)
+{
+    random_generator<float> gen(3);
+
+    std::vector<vec3> normals = {
+            vec3( 1.0f,  0.0f,  0.0f),
+            vec3(-1.0f,  0.0f,  0.0f),
+            vec3( 0.0f,  1.0f,  0.0f),
+            vec3( 0.0f, -1.0f,  0.0f),
+            vec3( 0.0f,  0.0f,  1.0f),
+            vec3( 0.0f,  0.0f, -1.0f)
+            };
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        normals.push_back(normalize(vec3(gen.next(), gen.next(), gen.next()) * 2.0f - vec3(1.0f)));
+    }
+
+    for (auto const& n : normals)
+    {
+        vec2 e = oct_encode(n);
+
+        EXPECT_LE(abs(e.x), 1.0f);
+        EXPECT_LE(abs(e.y), 1.0f);
+
+        vec3 decoded = oct_decode(e);
+        EXPECT_NEAR(decoded.x, n.x, 1e-5f);
+        EXPECT_NEAR(decoded.y, n.y, 1e-5f);
+        EXPECT_NEAR(decoded.z, n.z, 1e-5f);
+
+        // Quantized to 16 bits
+        snorm<16> qx(e.x);
+        snorm<16> qy(e.y);
+        decoded = oct_decode(vec2(static_cast<float>(qx), static_cast<float>(qy)));
+        EXPECT_GT(dot(decoded, n), 0.99999f);
+    }
+
+    // SIMD
+    vector<3, simd::float4> n4(
+            simd::float4(normals[6].x, normals[7].x, normals[8].x, normals[5].x),
+            simd::float4(normals[6].y, normals[7].y, normals[8].y, normals[5].y),
+            simd::float4(normals[6].z, normals[7].z, normals[8].z, normals[5].z)
+            );
+
+    simd::aligned_array_t<simd::float4> z;
+    store(z, oct_decode(oct_encode(n4)).z);
+
+    EXPECT_NEAR(z[0], normals[6].z, 1e-5f);
+    EXPECT_NEAR(z[1], normals[7].z, 1e-5f);
+    EXPECT_NEAR(z[2], normals[8].z, 1e-5f);
+    EXPECT_NEAR(z[3], normals[5].z, 1e-5f);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test precomputed gradients against central differences
+//
+
+TEST(GradientVolume, Gradients)
+{
+    const int w = 24;
+    const int h = 17;
+    const int d = 30;
+
+    auto volume = make_volume(w, h, d);
+
+    gradient_volume gradients;
+    gradients.build(volume);
+
+    EXPECT_EQ(gradients.width(), size_t(w));
+    EXPECT_EQ(gradients.height(), size_t(h));
+    EXPECT_EQ(gradients.depth(), size_t(d));
+
+    // Parallel construction yields the same gradients
+    thread_pool pool(4);
+    gradient_volume parallel_gradients;
+    parallel_gradients.build(volume, pool);
+
+    for (int z = 0; z < d; ++z)
+    {
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                vec3 a = gradients(x, y, z);
+                vec3 b = parallel_gradients(x, y, z);
+                EXPECT_FLOAT_EQ(a.x, b.x);
+                EXPECT_FLOAT_EQ(a.y, b.y);
+                EXPECT_FLOAT_EQ(a.z, b.z);
+            }
+        }
+    }
+
+    texture_ref<float, 3> volume_ref(volume);
+    auto ref = gradients.ref();
+
+    random_generator<float> gen(5);
+
+    // Trilinear interpolation commutes with central differences, both agree inside the
+    // volume where the differences don't read clamped voxels
+    for (int i = 0; i < 500; ++i)
+    {
+        vec3 lo = vec3(2.0f) / vec3(w, h, d);
+        vec3 coord = lo + vec3(gen.next(), gen.next(), gen.next()) * (vec3(1.0f) - lo * 2.0f);
+
+        vec3 expected = central_difference_gradient(volume_ref, coord);
+        vec3 g = gradient(ref, coord);
+
+        float tolerance = length(expected) * 1e-3f + 1e-4f;
+        EXPECT_NEAR(g.x, expected.x, tolerance);
+        EXPECT_NEAR(g.y, expected.y, tolerance);
+        EXPECT_NEAR(g.z, expected.z, tolerance);
+    }
+
+    // Smooth volume, interpolated gradients are close to the analytic ones inside
+    for (int i = 0; i < 200; ++i)
+    {
+        vec3 coord = vec3(gen.next(), gen.next(), gen.next()) * 0.8f + vec3(0.1f);
+        vec3 expected(
+                3.0f * cos(coord.x * 3.0f) * cos(coord.y * 2.0f),
+               -2.0f * sin(coord.x * 3.0f) * sin(coord.y * 2.0f),
+                2.0f * coord.z
+                );
+
+        vec3 g = gradient(ref, coord);
+        EXPECT_NEAR(g.x, expected.x, 0.05f);
+        EXPECT_NEAR(g.y, expected.y, 0.05f);
+        EXPECT_NEAR(g.z, expected.z, 0.05f);
+    }
+
+    // SIMD coordinates
+    for (auto filter_mode : { Nearest, Linear })
+    {
+        gradients.set_filter_mode(filter_mode);
+        ref = gradients.ref();
+
+        for (int i = 0; i < 50; ++i)
+        {
+            vec3 c[4];
+
+            for (int j = 0; j < 4; ++j)
+            {
+                c[j] = vec3(gen.next(), gen.next(), gen.next()) * 1.2f - vec3(0.1f);
+            }
+
+            vector<3, simd::float4> c4(
+                    simd::float4(c[0].x, c[1].x, c[2].x, c[3].x),
+                    simd::float4(c[0].y, c[1].y, c[2].y, c[3].y),
+                    simd::float4(c[0].z, c[1].z, c[2].z, c[3].z)
+                    );
+
+            auto g4 = gradient(ref, c4);
+
+            simd::aligned_array_t<simd::float4> gx;
+            simd::aligned_array_t<simd::float4> gy;
+            simd::aligned_array_t<simd::float4> gz;
+
+            store(gx, g4.x);
+            store(gy, g4.y);
+            store(gz, g4.z);
+
+            for (int j = 0; j < 4; ++j)
+            {
+                vec3 g = gradient(ref, c[j]);
+                EXPECT_FLOAT_EQ(gx[j], g.x);
+                EXPECT_FLOAT_EQ(gy[j], g.y);
+                EXPECT_FLOAT_EQ(gz[j], g.z);
+            }
+        }
+    }
+
+    // Nearest filtering returns voxel gradients
+    EXPECT_FLOAT_EQ(gradient(ref, vec3(0.5f / w, 1.5f / h, 2.5f / d)).x, gradients(0, 1, 2).x);
+
+    // Constant volumes have zero gradients
+    std::vector<float> constant(8 * 8 * 8, 0.5f);
+    texture<float, 3> constant_volume(8, 8, 8);
+    constant_volume.reset(constant.data());
+
+    gradients.build(constant_volume);
+    EXPECT_FLOAT_EQ(length(gradients(3, 4, 5)), 0.0f);
+    EXPECT_FLOAT_EQ(length(gradient(gradients.ref(), vec3(0.5f))), 0.0f);
+}
@@ -0,0 +1,259 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <cmath>
+
+#include <visionaray/detail/spd/blackbody.h>
+#include <visionaray/detail/spd/d65.h>
+#include <visionaray/math/math.h>
+#include <visionaray/hero_spectrum.h>
+#include <visionaray/random_generator.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+// Average RGB of the round trip RGB -> spectrum -> RGB over many wavelength samples
+template <size_t N>
+static vec3 round_trip(vec3 const& rgb)
+{
+    random_generator<float> gen(7);
+
+    const int M = 20000;
+    vec3 result(0.0f);
+
+    for (int i = 0; i < M; ++i)
+    {
+        auto wl = sample_hero_wavelengths<N>(gen.next());
+        result += to_rgb(from_rgb(rgb, wl), wl);
+    }
+
+    return result / static_cast<float>(M);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that wavelengths are stratified over the visible range
+//
+
+TEST(HeroSpectrum, Wavelengths)
+{
+    using W = hero_wavelengths<float, 4>;
+
+    const float range = W::lambda_max - W::lambda_min;
+
+    random_generator<float> gen(1);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto wl = sample_hero_wavelengths<4>(gen.next());
+
+        for (int j = 0; j < 4; ++j)
+        {
+            EXPECT_GE(wl.lambda[j], W::lambda_min);
+            EXPECT_LT(wl.lambda[j], W::lambda_max);
+
+            // Distance to the hero wavelength, wrapped around
+            float d = std::fmod(wl.lambda[j] - wl.lambda[0] + range, range);
+            EXPECT_NEAR(d, j * range / 4.0f, 1e-2f);
+        }
+    }
+
+    EXPECT_FLOAT_EQ(W::pdf(), 1.0f / range);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test conversions between RGB, SPDs and hero spectra
+//
+
+TEST(HeroSpectrum, Conversions)
+{
+    // Constant spectrum has Y = 1 and maps to white
+    random_generator<float> gen(2);
+
+    vec3 xyz(0.0f);
+    vec3 rgb(0.0f);
+
+    for (int i = 0; i < 20000; ++i)
+    {
+        auto wl = sample_hero_wavelengths<8>(gen.next());
+        xyz += to_xyz(hero_spectrum<float, 8>(1.0f), wl);
+        rgb += to_rgb(hero_spectrum<float, 8>(1.0f), wl);
+    }
+
+    xyz /= 20000.0f;
+    rgb /= 20000.0f;
+
+    EXPECT_NEAR(xyz.y, 1.0f, 0.01f);
+    EXPECT_NEAR(rgb.x, 1.0f, 0.01f);
+    EXPECT_NEAR(rgb.y, 1.0f, 0.01f);
+    EXPECT_NEAR(rgb.z, 1.0f, 0.01f);
+
+
+    // RGB reflectances survive the round trip
+    vec3 colors[] = {
+        vec3(1.0f, 1.0f, 1.0f),
+        vec3(0.5f, 0.5f, 0.5f),
+        vec3(0.8f, 0.2f, 0.1f),
+        vec3(0.2f, 0.7f, 0.3f),
+        vec3(0.1f, 0.3f, 0.9f)
+        };
+
+    for (auto c : colors)
+    {
+        vec3 r = round_trip<4>(c);
+        EXPECT_NEAR(r.x, c.x, 0.1f);
+        EXPECT_NEAR(r.y, c.y, 0.1f);
+        EXPECT_NEAR(r.z, c.z, 0.1f);
+    }
+
+
+    // SPDs are evaluated at the wavelengths
+    auto wl = sample_hero_wavelengths<4>(0.3f);
+
+    blackbody bb(3000.0f);
+    auto s = from_spd(bb, wl);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_FLOAT_EQ(s[i], bb(wl.lambda[i]));
+    }
+
+    // D65 is bluish white compared to 3000 K
+    vec3 d65(0.0f);
+    vec3 warm(0.0f);
+
+    for (int i = 0; i < 20000; ++i)
+    {
+        auto wl = sample_hero_wavelengths<4>(gen.next());
+        d65 += to_rgb(from_spd(spd_d65(), wl), wl);
+        warm += to_rgb(from_spd(bb, wl), wl);
+    }
+
+    EXPECT_GT(d65.z / d65.x, warm.z / warm.x);
+    EXPECT_GT(warm.x, warm.z);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that from_rgb() selects the same basis spectra as Smits' algorithm
+//
+
+// Reference: Smits (1999), evaluated per wavelength with spd_smits
+static float smits_reference(vec3 const& rgb, float lambda)
+{
+    float r = rgb.x;
+    float g = rgb.y;
+    float b = rgb.z;
+
+    auto basis = [lambda](spd_smits::basis b) { return spd_smits(b)(lambda); };
+
+    if (r <= g && r <= b)
+    {
+        return r * basis(spd_smits::White) + (g <= b
+                ? (g - r) * basis(spd_smits::Cyan) + (b - g) * basis(spd_smits::Blue)
+                : (b - r) * basis(spd_smits::Cyan) + (g - b) * basis(spd_smits::Green));
+    }
+    else if (g <= b)
+    {
+        return g * basis(spd_smits::White) + (r <= b
+                ? (r - g) * basis(spd_smits::Magenta) + (b - r) * basis(spd_smits::Blue)
+                : (b - g) * basis(spd_smits::Magenta) + (r - b) * basis(spd_smits::Red));
+    }
+    else
+    {
+        return b * basis(spd_smits::White) + (r <= g
+                ? (r - b) * basis(spd_smits::Yellow) + (g - r) * basis(spd_smits::Green)
+                : (g - b) * basis(spd_smits::Yellow) + (r - g) * basis(spd_smits::Red));
+    }
+}
+
+template <size_t N>
+static void test_smits()
+{
+    random_generator<float> gen(5);
+
+    // Includes ties between components
+    float values[] = { 0.0f, 0.25f, 0.5f, 1.0f };
+
+    for (float r : values)
+    {
+        for (float g : values)
+        {
+            for (float b : values)
+            {
+                vec3 rgb(r, g, b);
+
+                for (int i = 0; i < 10; ++i)
+                {
+                    auto wl = sample_hero_wavelengths<N>(gen.next());
+                    auto s = from_rgb(rgb, wl);
+
+                    for (size_t j = 0; j < N; ++j)
+                    {
+                        EXPECT_NEAR(s[j], smits_reference(rgb, wl.lambda[j]), 1e-5f);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(HeroSpectrum, Smits)
+{
+    test_smits<4>();
+    test_smits<8>();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that SIMD lanes agree with the scalar implementation
+//
+
+TEST(HeroSpectrum, SIMD)
+{
+    using F = simd::float4;
+
+    float us[4] = { 0.1f, 0.35f, 0.6f, 0.95f };
+    vec3 colors[4] = {
+        vec3(0.8f, 0.2f, 0.1f),
+        vec3(0.2f, 0.7f, 0.3f),
+        vec3(0.1f, 0.3f, 0.9f),
+        vec3(0.4f, 0.4f, 0.4f)
+        };
+
+    auto wl4 = sample_hero_wavelengths<4>(F(us[0], us[1], us[2], us[3]));
+
+    vector<3, F> rgb4(
+            F(colors[0].x, colors[1].x, colors[2].x, colors[3].x),
+            F(colors[0].y, colors[1].y, colors[2].y, colors[3].y),
+            F(colors[0].z, colors[1].z, colors[2].z, colors[3].z)
+            );
+
+    auto s4 = from_rgb(rgb4, wl4);
+    auto c4 = to_rgb(s4, wl4);
+
+    simd::aligned_array_t<F> r;
+    store(r, c4.x);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        auto wl = sample_hero_wavelengths<4>(us[i]);
+        auto s = from_rgb(colors[i], wl);
+
+        for (int j = 0; j < 4; ++j)
+        {
+            simd::aligned_array_t<F> lanes;
+            store(lanes, s4[j]);
+            EXPECT_NEAR(lanes[i], s[j], 1e-5f);
+        }
+
+        EXPECT_NEAR(r[i], to_rgb(s, wl).x, 1e-3f);
+    }
+}
@@ -0,0 +1,358 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <vector>
+
+#include <visionaray/detail/thread_pool.h>
+#include <visionaray/math/math.h>
+#include <visionaray/texture/texture.h>
+#include <visionaray/bvh.h>
+#include <visionaray/isosurface.h>
+#include <visionaray/random_generator.h>
+#include <visionaray/traverse.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+// 1 - distance to the center of the normalized voxel position
+static texture<float, 3> make_volume(int w, int h, int d)
+{
+    std::vector<float> data(w * h * d);
+
+    for (int z = 0; z < d; ++z)
+    {
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                vec3 p = (vec3(x, y, z) + vec3(0.5f)) / vec3(w, h, d);
+                data[(z * h + y) * w + x] = 1.0f - length(p - vec3(0.5f));
+            }
+        }
+    }
+
+    texture<float, 3> tex(w, h, d);
+    tex.reset(data.data());
+    tex.set_filter_mode(Linear);
+    tex.set_address_mode(Clamp);
+    return tex;
+}
+
+static basic_ray<float> random_ray(random_generator<float>& gen)
+{
+    vec3 ori = vec3(gen.next(), gen.next(), gen.next()) * 6.0f - vec3(3.0f);
+    vec3 target = vec3(gen.next(), gen.next(), gen.next()) * 1.6f - vec3(0.8f);
+    return basic_ray<float>(ori, normalize(target - ori));
+}
+
+// First crossing of the isovalue, sampled with small steps and refined with bisection
+static bool march(basic_ray<float> const& ray, texture_ref<float, 3> const& volume, aabb const& bounds, float isovalue, float& t)
+{
+    // Isosurfaces are defined between the outermost voxel centers
+    vec3 half_voxel = (bounds.max - bounds.min) * 0.5f / vec3(volume.width(), volume.height(), volume.depth());
+    aabb inner(bounds.min + half_voxel, bounds.max - half_voxel);
+
+    auto hr = intersect(ray, inner);
+
+    if (!hr.hit || hr.tfar < 0.0f)
+    {
+        return false;
+    }
+
+    auto sample = [&](float s)
+    {
+        vec3 coord = (ray.ori + ray.dir * s - bounds.min) / (bounds.max - bounds.min);
+        return tex3D(volume, coord) - isovalue;
+    };
+
+    float dt = 0.001f;
+    float t0 = max(hr.tnear, 0.0f);
+    float f0 = sample(t0);
+
+    for (float t1 = t0 + dt; t0 < hr.tfar; t1 = std::min(t0 + dt, hr.tfar))
+    {
+        float f1 = sample(t1);
+
+        if ((f0 < 0.0f) != (f1 < 0.0f))
+        {
+            for (int i = 0; i < 20; ++i)
+            {
+                float tm = (t0 + t1) * 0.5f;
+                float fm = sample(tm);
+
+                if ((fm < 0.0f) == (f0 < 0.0f))
+                {
+                    t0 = tm;
+                    f0 = fm;
+                }
+                else
+                {
+                    t1 = tm;
+                }
+            }
+
+            t = (t0 + t1) * 0.5f;
+            return true;
+        }
+
+        if (t1 >= hr.tfar)
+        {
+            break;
+        }
+
+        t0 = t1;
+        f0 = f1;
+    }
+
+    return false;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test min/max octree construction
+//
+
+TEST(Isosurface, MinMaxOctree)
+{
+    const int w = 21;
+    const int h = 9;
+    const int d = 14;
+
+    auto const volume = make_volume(w, h, d);
+
+    minmax_octree octree;
+    octree.build(volume);
+
+    // 20 x 8 x 13 cells, halved until 1 x 1 x 1
+    ASSERT_EQ(octree.num_levels(), 6);
+
+    // Parallel construction yields the same ranges
+    thread_pool pool(4);
+    minmax_octree parallel_octree;
+    parallel_octree.build(volume, pool);
+    ASSERT_EQ(parallel_octree.num_levels(), octree.num_levels());
+
+    auto ref = octree.ref();
+
+    for (int l = 0; l < octree.num_levels(); ++l)
+    {
+        vec3i dims = ref.dims[l];
+
+        for (int z = 0; z < dims.z; ++z)
+        {
+            for (int y = 0; y < dims.y; ++y)
+            {
+                for (int x = 0; x < dims.x; ++x)
+                {
+                    // Brute force, all voxels of the cells that the node covers
+                    int size = 1 << l;
+                    vec2 expected(numeric_limits<float>::max(), -numeric_limits<float>::max());
+
+                    for (int k = z * size; k <= std::min((z + 1) * size, d - 1); ++k)
+                    {
+                        for (int j = y * size; j <= std::min((y + 1) * size, h - 1); ++j)
+                        {
+                            for (int i = x * size; i <= std::min((x + 1) * size, w - 1); ++i)
+                            {
+                                expected.x = std::min(expected.x, volume(i, j, k));
+                                expected.y = std::max(expected.y, volume(i, j, k));
+                            }
+                        }
+                    }
+
+                    vec2 range = octree.range(l, x, y, z);
+                    EXPECT_FLOAT_EQ(range.x, expected.x);
+                    EXPECT_FLOAT_EQ(range.y, expected.y);
+                    EXPECT_FLOAT_EQ(ref.range(l, vec3i(x, y, z)).x, expected.x);
+
+                    vec2 parallel_range = parallel_octree.range(l, x, y, z);
+                    EXPECT_FLOAT_EQ(parallel_range.x, range.x);
+                    EXPECT_FLOAT_EQ(parallel_range.y, range.y);
+                }
+            }
+        }
+    }
+
+    // Not enough voxels for a cell
+    texture<float, 3> flat(8, 8, 1);
+    octree.build(flat);
+    EXPECT_EQ(octree.num_levels(), 0);
+
+    isosurface iso(texture_ref<float, 3>(flat), octree.ref(), aabb(vec3(-1.0f), vec3(1.0f)), 0.5f);
+    EXPECT_FALSE(intersect(basic_ray<float>(vec3(0.0f, 0.0f, -2.0f), vec3(0.0f, 0.0f, 1.0f)), iso).hit);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test ray / isosurface intersection against marching the trilinear interpolant
+//
+
+TEST(Isosurface, Intersect)
+{
+    const int w = 32;
+    const int h = 24;
+    const int d = 40;
+
+    auto volume = make_volume(w, h, d);
+
+    minmax_octree octree;
+    octree.build(volume);
+
+    texture_ref<float, 3> volume_ref(volume);
+    aabb bounds(vec3(-1.0f, -0.8f, -1.2f), vec3(1.0f, 0.8f, 1.2f));
+
+    // Sphere with radius 0.3 in texture coordinates, an ellipsoid in world space
+    isosurface iso(volume_ref, octree.ref(), bounds, 0.7f);
+    iso.prim_id = 3;
+    iso.geom_id = 5;
+
+    random_generator<float> gen(7);
+
+    int num_hits = 0;
+
+    for (int i = 0; i < 500; ++i)
+    {
+        auto ray = random_ray(gen);
+
+        auto hr = intersect(ray, iso);
+
+        float expected = 0.0f;
+        bool expected_hit = march(ray, volume_ref, bounds, iso.isovalue, expected);
+
+        ASSERT_EQ(hr.hit, expected_hit);
+
+        if (!hr.hit)
+        {
+            continue;
+        }
+
+        ++num_hits;
+
+        EXPECT_NEAR(hr.t, expected, 1e-3f);
+        EXPECT_EQ(hr.prim_id, 3);
+        EXPECT_EQ(hr.geom_id, 5);
+
+        // On the surface
+        vec3 coord = (hr.isect_pos - bounds.min) / (bounds.max - bounds.min);
+        EXPECT_NEAR(tex3D(volume_ref, coord), iso.isovalue, 1e-4f);
+        EXPECT_NEAR(length(coord - vec3(0.5f)), 0.3f, 0.01f);
+
+        // Normal points away from the center, towards lower values
+        vec3 n = get_normal(hr, iso);
+        vec3 expected_normal = normalize((coord - vec3(0.5f)) / (bounds.max - bounds.min));
+        EXPECT_NEAR(length(n), 1.0f, 1e-5f);
+        EXPECT_GT(dot(n, expected_normal), 0.99f);
+
+        vec3 ori = (ray.ori - bounds.min) / (bounds.max - bounds.min);
+
+        if (length(ori - vec3(0.5f)) > 0.3f)
+        {
+            EXPECT_LT(dot(n, ray.dir), 0.0f);
+        }
+    }
+
+    EXPECT_GT(num_hits, 100);
+
+    // Rays that start inside hit the surface from the inside
+    basic_ray<float> inside(vec3(0.0f), vec3(1.0f, 0.0f, 0.0f));
+    auto hr = intersect(inside, iso);
+    ASSERT_TRUE(hr.hit);
+    EXPECT_NEAR(hr.t, 0.6f, 0.01f);
+
+    // Isovalues outside the value range are skipped at the root
+    iso.isovalue = 1.5f;
+    EXPECT_FALSE(intersect(inside, iso).hit);
+
+    // SIMD rays
+    iso.isovalue = 0.7f;
+
+    for (int i = 0; i < 50; ++i)
+    {
+        basic_ray<float> rays[4];
+
+        for (int j = 0; j < 4; ++j)
+        {
+            rays[j] = random_ray(gen);
+        }
+
+        basic_ray<simd::float4> ray4;
+        ray4.ori = vector<3, simd::float4>(
+                simd::float4(rays[0].ori.x, rays[1].ori.x, rays[2].ori.x, rays[3].ori.x),
+                simd::float4(rays[0].ori.y, rays[1].ori.y, rays[2].ori.y, rays[3].ori.y),
+                simd::float4(rays[0].ori.z, rays[1].ori.z, rays[2].ori.z, rays[3].ori.z)
+                );
+        ray4.dir = vector<3, simd::float4>(
+                simd::float4(rays[0].dir.x, rays[1].dir.x, rays[2].dir.x, rays[3].dir.x),
+                simd::float4(rays[0].dir.y, rays[1].dir.y, rays[2].dir.y, rays[3].dir.y),
+                simd::float4(rays[0].dir.z, rays[1].dir.z, rays[2].dir.z, rays[3].dir.z)
+                );
+
+        auto hrs = simd::unpack(intersect(ray4, iso));
+
+        for (int j = 0; j < 4; ++j)
+        {
+            auto expected = intersect(rays[j], iso);
+            EXPECT_EQ(hrs[j].hit, expected.hit);
+
+            if (expected.hit)
+            {
+                EXPECT_FLOAT_EQ(hrs[j].t, expected.t);
+            }
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test isosurfaces as primitives of lists and BVHs
+//
+
+TEST(Isosurface, Traversal)
+{
+    auto volume = make_volume(16, 16, 16);
+
+    minmax_octree octree;
+    octree.build(volume);
+
+    std::vector<isosurface> isos;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        aabb bounds(vec3(i * 3.0f, 0.0f, 0.0f), vec3(i * 3.0f + 2.0f, 2.0f, 2.0f));
+        isos.emplace_back(texture_ref<float, 3>(volume), octree.ref(), bounds, 0.8f);
+        isos.back().prim_id = static_cast<unsigned>(i);
+        isos.back().geom_id = 0;
+    }
+
+    auto bvh = build<index_bvh<isosurface>>(isos.data(), isos.size());
+
+    // Along the row of volumes, the nearest one is hit
+    for (float x : { -2.0f, 14.0f })
+    {
+        basic_ray<float> ray(vec3(x, 1.0f, 1.0f), vec3(x < 0.0f ? 1.0f : -1.0f, 0.0f, 0.0f));
+
+        auto hr = closest_hit(ray, isos.begin(), isos.end());
+        ASSERT_TRUE(hr.hit);
+        EXPECT_EQ(hr.prim_id, x < 0.0f ? 0 : 3);
+
+        // Sphere with radius 0.2 in texture coordinates, sampled coarsely
+        EXPECT_NEAR(hr.t, x < 0.0f ? 2.6f : 3.6f, 0.02f);
+
+        std::vector<index_bvh<isosurface>::bvh_ref> bvhs = { bvh.ref() };
+        auto bvh_hr = closest_hit(ray, bvhs.begin(), bvhs.end());
+        ASSERT_TRUE(bvh_hr.hit);
+        EXPECT_EQ(bvh_hr.prim_id, hr.prim_id);
+        EXPECT_FLOAT_EQ(bvh_hr.t, hr.t);
+    }
+
+    // Between the volumes
+    basic_ray<float> miss(vec3(2.5f, 1.0f, -1.0f), vec3(0.0f, 0.0f, 1.0f));
+    EXPECT_FALSE(closest_hit(miss, isos.begin(), isos.end()).hit);
+}
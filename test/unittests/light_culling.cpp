@@ -0,0 +1,277 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include <visionaray/math/math.h>
+#include <visionaray/light_culling.h>
+#include <visionaray/pinhole_camera.h>
+#include <visionaray/point_light.h>
+#include <visionaray/spot_light.h>
+#include <visionaray/random_generator.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+static pinhole_camera make_camera()
+{
+    pinhole_camera cam;
+    cam.perspective(45.0f * constants::degrees_to_radians<float>(), 4.0f / 3.0f, 0.1f, 100.0f);
+    cam.set_viewport(0, 0, 320, 240);
+    cam.look_at(vec3(0.0f, 0.0f, 10.0f), vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
+    return cam;
+}
+
+static std::vector<point_light<float>> make_lights(int n)
+{
+    random_generator<float> gen(11);
+
+    std::vector<point_light<float>> lights(n);
+
+    for (auto& l : lights)
+    {
+        l.set_position(vec3(gen.next() * 30.0f - 15.0f, gen.next() * 20.0f - 10.0f, gen.next() * 30.0f - 20.0f));
+        l.set_cl(vec3(1.0f));
+        l.set_kl(1.0f);
+        l.set_constant_attenuation(1.0f);
+        l.set_linear_attenuation(0.0f);
+        l.set_quadratic_attenuation(1.0f);
+        l.set_influence_radius(0.5f + gen.next() * 3.0f);
+    }
+
+    return lights;
+}
+
+static std::vector<int> lights_in_cluster(light_clusters_ref const& ref, int cluster)
+{
+    return std::vector<int>(ref.indices + ref.offsets[cluster], ref.indices + ref.offsets[cluster + 1]);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that clusters contain all lights whose influence sphere contains a position
+//
+
+TEST(LightCulling, Conservative)
+{
+    auto cam = make_camera();
+    auto lights = make_lights(200);
+
+    light_clusters clusters(16, 8);
+    clusters.build(cam, lights.data(), lights.data() + lights.size());
+
+    auto ref = clusters.ref();
+
+    EXPECT_EQ(clusters.num_clusters(), static_cast<size_t>(20 * 15 * 8 + 1));
+
+    // The last cluster has all lights, the others only a few
+    EXPECT_EQ(ref.offsets[ref.overflow_cluster() + 1] - ref.offsets[ref.overflow_cluster()], 200);
+    EXPECT_LT(clusters.num_indices(), clusters.num_clusters() * 200 / 10);
+
+    random_generator<float> gen(5);
+
+    int num_culled = 0;
+
+    for (int i = 0; i < 20000; ++i)
+    {
+        vec3 pos(gen.next() * 30.0f - 15.0f, gen.next() * 20.0f - 10.0f, gen.next() * 30.0f - 20.0f);
+
+        int c = ref.cluster_index(pos);
+        ASSERT_GE(c, 0);
+        ASSERT_LE(c, ref.overflow_cluster());
+
+        auto list = lights_in_cluster(ref, c);
+
+        for (size_t l = 0; l < lights.size(); ++l)
+        {
+            bool listed = std::find(list.begin(), list.end(), static_cast<int>(l)) != list.end();
+
+            if (length(lights[l].position() - pos) < lights[l].influence_radius())
+            {
+                EXPECT_TRUE(listed);
+            }
+
+            num_culled += !listed;
+        }
+    }
+
+    EXPECT_GT(num_culled, 0);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test iteration over culled lights
+//
+
+struct params_type
+{
+    struct
+    {
+        point_light<float> const* begin;
+        point_light<float> const* end;
+    } lights;
+};
+
+TEST(LightCulling, Iterate)
+{
+    auto cam = make_camera();
+    auto lights = make_lights(50);
+
+    light_clusters clusters(32, 4);
+    clusters.build(cam, lights.data(), lights.data() + lights.size());
+
+    auto ref = clusters.ref();
+
+    params_type params;
+    params.lights.begin = lights.data();
+    params.lights.end   = lights.data() + lights.size();
+
+    auto cparams = with_light_clusters(params, ref);
+
+
+    // No clusters: all lights
+
+    int count = 0;
+    auto all = culled_lights(params, vec3(0.0f));
+
+    for (auto it = all.begin(); it != all.end(); ++it)
+    {
+        EXPECT_TRUE(it.active());
+        ++count;
+    }
+
+    EXPECT_EQ(count, 50);
+
+
+    // Scalar
+
+    random_generator<float> gen(3);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        vec3 pos(gen.next() * 10.0f - 5.0f, gen.next() * 6.0f - 3.0f, gen.next() * 10.0f - 10.0f);
+
+        auto list = lights_in_cluster(ref, ref.cluster_index(pos));
+        std::vector<int> visited;
+
+        auto culled = culled_lights(cparams, pos);
+
+        for (auto it = culled.begin(); it != culled.end(); ++it)
+        {
+            EXPECT_TRUE(it.active());
+            visited.push_back(static_cast<int>(&*it - lights.data()));
+        }
+
+        EXPECT_EQ(visited, list);
+    }
+
+
+    // SIMD, every lane sees the lights of its cluster exactly once
+
+    using F = simd::float4;
+    using M = simd::mask4;
+
+    const int N = simd::num_elements<F>::value;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        // Two lanes share a position to test clusters that are visited once
+        vec3 ps[N];
+
+        for (int l = 0; l < N; ++l)
+        {
+            ps[l] = vec3(gen.next() * 10.0f - 5.0f, gen.next() * 6.0f - 3.0f, gen.next() * 10.0f - 10.0f);
+        }
+
+        ps[N - 1] = ps[0];
+
+        vector<3, F> pos(
+                F(ps[0].x, ps[1].x, ps[2].x, ps[3].x),
+                F(ps[0].y, ps[1].y, ps[2].y, ps[3].y),
+                F(ps[0].z, ps[1].z, ps[2].z, ps[3].z)
+                );
+
+        std::vector<int> visited[N];
+
+        auto culled = culled_lights(cparams, pos);
+
+        for (auto it = culled.begin(); it != culled.end(); ++it)
+        {
+            M active = it.active();
+
+            simd::aligned_array_t<simd::int4> lanes;
+            store(lanes, select(active, simd::int4(1), simd::int4(0)));
+
+            for (int l = 0; l < N; ++l)
+            {
+                if (lanes[l])
+                {
+                    visited[l].push_back(static_cast<int>(it.operator->() - lights.data()));
+                }
+            }
+        }
+
+        for (int l = 0; l < N; ++l)
+        {
+            EXPECT_EQ(visited[l], lights_in_cluster(ref, ref.cluster_index(ps[l])));
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that the attenuation of culled lights falls off to zero at the influence radius
+//
+
+template <typename Light>
+static void test_window(Light light)
+{
+    light.set_position(vec3(0.0f));
+    light.set_cl(vec3(1.0f));
+    light.set_kl(1.0f);
+    light.set_constant_attenuation(1.0f);
+    light.set_linear_attenuation(0.0f);
+    light.set_quadratic_attenuation(1.0f);
+
+    // Unbounded by default, plain attenuation
+    EXPECT_FLOAT_EQ(light.intensity(vec3(0.0f, 0.0f, -3.0f)).x, 0.1f);
+
+    light.set_influence_radius(2.0f);
+
+    // Close to the light, the spot light direction is undefined at its position
+    EXPECT_NEAR(light.intensity(vec3(0.0f, 0.0f, -0.01f)).x, 1.0f, 1e-3f);
+    EXPECT_LT(light.intensity(vec3(0.0f, 0.0f, -1.0f)).x, 0.5f);
+    EXPECT_GT(light.intensity(vec3(0.0f, 0.0f, -1.0f)).x, 0.4f);
+    EXPECT_FLOAT_EQ(light.intensity(vec3(0.0f, 0.0f, -2.0f)).x, 0.0f);
+    EXPECT_FLOAT_EQ(light.intensity(vec3(0.0f, 0.0f, -3.0f)).x, 0.0f);
+
+    // SIMD
+    vector<3, simd::float4> pos(simd::float4(0.0f), simd::float4(0.0f), simd::float4(-0.01f, -1.0f, -2.0f, -3.0f));
+    simd::aligned_array_t<simd::float4> intensity;
+    store(intensity, light.intensity(pos).x);
+
+    EXPECT_FLOAT_EQ(intensity[0], light.intensity(vec3(0.0f, 0.0f, -0.01f)).x);
+    EXPECT_FLOAT_EQ(intensity[1], light.intensity(vec3(0.0f, 0.0f, -1.0f)).x);
+    EXPECT_FLOAT_EQ(intensity[2], 0.0f);
+    EXPECT_FLOAT_EQ(intensity[3], 0.0f);
+}
+
+TEST(LightCulling, Window)
+{
+    test_window(point_light<float>());
+
+    // Cone along -z
+    spot_light<float> spot;
+    spot.set_spot_direction(vec3(0.0f, 0.0f, -1.0f));
+    spot.set_spot_cutoff(constants::pi<float>() / 4.0f);
+    spot.set_spot_exponent(0.0f);
+    test_window(spot);
+}
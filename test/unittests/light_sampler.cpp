@@ -0,0 +1,198 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <cstddef>
+#include <vector>
+
+#include <visionaray/math/math.h>
+#include <visionaray/area_light.h>
+#include <visionaray/get_normal.h>
+#include <visionaray/light_sampler.h>
+#include <visionaray/point_light.h>
+#include <visionaray/random_generator.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+using triangle_type = basic_triangle<3, float>;
+using light_type    = area_light<float, triangle_type>;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+// Unit-area triangles along the x-axis with increasing power
+static std::vector<light_type> make_lights(int n)
+{
+    std::vector<light_type> lights;
+
+    for (int i = 0; i < n; ++i)
+    {
+        triangle_type t(
+                vec3(i * 4.0f, 0.0f, 0.0f),
+                vec3(1.0f, 0.0f, 0.0f),
+                vec3(0.0f, 2.0f, 0.0f)
+                );
+        t.prim_id = i * 2 + 1;
+        t.geom_id = 0;
+
+        light_type light(t);
+        light.set_cl(vec3(1.0f));
+        light.set_kl(static_cast<float>(i + 1));
+        lights.push_back(light);
+    }
+
+    return lights;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test the alias table, lights are picked proportional to their power
+//
+
+TEST(LightSampler, AliasTable)
+{
+    const int n = 8;
+    auto lights = make_lights(n);
+
+    light_sampler ls;
+    ls.build(lights.data(), lights.data() + lights.size());
+
+    EXPECT_EQ(ls.num_lights(), static_cast<size_t>(n));
+    EXPECT_FALSE(ls.has_bvh());
+
+    auto ref = ls.ref();
+
+    float total = n * (n + 1) / 2.0f;
+
+    for (int i = 0; i < n; ++i)
+    {
+        EXPECT_NEAR(ref.pmf(vec3(0.0f), i), (i + 1) / total, 1e-6f);
+    }
+
+    // Stratified u, the alias table must reproduce the pmf
+    const int num_samples = 1 << 16;
+    std::vector<int> counts(n, 0);
+
+    for (int s = 0; s < num_samples; ++s)
+    {
+        float u = (s + 0.5f) / num_samples;
+        float pmf = 0.0f;
+        int light = ref.sample_index(vec3(0.0f), u, pmf);
+
+        ASSERT_GE(light, 0);
+        ASSERT_LT(light, n);
+        EXPECT_FLOAT_EQ(pmf, ref.pmf(vec3(0.0f), light));
+
+        ++counts[light];
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        EXPECT_NEAR(counts[i] / static_cast<float>(num_samples), (i + 1) / total, 1e-3f);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test the light BVH, pmfs are consistent and nearby lights are preferred
+//
+
+TEST(LightSampler, BVH)
+{
+    const int n = 13;
+    auto lights = make_lights(n);
+
+    light_sampler ls;
+    ls.build(lights.data(), lights.data() + lights.size(), true);
+
+    EXPECT_TRUE(ls.has_bvh());
+
+    auto ref = ls.ref();
+
+    vec3 positions[] = {
+        vec3(0.0f, 0.0f, 1.0f),
+        vec3(24.0f, 1.0f, 0.5f),
+        vec3(100.0f, -3.0f, 10.0f)
+        };
+
+    for (auto pos : positions)
+    {
+        float sum = 0.0f;
+
+        for (int i = 0; i < n; ++i)
+        {
+            sum += ref.pmf(pos, i);
+        }
+
+        EXPECT_NEAR(sum, 1.0f, 1e-5f);
+
+        random_generator<float> gen(7);
+
+        for (int s = 0; s < 1000; ++s)
+        {
+            float pmf = 0.0f;
+            int light = ref.sample_index(pos, gen.next(), pmf);
+
+            ASSERT_GE(light, 0);
+            ASSERT_LT(light, n);
+            EXPECT_NEAR(pmf, ref.pmf(pos, light), 1e-6f);
+        }
+    }
+
+    // The weakest light is much closer than the brightest one
+    EXPECT_GT(ref.pmf(positions[0], 0), ref.pmf(positions[0], n - 1));
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test mapping from primitive IDs to lights
+//
+
+TEST(LightSampler, PrimitiveIDs)
+{
+    const int n = 4;
+    auto lights = make_lights(n);
+
+    light_sampler ls;
+    ls.build(lights.data(), lights.data() + lights.size());
+
+    auto ref = ls.ref();
+
+    for (int i = 0; i < n; ++i)
+    {
+        EXPECT_EQ(ref.light_index(i * 2 + 1), i);
+        EXPECT_EQ(ref.light_index(i * 2), -1);
+        EXPECT_FLOAT_EQ(ref.pmf_for_primitive(vec3(0.0f), i * 2 + 1), ref.pmf(vec3(0.0f), i));
+    }
+
+    EXPECT_EQ(ref.light_index(-1), -1);
+    EXPECT_EQ(ref.light_index(1000), -1);
+    EXPECT_FLOAT_EQ(ref.pmf_for_primitive(vec3(0.0f), 1000), 0.0f);
+
+
+    // Delta lights are not associated with primitives
+
+    float kl[] = { 1.0f, 3.0f, 0.0f };
+    std::vector<point_light<float>> point_lights(3);
+
+    for (size_t i = 0; i < point_lights.size(); ++i)
+    {
+        point_lights[i].set_position(vec3(static_cast<float>(i), 0.0f, 0.0f));
+        point_lights[i].set_cl(vec3(1.0f));
+        point_lights[i].set_kl(kl[i]);
+        point_lights[i].set_constant_attenuation(1.0f);
+        point_lights[i].set_linear_attenuation(0.0f);
+        point_lights[i].set_quadratic_attenuation(0.0f);
+    }
+
+    ls.build(point_lights.data(), point_lights.data() + point_lights.size());
+    ref = ls.ref();
+
+    EXPECT_EQ(ref.num_prims, 0);
+    EXPECT_NEAR(ref.pmf(vec3(0.0f), 0), 0.25f, 1e-6f);
+    EXPECT_NEAR(ref.pmf(vec3(0.0f), 1), 0.75f, 1e-6f);
+    EXPECT_FLOAT_EQ(ref.pmf(vec3(0.0f), 2), 0.0f);
+}
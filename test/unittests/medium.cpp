@@ -1,9 +1,13 @@
 // This file is distributed under the MIT license.
 // See the LICENSE file for details.
 
+#include <cmath>
 #include <limits>
+#include <vector>
 
 #include <visionaray/math/math.h>
+#include <visionaray/texture/texture.h>
+#include <visionaray/heterogeneous_medium.h>
 #include <visionaray/medium.h>
 #include <visionaray/random_generator.h>
 
@@ -81,3 +85,175 @@ TEST(Medium, Anisotropic)
         test_anisotropic<double>(g);
     }
 }
+
+
+//-------------------------------------------------------------------------------------------------
+// Test heterogeneous participating medium
+//
+
+// Density blob in one corner, zero elsewhere
+static texture<float, 3> make_density(int size)
+{
+    std::vector<float> data(size * size * size);
+
+    for (int z = 0; z < size; ++z)
+    {
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                vec3 p = (vec3(x, y, z) + vec3(0.5f)) / static_cast<float>(size);
+                float r = length(p - vec3(0.3f, 0.4f, 0.5f));
+                data[(z * size + y) * size + x] = r < 0.25f ? 1.0f - r * 4.0f : 0.0f;
+            }
+        }
+    }
+
+    texture<float, 3> tex(size, size, size);
+    tex.reset(data.data());
+    tex.set_filter_mode(Linear);
+    tex.set_address_mode(Clamp);
+    return tex;
+}
+
+// Transmittance by ray marching with small steps
+static float march_transmittance(heterogeneous_medium<float> const& medium, basic_ray<float> const& ray, float tmax)
+{
+    const int N = 4000;
+    float dt = tmax / N;
+    float tau = 0.0f;
+
+    for (int i = 0; i < N; ++i)
+    {
+        tau += medium.extinction(ray.ori + ray.dir * ((i + 0.5f) * dt)) * dt;
+    }
+
+    return std::exp(-tau);
+}
+
+TEST(Medium, MajorantGrid)
+{
+    auto density = make_density(32);
+
+    majorant_grid grid;
+    grid.build(density, 8);
+
+    auto ref = grid.ref();
+
+    EXPECT_EQ(ref.dims, vec3i(4, 4, 4));
+    EXPECT_GT(ref.max_majorant, 0.5f);
+
+    // Empty cells far from the blob
+    EXPECT_FLOAT_EQ(ref.majorant(3, 3, 3), 0.0f);
+
+    // The majorant bounds the filtered density
+    texture_ref<float, 3> tex(density);
+    random_generator<float> gen(1);
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        vec3 coord(gen.next(), gen.next(), gen.next());
+        vec3i cell(coord * ref.cells_per_texcoord);
+
+        EXPECT_LE(tex3D(tex, coord), ref.majorant(cell.x, cell.y, cell.z) + 1e-6f);
+    }
+}
+
+TEST(Medium, HeterogeneousTracking)
+{
+    auto density = make_density(32);
+
+    majorant_grid grid;
+    grid.build(density, 4);
+
+    heterogeneous_medium<float> medium;
+    medium.set_density(texture_ref<float, 3>(density), grid.ref());
+    medium.set_bounds(aabb(vec3(-1.0f), vec3(1.0f)));
+    medium.density_scale() = 4.0f;
+    medium.anisotropy() = 0.0f;
+
+    random_generator<float> gen(2);
+
+    basic_ray<float> rays[] = {
+        basic_ray<float>(vec3(-2.0f, -0.2f, 0.0f), normalize(vec3(1.0f, 0.0f, 0.0f))),
+        basic_ray<float>(vec3(-2.0f, -2.0f, -2.0f), normalize(vec3(1.0f, 1.0f, 1.0f))),
+        basic_ray<float>(vec3(-0.4f, 2.0f, 0.0f), normalize(vec3(0.0f, -1.0f, 0.1f))),
+        basic_ray<float>(vec3(0.9f, 0.9f, 2.0f), normalize(vec3(0.0f, 0.0f, -1.0f)))   // misses the blob
+        };
+
+    for (auto const& ray : rays)
+    {
+        float tmax = 6.0f;
+        float expected = march_transmittance(medium, ray, tmax);
+
+        const int N = 20000;
+        double ratio = 0.0;
+        int escaped = 0;
+
+        for (int i = 0; i < N; ++i)
+        {
+            ratio += medium.transmittance(ray, 0.0f, tmax, gen);
+
+            float t = 0.0f;
+            bool scattered = medium.sample_free_flight(ray, 0.0f, tmax, t, gen);
+
+            if (scattered)
+            {
+                EXPECT_GT(t, 0.0f);
+                EXPECT_LT(t, tmax);
+                EXPECT_GT(medium.extinction(ray.ori + ray.dir * t), 0.0f);
+            }
+            else
+            {
+                ++escaped;
+            }
+        }
+
+        EXPECT_NEAR(ratio / N, expected, 0.01);
+        EXPECT_NEAR(escaped / static_cast<double>(N), expected, 0.015);
+    }
+
+
+    // SIMD lanes
+
+    using F = simd::float4;
+
+    random_generator<F> gen4(array<unsigned, 4>{{ 3, 4, 5, 6 }});
+
+    basic_ray<F> ray4;
+    ray4.ori = vector<3, F>(
+            F(rays[0].ori.x, rays[1].ori.x, rays[2].ori.x, rays[3].ori.x),
+            F(rays[0].ori.y, rays[1].ori.y, rays[2].ori.y, rays[3].ori.y),
+            F(rays[0].ori.z, rays[1].ori.z, rays[2].ori.z, rays[3].ori.z)
+            );
+    ray4.dir = vector<3, F>(
+            F(rays[0].dir.x, rays[1].dir.x, rays[2].dir.x, rays[3].dir.x),
+            F(rays[0].dir.y, rays[1].dir.y, rays[2].dir.y, rays[3].dir.y),
+            F(rays[0].dir.z, rays[1].dir.z, rays[2].dir.z, rays[3].dir.z)
+            );
+
+    const int N = 20000;
+    F ratio(0.0f);
+    F escaped(0.0f);
+
+    for (int i = 0; i < N; ++i)
+    {
+        ratio += medium.transmittance(ray4, F(0.0f), F(6.0f), gen4);
+
+        F t;
+        auto scattered = medium.sample_free_flight(ray4, F(0.0f), F(6.0f), t, gen4);
+        escaped += select(scattered, F(0.0f), F(1.0f));
+    }
+
+    simd::aligned_array_t<F> ratios;
+    simd::aligned_array_t<F> escapes;
+    store(ratios, ratio / F(N));
+    store(escapes, escaped / F(N));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        float expected = march_transmittance(medium, rays[i], 6.0f);
+        EXPECT_NEAR(ratios[i], expected, 0.01f);
+        EXPECT_NEAR(escapes[i], expected, 0.015f);
+    }
+}
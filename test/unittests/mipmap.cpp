@@ -0,0 +1,235 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <cmath>
+#include <vector>
+
+#include <visionaray/math/math.h>
+#include <visionaray/texture/texture.h>
+#include <visionaray/pinhole_camera.h>
+#include <visionaray/ray_differential.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+static std::vector<vec4> make_texels(int width, int height)
+{
+    std::vector<vec4> data(width * height);
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            data[y * width + x] = vec4(float(x), float(y), float(x * y), 1.0f);
+        }
+    }
+
+    return data;
+}
+
+template <typename T>
+static T average(std::vector<T> const& data)
+{
+    T sum(0.0f);
+
+    for (auto const& t : data)
+    {
+        sum += t;
+    }
+
+    return sum / static_cast<float>(data.size());
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test mip level sizes and box filtered texels
+//
+
+TEST(Mipmap, Levels)
+{
+    // Power of two, RGBA32F
+    {
+        auto data = make_texels(16, 8);
+
+        texture<vec4, 2> tex(16, 8);
+        tex.reset(data.data());
+
+        EXPECT_EQ(tex.num_levels(), 1U);
+
+        tex.generate_mipmaps();
+
+        ASSERT_EQ(tex.num_levels(), 5U);
+
+        EXPECT_EQ(tex.level_width(1), 8U);
+        EXPECT_EQ(tex.level_height(1), 4U);
+        EXPECT_EQ(tex.level_width(4), 1U);
+        EXPECT_EQ(tex.level_height(4), 1U);
+
+        // Level 1 averages 2x2 blocks
+        vec4 const* l1 = tex.level_data(1);
+
+        for (int y = 0; y < 4; ++y)
+        {
+            for (int x = 0; x < 8; ++x)
+            {
+                vec4 expected = (data[(2 * y) * 16 + 2 * x]
+                               + data[(2 * y) * 16 + 2 * x + 1]
+                               + data[(2 * y + 1) * 16 + 2 * x]
+                               + data[(2 * y + 1) * 16 + 2 * x + 1]) * 0.25f;
+
+                EXPECT_FLOAT_EQ(l1[y * 8 + x].x, expected.x);
+                EXPECT_FLOAT_EQ(l1[y * 8 + x].y, expected.y);
+                EXPECT_FLOAT_EQ(l1[y * 8 + x].z, expected.z);
+            }
+        }
+
+        // The last level is the average of all texels
+        vec4 avg = average(data);
+        vec4 last = tex.level_data(4)[0];
+
+        EXPECT_NEAR(last.x, avg.x, 1e-4f);
+        EXPECT_NEAR(last.y, avg.y, 1e-4f);
+        EXPECT_NEAR(last.z, avg.z, 1e-3f);
+    }
+
+    // Odd size, scalar texels, parallel generation
+    {
+        std::vector<float> data(7 * 5);
+
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            data[i] = static_cast<float>(i % 11);
+        }
+
+        texture<float, 2> tex(7, 5);
+        tex.reset(data.data());
+
+        thread_pool pool(2);
+        tex.generate_mipmaps(pool);
+
+        ASSERT_EQ(tex.num_levels(), 3U);
+
+        EXPECT_EQ(tex.level_width(1), 3U);
+        EXPECT_EQ(tex.level_height(1), 2U);
+        EXPECT_EQ(tex.level_width(2), 1U);
+        EXPECT_EQ(tex.level_height(2), 1U);
+
+        // Box filter weights cover the whole texture, so every level has the same average
+        for (unsigned l = 1; l < tex.num_levels(); ++l)
+        {
+            size_t n = tex.level_width(l) * tex.level_height(l);
+            std::vector<float> level(tex.level_data(l), tex.level_data(l) + n);
+
+            EXPECT_NEAR(average(level), average(data), 1e-4f);
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test tex2D() with level of detail
+//
+
+TEST(Mipmap, Lookup)
+{
+    auto data = make_texels(16, 16);
+
+    texture<vec4, 2> tex(16, 16);
+    tex.reset(data.data());
+    tex.set_filter_mode(Nearest);
+    tex.set_address_mode(Clamp);
+    tex.generate_mipmaps();
+
+    texture_ref<vec4, 2> ref(tex);
+
+    ASSERT_EQ(ref.num_levels(), 5U);
+
+    vec2 coords[] = { vec2(0.1f, 0.2f), vec2(0.5f, 0.5f), vec2(0.9f, 0.3f) };
+
+    for (auto const& c : coords)
+    {
+        // LOD 0 (and below) samples the base level
+        vec4 base = tex2D(ref, c);
+        vec4 l0 = tex2D(ref, c, 0.0f);
+        vec4 neg = tex2D(ref, c, -2.0f);
+
+        EXPECT_FLOAT_EQ(l0.x, base.x);
+        EXPECT_FLOAT_EQ(l0.z, base.z);
+        EXPECT_FLOAT_EQ(neg.x, base.x);
+
+        // LOD beyond the last level samples the average
+        vec4 coarse = tex2D(ref, c, 10.0f);
+        vec4 avg = average(data);
+
+        EXPECT_NEAR(coarse.x, avg.x, 1e-4f);
+        EXPECT_NEAR(coarse.z, avg.z, 1e-3f);
+
+        // Fractional levels interpolate
+        vec4 a = tex2D(ref, c, 1.0f);
+        vec4 b = tex2D(ref, c, 2.0f);
+        vec4 m = tex2D(ref, c, 1.25f);
+
+        EXPECT_NEAR(m.x, a.x * 0.75f + b.x * 0.25f, 1e-4f);
+        EXPECT_NEAR(m.y, a.y * 0.75f + b.y * 0.25f, 1e-4f);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that camera ray differentials yield the expected level of detail
+//
+
+TEST(Mipmap, RayDifferentials)
+{
+    const int width = 64;
+    const int height = 64;
+
+    pinhole_camera cam;
+    cam.set_viewport(0, 0, width, height);
+    cam.perspective(45.0f * constants::degrees_to_radians<float>(), 1.0f, 0.001f, 1000.0f);
+    cam.look_at(vec3(0.0f, 0.0f, 2.0f), vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
+    cam.begin_frame();
+
+    auto ray = cam.primary_ray(ray_differential{}, 32.0f, 32.0f, float(width), float(height));
+    auto x1 = cam.primary_ray(basic_ray<float>{}, 33.0f, 32.0f, float(width), float(height));
+
+    EXPECT_NEAR(ray.dddx.x, x1.dir.x - ray.dir.x, 1e-6f);
+    EXPECT_NEAR(ray.dddx.y, x1.dir.y - ray.dir.y, 1e-6f);
+    EXPECT_FLOAT_EQ(ray.dodx.x, 0.0f);
+
+    cam.end_frame();
+
+
+    // Quad in the z=0 plane with texture coordinates [0,1]^2 over [-1,1]^2
+    basic_triangle<3, float> tri(vec3(-1.0f, -1.0f, 0.0f), vec3(2.0f, 0.0f, 0.0f), vec3(0.0f, 2.0f, 0.0f));
+
+    vec2 duvdx;
+    vec2 duvdy;
+    tex_coord_derivatives(ray, tri, vec2(0.0f, 0.0f), vec2(1.0f, 0.0f), vec2(0.0f, 1.0f), duvdx, duvdy);
+
+    // The quad covers tan(22.5 deg) * 2 * 2 = 1.66 world units across the screen, i.e.
+    // 1.0 / (1.66 / 2.0) * 64 ~ 77 pixels span the texture
+    float pixels = width / std::tan(22.5f * constants::degrees_to_radians<float>()) / 2.0f;
+
+    EXPECT_NEAR(duvdx.x, 1.0f / pixels, 1e-3f);
+    EXPECT_NEAR(std::abs(duvdy.y), 1.0f / pixels, 1e-3f);
+    EXPECT_NEAR(duvdx.y, 0.0f, 1e-4f);
+
+    // A texture with pixels texels maps one texel to one pixel
+    EXPECT_NEAR(texture_lod(duvdx, duvdy, pixels, pixels), 0.0f, 1e-2f);
+
+    // A texture with 4x the resolution is minified by 4, i.e. level 2
+    EXPECT_NEAR(texture_lod(duvdx, duvdy, 4.0f * pixels, 4.0f * pixels), 2.0f, 1e-2f);
+
+    // Rays without differentials select the base level
+    ray_differential r(ray.ori, ray.dir);
+    tex_coord_derivatives(r, tri, vec2(0.0f, 0.0f), vec2(1.0f, 0.0f), vec2(0.0f, 1.0f), duvdx, duvdy);
+
+    EXPECT_LE(texture_lod(duvdx, duvdy, 1024.0f, 1024.0f), 0.0f);
+}
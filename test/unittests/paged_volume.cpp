@@ -0,0 +1,260 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <visionaray/math/math.h>
+#include <visionaray/texture/texture.h>
+#include <visionaray/paged_volume.h>
+#include <visionaray/random_generator.h>
+#include <visionaray/volume_integrator.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+static texture<float, 3> make_volume(int w, int h, int d)
+{
+    std::vector<float> data(w * h * d);
+
+    for (int z = 0; z < d; ++z)
+    {
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                data[(z * h + y) * w + x] = float((x * 7 + y * 13 + z * 5) % 17) / 16.0f;
+            }
+        }
+    }
+
+    texture<float, 3> tex(w, h, d);
+    tex.reset(data.data());
+    tex.set_address_mode(Clamp);
+    return tex;
+}
+
+// Removes the file when going out of scope
+struct temp_file
+{
+    explicit temp_file(std::string n) : name(n) {}
+   ~temp_file() { std::remove(name.c_str()); }
+
+    std::string name;
+};
+
+// Cache slot of a brick, -1 if not resident
+static int slot(paged_volume<float> const& paged, int level, int x, int y, int z)
+{
+    auto ref = paged.ref();
+    auto const& lev = ref.levels[level];
+    return ref.page_table[lev.first_brick + (z * lev.bricks.y + y) * lev.bricks.x + x];
+}
+
+// Render a few frames, requests of a frame are resident two frames later if they fit
+static void render_frames(paged_volume<float>& paged, std::vector<vec3> const& coords, int num_frames = 3)
+{
+    for (int i = 0; i < num_frames; ++i)
+    {
+        auto ref = paged.ref();
+
+        for (auto const& c : coords)
+        {
+            tex3D(ref, c);
+        }
+
+        paged.finish();
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test writing and reading the file format
+//
+
+TEST(PagedVolume, File)
+{
+    temp_file file("paged_volume_file_test.pvol");
+
+    const int w = 37;
+    const int h = 20;
+    const int d = 45;
+
+    auto volume = make_volume(w, h, d);
+    auto const& cvolume = volume;
+
+    ASSERT_TRUE(write_paged_volume(file.name, volume, 8));
+
+    paged_volume<float> paged;
+    ASSERT_TRUE(paged.open(file.name, 0));
+
+    EXPECT_EQ(paged.width(), size_t(w));
+    EXPECT_EQ(paged.height(), size_t(h));
+    EXPECT_EQ(paged.depth(), size_t(d));
+    EXPECT_EQ(paged.brick_size(), 8);
+
+    // 37x20x45, 19x10x23, 10x5x12, 5x3x6
+    EXPECT_EQ(paged.num_levels(), 4);
+
+    // One brick plus the coarsest level
+    EXPECT_EQ(paged.num_cache_slots(), 2);
+
+    for (int z = 0; z < d; ++z)
+    {
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                EXPECT_FLOAT_EQ(paged(x, y, z), cvolume(x, y, z));
+            }
+        }
+    }
+
+    // The coarsest level is resident
+    EXPECT_EQ(slot(paged, 0, 0, 0, 0), -1);
+    EXPECT_EQ(slot(paged, 3, 0, 0, 0), 0);
+
+    // Wrong voxel type
+    paged_volume<unorm<8>> paged8;
+    EXPECT_FALSE(paged8.open(file.name, 1 << 20));
+
+    // No such file
+    EXPECT_FALSE(paged.open("paged_volume_missing.pvol", 1 << 20));
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test sampling with coarse fallback and after loading
+//
+
+TEST(PagedVolume, Sampling)
+{
+    temp_file file("paged_volume_sampling_test.pvol");
+
+    const int w = 30;
+    const int h = 17;
+    const int d = 21;
+
+    auto volume = make_volume(w, h, d);
+
+    ASSERT_TRUE(write_paged_volume(file.name, volume, 8));
+
+    // Large enough for all bricks of the finest level
+    paged_volume<float> paged;
+    ASSERT_TRUE(paged.open(file.name, 64 * 10 * 10 * 10 * sizeof(float)));
+
+    random_generator<float> gen(7);
+    std::vector<vec3> coords;
+
+    for (int i = 0; i < 500; ++i)
+    {
+        // Also sample outside [0,1) to exercise the address mode
+        coords.push_back(vec3(gen.next() * 1.4f - 0.2f, gen.next() * 1.4f - 0.2f, gen.next() * 1.4f - 0.2f));
+    }
+
+    // Fall back to the coarser levels, each missing brick is requested once, also the
+    // brick at level 1 (the coarsest level is level 2)
+    auto ref = paged.ref();
+    tex3D(ref, vec3(0.5f));
+    tex3D(ref, vec3(0.5f));
+    ASSERT_EQ(ref.num_requests->load(), 2);
+    EXPECT_EQ(ref.requests[0], ref.levels[0].first_brick + (1 * 3 + 1) * 4 + 1);
+    EXPECT_EQ(ref.requests[1], ref.levels[1].first_brick);
+
+    render_frames(paged, coords);
+
+    for (auto filter_mode : { Nearest, Linear })
+    {
+        volume.set_filter_mode(filter_mode);
+        paged.set_filter_mode(filter_mode);
+
+        ref = paged.ref();
+
+        for (auto const& c : coords)
+        {
+            EXPECT_NEAR(tex3D(ref, c), tex3D(volume, c), 1e-5f);
+        }
+
+        // SIMD coordinates
+        for (size_t i = 0; i + 4 <= coords.size(); i += 4)
+        {
+            vector<3, simd::float4> c4(
+                    simd::float4(coords[i].x, coords[i + 1].x, coords[i + 2].x, coords[i + 3].x),
+                    simd::float4(coords[i].y, coords[i + 1].y, coords[i + 2].y, coords[i + 3].y),
+                    simd::float4(coords[i].z, coords[i + 1].z, coords[i + 2].z, coords[i + 3].z)
+                    );
+
+            simd::aligned_array_t<simd::float4> s;
+            store(s, tex3D(ref, c4));
+
+            for (int j = 0; j < 4; ++j)
+            {
+                EXPECT_FLOAT_EQ(s[j], tex3D(ref, coords[i + j]));
+            }
+        }
+    }
+
+    // Paged volumes can be used for empty space skipping and integration
+    macrocell_grid cells;
+    cells.build(paged, 8);
+
+    volume_integrator<float, paged_volume_ref<float>> integrator;
+    integrator.set_volume(paged.ref(), cells.ref());
+
+    EXPECT_EQ(cells.ref().dims, vec3i(4, 3, 3));
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test least recently used replacement
+//
+
+TEST(PagedVolume, Replacement)
+{
+    temp_file file("paged_volume_replacement_test.pvol");
+
+    // 2x2x1 bricks, the second level is the coarsest one, so only bricks of the finest
+    // level are requested
+    auto volume = make_volume(16, 16, 8);
+
+    ASSERT_TRUE(write_paged_volume(file.name, volume, 8));
+
+    // Two slots for the finest level
+    paged_volume<float> paged;
+    ASSERT_TRUE(paged.open(file.name, 2 * 10 * 10 * 10 * sizeof(float)));
+    ASSERT_EQ(paged.num_cache_slots(), 3);
+
+    // Centers of three bricks of the finest level
+    vec3 a(0.25f, 0.25f, 0.5f);
+    vec3 b(0.75f, 0.25f, 0.5f);
+    vec3 c(0.25f, 0.75f, 0.5f);
+
+    render_frames(paged, { a, b });
+
+    EXPECT_NE(slot(paged, 0, 0, 0, 0), -1);
+    EXPECT_NE(slot(paged, 0, 1, 0, 0), -1);
+    EXPECT_EQ(slot(paged, 0, 0, 1, 0), -1);
+
+    // b was not used in the frame that requested c
+    render_frames(paged, { a, c });
+
+    EXPECT_NE(slot(paged, 0, 0, 0, 0), -1);
+    EXPECT_EQ(slot(paged, 0, 1, 0, 0), -1);
+    EXPECT_NE(slot(paged, 0, 0, 1, 0), -1);
+
+    // Working set exceeds the cache, the missing brick falls back to the coarser level
+    render_frames(paged, { a, b, c });
+
+    int resident = 0;
+    resident += slot(paged, 0, 0, 0, 0) != -1 ? 1 : 0;
+    resident += slot(paged, 0, 1, 0, 0) != -1 ? 1 : 0;
+    resident += slot(paged, 0, 0, 1, 0) != -1 ? 1 : 0;
+    EXPECT_EQ(resident, 2);
+}
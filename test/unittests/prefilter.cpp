@@ -0,0 +1,182 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <vector>
+
+#include <visionaray/detail/thread_pool.h>
+#include <visionaray/math/math.h>
+#include <visionaray/texture/texture.h>
+#include <visionaray/random_generator.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+// Smooth function, values in [0.25,0.75]
+static float func(vec3 const& p)
+{
+    return 0.5f + 0.25f * sin(p.x * 9.0f) * cos(p.y * 7.0f) * cos(p.z * 5.0f);
+}
+
+// Function sampled at the voxel centers
+static std::vector<float> make_voxels(int w, int h, int d)
+{
+    std::vector<float> data(w * h * d);
+
+    for (int z = 0; z < d; ++z)
+    {
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                data[(z * h + y) * w + x] = func((vec3(x, y, z) + vec3(0.5f)) / vec3(w, h, d));
+            }
+        }
+    }
+
+    return data;
+}
+
+// Texture coordinate between voxel (x,y,z) and its neighbors
+template <typename Tex>
+static vec3 coord_between(Tex const& tex, int x, int y, int z)
+{
+    return (vec3(x, y, z) + vec3(0.8f, 0.7f, 0.9f)) / vec3(tex.width(), tex.height(), tex.depth());
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that B-spline filtering of the coefficients interpolates the voxels
+//
+// Compares with the sampled function between voxel centers, where interpolation is much
+// more accurate than B-spline approximation of the voxels
+//
+
+TEST(Prefilter, Interpolation)
+{
+    const int w = 20;
+    const int h = 17;
+    const int d = 23;
+
+    auto voxels = make_voxels(w, h, d);
+
+    // Parallel prefiltering yields the same coefficients
+    auto coeffs = voxels;
+    convert_for_bspline_interpol(coeffs.data(), w, h, d);
+
+    thread_pool pool(4);
+    auto parallel_coeffs = voxels;
+    convert_for_bspline_interpol(parallel_coeffs.data(), w, h, d, pool);
+
+    for (size_t i = 0; i < coeffs.size(); ++i)
+    {
+        EXPECT_FLOAT_EQ(coeffs[i], parallel_coeffs[i]);
+    }
+
+    texture<float, 3> original(w, h, d);
+    original.reset(voxels.data());
+    original.set_filter_mode(BSpline);
+    original.set_address_mode(Clamp);
+
+    texture<float, 3> prefiltered(w, h, d);
+    prefiltered.reset(coeffs.data());
+    prefiltered.set_filter_mode(BSpline);
+    prefiltered.set_address_mode(Clamp);
+
+    texture_ref<float, 3> original_ref(original);
+    texture_ref<float, 3> prefiltered_ref(prefiltered);
+
+    // Away from the borders, where the boundary conditions don't matter
+    float max_error = 0.0f;
+    float max_smoothing_error = 0.0f;
+
+    for (int z = 3; z < d - 3; ++z)
+    {
+        for (int y = 3; y < h - 3; ++y)
+        {
+            for (int x = 3; x < w - 3; ++x)
+            {
+                vec3 coord = coord_between(prefiltered_ref, x, y, z);
+                float expected = func(coord);
+                max_error = max(max_error, abs(tex3D(prefiltered_ref, coord) - expected));
+                max_smoothing_error = max(max_smoothing_error, abs(tex3D(original_ref, coord) - expected));
+            }
+        }
+    }
+
+    EXPECT_LT(max_error, 1e-3f);
+
+    // Without prefiltering, B-spline filtering smoothes the data
+    EXPECT_GT(max_smoothing_error, max_error * 4.0f);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test 16-bit voxels and 2D data
+//
+
+TEST(Prefilter, FormatsAndDimensions)
+{
+    const int w = 19;
+    const int h = 21;
+    const int d = 13;
+
+    auto voxels = make_voxels(w, h, d);
+
+    std::vector<unorm<16>> coeffs(voxels.begin(), voxels.end());
+    thread_pool pool(4);
+    convert_for_bspline_interpol(coeffs.data(), w, h, d, pool);
+
+    texture<unorm<16>, 3> prefiltered(w, h, d);
+    prefiltered.reset(coeffs.data());
+    prefiltered.set_filter_mode(BSpline);
+    prefiltered.set_address_mode(Clamp);
+
+    texture_ref<unorm<16>, 3> prefiltered_ref(prefiltered);
+
+    for (int z = 3; z < d - 3; ++z)
+    {
+        for (int y = 3; y < h - 3; ++y)
+        {
+            for (int x = 3; x < w - 3; ++x)
+            {
+                vec3 coord = coord_between(prefiltered_ref, x, y, z);
+                EXPECT_NEAR(static_cast<float>(tex3D(prefiltered_ref, coord)), func(coord), 2e-3f);
+            }
+        }
+    }
+
+    // 2D data, filtering groups of lines agrees with filtering rows, then columns one by one
+    std::vector<float> slice(voxels.begin(), voxels.begin() + w * h);
+    convert_for_bspline_interpol(slice.data(), w, h, 1);
+
+    std::vector<float> expected(voxels.begin(), voxels.begin() + w * h);
+
+    for (int y = 0; y < h; ++y)
+    {
+        convert_for_bspline_interpol(expected.data() + y * w, w, 1, 1);
+    }
+
+    for (int x = 0; x < w; ++x)
+    {
+        // Columns of a transposed copy
+        std::vector<float> column(h);
+
+        for (int y = 0; y < h; ++y)
+        {
+            column[y] = expected[y * w + x];
+        }
+
+        convert_for_bspline_interpol(column.data(), h, 1, 1);
+
+        for (int y = 0; y < h; ++y)
+        {
+            EXPECT_FLOAT_EQ(slice[y * w + x], column[y]);
+        }
+    }
+}
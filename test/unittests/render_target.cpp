@@ -2,6 +2,7 @@
 // See the LICENSE file for details
 
 #include <visionaray/math/math.h>
+#include <visionaray/accum_buffer_rt.h>
 #include <visionaray/result_record.h>
 #include <visionaray/simple_buffer_rt.h>
 #include <visionaray/scheduler.h>
@@ -110,3 +111,478 @@ TEST(RenderTarget, PixelFormats)
     EXPECT_FLOAT_EQ(rt_RGBA32F.color()[0].y, 0.4f);
     EXPECT_FLOAT_EQ(rt_RGBA32F.color()[0].z, 0.4f);
 }
+
+
+//-------------------------------------------------------------------------------------------------
+// Test progressive rendering w/ accumulation buffer
+//
+
+TEST(RenderTarget, AccumBuffer)
+{
+    accum_buffer_rt<simple_buffer_rt<PF_RGBA8, PF_DEPTH32F>> rt;
+    rt.resize(3, 3);
+    rt.clear_color_buffer();
+    rt.clear_depth_buffer();
+
+    // dummies
+    mat4 mv = mat4::identity();
+    mat4 pr = mat4::identity();
+
+    auto sparams = make_sched_params(pixel_sampler::jittered_blend_type{}, mv, pr, rt);
+
+    simple_sched<ray> sched;
+
+    for (unsigned frame_num = 1; frame_num <= 4; ++frame_num)
+    {
+        sched.frame([&](ray) -> result_record<float>
+        {
+            result_record<float> result;
+            result.color = vec4(frame_num % 2 == 0 ? 1.0f : 0.0f);
+            return result;
+        }, sparams, frame_num);
+    }
+
+    for (int i = 0; i < rt.width() * rt.height(); ++i)
+    {
+        // Accumulated in floating point
+        EXPECT_FLOAT_EQ(rt.accum()[i].x, 0.5f);
+        EXPECT_FLOAT_EQ(rt.accum()[i].w, 0.5f);
+
+        // Resolved to RGBA8 in end_frame()
+        EXPECT_EQ(rt.color()[i].x.value, 127);
+        EXPECT_EQ(rt.color()[i].w.value, 127);
+
+        // No hits, depth is written to the wrapped render target
+        EXPECT_FLOAT_EQ(rt.depth()[i], 1.0f);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that the SIMD resolve of the accumulation buffer matches per-pixel conversion
+//
+
+TEST(RenderTarget, AccumBufferResolve)
+{
+    // Several chunks of pixels, not a multiple of the SIMD width, resolved on the caller's threads
+    thread_pool pool(4);
+    accum_buffer_rt<simple_buffer_rt<PF_RGBA8, PF_UNSPECIFIED>> rt(&pool);
+    rt.resize(67, 71);
+    rt.clear_color_buffer();
+
+    int num_pixels = rt.width() * rt.height();
+
+    for (int i = 0; i < num_pixels; ++i)
+    {
+        // Includes values outside [0,1]
+        rt.accum()[i] = vec4(
+                (i % 300) / 256.0f,
+                (i % 7) / 6.0f,
+                -(i % 3) / 2.0f,
+                1.0f - (i % 11) / 10.0f
+                );
+    }
+
+    rt.end_frame();
+
+    for (int i = 0; i < num_pixels; ++i)
+    {
+        vector<4, unorm<8>> expected;
+        convert(pixel_format_constant<PF_RGBA8>{}, pixel_format_constant<PF_RGBA32F>{}, expected, rt.accum()[i]);
+
+        EXPECT_EQ(rt.color()[i].x.value, expected.x.value);
+        EXPECT_EQ(rt.color()[i].y.value, expected.y.value);
+        EXPECT_EQ(rt.color()[i].z.value, expected.z.value);
+        EXPECT_EQ(rt.color()[i].w.value, expected.w.value);
+    }
+
+    // Unaligned source and odd number of pixels
+    aligned_vector<vector<4, unorm<8>>> target(num_pixels);
+    convert(
+            pixel_format_constant<PF_RGBA8>{},
+            pixel_format_constant<PF_RGBA32F>{},
+            target.data() + 1,
+            rt.accum() + 1,
+            num_pixels - 2
+            );
+
+    for (int i = 1; i < num_pixels - 1; ++i)
+    {
+        EXPECT_EQ(target[i].x.value, rt.color()[i].x.value);
+        EXPECT_EQ(target[i].w.value, rt.color()[i].w.value);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test progressive rendering w/ accumulation buffer and tile-major wrapped render target
+//
+
+template <typename R>
+void test_accum_buffer_tiled()
+{
+    using S = typename R::scalar_type;
+
+    // Not a multiple of the tile size
+    accum_buffer_rt<simple_buffer_rt<PF_RGBA8, PF_DEPTH32F>> rt;
+    rt.target().set_layout(RT_TILED);
+    rt.resize(37, 21);
+    rt.clear_color_buffer();
+    rt.clear_depth_buffer();
+
+    // dummies
+    mat4 mv = mat4::identity();
+    mat4 pr = mat4::identity();
+
+    auto sparams = make_sched_params(pixel_sampler::jittered_blend_type{}, mv, pr, rt);
+
+    tiled_sched<R> sched(2);
+
+    for (unsigned frame_num = 1; frame_num <= 4; ++frame_num)
+    {
+        sched.frame([&](R, int x, int /* y */) -> result_record<S>
+        {
+            result_record<S> result;
+            result.color = vector<4, S>(frame_num % 2 == 0 ? 1.0f : 0.0f);
+            result.isect_pos = vector<3, S>(S(0.0f), S(0.0f), S(static_cast<float>(x) / 32.0f - 1.0f));
+            result.hit = true;
+            return result;
+        }, sparams, frame_num);
+    }
+
+    const int pw = packet_size<S>::w;
+
+    for (int y = 0; y < rt.height(); ++y)
+    {
+        for (int x = 0; x < rt.width(); ++x)
+        {
+            int i = y * rt.width() + x;
+
+            // Resolved to row-major order in end_frame()
+            EXPECT_FLOAT_EQ(rt.accum()[i].x, 0.5f);
+
+            // Not overwritten by the unused tiled color storage of the wrapped target
+            EXPECT_EQ(rt.color()[i].x.value, 127);
+            EXPECT_EQ(rt.color()[i].w.value, 127);
+
+            // Depth is written to the tiled depth storage of the wrapped target
+            // (identity matrices, depth = (z + 1) / 2)
+            EXPECT_FLOAT_EQ(rt.depth()[i], static_cast<float>(x - x % pw) / 64.0f);
+        }
+    }
+}
+
+TEST(RenderTarget, AccumBufferTiled)
+{
+    test_accum_buffer_tiled<ray>();
+    test_accum_buffer_tiled<simd::ray4>();
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test if AOVs are written in the same pass as color
+//
+
+template <typename R>
+void test_aovs()
+{
+    using S = typename R::scalar_type;
+    using I = simd::int_type_t<S>;
+
+    // Width is not a multiple of the packet width
+    simple_buffer_rt<PF_RGBA32F, PF_DEPTH32F> rt;
+    rt.aovs().set_layers(AOV_NORMAL | AOV_PRIM_ID | AOV_SAMPLE_COUNT);
+    rt.resize(5, 3);
+    rt.clear_color_buffer();
+    rt.clear_depth_buffer();
+
+    EXPECT_EQ(rt.aovs().albedo(0), nullptr);
+    EXPECT_EQ(rt.aovs().geom_id(), nullptr);
+
+    // dummies
+    mat4 mv = mat4::identity();
+    mat4 pr = mat4::identity();
+
+    auto sparams = make_sched_params(pixel_sampler::jittered_blend_type{}, mv, pr, rt);
+
+    tiled_sched<R> sched(2);
+
+    for (unsigned frame_num = 1; frame_num <= 3; ++frame_num)
+    {
+        sched.frame([&](R) -> aov_result_record<S>
+        {
+            aov_result_record<S> result;
+            result.color = vector<4, S>(0.5f);
+            result.normal = vector<3, S>(0.0f, 0.0f, static_cast<float>(frame_num));
+            result.prim_id = I(static_cast<int>(frame_num));
+            return result;
+        }, sparams, frame_num);
+    }
+
+    for (int i = 0; i < rt.width() * rt.height(); ++i)
+    {
+        EXPECT_FLOAT_EQ(rt.color()[i].x, 0.5f);
+
+        // Averaged over all samples
+        EXPECT_FLOAT_EQ(rt.aovs().normal(0)[i], 0.0f);
+        EXPECT_FLOAT_EQ(rt.aovs().normal(2)[i], 2.0f);
+
+        // Ids are taken from the last sample
+        EXPECT_EQ(rt.aovs().prim_id()[i], 3);
+
+        EXPECT_EQ(rt.aovs().sample_count()[i], 3U);
+    }
+
+    // Clearing the color buffer also resets the AOV layers
+    rt.clear_color_buffer();
+
+    for (int i = 0; i < rt.width() * rt.height(); ++i)
+    {
+        EXPECT_FLOAT_EQ(rt.aovs().normal(2)[i], 0.0f);
+        EXPECT_EQ(rt.aovs().prim_id()[i], -1);
+        EXPECT_EQ(rt.aovs().sample_count()[i], 0U);
+    }
+}
+
+TEST(RenderTarget, AOVs)
+{
+    test_aovs<ray>();
+    test_aovs<simd::ray4>();
+}
+
+TEST(RenderTarget, AOVSampleCount)
+{
+    simple_buffer_rt<PF_RGBA32F, PF_DEPTH32F> rt;
+    rt.aovs().set_layers(AOV_NORMAL | AOV_SAMPLE_COUNT);
+    rt.resize(3, 2);
+    rt.clear_color_buffer();
+    rt.clear_depth_buffer();
+
+    // dummies
+    mat4 mv = mat4::identity();
+    mat4 pr = mat4::identity();
+
+    // Several samples per pixel and frame, averaged within the frame
+    auto sparams = make_sched_params(pixel_sampler::ssaa_type<4>{}, mv, pr, rt);
+
+    simple_sched<ray> sched;
+
+    int sample = 0;
+
+    for (unsigned frame_num = 1; frame_num <= 2; ++frame_num)
+    {
+        sched.frame([&](ray) -> aov_result_record<float>
+        {
+            aov_result_record<float> result;
+            result.color = vec4(1.0f);
+            result.normal = vec3(static_cast<float>(sample++ % 4), 0.0f, 0.0f);
+            return result;
+        }, sparams, frame_num);
+    }
+
+    for (int i = 0; i < rt.width() * rt.height(); ++i)
+    {
+        EXPECT_FLOAT_EQ(rt.color()[i].x, 1.0f);
+        EXPECT_FLOAT_EQ(rt.aovs().normal(0)[i], 1.5f);
+        EXPECT_EQ(rt.aovs().sample_count()[i], 4U);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test tile-major storage
+//
+
+template <typename R>
+void test_tiled_layout(thread_pool* pool)
+{
+    using S = typename R::scalar_type;
+
+    const int pw = packet_size<S>::w;
+    const int ph = packet_size<S>::h;
+
+    // Not a multiple of the tile size
+    simple_buffer_rt<PF_RGBA32F, PF_DEPTH32F> rt;
+    rt.set_layout(RT_TILED, pool);
+    rt.aovs().set_layers(AOV_SAMPLE_COUNT);
+    rt.resize(37, 21);
+    rt.clear_color_buffer();
+    rt.clear_depth_buffer();
+
+    // dummies
+    mat4 mv = mat4::identity();
+    mat4 pr = mat4::identity();
+
+    auto sparams = make_sched_params(pixel_sampler::jittered_blend_type{}, mv, pr, rt);
+
+    tiled_sched<R> sched(2);
+
+    for (unsigned frame_num = 1; frame_num <= 2; ++frame_num)
+    {
+        // Kernel receives image coordinates of the packet
+        sched.frame([&](R, int x, int y) -> result_record<S>
+        {
+            result_record<S> result;
+            result.color = vector<4, S>(
+                    S(static_cast<float>(x)),
+                    S(static_cast<float>(y)),
+                    S(static_cast<float>(frame_num)),
+                    S(1.0f)
+                    );
+            return result;
+        }, sparams, frame_num);
+    }
+
+    for (int y = 0; y < rt.height(); ++y)
+    {
+        for (int x = 0; x < rt.width(); ++x)
+        {
+            // Resolved to row-major order in end_frame()
+            vec4 c = rt.color()[y * rt.width() + x];
+            EXPECT_FLOAT_EQ(c.x, static_cast<float>(x - x % pw));
+            EXPECT_FLOAT_EQ(c.y, static_cast<float>(y - y % ph));
+
+            // Blended with the first frame, read from tiled storage
+            EXPECT_FLOAT_EQ(c.z, 1.5f);
+
+            // No hits
+            EXPECT_FLOAT_EQ(rt.depth()[y * rt.width() + x], 1.0f);
+
+            // AOVs are stored in row-major order
+            EXPECT_EQ(rt.aovs().sample_count()[y * rt.width() + x], 2U);
+        }
+    }
+}
+
+TEST(RenderTarget, TiledLayout)
+{
+    test_tiled_layout<ray>(nullptr);
+    test_tiled_layout<simd::ray4>(nullptr);
+    test_tiled_layout<simd::ray8>(nullptr);
+
+    // Resolve tiles on the caller's threads
+    thread_pool pool(3);
+    test_tiled_layout<ray>(&pool);
+    test_tiled_layout<simd::ray8>(&pool);
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that full packets (fast path) and edge packets (per-lane path) store and get the same
+// pixels as the scalar code path
+//
+
+template <typename S>
+void test_packet_access()
+{
+    using namespace detail::pixel_access;
+
+    using float_array = simd::aligned_array_t<S>;
+
+    const int pw = packet_size<S>::w;
+    const int ph = packet_size<S>::h;
+    const int num_lanes = simd::num_elements<S>::value;
+
+    // Edge packets on the right and bottom
+    const int width  = 3 * pw + 1;
+    const int height = 2 * ph + 1;
+    const int size   = width * height;
+
+    aligned_vector<vec4>                rgba32f(size);
+    aligned_vector<vector<4, unorm<8>>> rgba8(size);
+    aligned_vector<float>               depth(size);
+
+    for (int y = 0; y < height; y += ph)
+    {
+        for (int x = 0; x < width; x += pw)
+        {
+            float_array r;
+            float_array g;
+            float_array b;
+            float_array a;
+
+            for (int i = 0; i < num_lanes; ++i)
+            {
+                int px = x + i % pw;
+                int py = y + i / pw;
+                r[i] = px / 16.0f;
+                g[i] = py / 16.0f;
+                b[i] = 0.3f;
+                a[i] = 1.0f - px / 32.0f;
+            }
+
+            auto color = vector<4, S>(S(r), S(g), S(b), S(a));
+
+            store(pixel_format_constant<PF_RGBA32F>{}, pixel_format_constant<PF_RGBA32F>{}, x, y, width, height, color, rgba32f.data());
+            store(pixel_format_constant<PF_RGBA8>{}, pixel_format_constant<PF_RGBA32F>{}, x, y, width, height, color, rgba8.data());
+            store(pixel_format_constant<PF_DEPTH32F>{}, pixel_format_constant<PF_DEPTH32F>{}, x, y, width, height, color.x, depth.data());
+        }
+    }
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            vec4 expected(x / 16.0f, y / 16.0f, 0.3f, 1.0f - x / 32.0f);
+
+            vector<4, unorm<8>> expected8;
+            convert(pixel_format_constant<PF_RGBA8>{}, pixel_format_constant<PF_RGBA32F>{}, expected8, expected);
+
+            int idx = y * width + x;
+
+            EXPECT_FLOAT_EQ(rgba32f[idx].x, expected.x);
+            EXPECT_FLOAT_EQ(rgba32f[idx].y, expected.y);
+            EXPECT_FLOAT_EQ(rgba32f[idx].z, expected.z);
+            EXPECT_FLOAT_EQ(rgba32f[idx].w, expected.w);
+
+            EXPECT_EQ(rgba8[idx].x.value, expected8.x.value);
+            EXPECT_EQ(rgba8[idx].y.value, expected8.y.value);
+            EXPECT_EQ(rgba8[idx].z.value, expected8.z.value);
+            EXPECT_EQ(rgba8[idx].w.value, expected8.w.value);
+
+            EXPECT_FLOAT_EQ(depth[idx], expected.x);
+        }
+    }
+
+    // Read back
+    for (int y = 0; y < height; y += ph)
+    {
+        for (int x = 0; x < width; x += pw)
+        {
+            vector<4, S> color;
+            S z;
+
+            get(pixel_format_constant<PF_RGBA32F>{}, pixel_format_constant<PF_RGBA32F>{}, x, y, width, height, color, rgba32f.data());
+            get(pixel_format_constant<PF_DEPTH32F>{}, pixel_format_constant<PF_DEPTH32F>{}, x, y, width, height, z, depth.data());
+
+            float_array r;
+            float_array a;
+            float_array zz;
+
+            simd::store(r, color.x);
+            simd::store(a, color.w);
+            simd::store(zz, z);
+
+            for (int i = 0; i < num_lanes; ++i)
+            {
+                int px = x + i % pw;
+                int py = y + i / pw;
+
+                if (px < width && py < height)
+                {
+                    EXPECT_FLOAT_EQ(r[i], px / 16.0f);
+                    EXPECT_FLOAT_EQ(a[i], 1.0f - px / 32.0f);
+                    EXPECT_FLOAT_EQ(zz[i], px / 16.0f);
+                }
+            }
+        }
+    }
+}
+
+TEST(RenderTarget, PacketAccess)
+{
+    test_packet_access<simd::float4>();
+#if VSNRAY_SIMD_ISA_GE(VSNRAY_SIMD_ISA_AVX)
+    test_packet_access<simd::float8>();
+#endif
+}
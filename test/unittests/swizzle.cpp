@@ -1,6 +1,8 @@
 // This file is distributed under the MIT license.
 // See the LICENSE file for details.
 
+#include <cmath>
+#include <cstdint>
 #include <vector>
 
 #include <visionaray/math/math.h>
@@ -307,3 +309,191 @@ TEST(Swizzle, Down)
         EXPECT_FLOAT_EQ(rgba8[i].w, static_cast<float>(unorm<8>(rgba32f[i].w)));
     }
 }
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that SIMD and parallel conversions match scalar conversions
+// Sizes are not multiples of the SIMD width so that remainders are also converted
+//
+
+TEST(Swizzle, Vectorized)
+{
+    // RGB8 -> RGBA8 -> RGB8
+
+    std::vector<unorm8_3> rgb8(1031);
+
+    for (size_t i = 0; i < rgb8.size(); ++i)
+    {
+        rgb8[i].x.value = static_cast<uint8_t>(i);
+        rgb8[i].y.value = static_cast<uint8_t>(i * 3);
+        rgb8[i].z.value = static_cast<uint8_t>(255 - i);
+    }
+
+    std::vector<unorm8_4> rgba8(rgb8.size());
+
+    swizzle(rgba8.data(), PF_RGBA8, rgb8.data(), PF_RGB8, rgba8.size(), AlphaIsOne);
+
+    for (size_t i = 0; i < rgb8.size(); ++i)
+    {
+        EXPECT_EQ(rgba8[i].x.value, rgb8[i].x.value);
+        EXPECT_EQ(rgba8[i].y.value, rgb8[i].y.value);
+        EXPECT_EQ(rgba8[i].z.value, rgb8[i].z.value);
+        EXPECT_EQ(rgba8[i].w.value, 255);
+    }
+
+    std::vector<unorm8_3> rgb8_cpy(rgba8.size());
+
+    swizzle(rgb8_cpy.data(), PF_RGB8, rgba8.data(), PF_RGBA8, rgb8_cpy.size(), TruncateAlpha);
+
+    for (size_t i = 0; i < rgb8.size(); ++i)
+    {
+        EXPECT_EQ(rgb8_cpy[i].x.value, rgb8[i].x.value);
+        EXPECT_EQ(rgb8_cpy[i].y.value, rgb8[i].y.value);
+        EXPECT_EQ(rgb8_cpy[i].z.value, rgb8[i].z.value);
+    }
+
+
+    // RGBA8 -> RGBA32F, all 8-bit values
+
+    rgba8.resize(258);
+
+    for (size_t i = 0; i < rgba8.size(); ++i)
+    {
+        rgba8[i].x.value = static_cast<uint8_t>(i);
+        rgba8[i].y.value = static_cast<uint8_t>(255 - i);
+        rgba8[i].z.value = static_cast<uint8_t>(i / 2);
+        rgba8[i].w.value = static_cast<uint8_t>(i * 7);
+    }
+
+    std::vector<vec4> rgba32f(rgba8.size());
+
+    swizzle(rgba32f.data(), PF_RGBA32F, rgba8.data(), PF_RGBA8, rgba32f.size());
+
+    for (size_t i = 0; i < rgba8.size(); ++i)
+    {
+        EXPECT_EQ(rgba32f[i].x, static_cast<float>(rgba8[i].x));
+        EXPECT_EQ(rgba32f[i].y, static_cast<float>(rgba8[i].y));
+        EXPECT_EQ(rgba32f[i].z, static_cast<float>(rgba8[i].z));
+        EXPECT_EQ(rgba32f[i].w, static_cast<float>(rgba8[i].w));
+    }
+
+
+    // RGBA32F -> RGBA8
+
+    rgba32f.resize(1027);
+
+    for (size_t i = 0; i < rgba32f.size(); ++i)
+    {
+        float f = static_cast<float>(i) / rgba32f.size();
+        rgba32f[i] = vec4(f, 1.0f - f, f * 2.0f, f - 0.5f);
+    }
+
+    rgba8.resize(rgba32f.size());
+
+    swizzle(rgba8.data(), PF_RGBA8, rgba32f.data(), PF_RGBA32F, rgba8.size());
+
+    for (size_t i = 0; i < rgba32f.size(); ++i)
+    {
+        EXPECT_EQ(rgba8[i].x.value, unorm<8>(rgba32f[i].x).value);
+        EXPECT_EQ(rgba8[i].y.value, unorm<8>(rgba32f[i].y).value);
+        EXPECT_EQ(rgba8[i].z.value, unorm<8>(rgba32f[i].z).value);
+        EXPECT_EQ(rgba8[i].w.value, unorm<8>(rgba32f[i].w).value);
+    }
+
+
+    // R16UI -> R32F, large enough to be converted in parallel
+
+    std::vector<unorm<16>> r16ui((size_t(1) << 20) + 3);
+
+    for (size_t i = 0; i < r16ui.size(); ++i)
+    {
+        r16ui[i].value = static_cast<uint16_t>(i * 31);
+    }
+
+    std::vector<float> r32f(r16ui.size());
+
+    thread_pool pool(4);
+    swizzle(r32f.data(), PF_R32F, r16ui.data(), PF_R16UI, r32f.size(), pool);
+
+    for (size_t i = 0; i < r16ui.size(); ++i)
+    {
+        ASSERT_EQ(r32f[i], static_cast<float>(r16ui[i]));
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test sRGB <-> linear conversions
+//
+
+TEST(Swizzle, SRGB)
+{
+    std::vector<unorm8_4> srgb8(256);
+
+    for (size_t i = 0; i < srgb8.size(); ++i)
+    {
+        srgb8[i].x.value = static_cast<uint8_t>(i);
+        srgb8[i].y.value = static_cast<uint8_t>(255 - i);
+        srgb8[i].z.value = static_cast<uint8_t>(i / 2);
+        srgb8[i].w.value = static_cast<uint8_t>(i);
+    }
+
+    std::vector<vec4> linear(srgb8.size());
+
+    swizzle(linear.data(), PF_RGBA32F, srgb8.data(), PF_RGBA8, linear.size(), DecodeSRGB);
+
+    for (size_t i = 0; i < srgb8.size(); ++i)
+    {
+        float c = i / 255.0f;
+        float expected = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+
+        EXPECT_NEAR(linear[i].x, expected, 1e-6f);
+
+        // Alpha is not encoded
+        EXPECT_FLOAT_EQ(linear[i].w, static_cast<float>(srgb8[i].w));
+    }
+
+    // Round trip
+
+    std::vector<unorm8_4> srgb8_cpy(linear.size());
+
+    swizzle(srgb8_cpy.data(), PF_RGBA8, linear.data(), PF_RGBA32F, srgb8_cpy.size(), EncodeSRGB);
+
+    for (size_t i = 0; i < srgb8.size(); ++i)
+    {
+        EXPECT_EQ(srgb8_cpy[i].x.value, srgb8[i].x.value);
+        EXPECT_EQ(srgb8_cpy[i].y.value, srgb8[i].y.value);
+        EXPECT_EQ(srgb8_cpy[i].z.value, srgb8[i].z.value);
+        EXPECT_EQ(srgb8_cpy[i].w.value, srgb8[i].w.value);
+    }
+
+    // Values between the codes and outside [0..1] (SIMD path) match the nearest code search
+
+    std::vector<vec4> sweep(4099);
+
+    for (size_t i = 0; i < sweep.size(); ++i)
+    {
+        float f = static_cast<float>(i) / (sweep.size() - 1) * 1.2f - 0.1f;
+        sweep[i] = vec4(f, f * f, 1.0f - f, 1.0f);
+    }
+
+    std::vector<unorm8_4> sweep8(sweep.size());
+
+    swizzle(sweep8.data(), PF_RGBA8, sweep.data(), PF_RGBA32F, sweep8.size(), EncodeSRGB);
+
+    auto const& tables = detail::get_srgb8_tables();
+
+    for (size_t i = 0; i < sweep.size(); ++i)
+    {
+        EXPECT_EQ(sweep8[i].x.value, detail::linear_to_srgb8(tables, sweep[i].x));
+        EXPECT_EQ(sweep8[i].y.value, detail::linear_to_srgb8(tables, sweep[i].y));
+        EXPECT_EQ(sweep8[i].z.value, detail::linear_to_srgb8(tables, sweep[i].z));
+    }
+
+    // Middle gray
+
+    vec4 gray(0.5f);
+    unorm8_4 gray8;
+    swizzle(&gray8, PF_RGBA8, &gray, PF_RGBA32F, 1, EncodeSRGB);
+    EXPECT_EQ(gray8.x.value, 188);
+}
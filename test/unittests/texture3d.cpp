@@ -0,0 +1,428 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <cstddef>
+#include <vector>
+
+#include <visionaray/detail/thread_pool.h>
+#include <visionaray/math/math.h>
+#include <visionaray/texture/texture.h>
+#include <visionaray/random_generator.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+template <typename T, typename Func>
+static std::vector<T> make_voxels(int w, int h, int d, Func func)
+{
+    std::vector<T> data(w * h * d);
+
+    for (int z = 0; z < d; ++z)
+    {
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                data[(z * h + y) * w + x] = func(x, y, z);
+            }
+        }
+    }
+
+    return data;
+}
+
+static tex_filter_mode const filter_modes[] = { Nearest, Linear, BSpline, CardinalSpline };
+static tex_address_mode const address_modes[] = { Clamp, Wrap, Mirror };
+
+
+//-------------------------------------------------------------------------------------------------
+// Test conversion between row major and bricked storage
+//
+
+TEST(Texture3D, BrickedStorage)
+{
+    // Not a multiple of the brick size
+    const int w = 13;
+    const int h = 10;
+    const int d = 9;
+
+    auto data = make_voxels<float>(w, h, d, [](int x, int y, int z) { return float(x + 100 * y + 10000 * z); });
+
+    texture<float, 3> tex(w, h, d);
+    EXPECT_EQ(tex.get_storage_layout(), RowMajor);
+
+    tex.set_storage_layout(Bricked);
+    tex.reset(data.data());
+
+    EXPECT_EQ(tex.get_storage_layout(), Bricked);
+
+    auto const& ctex = tex;
+
+    for (int z = 0; z < d; ++z)
+    {
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                EXPECT_FLOAT_EQ(ctex(x, y, z), data[(z * h + y) * w + x]);
+            }
+        }
+    }
+
+    // Voxels of a brick are contiguous
+    EXPECT_FLOAT_EQ(tex.data()[0], ctex(0, 0, 0));
+    EXPECT_FLOAT_EQ(tex.data()[7], ctex(7, 0, 0));
+    EXPECT_FLOAT_EQ(tex.data()[8], ctex(0, 1, 0));
+    EXPECT_FLOAT_EQ(tex.data()[64], ctex(0, 0, 1));
+    EXPECT_FLOAT_EQ(tex.data()[512], ctex(8, 0, 0));
+
+    // Refs share the layout
+    texture_ref<float, 3> const ref(tex);
+    EXPECT_EQ(ref.get_storage_layout(), Bricked);
+    EXPECT_FLOAT_EQ(ref(12, 9, 8), data[(8 * h + 9) * w + 12]);
+
+    // Round trip
+    tex.set_storage_layout(RowMajor);
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        EXPECT_FLOAT_EQ(tex.data()[i], data[i]);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test converting pixel formats into bricked storage
+//
+
+TEST(Texture3D, BrickedSwizzle)
+{
+    const int w = 11;
+    const int h = 9;
+    const int d = 10;
+
+    using rgb8 = vector<3, unorm<8>>;
+    using rgba8 = vector<4, unorm<8>>;
+
+    auto data = make_voxels<vec4>(w, h, d, [](int x, int y, int z)
+    {
+        return vec4(x / 255.0f, y / 255.0f, z / 255.0f, 0.0f);
+    });
+
+    std::vector<rgb8> data_rgb(data.begin(), data.end());
+
+    texture<rgba8, 3> tex(w, h, d);
+    tex.set_storage_layout(Bricked);
+    tex.reset(data.data(), PF_RGBA32F, PF_RGBA8);
+
+    texture<rgba8, 3> tex_hint(w, h, d);
+    tex_hint.set_storage_layout(Bricked);
+    tex_hint.reset(data_rgb.data(), PF_RGB8, PF_RGBA8, AlphaIsOne);
+
+    auto const& ctex = tex;
+    auto const& ctex_hint = tex_hint;
+
+    for (int z = 0; z < d; ++z)
+    {
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                vec4 v = vec4(ctex(x, y, z));
+                EXPECT_FLOAT_EQ(v.x, x / 255.0f);
+                EXPECT_FLOAT_EQ(v.y, y / 255.0f);
+                EXPECT_FLOAT_EQ(v.z, z / 255.0f);
+                EXPECT_FLOAT_EQ(v.w, 0.0f);
+
+                vec4 vh = vec4(ctex_hint(x, y, z));
+                EXPECT_FLOAT_EQ(vh.x, x / 255.0f);
+                EXPECT_FLOAT_EQ(vh.y, y / 255.0f);
+                EXPECT_FLOAT_EQ(vh.z, z / 255.0f);
+                EXPECT_FLOAT_EQ(vh.w, 1.0f);
+            }
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that converting pixel formats on a thread pool yields the same textures
+//
+
+TEST(Texture3D, PooledReset)
+{
+    // Large enough to be converted in parallel chunks
+    const int w = 128;
+    const int h = 96;
+    const int d = 90;
+
+    using rgb8 = vector<3, unorm<8>>;
+    using rgba8 = vector<4, unorm<8>>;
+
+    auto data = make_voxels<vec4>(w, h, d, [](int x, int y, int z)
+    {
+        return vec4(x / 127.0f, y / 95.0f, z / 89.0f, (x + y + z) % 7 / 6.0f);
+    });
+
+    std::vector<rgb8> data_rgb(data.begin(), data.end());
+    std::vector<rgba8> data_bgra(data.begin(), data.end());
+
+    thread_pool pool(4);
+
+    for (auto layout : { RowMajor, Bricked })
+    {
+        texture<rgba8, 3> serial(w, h, d);
+        texture<rgba8, 3> pooled(w, h, d);
+        serial.set_storage_layout(layout);
+        pooled.set_storage_layout(layout);
+
+        auto expect_equal = [&]()
+        {
+            auto const& a = serial;
+            auto const& b = pooled;
+
+            for (int z = 0; z < d; ++z)
+            {
+                for (int y = 0; y < h; ++y)
+                {
+                    for (int x = 0; x < w; ++x)
+                    {
+                        ASSERT_EQ(vec4(a(x, y, z)), vec4(b(x, y, z)));
+                    }
+                }
+            }
+        };
+
+        serial.reset(data.data(), PF_RGBA32F, PF_RGBA8);
+        pooled.reset(data.data(), PF_RGBA32F, PF_RGBA8, pool);
+        expect_equal();
+
+        serial.reset(data_rgb.data(), PF_RGB8, PF_RGBA8, AlphaIsOne);
+        pooled.reset(data_rgb.data(), PF_RGB8, PF_RGBA8, AlphaIsOne, pool);
+        expect_equal();
+
+        serial.reset(data_bgra.data(), PF_BGRA8, PF_RGBA8);
+        pooled.reset(data_bgra.data(), PF_BGRA8, PF_RGBA8, pool);
+        expect_equal();
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that all filters return the same values for both layouts
+//
+
+TEST(Texture3D, BrickedFiltering)
+{
+    const int w = 19;
+    const int h = 8;
+    const int d = 11;
+
+    auto scalars = make_voxels<float>(w, h, d, [](int x, int y, int z) { return float((x * 7 + y * 13 + z * 5) % 17); });
+    auto vectors = make_voxels<vec4>(w, h, d, [](int x, int y, int z) { return vec4(float(x), float(y), float(z), 1.0f); });
+    auto unorms  = make_voxels<unorm<8>>(w, h, d, [](int x, int y, int z) { return unorm<8>(((x + y * z) % 9) / 8.0f); });
+
+    texture<float, 3>    scalar_row_major(w, h, d);
+    texture<float, 3>    scalar_bricked(w, h, d);
+    texture<vec4, 3>     vector_row_major(w, h, d);
+    texture<vec4, 3>     vector_bricked(w, h, d);
+    texture<unorm<8>, 3> unorm_row_major(w, h, d);
+    texture<unorm<8>, 3> unorm_bricked(w, h, d);
+
+    scalar_row_major.reset(scalars.data());
+    vector_row_major.reset(vectors.data());
+    unorm_row_major.reset(unorms.data());
+
+    scalar_bricked.set_storage_layout(Bricked);
+    scalar_bricked.reset(scalars.data());
+    vector_bricked.set_storage_layout(Bricked);
+    vector_bricked.reset(vectors.data());
+
+    // Convert existing data
+    unorm_bricked.reset(unorms.data());
+    unorm_bricked.set_storage_layout(Bricked);
+
+    random_generator<float> gen(3);
+
+    for (auto filter_mode : filter_modes)
+    {
+        for (auto address_mode : address_modes)
+        {
+            scalar_row_major.set_filter_mode(filter_mode);
+            scalar_bricked.set_filter_mode(filter_mode);
+            vector_row_major.set_filter_mode(filter_mode);
+            vector_bricked.set_filter_mode(filter_mode);
+            unorm_row_major.set_filter_mode(filter_mode);
+            unorm_bricked.set_filter_mode(filter_mode);
+
+            scalar_row_major.set_address_mode(address_mode);
+            scalar_bricked.set_address_mode(address_mode);
+            vector_row_major.set_address_mode(address_mode);
+            vector_bricked.set_address_mode(address_mode);
+            unorm_row_major.set_address_mode(address_mode);
+            unorm_bricked.set_address_mode(address_mode);
+
+            for (int i = 0; i < 100; ++i)
+            {
+                // Also sample outside [0,1) to exercise the address modes
+                vec3 coord(
+                        gen.next() * 1.4f - 0.2f,
+                        gen.next() * 1.4f - 0.2f,
+                        gen.next() * 1.4f - 0.2f
+                        );
+
+                EXPECT_FLOAT_EQ(tex3D(scalar_bricked, coord), tex3D(scalar_row_major, coord));
+                EXPECT_FLOAT_EQ(tex3D(unorm_bricked, coord), tex3D(unorm_row_major, coord));
+
+                vec4 vb = tex3D(vector_bricked, coord);
+                vec4 vr = tex3D(vector_row_major, coord);
+
+                EXPECT_FLOAT_EQ(vb.x, vr.x);
+                EXPECT_FLOAT_EQ(vb.y, vr.y);
+                EXPECT_FLOAT_EQ(vb.z, vr.z);
+            }
+
+            // SIMD coordinates
+            for (int i = 0; i < 25; ++i)
+            {
+                vector<3, simd::float4> coord(
+                        simd::float4(gen.next(), gen.next(), gen.next(), gen.next()),
+                        simd::float4(gen.next(), gen.next(), gen.next(), gen.next()),
+                        simd::float4(gen.next(), gen.next(), gen.next(), gen.next())
+                        );
+
+                simd::aligned_array_t<simd::float4> sb;
+                simd::aligned_array_t<simd::float4> sr;
+
+                store(sb, tex3D(scalar_bricked, coord));
+                store(sr, tex3D(scalar_row_major, coord));
+
+                for (int j = 0; j < 4; ++j)
+                {
+                    EXPECT_FLOAT_EQ(sb[j], sr[j]);
+                }
+            }
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test volume pyramid generation and sampling with level of detail
+//
+
+TEST(Texture3D, Mipmaps)
+{
+    const int w = 16;
+    const int h = 9;
+    const int d = 6;
+
+    auto data = make_voxels<float>(w, h, d, [](int x, int y, int z) { return float((x * 7 + y * 13 + z * 5) % 17); });
+
+    texture<float, 3> tex(w, h, d);
+    tex.reset(data.data());
+    tex.set_filter_mode(Linear);
+    tex.set_address_mode(Clamp);
+
+    EXPECT_EQ(tex.num_levels(), 1U);
+
+    tex.generate_mipmaps();
+
+    // 16x9x6, 8x4x3, 4x2x1, 2x1x1, 1x1x1
+    ASSERT_EQ(tex.num_levels(), 5U);
+    EXPECT_EQ(tex.level_width(1), size_t(8));
+    EXPECT_EQ(tex.level_height(1), size_t(4));
+    EXPECT_EQ(tex.level_depth(1), size_t(3));
+    EXPECT_EQ(tex.level_depth(2), size_t(1));
+
+    // Box filter preserves the mean
+    double mean = 0.0;
+
+    for (float v : data)
+    {
+        mean += v;
+    }
+
+    mean /= data.size();
+
+    for (unsigned l = 1; l < tex.num_levels(); ++l)
+    {
+        size_t n = tex.level_width(l) * tex.level_height(l) * tex.level_depth(l);
+
+        double level_mean = 0.0;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            level_mean += tex.level_data(l)[i];
+        }
+
+        EXPECT_NEAR(level_mean / n, mean, 1e-4);
+    }
+
+    // Box filter weights for odd sizes
+    // (2,0,1) in level 1 covers x = 4..5, y = 0..2 (9 -> 4), z = 2..3
+    float covered = 0.0f;
+    float weights[3] = { 4.0f / 9.0f, 4.0f / 9.0f, 1.0f / 9.0f };
+
+    for (int z = 2; z < 4; ++z)
+    {
+        for (int y = 0; y < 3; ++y)
+        {
+            for (int x = 4; x < 6; ++x)
+            {
+                covered += data[(z * h + y) * w + x] * weights[y] * 0.25f;
+            }
+        }
+    }
+
+    EXPECT_FLOAT_EQ(tex.level_data(1)[(1 * 4 + 0) * 8 + 2], covered);
+
+    // Parallel generation and bricked textures yield the same pyramid
+    thread_pool pool(4);
+
+    texture<float, 3> parallel(w, h, d);
+    parallel.reset(data.data());
+    parallel.generate_mipmaps(pool);
+
+    texture<float, 3> bricked(w, h, d);
+    bricked.set_storage_layout(Bricked);
+    bricked.reset(data.data());
+    bricked.set_filter_mode(Linear);
+    bricked.set_address_mode(Clamp);
+    bricked.generate_mipmaps();
+
+    size_t chain = detail::mip_chain_size(w, h, d, tex.num_levels());
+
+    for (size_t i = 0; i < chain; ++i)
+    {
+        EXPECT_FLOAT_EQ(parallel.mip_data()[i], tex.mip_data()[i]);
+        EXPECT_FLOAT_EQ(bricked.mip_data()[i], tex.mip_data()[i]);
+    }
+
+    // Sampling
+    texture_ref<float, 3> ref(tex);
+    EXPECT_EQ(ref.num_levels(), tex.num_levels());
+
+    random_generator<float> gen(11);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        vec3 coord(gen.next(), gen.next(), gen.next());
+
+        EXPECT_FLOAT_EQ(tex3D(ref, coord, 0.0f), tex3D(ref, coord));
+        EXPECT_FLOAT_EQ(tex3D(bricked, coord, 0.0f), tex3D(ref, coord));
+        EXPECT_FLOAT_EQ(tex3D(bricked, coord, 1.5f), tex3D(ref, coord, 1.5f));
+
+        // Fractional levels interpolate, levels beyond the coarsest are clamped
+        float s1 = tex3D(ref, coord, 1.0f);
+        float s2 = tex3D(ref, coord, 2.0f);
+        EXPECT_NEAR(tex3D(ref, coord, 1.25f), s1 * 0.75f + s2 * 0.25f, 1e-4f);
+        EXPECT_FLOAT_EQ(tex3D(ref, coord, 10.0f), tex.level_data(4)[0]);
+    }
+}
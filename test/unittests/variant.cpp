@@ -111,3 +111,69 @@ TEST(VariantTest, General)
 
     EXPECT_STREQ( str1.c_str(), str2.c_str() );
 }
+
+
+//-------------------------------------------------------------------------------------------------
+// Test dispatch for variants with many alternatives
+//
+
+template <int I>
+struct tagged
+{
+    int value;
+};
+
+struct tag_visitor
+{
+    using return_type = int;
+
+    template <int I>
+    int operator()(tagged<I> const& t) const
+    {
+        return I * 100 + t.value;
+    }
+};
+
+template <typename Variant, int I>
+static void check_alternative()
+{
+    Variant var = tagged<I>{ I };
+    EXPECT_EQ( var.which(), static_cast<unsigned>(I + 1) );
+    EXPECT_EQ( apply_visitor( tag_visitor(), var ), I * 100 + I );
+    EXPECT_EQ( apply_visitor_as<tagged<I>>( tag_visitor(), var ), I * 100 + I );
+}
+
+TEST(VariantTest, Dispatch)
+{
+    // Jump table
+
+    using variant5 = variant<tagged<0>, tagged<1>, tagged<2>, tagged<3>, tagged<4>>;
+
+    check_alternative<variant5, 0>();
+    check_alternative<variant5, 2>();
+    check_alternative<variant5, 4>();
+
+
+    // More alternatives than switch cases
+
+    using variant18 = variant<
+            tagged<0>, tagged<1>, tagged<2>, tagged<3>, tagged<4>, tagged<5>,
+            tagged<6>, tagged<7>, tagged<8>, tagged<9>, tagged<10>, tagged<11>,
+            tagged<12>, tagged<13>, tagged<14>, tagged<15>, tagged<16>, tagged<17>
+            >;
+
+    check_alternative<variant18, 0>();
+    check_alternative<variant18, 15>();
+    check_alternative<variant18, 16>();
+    check_alternative<variant18, 17>();
+
+
+    // Single alternative
+
+    check_alternative<variant<tagged<0>>, 0>();
+
+
+    // Compact type tag
+
+    EXPECT_EQ( sizeof(variant<int, float>), 2 * sizeof(int) );
+}
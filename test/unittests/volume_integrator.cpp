@@ -0,0 +1,515 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <vector>
+
+#include <visionaray/detail/thread_pool.h>
+#include <visionaray/math/math.h>
+#include <visionaray/texture/texture.h>
+#include <visionaray/preintegration.h>
+#include <visionaray/random_generator.h>
+#include <visionaray/volume_integrator.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+// Two blobs with values in (0.5,1], low noise elsewhere
+static texture<float, 3> make_volume(int size)
+{
+    std::vector<float> data(size * size * size);
+
+    for (int z = 0; z < size; ++z)
+    {
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                vec3 p = (vec3(x, y, z) + vec3(0.5f)) / static_cast<float>(size);
+                float r1 = length(p - vec3(0.3f, 0.4f, 0.5f));
+                float r2 = length(p - vec3(0.75f, 0.7f, 0.3f));
+                float noise = ((x * 7 + y * 3 + z * 5) % 10) * 0.01f;
+                float v = noise;
+                v = r1 < 0.2f ? 1.0f - r1 : v;
+                v = r2 < 0.1f ? 1.0f - r2 : v;
+                data[(z * size + y) * size + x] = v;
+            }
+        }
+    }
+
+    texture<float, 3> tex(size, size, size);
+    tex.reset(data.data());
+    tex.set_filter_mode(Linear);
+    tex.set_address_mode(Clamp);
+    return tex;
+}
+
+// Values decrease linearly with the distance to the center
+static texture<float, 3> make_smooth_volume(int size)
+{
+    std::vector<float> data(size * size * size);
+
+    for (int z = 0; z < size; ++z)
+    {
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                vec3 p = (vec3(x, y, z) + vec3(0.5f)) / static_cast<float>(size);
+                data[(z * size + y) * size + x] = max(1.0f - 2.0f * length(p - vec3(0.5f)), 0.0f);
+            }
+        }
+    }
+
+    texture<float, 3> tex(size, size, size);
+    tex.reset(data.data());
+    tex.set_filter_mode(Linear);
+    tex.set_address_mode(Clamp);
+    return tex;
+}
+
+// Transparent for values below 0.5
+static texture<vec4, 1> make_transfunc()
+{
+    std::vector<vec4> data = {
+        vec4(0.0f, 0.0f, 0.0f, 0.0f),
+        vec4(0.0f, 0.0f, 0.0f, 0.0f),
+        vec4(0.0f, 0.0f, 0.0f, 0.0f),
+        vec4(0.0f, 0.0f, 0.0f, 0.0f),
+        vec4(0.0f, 0.0f, 0.0f, 0.0f),
+        vec4(0.9f, 0.1f, 0.1f, 0.02f),
+        vec4(0.9f, 0.8f, 0.1f, 0.05f),
+        vec4(0.1f, 0.9f, 0.1f, 0.1f),
+        vec4(0.1f, 0.1f, 0.9f, 0.2f),
+        vec4(1.0f, 1.0f, 1.0f, 0.3f)
+        };
+
+    texture<vec4, 1> tex(data.size());
+    tex.reset(data.data());
+    tex.set_filter_mode(Linear);
+    tex.set_address_mode(Clamp);
+    return tex;
+}
+
+// Fixed step ray marching without empty space skipping
+static vec4 march(
+        volume_integrator<float> const& integrator,
+        aabb const&                     bounds,
+        basic_ray<float> const&         ray
+        )
+{
+    vec4 result(0.0f);
+
+    auto hr = intersect(ray, bounds);
+
+    if (!hr.hit)
+    {
+        return result;
+    }
+
+    float t0 = max(0.0f, hr.tnear);
+
+    for (int k = 0; t0 + k * integrator.step_size() < hr.tfar; ++k)
+    {
+        integrator.composite(ray.ori + ray.dir * (t0 + k * integrator.step_size()), result);
+
+        if (result.w >= integrator.opacity_threshold())
+        {
+            break;
+        }
+    }
+
+    return result;
+}
+
+static basic_ray<float> random_ray(random_generator<float>& gen)
+{
+    vec3 ori(gen.next() * 6.0f - 3.0f, gen.next() * 6.0f - 3.0f, 3.0f);
+    vec3 target(gen.next() * 2.0f - 1.0f, gen.next() * 2.0f - 1.0f, gen.next() * 2.0f - 1.0f);
+    return basic_ray<float>(ori, normalize(target - ori));
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test macrocell value ranges and classification
+//
+
+TEST(VolumeIntegrator, Macrocells)
+{
+    auto volume = make_volume(40);
+    auto transfunc = make_transfunc();
+
+    macrocell_grid cells;
+    cells.build(volume, 8);
+
+    auto ref = cells.ref();
+    auto const& cvolume = volume;
+
+    ASSERT_EQ(ref.dims, vec3i(5, 5, 5));
+
+    // Unclassified grids are fully visible
+    EXPECT_FALSE(ref.empty(0, 0, 0));
+
+    // Value ranges contain all voxels of the cell
+    for (int z = 0; z < 8; ++z)
+    {
+        for (int y = 8; y < 16; ++y)
+        {
+            for (int x = 16; x < 24; ++x)
+            {
+                auto range = ref.value_range(2, 1, 0);
+                EXPECT_LE(range.x, cvolume(x, y, z));
+                EXPECT_GE(range.y, cvolume(x, y, z));
+            }
+        }
+    }
+
+    cells.classify(transfunc);
+    ref = cells.ref();
+
+    int num_empty = 0;
+
+    for (int z = 0; z < ref.dims.z; ++z)
+    {
+        for (int y = 0; y < ref.dims.y; ++y)
+        {
+            for (int x = 0; x < ref.dims.x; ++x)
+            {
+                vec2 range = ref.value_range(x, y, z);
+
+                // Values >= 0.45 may interpolate with the first visible entry
+                EXPECT_EQ(ref.empty(x, y, z), range.y < 0.45f);
+
+                num_empty += ref.empty(x, y, z) ? 1 : 0;
+            }
+        }
+    }
+
+    // Most of the volume is empty
+    EXPECT_GT(num_empty, ref.dims.x * ref.dims.y * ref.dims.z / 2);
+
+    // Center of the first blob
+    EXPECT_FALSE(ref.empty(1, 2, 2));
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that value ranges contain the overshoot of cardinal spline filtering
+//
+
+TEST(VolumeIntegrator, MacrocellsCardinalSpline)
+{
+    auto volume = make_volume(40);
+    volume.set_filter_mode(CardinalSpline);
+
+    macrocell_grid cells;
+    cells.build(volume, 8);
+
+    auto ref = cells.ref();
+    texture_ref<float, 3> volume_ref(volume);
+
+    random_generator<float> gen(7);
+
+    for (int i = 0; i < 20000; ++i)
+    {
+        vec3 coord(gen.next(), gen.next(), gen.next());
+        vec3i cell(coord * ref.cells_per_texcoord);
+        cell = min(cell, ref.dims - vec3i(1));
+
+        float v = tex3D(volume_ref, coord);
+        vec2 range = ref.value_range(cell.x, cell.y, cell.z);
+
+        EXPECT_LE(range.x, v + 1e-5f);
+        EXPECT_GE(range.y, v - 1e-5f);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test that empty space skipping yields the same result as fixed step ray marching
+//
+
+TEST(VolumeIntegrator, Integrate)
+{
+    auto volume = make_volume(40);
+    auto transfunc = make_transfunc();
+
+    macrocell_grid cells;
+    cells.build(volume, 8);
+    cells.classify(transfunc);
+
+    aabb bounds(vec3(-1.0f), vec3(1.0f));
+
+    volume_integrator<float> integrator;
+    integrator.set_volume(texture_ref<float, 3>(volume), cells.ref());
+    integrator.set_transfunc(texture_ref<vec4, 1>(transfunc));
+    integrator.set_bounds(bounds);
+    integrator.step_size() = 0.01f;
+
+    random_generator<float> gen(5);
+
+    for (int pass = 0; pass < 3; ++pass)
+    {
+        if (pass == 1)
+        {
+            // Opacity correction
+            integrator.reference_step_size() = 0.005f;
+        }
+        else if (pass == 2)
+        {
+            // Early ray termination
+            integrator.reference_step_size() = 0.0f;
+            integrator.opacity_threshold() = 0.3f;
+        }
+
+        int num_visible = 0;
+
+        for (int i = 0; i < 200; ++i)
+        {
+            auto ray = random_ray(gen);
+
+            vec4 expected = march(integrator, bounds, ray);
+            vec4 actual = integrator.integrate(ray, 0.0f, numeric_limits<float>::max());
+
+            EXPECT_NEAR(actual.x, expected.x, 1e-5f);
+            EXPECT_NEAR(actual.y, expected.y, 1e-5f);
+            EXPECT_NEAR(actual.z, expected.z, 1e-5f);
+            EXPECT_NEAR(actual.w, expected.w, 1e-5f);
+
+            num_visible += actual.w > 0.0f ? 1 : 0;
+
+            if (pass == 2)
+            {
+                EXPECT_LT(actual.w, 0.3f + 0.3f);
+            }
+        }
+
+        EXPECT_GT(num_visible, 10);
+    }
+
+
+    // SIMD lanes agree with the scalar implementation
+
+    integrator.opacity_threshold() = 0.999f;
+
+    basic_ray<float> rays[4] = { random_ray(gen), random_ray(gen), random_ray(gen), random_ray(gen) };
+    auto ray4 = simd::pack(rays[0], rays[1], rays[2], rays[3]);
+
+    auto c4 = integrator.integrate(ray4, simd::float4(0.0f), simd::float4(numeric_limits<float>::max()));
+
+    simd::aligned_array_t<simd::float4> r;
+    simd::aligned_array_t<simd::float4> a;
+    store(r, c4.x);
+    store(a, c4.w);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        auto c = integrator.integrate(rays[i], 0.0f, numeric_limits<float>::max());
+        EXPECT_FLOAT_EQ(r[i], c.x);
+        EXPECT_FLOAT_EQ(a[i], c.w);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test level of detail selection from ray differentials
+//
+
+TEST(VolumeIntegrator, LevelOfDetail)
+{
+    auto volume = make_volume(40);
+    auto transfunc = make_transfunc();
+
+    volume.generate_mipmaps();
+
+    // Unclassified, don't skip
+    macrocell_grid cells;
+    cells.build(volume, 8);
+
+    aabb bounds(vec3(-1.0f), vec3(1.0f));
+
+    volume_integrator<float> integrator;
+    integrator.set_volume(texture_ref<float, 3>(volume), cells.ref());
+    integrator.set_transfunc(texture_ref<vec4, 1>(transfunc));
+    integrator.set_bounds(bounds);
+    integrator.step_size() = 0.01f;
+
+    random_generator<float> gen(9);
+
+    // Differentials of zero width sample the finest level
+    for (int i = 0; i < 50; ++i)
+    {
+        auto ray = random_ray(gen);
+
+        vec4 expected = integrator.integrate(ray, 0.0f, numeric_limits<float>::max());
+        vec4 actual = integrator.integrate(ray_differential(ray), 0.0f, numeric_limits<float>::max());
+
+        EXPECT_NEAR(actual.x, expected.x, 1e-4f);
+        EXPECT_NEAR(actual.w, expected.w, 1e-4f);
+    }
+
+
+    // Homogeneous volume: opacity correction compensates for the larger steps
+
+    std::vector<float> constant(32 * 32 * 32, 0.5f);
+    texture<float, 3> homogeneous(32, 32, 32);
+    homogeneous.reset(constant.data());
+    homogeneous.set_filter_mode(Linear);
+    homogeneous.set_address_mode(Clamp);
+    homogeneous.generate_mipmaps();
+
+    std::vector<vec4> tf(4, vec4(1.0f, 1.0f, 1.0f, 0.02f));
+    texture<vec4, 1> homogeneous_tf(tf.size());
+    homogeneous_tf.reset(tf.data());
+    homogeneous_tf.set_filter_mode(Linear);
+    homogeneous_tf.set_address_mode(Clamp);
+
+    macrocell_grid homogeneous_cells;
+    homogeneous_cells.build(homogeneous, 8);
+    homogeneous_cells.classify(homogeneous_tf);
+
+    integrator.set_volume(texture_ref<float, 3>(homogeneous), homogeneous_cells.ref());
+    integrator.set_transfunc(texture_ref<vec4, 1>(homogeneous_tf));
+    integrator.reference_step_size() = 0.01f;
+    integrator.opacity_threshold() = 2.0f;
+
+    // Straight through the center, the ray travels 2 units through the volume
+    ray_differential ray(vec3(0.0f, 0.0f, 3.0f), vec3(0.0f, 0.0f, -1.0f));
+    ray.dddx = vec3(0.05f, 0.0f, 0.0f);
+    ray.dddy = vec3(0.0f, 0.05f, 0.0f);
+
+    float expected = 1.0f - pow(0.98f, 200.0f);
+
+    vec4 fine = integrator.integrate(static_cast<basic_ray<float> const&>(ray), 0.0f, numeric_limits<float>::max());
+    vec4 coarse = integrator.integrate(ray, 0.0f, numeric_limits<float>::max());
+
+    EXPECT_NEAR(fine.w, expected, 1e-3f);
+    EXPECT_NEAR(coarse.w, expected, 2e-3f);
+
+    // SIMD lanes agree with the scalar implementation
+    basic_ray_differential<simd::float4> ray4(
+            vector<3, simd::float4>(ray.ori),
+            vector<3, simd::float4>(ray.dir)
+            );
+    ray4.dddx = vector<3, simd::float4>(ray.dddx);
+    ray4.dddy = vector<3, simd::float4>(ray.dddy);
+
+    auto c4 = integrator.integrate(ray4, simd::float4(0.0f), simd::float4(numeric_limits<float>::max()));
+
+    simd::aligned_array_t<simd::float4> a;
+    store(a, c4.w);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_FLOAT_EQ(a[i], coarse.w);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test pre-integrated transfer functions
+//
+
+TEST(VolumeIntegrator, Preintegration)
+{
+    // Pre-integration assumes that values change linearly along segments
+    auto volume = make_smooth_volume(40);
+
+    // Narrow peak that large steps miss with post-classification
+    std::vector<vec4> tf(256, vec4(0.0f));
+    tf[128] = vec4(1.0f, 0.5f, 0.2f, 0.5f);
+    tf[129] = vec4(1.0f, 0.5f, 0.2f, 0.5f);
+
+    texture<vec4, 1> transfunc(tf.size());
+    transfunc.reset(tf.data());
+    transfunc.set_filter_mode(Linear);
+    transfunc.set_address_mode(Clamp);
+
+    texture<vec4, 2> table(128, 128);
+    preintegrate(table, transfunc, 2.0f);
+
+    // Parallel construction yields the same table
+    thread_pool pool(4);
+    texture<vec4, 2> parallel_table(128, 128);
+    preintegrate(parallel_table, transfunc, 2.0f, pool);
+
+    for (size_t i = 0; i < table.width() * table.height(); ++i)
+    {
+        EXPECT_FLOAT_EQ(parallel_table.data()[i].w, table.data()[i].w);
+    }
+
+    // Segments of constant value match post-classification with opacity correction
+    for (int i = 0; i < 128; ++i)
+    {
+        vec4 c = tex1D(transfunc, (i + 0.5f) / 128.0f);
+        float alpha = 1.0f - pow(1.0f - c.w, 2.0f);
+
+        vec4 entry = table.data()[i * 128 + i];
+        EXPECT_NEAR(entry.w, alpha, 1e-5f);
+        EXPECT_NEAR(entry.x, c.x * alpha, 1e-5f);
+    }
+
+    // Segments that cross the peak are visible although their ends are not
+    texture_ref<vec4, 2> table_ref(table);
+    EXPECT_GT(preintegrated_segment(table_ref, 0.45f, 0.55f).w, 0.05f);
+    EXPECT_GT(preintegrated_segment(table_ref, 0.55f, 0.45f).w, 0.05f);
+    EXPECT_FLOAT_EQ(preintegrated_segment(table_ref, 0.2f, 0.3f).w, 0.0f);
+
+
+    aabb bounds(vec3(-1.0f), vec3(1.0f));
+
+    macrocell_grid cells;
+    cells.build(volume, 8);
+
+    macrocell_grid classified_cells;
+    classified_cells.build(volume, 8);
+    classified_cells.classify(transfunc);
+
+    // Fine post-classified reference
+    volume_integrator<float> reference;
+    reference.set_volume(texture_ref<float, 3>(volume), classified_cells.ref());
+    reference.set_transfunc(texture_ref<vec4, 1>(transfunc));
+    reference.set_bounds(bounds);
+    reference.step_size() = 0.001f;
+    reference.reference_step_size() = 0.01f;
+
+    // Post-classified and pre-integrated with 20x the step size
+    volume_integrator<float> post = reference;
+    post.step_size() = 0.02f;
+
+    volume_integrator<float> pre = post;
+    pre.set_preintegration_table(table_ref);
+
+    // Pre-integrated w/o empty space skipping
+    volume_integrator<float> pre_no_skipping = pre;
+    pre_no_skipping.set_volume(texture_ref<float, 3>(volume), cells.ref());
+
+    random_generator<float> gen(13);
+
+    float post_error = 0.0f;
+    float pre_error = 0.0f;
+
+    for (int i = 0; i < 200; ++i)
+    {
+        auto ray = random_ray(gen);
+
+        vec4 expected = reference.integrate(ray, 0.0f, numeric_limits<float>::max());
+        vec4 p = post.integrate(ray, 0.0f, numeric_limits<float>::max());
+        vec4 q = pre.integrate(ray, 0.0f, numeric_limits<float>::max());
+        vec4 r = pre_no_skipping.integrate(ray, 0.0f, numeric_limits<float>::max());
+
+        EXPECT_NEAR(q.x, r.x, 1e-5f);
+        EXPECT_NEAR(q.w, r.w, 1e-5f);
+
+        post_error += abs(p.w - expected.w);
+        pre_error += abs(q.w - expected.w);
+    }
+
+    EXPECT_GT(post_error, 0.0f);
+    EXPECT_LT(pre_error, post_error * 0.25f);
+}
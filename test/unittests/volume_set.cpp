@@ -0,0 +1,234 @@
+// This file is distributed under the MIT license.
+// See the LICENSE file for details.
+
+#include <utility>
+#include <vector>
+
+#include <visionaray/math/math.h>
+#include <visionaray/random_generator.h>
+#include <visionaray/volume_set.h>
+
+#include <gtest/gtest.h>
+
+using namespace visionaray;
+
+
+//-------------------------------------------------------------------------------------------------
+// Helper functions
+//
+
+// Small, rotated and overlapping boxes in [-2,2]^3
+static std::vector<volume_box> make_boxes(int count, random_generator<float>& gen)
+{
+    std::vector<volume_box> boxes;
+
+    for (int i = 0; i < count; ++i)
+    {
+        vec3 size = vec3(gen.next(), gen.next(), gen.next()) * 0.5f + vec3(0.1f);
+        vec3 pos = vec3(gen.next(), gen.next(), gen.next()) * 3.0f - vec3(1.5f);
+        vec3 axis = normalize(vec3(gen.next(), gen.next(), gen.next()) - vec3(0.5f));
+
+        mat4 transform = mat4::identity();
+        transform = translate(transform, pos);
+        transform = rotate(transform, axis, gen.next() * constants::pi<float>());
+
+        boxes.emplace_back(aabb(-size, size), transform);
+    }
+
+    return boxes;
+}
+
+static basic_ray<float> random_ray(random_generator<float>& gen)
+{
+    vec3 ori = vec3(gen.next(), gen.next(), gen.next()) * 6.0f - vec3(3.0f);
+    vec3 target = vec3(gen.next(), gen.next(), gen.next()) * 3.0f - vec3(1.5f);
+    return basic_ray<float>(ori, normalize(target - ori));
+}
+
+using sample = std::pair<float, std::vector<int>>;
+
+// Samples and active volumes from march_volumes()
+static std::vector<sample> march(basic_ray<float> const& ray, volume_set_ref const& set, float dt, float& tnear)
+{
+    std::vector<sample> result;
+
+    march_volumes(ray, set, 0.0f, numeric_limits<float>::max(), dt, [&](float t, int const* volumes, int count)
+    {
+        result.emplace_back(t, std::vector<int>(volumes, volumes + count));
+        return true;
+    });
+
+    tnear = result.empty() ? 0.0f : result[0].first;
+    return result;
+}
+
+// Test all volumes at all samples between the first entry and the last exit
+static std::vector<sample> brute_force(
+        basic_ray<float> const&         ray,
+        std::vector<volume_box> const&  boxes,
+        float                           dt
+        )
+{
+    std::vector<sample> result;
+
+    std::vector<vec2> ranges;
+    float tmin = numeric_limits<float>::max();
+    float tmax = 0.0f;
+
+    for (auto const& box : boxes)
+    {
+        basic_ray<float> r;
+        r.ori = (box.transform_inv * vec4(ray.ori, 1.0f)).xyz();
+        r.dir = (box.transform_inv * vec4(ray.dir, 0.0f)).xyz();
+
+        auto hr = intersect(r, box.bounds);
+        vec2 range(max(hr.tnear, 0.0f), hr.tfar);
+
+        if (!hr.hit || range.x >= range.y)
+        {
+            range = vec2(numeric_limits<float>::max(), -numeric_limits<float>::max());
+        }
+
+        tmin = min(tmin, range.x);
+        tmax = max(tmax, range.y);
+        ranges.push_back(range);
+    }
+
+    for (float k = 0.0f; tmin + k * dt < tmax; k += 1.0f)
+    {
+        float t = tmin + k * dt;
+        std::vector<int> inside;
+
+        for (size_t i = 0; i < ranges.size(); ++i)
+        {
+            if (t >= ranges[i].x && t < ranges[i].y)
+            {
+                inside.push_back(static_cast<int>(i));
+            }
+        }
+
+        if (!inside.empty())
+        {
+            result.emplace_back(t, inside);
+        }
+    }
+
+    return result;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test interval marching against testing all volumes at every sample
+//
+
+TEST(VolumeSet, March)
+{
+    random_generator<float> gen(11);
+
+    for (int count : { 3, 40 })
+    {
+        auto boxes = make_boxes(count, gen);
+
+        volume_set set;
+        set.build(boxes.data(), boxes.size());
+
+        EXPECT_EQ(set.size(), size_t(count));
+        EXPECT_EQ(set.has_bvh(), count >= static_cast<int>(volume_set::min_bvh_volumes));
+
+        int num_hits = 0;
+
+        for (int i = 0; i < 300; ++i)
+        {
+            auto ray = random_ray(gen);
+
+            float tnear = 0.0f;
+            auto samples = march(ray, set.ref(), 0.05f, tnear);
+            auto expected = brute_force(ray, boxes, 0.05f);
+
+            ASSERT_EQ(samples.size(), expected.size());
+
+            for (size_t j = 0; j < samples.size(); ++j)
+            {
+                EXPECT_FLOAT_EQ(samples[j].first, expected[j].first);
+                EXPECT_EQ(samples[j].second, expected[j].second);
+            }
+
+            num_hits += samples.empty() ? 0 : 1;
+        }
+
+        EXPECT_GT(num_hits, 50);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Test intersection, clipping, and termination
+//
+
+TEST(VolumeSet, Intersect)
+{
+    // Three unit boxes along the x axis, the second one overlaps the first one
+    std::vector<volume_box> boxes = {
+            volume_box(aabb(vec3(-0.5f), vec3(0.5f)), translate(mat4::identity(), vec3(6.0f, 0.0f, 0.0f))),
+            volume_box(aabb(vec3(-0.5f), vec3(0.5f)), translate(mat4::identity(), vec3(0.0f, 0.0f, 0.0f))),
+            volume_box(aabb(vec3(-0.5f), vec3(0.5f)), translate(mat4::identity(), vec3(0.5f, 0.0f, 0.0f)))
+            };
+
+    volume_set set;
+    set.build(boxes.data(), boxes.size());
+
+    basic_ray<float> ray(vec3(-2.0f, 0.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f));
+
+    auto hits = intersect<8>(ray, set.ref(), 0.0f, 100.0f);
+    ASSERT_EQ(hits.size, 3);
+    EXPECT_EQ(hits.volume[0], 1);
+    EXPECT_EQ(hits.volume[1], 2);
+    EXPECT_EQ(hits.volume[2], 0);
+    EXPECT_FLOAT_EQ(hits.tnear[0], 1.5f);
+    EXPECT_FLOAT_EQ(hits.tfar[2], 8.5f);
+
+    // Clipped to [tmin,tmax)
+    hits = intersect<8>(ray, set.ref(), 1.8f, 2.2f);
+    ASSERT_EQ(hits.size, 2);
+    EXPECT_FLOAT_EQ(hits.tnear[0], 1.8f);
+    EXPECT_FLOAT_EQ(hits.tfar[1], 2.2f);
+
+    // The nearest volumes are kept
+    auto nearest = intersect<2>(ray, set.ref(), 0.0f, 100.0f);
+    ASSERT_EQ(nearest.size, 2);
+    EXPECT_EQ(nearest.volume[0], 1);
+    EXPECT_EQ(nearest.volume[1], 2);
+
+    // Gaps are skipped, samples at 1.5 + k * 0.25
+    std::vector<float> samples;
+    std::vector<int> counts;
+
+    bool hit = march_volumes(ray, set.ref(), 0.0f, 100.0f, 0.25f, [&](float t, int const* /* volumes */, int count)
+    {
+        samples.push_back(t);
+        counts.push_back(count);
+        return true;
+    });
+
+    EXPECT_TRUE(hit);
+    ASSERT_EQ(samples.size(), size_t(10));
+    EXPECT_FLOAT_EQ(samples[0], 1.5f);
+    EXPECT_FLOAT_EQ(samples[5], 2.75f);
+    EXPECT_FLOAT_EQ(samples[6], 7.5f);
+    EXPECT_EQ(counts[0], 1);
+    EXPECT_EQ(counts[2], 2);
+    EXPECT_EQ(counts[4], 1);
+    EXPECT_EQ(counts[6], 1);
+
+    // Early termination
+    int num_samples = 0;
+    march_volumes(ray, set.ref(), 0.0f, 100.0f, 0.25f, [&](float, int const*, int)
+    {
+        return ++num_samples < 3;
+    });
+    EXPECT_EQ(num_samples, 3);
+
+    // Miss
+    basic_ray<float> miss(vec3(-2.0f, 2.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f));
+    EXPECT_FALSE(march_volumes(miss, set.ref(), 0.0f, 100.0f, 0.25f, [](float, int const*, int) { return true; }));
+}